@@ -0,0 +1,134 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QFile>
+#include <QDir>
+#include "core/savemanager.h"
+#include "core/backupcatalog.h"
+#include "core/database.h"
+
+// Lists every backup of a large library, and the per-game totals the main
+// window shows in the game tree and storage summary, from the backups table
+// and from the sidecars alone.
+//
+//   ./bench_backupcatalog
+
+class BenchBackupCatalog : public QObject {
+    Q_OBJECT
+
+private:
+    static constexpr int GameCount = 500;
+    static constexpr int BackupsPerGame = 20;
+
+    QTemporaryDir m_tmpDir;
+    QString m_dbPath;
+
+    static QString gameId(int i)
+    {
+        return QString("game-%1").arg(i);
+    }
+
+    qsizetype listAll(SaveManager &mgr)
+    {
+        qsizetype total = 0;
+        for (int i = 0; i < GameCount; ++i)
+            total += mgr.getBackupsForGame(gameId(i)).size();
+        return total;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QDateTime base = QDateTime::currentDateTime();
+        for (int g = 0; g < GameCount; ++g) {
+            QString dir = m_tmpDir.path() + "/games/" + gameId(g);
+            QDir().mkpath(dir);
+            for (int b = 0; b < BackupsPerGame; ++b) {
+                BackupInfo backup;
+                backup.id = QString::number(1700000000000LL + b);
+                backup.gameId = gameId(g);
+                backup.gameName = "Game " + QString::number(g);
+                backup.displayName = "Backup " + QString::number(b);
+                backup.timestamp = base.addSecs(b);
+                backup.archivePath = dir + "/" + backup.id + ".tar.gz";
+                QFile sidecar(backup.archivePath + ".json");
+                if (!sidecar.open(QIODevice::WriteOnly))
+                    qFatal("Failed to write sidecar");
+                sidecar.write(QJsonDocument(BackupCatalog::toJson(backup)).toJson());
+            }
+        }
+
+        qputenv("XDG_DATA_HOME", (m_tmpDir.path() + "/data").toUtf8());
+        Database db;
+        QVERIFY(db.open());
+        m_dbPath = db.databasePath();
+    }
+
+    // Before the table is filled: every sidecar is parsed and imported once
+    void listAll_firstRun()
+    {
+        QBENCHMARK_ONCE {
+            SaveManager mgr;
+            mgr.setBackupDirectory(m_tmpDir.path());
+            mgr.setMetadataDatabase(m_dbPath);
+            QCOMPARE(listAll(mgr), qsizetype(GameCount * BackupsPerGame));
+        }
+    }
+
+    // New session: one readdir per game to sync, then one query per game
+    void listAll_coldCache()
+    {
+        QBENCHMARK {
+            SaveManager mgr;
+            mgr.setBackupDirectory(m_tmpDir.path());
+            mgr.setMetadataDatabase(m_dbPath);
+            QCOMPARE(listAll(mgr), qsizetype(GameCount * BackupsPerGame));
+        }
+    }
+
+    // Repeated refreshes within a session
+    void listAll_warmCache()
+    {
+        SaveManager mgr;
+        mgr.setBackupDirectory(m_tmpDir.path());
+        mgr.setMetadataDatabase(m_dbPath);
+        listAll(mgr);
+        QBENCHMARK {
+            QCOMPARE(listAll(mgr), qsizetype(GameCount * BackupsPerGame));
+        }
+    }
+
+    // No database: every sidecar is parsed
+    void listAll_sidecarsOnly()
+    {
+        QBENCHMARK_ONCE {
+            SaveManager mgr;
+            mgr.setBackupDirectory(m_tmpDir.path());
+            QCOMPARE(listAll(mgr), qsizetype(GameCount * BackupsPerGame));
+        }
+    }
+
+    // Count, size and last backup of every game, as the game tree needs
+    void summaries_indexed()
+    {
+        SaveManager mgr;
+        mgr.setBackupDirectory(m_tmpDir.path());
+        mgr.setMetadataDatabase(m_dbPath);
+        QCOMPARE(mgr.getBackupTotals().count, GameCount * BackupsPerGame);
+        QBENCHMARK {
+            QCOMPARE(mgr.getBackupSummaries().size(), GameCount);
+        }
+    }
+
+    void summaries_sidecarsOnly()
+    {
+        QBENCHMARK_ONCE {
+            SaveManager mgr;
+            mgr.setBackupDirectory(m_tmpDir.path());
+            QCOMPARE(mgr.getBackupSummaries().size(), GameCount);
+        }
+    }
+};
+
+QTEST_MAIN(BenchBackupCatalog)
+#include "bench_backupcatalog.moc"
@@ -0,0 +1,210 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QFile>
+#include <QDir>
+#include <limits>
+#include "core/batchfilereader.h"
+#include "core/dirwalker.h"
+#include "core/gameinfo.h"
+#include "core/savemanager.h"
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Reads a save tree of many small files (default 20000 files of 1-16 KiB,
+// GAME_REWIND_BENCH_FILES to change) the way tar backups do: every file in
+// walk order, start to end. Compares the QFile loop backups used before with
+// BatchFileReader reading directly and through io_uring, then whole tar.zst
+// backups with and without batched reads.
+//
+// Every round starts on a cold page cache: the tree's pages are dropped with
+// posix_fadvise first. That leaves inodes and dentries cached; for a fully
+// cold run, as root:
+//
+//   GAME_REWIND_BENCH_DROP_CACHES=1 ./bench_batchread
+//
+// which writes /proc/sys/vm/drop_caches before each round instead.
+// GAME_REWIND_BENCH_SAVES benchmarks a real save directory.
+
+class BenchBatchRead : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+    QString m_saveDir;
+    QStringList m_paths;
+    QList<qint64> m_sizes;
+    qint64 m_treeBytes = 0;
+    int m_run = 0;
+
+    void generateTree(int fileCount)
+    {
+        QRandomGenerator rng(20);
+        for (int i = 0; i < fileCount; ++i) {
+            if (i % 200 == 0)
+                QDir().mkpath(QString("%1/slot%2/chunks%3").arg(m_saveDir).arg(i / 4000).arg(i / 200 % 20));
+            QByteArray data(rng.bounded(1024, 16 * 1024), Qt::Uninitialized);
+            for (qsizetype j = 0; j < data.size(); ++j)
+                data[j] = char(rng.bounded(32) + 'A');
+            QFile f(QString("%1/slot%2/chunks%3/c_%4.dat").arg(m_saveDir).arg(i / 4000).arg(i / 200 % 20).arg(i));
+            if (!f.open(QIODevice::WriteOnly))
+                qFatal("Failed to write benchmark file");
+            f.write(data);
+        }
+    }
+
+    void dropCaches()
+    {
+#ifdef Q_OS_LINUX
+        if (qEnvironmentVariableIsSet("GAME_REWIND_BENCH_DROP_CACHES")) {
+            ::sync();
+            QFile drop("/proc/sys/vm/drop_caches");
+            if (drop.open(QIODevice::WriteOnly) && drop.write("3\n") == 2)
+                return;
+            qWarning("Cannot write drop_caches, falling back to posix_fadvise");
+        }
+#endif
+#ifdef Q_OS_UNIX
+        for (const QString &path : m_paths) {
+            int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                continue;
+            ::fdatasync(fd);
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+#endif
+    }
+
+    // The loop addFileToArchive used before BatchFileReader
+    qint64 readQFile(qint64 bufferSize)
+    {
+        QByteArray buf(bufferSize, Qt::Uninitialized);
+        qint64 total = 0;
+        for (const QString &path : m_paths) {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly))
+                continue;
+            qint64 n;
+            while ((n = file.read(buf.data(), bufferSize)) > 0)
+                total += n;
+        }
+        return total;
+    }
+
+    // Keeps the queue full the way addDirectoryToArchive does
+    qint64 readBatched(bool useIoUring)
+    {
+        BatchFileReader reader(useIoUring);
+        qint64 total = 0;
+        auto sink = [&total](const char *, qsizetype size) {
+            total += size;
+            return true;
+        };
+        for (int i = 0; i < m_paths.size(); ++i) {
+            reader.enqueue(m_paths.at(i), m_sizes.at(i));
+            while (reader.pending() > reader.queueDepth())
+                reader.readNext(sink);
+        }
+        while (reader.pending() > 0)
+            reader.readNext(sink);
+        return total;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_saveDir = qEnvironmentVariable("GAME_REWIND_BENCH_SAVES");
+        if (m_saveDir.isEmpty()) {
+            bool ok = false;
+            int files = qEnvironmentVariableIntValue("GAME_REWIND_BENCH_FILES", &ok);
+            m_saveDir = m_tmpDir.path() + "/saves";
+            generateTree(ok && files > 0 ? files : 20000);
+        }
+        DirWalker::walk(m_saveDir, [this](const DirWalker::Entry &entry) {
+            if (entry.type == DirWalker::File) {
+                m_paths.append(entry.filePath());
+                m_sizes.append(entry.size);
+                m_treeBytes += entry.size;
+            }
+            return DirWalker::Continue;
+        }, DirWalker::DirsFirst);
+        QVERIFY(!m_paths.isEmpty());
+        qInfo("Save tree: %s, %lld files, %.1f MiB, io_uring %s", qPrintable(m_saveDir),
+              qint64(m_paths.size()), m_treeBytes / 1048576.0,
+              BatchFileReader::ioUringAvailable() ? "available" : "unavailable");
+    }
+
+    void read_data()
+    {
+        QTest::addColumn<QString>("method");
+        QTest::newRow("qfile-8k") << "qfile-8k";
+        QTest::newRow("qfile-64k") << "qfile-64k";
+        QTest::newRow("batch-direct") << "batch-direct";
+        QTest::newRow("batch-io_uring") << "batch-io_uring";
+    }
+
+    void read()
+    {
+        QFETCH(QString, method);
+        if (method == "batch-io_uring" && !BatchFileReader::ioUringAvailable())
+            QSKIP("io_uring is not available");
+
+        qint64 bestNs = std::numeric_limits<qint64>::max();
+        for (int round = 0; round < 3; ++round) {
+            dropCaches();
+            QElapsedTimer timer;
+            timer.start();
+            qint64 bytes = method == "qfile-8k"     ? readQFile(8 * 1024)
+                         : method == "qfile-64k"    ? readQFile(64 * 1024)
+                         : method == "batch-direct" ? readBatched(false)
+                                                    : readBatched(true);
+            bestNs = qMin(bestNs, timer.nsecsElapsed());
+            QCOMPARE(bytes, m_treeBytes);
+        }
+        qInfo("%-16s %8.1f ms  %7.1f us/file  %7.1f MiB/s", QTest::currentDataTag(), bestNs / 1e6,
+              bestNs / 1e3 / m_paths.size(), m_treeBytes / 1048576.0 / (bestNs / 1e9));
+        QTest::setBenchmarkResult(bestNs / 1e6, QTest::WalltimeMilliseconds);
+    }
+
+    void backup_data()
+    {
+        QTest::addColumn<bool>("batched");
+        QTest::newRow("backup-direct") << false;
+        QTest::newRow("backup-batched") << true;
+    }
+
+    // Fast compression, so reading the files is what the backup waits on
+    void backup()
+    {
+        QFETCH(bool, batched);
+
+        SaveManager mgr;
+        mgr.setBackupDirectory(m_tmpDir.path() + "/backups_" + QString::number(++m_run));
+        mgr.setBackupFormat("tar.zst");
+        mgr.setCompressionLevel(1);
+        mgr.setBatchedReads(batched);
+
+        GameInfo game;
+        game.id = "bench";
+        game.name = "Benchmark";
+        game.detectedSavePath = m_saveDir;
+        game.isDetected = true;
+
+        dropCaches();
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(mgr.createBackup(game));
+        qint64 ns = timer.nsecsElapsed();
+        qInfo("%-16s %8.1f ms  %7.1f us/file  %7.1f MiB/s", QTest::currentDataTag(), ns / 1e6,
+              ns / 1e3 / m_paths.size(), m_treeBytes / 1048576.0 / (ns / 1e9));
+        QTest::setBenchmarkResult(ns / 1e6, QTest::WalltimeMilliseconds);
+    }
+};
+
+QTEST_MAIN(BenchBatchRead)
+#include "bench_batchread.moc"
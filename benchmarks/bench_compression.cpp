@@ -0,0 +1,162 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QDirIterator>
+#include <QRandomGenerator>
+#include <QFile>
+#include <QDir>
+#include "core/savemanager.h"
+#include "core/gameinfo.h"
+
+// Compares backup formats and levels on a save tree.
+//
+// Set GAME_REWIND_BENCH_SAVES to a real save directory (e.g. a Minecraft or
+// Factorio world) to benchmark on real data; otherwise a synthetic tree with
+// a mix of structured, text and incompressible files is generated.
+//
+//   ./bench_compression                 # all rows
+//   ./bench_compression compress:zstd-3 # a single row
+
+class BenchCompression : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+    QString m_saveDir;
+    qint64 m_treeBytes = 0;
+    int m_run = 0;
+
+    static void writeFile(const QString &path, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write benchmark file");
+        f.write(data);
+    }
+
+    void generateSyntheticTree()
+    {
+        QRandomGenerator rng(42);
+
+        // Region files: fixed-size records with small per-record variation,
+        // similar to chunked world formats
+        for (int region = 0; region < 24; ++region) {
+            QByteArray data;
+            data.reserve(2 * 1024 * 1024);
+            while (data.size() < 2 * 1024 * 1024) {
+                QByteArray record(256, char(region));
+                for (int i = 0; i < 16; ++i)
+                    record[rng.bounded(256)] = char(rng.bounded(256));
+                data.append(record);
+            }
+            writeFile(QString("%1/world/region/r.%2.mca").arg(m_saveDir).arg(region), data);
+        }
+
+        // Text metadata and configs
+        QByteArray text;
+        for (int i = 0; i < 20000; ++i)
+            text.append(QString("{\"entity\":%1,\"x\":%2,\"y\":%3,\"tag\":\"npc\"}\n")
+                            .arg(i).arg(rng.bounded(10000)).arg(rng.bounded(10000)).toUtf8());
+        writeFile(m_saveDir + "/world/entities.json", text);
+        writeFile(m_saveDir + "/options.txt", text.left(4096));
+
+        // Already-compressed data (screenshots, thumbnails)
+        for (int shot = 0; shot < 4; ++shot) {
+            QByteArray noise(1024 * 1024, Qt::Uninitialized);
+            for (qsizetype i = 0; i < noise.size(); ++i)
+                noise[i] = char(rng.bounded(256));
+            writeFile(QString("%1/screenshots/%2.png").arg(m_saveDir).arg(shot), noise);
+        }
+    }
+
+    static qint64 treeSize(const QString &dir)
+    {
+        qint64 total = 0;
+        QDirIterator it(dir, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            total += it.fileInfo().size();
+        }
+        return total;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_saveDir = qEnvironmentVariable("GAME_REWIND_BENCH_SAVES");
+        if (m_saveDir.isEmpty()) {
+            m_saveDir = m_tmpDir.path() + "/saves";
+            generateSyntheticTree();
+        }
+        m_treeBytes = treeSize(m_saveDir);
+        QVERIFY(m_treeBytes > 0);
+        qInfo("Save tree: %s (%.1f MiB)", qPrintable(m_saveDir), m_treeBytes / 1048576.0);
+    }
+
+    void compress_data()
+    {
+        QTest::addColumn<QString>("format");
+        QTest::addColumn<int>("level");
+        QTest::addColumn<int>("threads");
+        QTest::addColumn<bool>("longDistance");
+
+        QTest::newRow("gzip-1") << "tar.gz" << 1 << 1 << false;
+        QTest::newRow("gzip-6") << "tar.gz" << 6 << 1 << false;
+        QTest::newRow("gzip-6-mt") << "tar.gz" << 6 << 0 << false;
+        QTest::newRow("gzip-9-mt") << "tar.gz" << 9 << 0 << false;
+        QTest::newRow("zstd-1") << "tar.zst" << 1 << 1 << false;
+        QTest::newRow("zstd-3") << "tar.zst" << 3 << 1 << false;
+        QTest::newRow("zstd-3-mt") << "tar.zst" << 3 << 0 << false;
+        QTest::newRow("zstd-9-mt") << "tar.zst" << 9 << 0 << false;
+        QTest::newRow("zstd-19-mt") << "tar.zst" << 19 << 0 << false;
+        QTest::newRow("zstd-19-mt-long") << "tar.zst" << 19 << 0 << true;
+        QTest::newRow("chunks-6") << "chunks" << 6 << 0 << false;
+    }
+
+    void compress()
+    {
+        QFETCH(QString, format);
+        QFETCH(int, level);
+        QFETCH(int, threads);
+        QFETCH(bool, longDistance);
+
+        SaveManager mgr;
+        mgr.setBackupDirectory(m_tmpDir.path() + "/backups_" + QString::number(++m_run));
+        mgr.setBackupFormat(format);
+        mgr.setCompressionLevel(level);
+        mgr.setCompressionThreads(threads);
+        mgr.setLongDistanceMatching(longDistance);
+        // Measure the levels and threads as named, not what the default
+        // memory budget allows of them
+        mgr.setMemoryBudget(4096LL * 1024 * 1024);
+
+        GameInfo game;
+        game.id = "bench";
+        game.name = "Benchmark";
+        game.detectedSavePath = m_saveDir;
+        game.isDetected = true;
+
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(mgr.createBackup(game));
+        qint64 backupMs = qMax<qint64>(1, timer.elapsed());
+
+        BackupInfo backup = mgr.getBackupsForGame("bench").first();
+
+        timer.restart();
+        QVERIFY(mgr.restoreBackup(backup, m_tmpDir.path() + "/restore_" + QString::number(m_run)));
+        qint64 restoreMs = qMax<qint64>(1, timer.elapsed());
+
+        double ratio = double(backup.size) / double(m_treeBytes);
+        qInfo("%-16s backup %7.1f MB/s  restore %7.1f MB/s  size %6.1f MiB  ratio %.3f",
+              QTest::currentDataTag(),
+              m_treeBytes / 1e3 / backupMs, m_treeBytes / 1e3 / restoreMs,
+              backup.size / 1048576.0, ratio);
+
+        QTest::setBenchmarkResult(m_treeBytes * 1000.0 / backupMs, QTest::BytesPerSecond);
+    }
+};
+
+QTEST_MAIN(BenchCompression)
+#include "bench_compression.moc"
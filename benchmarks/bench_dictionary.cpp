@@ -0,0 +1,258 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QDirIterator>
+#include <QRandomGenerator>
+#include <QFile>
+#include <QDir>
+#include <QSignalSpy>
+#include <zstd.h>
+#include "core/savemanager.h"
+#include "core/gameinfo.h"
+#include "core/zstddictionary.h"
+
+// Compression of small save files one at a time, as the chunk store does,
+// with and without a dictionary trained on an earlier copy of the saves.
+//
+// Set GAME_REWIND_BENCH_SAVES to a real save directory to benchmark on real
+// data; files up to ZstdDictionary::MaxSampleSize are used. Otherwise
+// synthetic JSON, XML and binary save slots of 2-50 KiB are generated. The
+// dictionary is trained on half of the files and measured on the other half,
+// so it never sees the exact data it compresses.
+//
+//   ./bench_dictionary                    # all rows
+//   ./bench_dictionary perFile:zstd-3-dict # a single row
+
+class BenchDictionary : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+    QString m_saveDir;
+    QList<QByteArray> m_trainFiles;
+    QList<QByteArray> m_testFiles;
+    qint64 m_testBytes = 0;
+    ZstdDictionary m_dictionary;
+
+    static void writeFile(const QString &path, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write benchmark file");
+        f.write(data);
+    }
+
+    void generateSyntheticTree()
+    {
+        QRandomGenerator rng(42);
+        const QStringList items = {"sword", "potion", "arrow", "shield", "torch", "ration", "key", "map"};
+
+        for (int i = 0; i < 200; ++i) {
+            // JSON slot: player state and inventory
+            QByteArray json = "{\n  \"version\": 12,\n  \"player\": {\"name\": \"Hero\", \"level\": ";
+            json += QByteArray::number(rng.bounded(99)) + ", \"inventory\": [\n";
+            int count = 40 + rng.bounded(600);
+            for (int n = 0; n < count; ++n) {
+                json += QString("    {\"id\": \"%1\", \"count\": %2, \"durability\": %3, \"quality\": \"%4\"},\n")
+                            .arg(items.at(rng.bounded(items.size()))).arg(rng.bounded(99))
+                            .arg(rng.bounded(1000)).arg(rng.bounded(2) ? "common" : "rare").toUtf8();
+            }
+            json += "  ]}\n}\n";
+            writeFile(QString("%1/slots/slot%2.json").arg(m_saveDir).arg(i), json);
+
+            // XML quest log
+            QByteArray xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<quests>\n";
+            int quests = 20 + rng.bounded(200);
+            for (int n = 0; n < quests; ++n) {
+                xml += QString("  <quest id=\"%1\" state=\"%2\" stage=\"%3\"/>\n")
+                           .arg(rng.bounded(5000)).arg(rng.bounded(2) ? "active" : "completed")
+                           .arg(rng.bounded(12)).toUtf8();
+            }
+            xml += "</quests>\n";
+            writeFile(QString("%1/quests/quests%2.xml").arg(m_saveDir).arg(i), xml);
+
+            // Binary slot: fixed header and records with a few varying fields
+            QByteArray bin("SAVE\x02\x00\x01\x00", 8);
+            int records = 100 + rng.bounded(1400);
+            for (int n = 0; n < records; ++n) {
+                QByteArray record(32, '\0');
+                record[0] = char(n & 0xff);
+                record[1] = char(0x40);
+                record[4] = char(rng.bounded(256));
+                record[5] = char(rng.bounded(16));
+                record[12] = char(rng.bounded(4));
+                bin += record;
+            }
+            writeFile(QString("%1/data/slot%2.bin").arg(m_saveDir).arg(i), bin);
+        }
+    }
+
+    void loadFiles()
+    {
+        QDirIterator it(m_saveDir, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        QStringList paths;
+        while (it.hasNext()) {
+            it.next();
+            if (it.fileInfo().size() > 0 && it.fileInfo().size() <= ZstdDictionary::MaxSampleSize)
+                paths.append(it.filePath());
+        }
+        paths.sort();
+        for (int i = 0; i < paths.size(); ++i) {
+            QFile f(paths.at(i));
+            if (!f.open(QIODevice::ReadOnly))
+                continue;
+            if (i % 2 == 0) {
+                m_trainFiles.append(f.readAll());
+            } else {
+                m_testFiles.append(f.readAll());
+                m_testBytes += m_testFiles.last().size();
+            }
+        }
+    }
+
+    void report(const char *tag, qint64 compressedBytes, qint64 compressNs, qint64 decompressNs)
+    {
+        double ratio = double(compressedBytes) / double(m_testBytes);
+        qInfo("%-18s compress %7.1f MB/s  decompress %7.1f MB/s  size %8.1f KiB  ratio %.3f",
+              tag, m_testBytes * 1e3 / qMax<qint64>(1, compressNs), m_testBytes * 1e3 / qMax<qint64>(1, decompressNs),
+              compressedBytes / 1024.0, ratio);
+        QTest::setBenchmarkResult(m_testBytes * 1e9 / qMax<qint64>(1, compressNs), QTest::BytesPerSecond);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_saveDir = qEnvironmentVariable("GAME_REWIND_BENCH_SAVES");
+        if (m_saveDir.isEmpty()) {
+            m_saveDir = m_tmpDir.path() + "/saves";
+            generateSyntheticTree();
+        }
+        loadFiles();
+        QVERIFY2(m_testFiles.size() >= ZstdDictionary::MinSamples, "Not enough small files in the save tree");
+
+        QElapsedTimer timer;
+        timer.start();
+        QString error;
+        m_dictionary = ZstdDictionary::train(m_trainFiles, ZstdDictionary::DefaultCapacity, &error);
+        QVERIFY2(!m_dictionary.isNull(), qPrintable(error));
+        qInfo("Save tree: %s, %lld small files (%.1f KiB tested)", qPrintable(m_saveDir),
+              qint64(m_trainFiles.size() + m_testFiles.size()), m_testBytes / 1024.0);
+        qInfo("Trained a %.1f KiB dictionary in %lld ms", m_dictionary.data().size() / 1024.0,
+              timer.elapsed());
+    }
+
+    void perFile_data()
+    {
+        QTest::addColumn<QString>("codec");
+        QTest::addColumn<int>("level");
+
+        QTest::newRow("zlib-6") << "zlib" << 6;
+        QTest::newRow("zlib-9") << "zlib" << 9;
+        QTest::newRow("zstd-3") << "zstd" << 3;
+        QTest::newRow("zstd-3-dict") << "zstd-dict" << 3;
+        QTest::newRow("zstd-9-dict") << "zstd-dict" << 9;
+        QTest::newRow("zstd-19-dict") << "zstd-dict" << 19;
+    }
+
+    void perFile()
+    {
+        QFETCH(QString, codec);
+        QFETCH(int, level);
+
+        QList<QByteArray> compressed;
+        qint64 compressedBytes = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (const QByteArray &file : std::as_const(m_testFiles)) {
+            QByteArray out;
+            if (codec == "zlib") {
+                out = qCompress(file, level);
+            } else if (codec == "zstd") {
+                out.resize(static_cast<qsizetype>(ZSTD_compressBound(file.size())));
+                out.resize(static_cast<qsizetype>(
+                    ZSTD_compress(out.data(), out.size(), file.constData(), file.size(), level)));
+            } else {
+                out = m_dictionary.compress(file.constData(), file.size(), level);
+            }
+            compressedBytes += out.size() + 1;  // with the chunk codec tag
+            compressed.append(out);
+        }
+        qint64 compressNs = timer.nsecsElapsed();
+
+        timer.restart();
+        for (int i = 0; i < compressed.size(); ++i) {
+            const QByteArray &frame = compressed.at(i);
+            QByteArray data;
+            if (codec == "zlib") {
+                data = qUncompress(frame);
+            } else if (codec == "zstd") {
+                data.resize(m_testFiles.at(i).size());
+                data.resize(static_cast<qsizetype>(
+                    ZSTD_decompress(data.data(), data.size(), frame.constData(), frame.size())));
+            } else {
+                data = m_dictionary.decompress(frame.constData(), frame.size(), m_testFiles.at(i).size());
+            }
+            QCOMPARE(data.size(), m_testFiles.at(i).size());
+        }
+        qint64 decompressNs = timer.nsecsElapsed();
+
+        report(QTest::currentDataTag(), compressedBytes, compressNs, decompressNs);
+    }
+
+    // The whole tree through the chunk store, as a second backup after the
+    // dictionary was trained on the first
+    void chunkBackup_data()
+    {
+        QTest::addColumn<bool>("dictionary");
+        QTest::newRow("chunks-6") << false;
+        QTest::newRow("chunks-6-dict") << true;
+    }
+
+    void chunkBackup()
+    {
+        QFETCH(bool, dictionary);
+
+        SaveManager mgr;
+        mgr.setBackupDirectory(m_tmpDir.path() + (dictionary ? "/backups_dict" : "/backups_plain"));
+
+        GameInfo game;
+        game.id = "bench";
+        game.name = "Benchmark";
+        game.detectedSavePath = m_saveDir;
+        game.isDetected = true;
+
+        if (dictionary) {
+            QVERIFY(mgr.createBackup(game, "Seed"));
+            QSignalSpy trainedSpy(&mgr, &SaveManager::dictionaryTrained);
+            QVERIFY(mgr.trainDictionaryAsync("bench") != 0);
+            QVERIFY(trainedSpy.wait(60000));
+        }
+
+        mgr.setBackupFormat("chunks");
+        qint64 treeBytes = 0;
+        QDirIterator it(m_saveDir, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            treeBytes += it.fileInfo().size();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(mgr.createBackup(game));
+        qint64 backupMs = qMax<qint64>(1, timer.elapsed());
+        BackupInfo backup = mgr.getBackupsForGame("bench").first();
+
+        timer.restart();
+        QVERIFY(mgr.restoreBackup(backup, m_tmpDir.path() + "/restore_" + QTest::currentDataTag()));
+        qint64 restoreMs = qMax<qint64>(1, timer.elapsed());
+
+        qInfo("%-18s backup %7.1f MB/s  restore %7.1f MB/s  size %8.1f KiB  ratio %.3f",
+              QTest::currentDataTag(), treeBytes / 1e3 / backupMs, treeBytes / 1e3 / restoreMs,
+              backup.size / 1024.0, double(backup.size) / double(treeBytes));
+        QTest::setBenchmarkResult(treeBytes * 1000.0 / backupMs, QTest::BytesPerSecond);
+    }
+};
+
+QTEST_MAIN(BenchDictionary)
+#include "bench_dictionary.moc"
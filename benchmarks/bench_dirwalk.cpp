@@ -0,0 +1,246 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <atomic>
+#include <limits>
+#include "core/dirwalker.h"
+#include "core/filemanifest.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+// Walks a large save tree (some modded games keep 100k files) the way
+// backups and change detection do: type, size, mtime and inode of every
+// entry and its path below the root.
+//
+// Set GAME_REWIND_BENCH_SAVES to a real save directory to walk real data;
+// otherwise a synthetic tree of GAME_REWIND_BENCH_FILES files (default
+// 100000, 100 per directory) is generated. Every row walks a warm cache.
+// Heap allocations are counted in-process on glibc; for syscall counts run
+// a single row under strace:
+//
+//   ./bench_dirwalk                                  # all rows
+//   strace -f -c ./bench_dirwalk walk:qdir-entryinfo # syscalls of one row
+//   strace -f -c ./bench_dirwalk walk:dirwalker
+
+#ifdef __GLIBC__
+namespace {
+std::atomic<qint64> s_allocations{0};
+}
+
+// Count every allocation, including Qt's, by interposing glibc's malloc
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+static qint64 allocationCount()
+{
+    return s_allocations.load(std::memory_order_relaxed);
+}
+#else
+static qint64 allocationCount()
+{
+    return -1;
+}
+#endif
+
+class BenchDirWalk : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+    QString m_saveDir;
+
+    // What the walks collect, so the compiler cannot drop the work
+    struct Totals {
+        qint64 entries = 0;
+        qint64 bytes = 0;
+        qint64 mtimes = 0;
+        quint64 inodes = 0;
+        qint64 pathChars = 0;
+    };
+
+    void generateTree(int fileCount)
+    {
+        const QByteArray data("{\"slot\":1,\"hp\":100}\n");
+        for (int i = 0; i < fileCount; ++i) {
+            if (i % 100 == 0)
+                QDir().mkpath(QString("%1/mod%2/data%3").arg(m_saveDir).arg(i / 10000).arg(i / 100 % 100));
+            QFile f(QString("%1/mod%2/data%3/asset_%4.json").arg(m_saveDir).arg(i / 10000).arg(i / 100 % 100).arg(i));
+            if (!f.open(QIODevice::WriteOnly))
+                qFatal("Failed to write benchmark file");
+            f.write(data);
+        }
+    }
+
+    // The pattern DirWalker replaced: QDir::entryInfoList per directory and
+    // an extra lstat per entry for the inode
+    static void walkEntryInfo(const QString &dir, const QString &relPath, Totals &t)
+    {
+        const QFileInfoList infos = QDir(dir).entryInfoList(
+            QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden | QDir::System, QDir::DirsFirst | QDir::Name);
+        for (const QFileInfo &fi : infos) {
+            QString entryPath = relPath.isEmpty() ? fi.fileName() : relPath + "/" + fi.fileName();
+            t.entries++;
+            t.pathChars += entryPath.size();
+            t.mtimes += fi.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+            struct stat st;
+            if (::lstat(QFile::encodeName(fi.absoluteFilePath()).constData(), &st) == 0)
+                t.inodes += quint64(st.st_ino);
+#endif
+            if (fi.isSymLink())
+                continue;
+            if (fi.isDir())
+                walkEntryInfo(fi.absoluteFilePath(), entryPath, t);
+            else if (fi.isFile())
+                t.bytes += fi.size();
+        }
+    }
+
+    static void walkIterator(const QString &root, Totals &t)
+    {
+        QDir rootDir(root);
+        QDirIterator it(root, QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden | QDir::System,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            QFileInfo fi = it.fileInfo();
+            t.entries++;
+            t.pathChars += rootDir.relativeFilePath(fi.filePath()).size();
+            t.mtimes += fi.lastModified().toMSecsSinceEpoch();
+            if (fi.isFile() && !fi.isSymLink())
+                t.bytes += fi.size();
+        }
+    }
+
+    static void walkDirWalker(const QString &root, bool paths, Totals &t)
+    {
+        DirWalker::walk(root, [&t, paths](const DirWalker::Entry &entry) {
+            t.entries++;
+            t.bytes += entry.size;
+            t.mtimes += entry.mtimeMs;
+            t.inodes += entry.inode;
+            if (paths)
+                t.pathChars += entry.relativePath().size();
+            return DirWalker::Continue;
+        }, DirWalker::DirsFirst);
+    }
+
+    void run(const QString &method, Totals &t)
+    {
+        if (method == "qdir-entryinfo") {
+            walkEntryInfo(m_saveDir, QString(), t);
+        } else if (method == "qdiriterator") {
+            walkIterator(m_saveDir, t);
+        } else if (method == "dirwalker") {
+            walkDirWalker(m_saveDir, false, t);
+        } else if (method == "dirwalker-paths") {
+            walkDirWalker(m_saveDir, true, t);
+        }
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_saveDir = qEnvironmentVariable("GAME_REWIND_BENCH_SAVES");
+        if (m_saveDir.isEmpty()) {
+            bool ok = false;
+            int files = qEnvironmentVariableIntValue("GAME_REWIND_BENCH_FILES", &ok);
+            m_saveDir = m_tmpDir.path() + "/saves";
+            QElapsedTimer timer;
+            timer.start();
+            generateTree(ok && files > 0 ? files : 100000);
+            qInfo("Generated %d files in %lld ms", ok && files > 0 ? files : 100000, timer.elapsed());
+        }
+        // Warm the dentry and inode caches
+        Totals warm;
+        walkDirWalker(m_saveDir, false, warm);
+        qInfo("Save tree: %s, %lld entries, %.1f MiB", qPrintable(m_saveDir), warm.entries,
+              warm.bytes / 1048576.0);
+    }
+
+    void walk_data()
+    {
+        QTest::addColumn<QString>("method");
+        QTest::newRow("qdir-entryinfo") << "qdir-entryinfo";
+        QTest::newRow("qdiriterator") << "qdiriterator";
+        QTest::newRow("dirwalker") << "dirwalker";
+        QTest::newRow("dirwalker-paths") << "dirwalker-paths";
+    }
+
+    void walk()
+    {
+        QFETCH(QString, method);
+
+        qint64 bestNs = std::numeric_limits<qint64>::max();
+        qint64 allocations = 0;
+        Totals t;
+        for (int round = 0; round < 3; ++round) {
+            t = Totals();
+            qint64 allocsBefore = allocationCount();
+            QElapsedTimer timer;
+            timer.start();
+            run(method, t);
+            bestNs = qMin(bestNs, timer.nsecsElapsed());
+            allocations = allocationCount() - allocsBefore;
+        }
+        QVERIFY(t.entries > 0);
+
+        if (allocationCount() >= 0) {
+            qInfo("%-16s %8.1f ms  %6.0f ns/entry  %9lld allocations  %5.1f per entry", QTest::currentDataTag(),
+                  bestNs / 1e6, double(bestNs) / t.entries, allocations, double(allocations) / t.entries);
+        } else {
+            qInfo("%-16s %8.1f ms  %6.0f ns/entry", QTest::currentDataTag(), bestNs / 1e6,
+                  double(bestNs) / t.entries);
+        }
+        QTest::setBenchmarkResult(bestNs / 1e6, QTest::WalltimeMilliseconds);
+    }
+
+    // Change detection for an auto-backup of an untouched tree: a full
+    // rescan that reuses every hash, so only the walk and stats remain
+    void manifestRescan()
+    {
+        // Files written within the timestamp margin of a scan are re-hashed
+        QTest::qWait(2100);
+        FileManifest first = FileManifest::scan(QFileInfo(m_saveDir).absolutePath(),
+                                                QStringList() << QFileInfo(m_saveDir).fileName());
+        QElapsedTimer timer;
+        timer.start();
+        qint64 allocsBefore = allocationCount();
+        FileManifest again = FileManifest::scan(QFileInfo(m_saveDir).absolutePath(),
+                                                QStringList() << QFileInfo(m_saveDir).fileName(), first);
+        qint64 ns = timer.nsecsElapsed();
+        qint64 allocations = allocationCount() - allocsBefore;
+        QVERIFY(again.sameContent(first));
+        qInfo("%-16s %8.1f ms  %6.0f ns/entry  %9lld allocations", "manifest-rescan", ns / 1e6,
+              double(ns) / again.entries().size(), allocations);
+        QTest::setBenchmarkResult(ns / 1e6, QTest::WalltimeMilliseconds);
+    }
+};
+
+QTEST_MAIN(BenchDirWalk)
+#include "bench_dirwalk.moc"
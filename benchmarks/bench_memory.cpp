@@ -0,0 +1,162 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include "core/gameinfo.h"
+#include "core/memorybudget.h"
+#include "core/savemanager.h"
+
+// Backs up and restores one large save file (default 256 MiB,
+// GAME_REWIND_BENCH_SIZE_MB to change, e.g. 20480 for a 20 GiB save) in
+// every format at the smallest memory budget, and reports how far the
+// resident set grew during each. The check fails when it grew by more than
+// the budget plus allocator and libarchive overhead, which is what holding
+// a whole file anywhere in the pipeline looks like.
+//
+// Linux only: the peak comes from VmHWM in /proc/self/status, reset before
+// each step through /proc/self/clear_refs.
+
+class BenchMemory : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+    QString m_saveDir;
+    QByteArray m_expected;
+    qint64 m_saveSize = 0;
+
+    // Allocator slack, thread stacks and libarchive's own buffers
+    static constexpr qint64 kOverhead = 16 * 1024 * 1024;
+
+    // Compressible but never the same 1 MiB twice, written a slice at a time
+    static QByteArray writeLargeFile(const QString &path, qint64 size)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write benchmark file");
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        QByteArray slice = QByteArray("region=12,40;entities=[zombie,skeleton];\n").repeated(25000);
+        slice.resize(1024 * 1024);
+        for (qint64 pos = 0; pos < size; pos += slice.size()) {
+            QByteArray stamp = QByteArray::number(pos);
+            slice.replace(0, stamp.size(), stamp);
+            f.write(slice);
+            hash.addData(slice);
+        }
+        f.close();
+        return hash.result();
+    }
+
+    static QByteArray hashFile(const QString &path)
+    {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(&f);
+        return hash.result();
+    }
+
+    // Writing 5 to clear_refs resets VmHWM to the current resident size
+    static bool resetPeakResident()
+    {
+        QFile f("/proc/self/clear_refs");
+        return f.open(QIODevice::WriteOnly) && f.write("5") == 1;
+    }
+
+    static qint64 statusBytes(const QByteArray &field)
+    {
+        QFile f("/proc/self/status");
+        if (!f.open(QIODevice::ReadOnly))
+            return -1;
+        const QList<QByteArray> lines = f.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            // "VmHWM:     52344 kB"
+            if (line.startsWith(field + ":"))
+                return line.mid(field.size() + 1).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+        return -1;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        if (!resetPeakResident() || statusBytes("VmHWM") < 0)
+            QSKIP("Peak resident size can only be reset on Linux");
+
+        bool ok = false;
+        int sizeMb = qEnvironmentVariableIntValue("GAME_REWIND_BENCH_SIZE_MB", &ok);
+        m_saveSize = qint64(ok && sizeMb > 0 ? sizeMb : 256) * 1024 * 1024;
+        m_saveDir = m_tmpDir.path() + "/save";
+        m_expected = writeLargeFile(m_saveDir + "/world.dat", m_saveSize);
+        qInfo("Save: one %.0f MiB file, budget %lld MiB", m_saveSize / 1048576.0,
+              MemoryBudget::MinimumBytes >> 20);
+    }
+
+    void largeSave_data()
+    {
+        QTest::addColumn<QString>("format");
+        QTest::newRow("tar.gz") << "tar.gz";
+        QTest::newRow("tar.zst") << "tar.zst";
+        QTest::newRow("chunks") << "chunks";
+        QTest::newRow("delta") << "delta";
+        QTest::newRow("hardlinks") << "hardlinks";
+    }
+
+    void largeSave()
+    {
+        QFETCH(QString, format);
+        QString runDir = m_tmpDir.path() + "/" + format;
+
+        SaveManager manager;
+        manager.setBackupDirectory(runDir + "/backups");
+        manager.setBackupFormat(format);
+        manager.setCompressionLevel(1);
+        manager.setLongDistanceMatching(true);
+        manager.setMemoryBudget(MemoryBudget::MinimumBytes);
+
+        GameInfo game;
+        game.id = "large";
+        game.name = "Large";
+        game.platform = "native";
+        game.detectedSavePath = m_saveDir;
+        game.isDetected = true;
+
+        QVERIFY(resetPeakResident());
+        qint64 before = statusBytes("VmRSS");
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(manager.createBackup(game));
+        qint64 backupMs = timer.elapsed();
+        qint64 backupPeak = statusBytes("VmHWM") - before;
+
+        QList<BackupInfo> backups = manager.getBackupsForGame("large");
+        QCOMPARE(backups.size(), 1);
+        QString target = runDir + "/restored";
+        QVERIFY(resetPeakResident());
+        before = statusBytes("VmRSS");
+        timer.restart();
+        QVERIFY(manager.restoreBackup(backups[0], target));
+        qint64 restoreMs = timer.elapsed();
+        qint64 restorePeak = statusBytes("VmHWM") - before;
+
+        qInfo("%-10s backup +%5lld MiB %8lld ms   restore +%5lld MiB %8lld ms", QTest::currentDataTag(),
+              backupPeak >> 20, backupMs, restorePeak >> 20, restoreMs);
+
+        qint64 limit = manager.memoryBudget() + kOverhead;
+        QVERIFY2(backupPeak < limit, qPrintable(QString("backup grew by %1 MiB").arg(backupPeak >> 20)));
+        QVERIFY2(restorePeak < limit, qPrintable(QString("restore grew by %1 MiB").arg(restorePeak >> 20)));
+        QCOMPARE(QFileInfo(target + "/world.dat").size(), m_saveSize);
+        QCOMPARE(hashFile(target + "/world.dat"), m_expected);
+
+        // Keeps a 20 GiB run from needing room for five copies at once
+        QDir(runDir).removeRecursively();
+    }
+};
+
+QTEST_MAIN(BenchMemory)
+#include "bench_memory.moc"
@@ -0,0 +1,307 @@
+#include "archiveindex.h"
+#include "transferprogress.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <zlib.h>
+
+namespace {
+
+constexpr qsizetype kReadSize = 256 * 1024;
+
+bool isSafePath(const QString &path)
+{
+    QString cleanPath = QDir::cleanPath(path);
+    return !path.isEmpty() && !QDir::isAbsolutePath(cleanPath)
+           && cleanPath != ".." && !cleanPath.startsWith("../");
+}
+
+// Sequential reader over a run of gzip members that can restart at any
+// member boundary. Reading forward within the current or next member keeps
+// inflating; anything further away seeks to the member holding the target.
+class MemberReader {
+public:
+    MemberReader(QFile *file, const QList<qint64> &memberOffsets, qint64 blockSize)
+        : m_file(file)
+        , m_offsets(memberOffsets)
+        , m_blockSize(blockSize)
+        , m_in(kReadSize, Qt::Uninitialized)
+        , m_scratch(kReadSize, Qt::Uninitialized)
+    {
+        m_ok = inflateInit2(&m_zs, 15 + 16) == Z_OK;
+    }
+
+    ~MemberReader()
+    {
+        if (m_ok) {
+            inflateEnd(&m_zs);
+        }
+    }
+
+    bool seek(qint64 pos)
+    {
+        if (!m_ok) {
+            return false;
+        }
+        qint64 member = pos / m_blockSize;
+        if (m_pos < 0 || pos < m_pos || member > m_pos / m_blockSize + 1) {
+            if (member >= m_offsets.size() || !m_file->seek(m_offsets.at(member))) {
+                return false;
+            }
+            inflateReset(&m_zs);
+            m_zs.avail_in = 0;
+            m_pos = member * m_blockSize;
+        }
+        while (m_pos < pos) {
+            qint64 n = qMin<qint64>(pos - m_pos, m_scratch.size());
+            if (!read(m_scratch.data(), n)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool read(char *out, qint64 length)
+    {
+        m_zs.next_out = reinterpret_cast<Bytef *>(out);
+        m_zs.avail_out = static_cast<uInt>(length);
+        while (m_zs.avail_out > 0) {
+            if (m_zs.avail_in == 0) {
+                qint64 n = m_file->read(m_in.data(), m_in.size());
+                if (n <= 0) {
+                    return false;
+                }
+                m_zs.next_in = reinterpret_cast<Bytef *>(m_in.data());
+                m_zs.avail_in = static_cast<uInt>(n);
+            }
+            int rc = inflate(&m_zs, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                // The next member follows directly
+                inflateReset(&m_zs);
+            } else if (rc != Z_OK) {
+                return false;
+            }
+        }
+        m_pos += length;
+        return true;
+    }
+
+private:
+    QFile *m_file;
+    QList<qint64> m_offsets;
+    qint64 m_blockSize;
+    QByteArray m_in;
+    QByteArray m_scratch;
+    z_stream m_zs = {};
+    bool m_ok = false;
+    qint64 m_pos = -1;
+};
+
+} // namespace
+
+void ArchiveIndex::setMembers(qint64 blockSize, const QList<qint64> &memberSizes)
+{
+    m_blockSize = blockSize;
+    m_memberSizes = memberSizes;
+}
+
+void ArchiveIndex::addEntry(const Entry &entry)
+{
+    m_index.insert(entry.path, m_entries.size());
+    m_entries.append(entry);
+}
+
+bool ArchiveIndex::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+const QList<ArchiveIndex::Entry> &ArchiveIndex::entries() const
+{
+    return m_entries;
+}
+
+const ArchiveIndex::Entry *ArchiveIndex::find(const QString &path) const
+{
+    auto it = m_index.constFind(path);
+    if (it == m_index.constEnd()) {
+        return nullptr;
+    }
+    return &m_entries.at(it.value());
+}
+
+bool ArchiveIndex::save(const QString &path) const
+{
+    QJsonArray members;
+    for (qint64 size : m_memberSizes) {
+        members.append(size);
+    }
+
+    QJsonArray array;
+    for (const Entry &entry : m_entries) {
+        QJsonObject obj;
+        obj["path"] = entry.path;
+        obj["type"] = entry.type;
+        obj["mtime"] = entry.mtime;
+        if (entry.type == "file") {
+            obj["size"] = entry.size;
+            obj["off"] = entry.offset;
+            if (entry.executable) {
+                obj["exec"] = true;
+            }
+        } else if (entry.type == "symlink") {
+            obj["target"] = entry.linkTarget;
+        }
+        array.append(obj);
+    }
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["blockSize"] = m_blockSize;
+    root["members"] = members;
+    root["entries"] = array;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+ArchiveIndex ArchiveIndex::load(const QString &path, bool *ok)
+{
+    ArchiveIndex index;
+    if (ok) *ok = false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return index;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root["version"].toInt() != 1 || root["blockSize"].toInteger() <= 0) {
+        return index;
+    }
+
+    index.m_blockSize = root["blockSize"].toInteger();
+    const QJsonArray members = root["members"].toArray();
+    for (const QJsonValue &value : members) {
+        index.m_memberSizes.append(value.toInteger());
+    }
+    const QJsonArray array = root["entries"].toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject obj = value.toObject();
+        Entry entry;
+        entry.path = obj["path"].toString();
+        entry.type = obj["type"].toString();
+        entry.mtime = obj["mtime"].toInteger();
+        entry.size = obj["size"].toInteger();
+        entry.offset = obj["off"].toInteger();
+        entry.executable = obj["exec"].toBool();
+        entry.linkTarget = obj["target"].toString();
+        index.addEntry(entry);
+    }
+
+    if (ok) *ok = true;
+    return index;
+}
+
+void ArchiveIndex::setProgress(TransferProgress *progress)
+{
+    m_progress = progress;
+}
+
+bool ArchiveIndex::extract(const QString &archivePath, const QStringList &paths, const QString &targetDir) const
+{
+    QFile archive(archivePath);
+    if (!archive.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // An archive rewritten after indexing would decode to garbage
+    QList<qint64> offsets;
+    qint64 total = 0;
+    for (qint64 size : m_memberSizes) {
+        offsets.append(total);
+        total += size;
+    }
+    if (m_blockSize <= 0 || total != archive.size()) {
+        qWarning() << "Archive index is out of date:" << archivePath;
+        return false;
+    }
+
+    MemberReader reader(&archive, offsets, m_blockSize);
+    QByteArray buffer(kReadSize, Qt::Uninitialized);
+    QDir().mkpath(targetDir);
+
+    for (const Entry &entry : m_entries) {
+        if (!isSelected(entry.path, paths)) {
+            continue;
+        }
+        if (!isSafePath(entry.path)) {
+            qWarning() << "Skipping unsafe archive path:" << entry.path;
+            continue;
+        }
+
+        QString outPath = targetDir + "/" + entry.path;
+        if (entry.type == "dir") {
+            QDir().mkpath(outPath);
+        } else if (entry.type == "symlink") {
+            QDir().mkpath(QFileInfo(outPath).absolutePath());
+            QFile::remove(outPath);
+            QFile::link(entry.linkTarget, outPath);
+        } else if (entry.type == "file") {
+            QDir().mkpath(QFileInfo(outPath).absolutePath());
+            QFile file(outPath);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qWarning() << "Failed to create file:" << outPath;
+                return false;
+            }
+            if (entry.size > 0 && !reader.seek(entry.offset)) {
+                qWarning() << "Failed to seek to" << entry.path << "in" << archivePath;
+                return false;
+            }
+            for (qint64 done = 0; done < entry.size;) {
+                qint64 n = qMin<qint64>(entry.size - done, buffer.size());
+                if (!reader.read(buffer.data(), n) || file.write(buffer.constData(), n) != n) {
+                    qWarning() << "Failed to extract" << entry.path << "from" << archivePath;
+                    return false;
+                }
+                done += n;
+                if (m_progress && !m_progress->addBytes(n)) {
+                    return false;
+                }
+            }
+            if (entry.executable) {
+                file.setPermissions(file.permissions() | QFileDevice::ExeOwner
+                                    | QFileDevice::ExeGroup | QFileDevice::ExeOther);
+            }
+            file.setFileTime(QDateTime::fromSecsSinceEpoch(entry.mtime), QFileDevice::FileModificationTime);
+            file.close();
+            if (m_progress) {
+                m_progress->addFile();
+            }
+        }
+    }
+    return true;
+}
+
+bool ArchiveIndex::isSelected(const QString &path, const QStringList &selection)
+{
+    if (selection.isEmpty()) {
+        return true;
+    }
+    for (const QString &selected : selection) {
+        if (path == selected || path.startsWith(selected + "/")) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,59 @@
+#ifndef ARCHIVEINDEX_H
+#define ARCHIVEINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+
+class TransferProgress;
+
+// Random access into .tar.gz backups. ParallelGzipWriter compresses the tar
+// stream in fixed-size blocks, each an independent gzip member. The index
+// records the compressed size of every member and where each entry's data
+// starts in the uncompressed stream, so extracting one file only inflates the
+// members it spans instead of the whole archive.
+//
+// Kept as a .index sidecar: the archive itself stays a plain .tar.gz, and
+// archives without an index are read front to back as before.
+class ArchiveIndex {
+public:
+    struct Entry {
+        QString path;       // tar entry path
+        QString type;       // "file", "dir" or "symlink"
+        bool executable = false;
+        qint64 mtime = 0;   // seconds since epoch
+        qint64 size = 0;
+        qint64 offset = 0;  // file data position in the uncompressed tar stream
+        QString linkTarget;
+    };
+
+    void setMembers(qint64 blockSize, const QList<qint64> &memberSizes);
+    void addEntry(const Entry &entry);
+
+    bool isEmpty() const;
+    const QList<Entry> &entries() const;
+    const Entry *find(const QString &path) const;
+
+    bool save(const QString &path) const;
+    static ArchiveIndex load(const QString &path, bool *ok = nullptr);
+
+    // Counts bytes written and aborts when cancelled
+    void setProgress(TransferProgress *progress);
+    // Extract the selected entries of archivePath below targetDir. Fails
+    // without touching anything when the archive does not match the index.
+    bool extract(const QString &archivePath, const QStringList &paths, const QString &targetDir) const;
+
+    // A selection names paths that are taken with everything below them;
+    // an empty selection takes everything
+    static bool isSelected(const QString &path, const QStringList &selection);
+
+private:
+    qint64 m_blockSize = 0;
+    QList<qint64> m_memberSizes;
+    QList<Entry> m_entries;
+    QHash<QString, int> m_index;
+    TransferProgress *m_progress = nullptr;
+};
+
+#endif // ARCHIVEINDEX_H
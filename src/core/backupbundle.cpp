@@ -0,0 +1,685 @@
+#include "backupbundle.h"
+#include "backupcatalog.h"
+#include "chunkstore.h"
+#include "dirwalker.h"
+#include "filechecksums.h"
+#include "filecopy.h"
+#include "transferprogress.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QTemporaryDir>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <archive.h>
+#include <archive_entry.h>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+constexpr char kHeaderName[] = "game-rewind-bundle.json";
+constexpr char kFormatName[] = "game-rewind-bundle";
+constexpr int kVersion = 1;
+constexpr qint64 kMaxHeaderSize = 1024 * 1024;
+// One backup's manifest; a hard-linked snapshot of a million files is ~150 MB
+constexpr qint64 kMaxManifestSize = 256 * 1024 * 1024;
+constexpr qint64 kSlice = 1024 * 1024;
+
+la_ssize_t deviceWrite(struct archive *, void *client, const void *buffer, size_t length)
+{
+    auto *device = static_cast<QIODevice *>(client);
+    qint64 written = device->write(static_cast<const char *>(buffer), static_cast<qint64>(length));
+    return written == static_cast<qint64>(length) ? written : -1;
+}
+
+struct ReadSource {
+    QIODevice *device;
+    QByteArray buffer;
+};
+
+la_ssize_t deviceRead(struct archive *, void *client, const void **buffer)
+{
+    auto *source = static_cast<ReadSource *>(client);
+    *buffer = source->buffer.constData();
+    return source->device->read(source->buffer.data(), source->buffer.size());
+}
+
+QString backupEntryPath(const BackupInfo &backup)
+{
+    return "games/" + backup.gameId + "/" + QFileInfo(backup.archivePath).fileName();
+}
+
+// Relative, without . or .. components, and below games/<id>/ or chunks/
+bool isSafePath(const QString &path)
+{
+    const QStringList parts = path.split('/');
+    for (const QString &part : parts) {
+        if (part.isEmpty() || part == "." || part == "..") {
+            return false;
+        }
+    }
+    return (parts.first() == "games" && parts.size() >= 3) || (parts.first() == "chunks" && parts.size() >= 2);
+}
+
+// Whether path, below root, goes through a symlink, its last component
+// included. Symlinks in a snapshot are the save's own and are never
+// followed while importing, or a bundle could stage a link to anywhere
+// and then write through it.
+bool throughSymlink(const QString &root, const QString &path)
+{
+    QString current = root;
+    const QStringList parts = path.split('/');
+    for (const QString &part : parts) {
+        current += "/" + part;
+        QFileInfo info(current);
+        if (info.isSymLink()) {
+            return true;
+        }
+        if (!info.exists()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// What is moved into place as a whole: a backup's files (a snapshot tree
+// with everything in it), the game's dictionary, single chunks
+QString commitUnit(const QString &path)
+{
+    return path.startsWith("games/") ? path.section('/', 0, 2) : path;
+}
+
+// Raw target, so relative links stay relative
+QString readLink(const QString &path)
+{
+    std::error_code ec;
+    auto target = std::filesystem::read_symlink(QFile::encodeName(path).toStdString(), ec);
+    return ec ? QString() : QFile::decodeName(target.c_str());
+}
+
+bool writeHeader(struct archive *a, const QString &path, unsigned int type, int perm, qint64 size,
+                 qint64 mtimeMs, const QString &symlink = QString(), const QString &hardlink = QString())
+{
+    struct archive_entry *entry = archive_entry_new();
+    archive_entry_set_pathname_utf8(entry, path.toUtf8().constData());
+    archive_entry_set_filetype(entry, type);
+    archive_entry_set_perm(entry, perm);
+    archive_entry_set_size(entry, size);
+    archive_entry_set_mtime(entry, mtimeMs / 1000, (mtimeMs % 1000) * 1000000);
+    if (!symlink.isEmpty()) {
+        archive_entry_set_symlink_utf8(entry, symlink.toUtf8().constData());
+    }
+    if (!hardlink.isEmpty()) {
+        archive_entry_set_hardlink_utf8(entry, hardlink.toUtf8().constData());
+    }
+    bool ok = archive_write_header(a, entry) == ARCHIVE_OK;
+    if (!ok) {
+        qWarning() << "Bundle write error:" << archive_error_string(a);
+    }
+    archive_entry_free(entry);
+    return ok;
+}
+
+bool writeBlob(struct archive *a, const QString &path, const QByteArray &data)
+{
+    if (!writeHeader(a, path, AE_IFREG, 0644, data.size(), QDateTime::currentMSecsSinceEpoch())) {
+        return false;
+    }
+    if (archive_write_data(a, data.constData(), data.size()) != data.size()) {
+        qWarning() << "Bundle write error:" << archive_error_string(a);
+        return false;
+    }
+    return true;
+}
+
+QByteArray readBlob(struct archive *a, struct archive_entry *entry, qint64 maxSize, bool *ok)
+{
+    *ok = false;
+    qint64 size = archive_entry_size(entry);
+    if (size < 0 || size > maxSize) {
+        qWarning() << "Bundle metadata entry is too large:" << archive_entry_pathname(entry);
+        return QByteArray();
+    }
+    QByteArray data(size, Qt::Uninitialized);
+    qint64 done = 0;
+    while (done < size) {
+        la_ssize_t n = archive_read_data(a, data.data() + done, size - done);
+        if (n <= 0) {
+            qWarning() << "Bundle read error:" << archive_error_string(a);
+            return QByteArray();
+        }
+        done += n;
+    }
+    *ok = true;
+    return data;
+}
+
+QJsonObject manifestEntry(const QString &path, const QString &type)
+{
+    QJsonObject obj;
+    obj["path"] = path;
+    obj["type"] = type;
+    return obj;
+}
+
+} // namespace
+
+BackupBundle::BackupBundle(const QString &backupDir)
+    : m_backupDir(backupDir)
+{
+}
+
+void BackupBundle::setProgress(TransferProgress *progress)
+{
+    m_progress = progress;
+}
+
+bool BackupBundle::write(QIODevice *out, const QList<BackupInfo> &backups, Stats *stats)
+{
+    struct archive *a = archive_write_new();
+    archive_write_set_format_pax_restricted(a);
+    // Pipes take whatever is ready; no need to pad the last block
+    archive_write_set_bytes_in_last_block(a, 1);
+    if (archive_write_open2(a, out, nullptr, deviceWrite, nullptr, nullptr) != ARCHIVE_OK) {
+        qWarning() << "Failed to open bundle for writing:" << archive_error_string(a);
+        archive_write_free(a);
+        return false;
+    }
+
+    QJsonArray games;
+    for (const BackupInfo &backup : backups) {
+        if (games.isEmpty() || games.last().toString() != backup.gameId) {
+            games.append(backup.gameId);
+        }
+    }
+    QJsonObject header;
+    header["format"] = kFormatName;
+    header["version"] = kVersion;
+    header["created"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    header["games"] = games;
+    header["backups"] = static_cast<int>(backups.size());
+    bool ok = writeBlob(a, kHeaderName, QJsonDocument(header).toJson(QJsonDocument::Compact));
+
+    ExportState state;
+    for (const BackupInfo &backup : backups) {
+        if (!ok) {
+            break;
+        }
+        ok = writeBackup(a, backup, state, stats);
+    }
+
+    if (archive_write_close(a) != ARCHIVE_OK) {
+        qWarning() << "Bundle write error:" << archive_error_string(a);
+        ok = false;
+    }
+    archive_write_free(a);
+    return ok;
+}
+
+bool BackupBundle::writeBackup(struct archive *a, const BackupInfo &backup, ExportState &state, Stats *stats)
+{
+    const QString entryPath = backupEntryPath(backup);
+    QJsonArray manifest;
+    bool ok = true;
+
+    if (backup.gameId != state.gameId) {
+        state.gameId = backup.gameId;
+        state.previousTree.clear();
+        state.previousTreeEntry.clear();
+        state.previousChunks.clear();
+        QString dictionary = QFileInfo(backup.archivePath).absolutePath() + "/zstd.dict";
+        if (QFile::exists(dictionary)) {
+            ok = writeFile(a, dictionary, "games/" + backup.gameId + "/zstd.dict", &manifest, stats);
+        }
+    }
+
+    if (ok && backup.format == "chunks") {
+        // The chunk store SaveManager keeps next to the games
+        const QString chunkDir = m_backupDir + "/chunks";
+        ChunkStore store(chunkDir);
+        bool manifestOk = false;
+        const QSet<QString> chunks = ChunkStore::referencedChunks(backup.archivePath, &manifestOk);
+        if (!manifestOk) {
+            qWarning() << "Failed to read chunk snapshot:" << backup.archivePath;
+            return false;
+        }
+        if (!state.dictionariesWritten) {
+            state.dictionariesWritten = true;
+            const QStringList names = QDir(chunkDir + "/dicts").entryList(QDir::Files, QDir::Name);
+            for (const QString &name : names) {
+                ok = ok && writeFile(a, chunkDir + "/dicts/" + name, "chunks/dicts/" + name, &manifest, stats);
+            }
+        }
+        // Chunks the game's previous snapshot already carried are left out
+        for (const QString &hash : chunks) {
+            if (!ok) {
+                break;
+            }
+            if (!state.previousChunks.contains(hash)) {
+                QString path = store.chunkPath(hash);
+                ok = writeFile(a, path, "chunks/" + path.mid(chunkDir.size() + 1), &manifest, stats);
+            }
+        }
+        state.previousChunks = chunks;
+    }
+
+    if (ok && backup.format == "hardlinks") {
+        ok = writeTree(a, backup.archivePath, entryPath, state, &manifest, stats);
+        state.previousTree = backup.archivePath;
+        state.previousTreeEntry = entryPath;
+    } else if (ok) {
+        ok = writeFile(a, backup.archivePath, entryPath, &manifest, stats);
+    }
+
+    // Fingerprint and archive index; the .contents listing is a cache
+    for (const char *suffix : {".files", ".index", ".json"}) {
+        if (ok && QFile::exists(backup.archivePath + suffix)) {
+            ok = writeFile(a, backup.archivePath + suffix, entryPath + suffix, &manifest, stats);
+        }
+    }
+    if (!ok) {
+        return false;
+    }
+
+    QJsonObject obj;
+    obj["gameId"] = backup.gameId;
+    obj["backup"] = entryPath;
+    obj["entries"] = manifest;
+    if (!writeBlob(a, "manifests/" + entryPath.mid(6) + ".json", QJsonDocument(obj).toJson(QJsonDocument::Compact))) {
+        return false;
+    }
+    if (stats) {
+        stats->backups++;
+    }
+    return true;
+}
+
+bool BackupBundle::writeFile(struct archive *a, const QString &filePath, const QString &entryPath,
+                             QJsonArray *manifest, Stats *stats)
+{
+    DirWalker::FileStat st;
+    QFile file(filePath);
+    if (!DirWalker::stat(filePath, &st) || st.type != DirWalker::File || !file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to read file for bundle:" << filePath;
+        return false;
+    }
+    if (!writeHeader(a, entryPath, AE_IFREG, st.executable ? 0755 : 0644, st.size, st.mtimeMs)) {
+        return false;
+    }
+
+    // Exactly the size in the header goes out, even if the file changes
+    if (m_buffer.isEmpty()) {
+        m_buffer.resize(kSlice);
+    }
+    FileChecksums::Hasher hasher;
+    qint64 remaining = st.size;
+    while (remaining > 0) {
+        qint64 n = file.read(m_buffer.data(), qMin(kSlice, remaining));
+        if (n <= 0) {
+            qWarning() << "Failed to read file for bundle:" << filePath;
+            return false;
+        }
+        if (archive_write_data(a, m_buffer.constData(), n) != n) {
+            qWarning() << "Bundle write error:" << archive_error_string(a);
+            return false;
+        }
+        hasher.addData(m_buffer.constData(), n);
+        remaining -= n;
+        if (m_progress && !m_progress->addBytes(n)) {
+            return false;
+        }
+    }
+
+    QJsonObject obj = manifestEntry(entryPath, "file");
+    obj["size"] = st.size;
+    obj["blake2b"] = QString::fromLatin1(hasher.result());
+    manifest->append(obj);
+    if (stats) {
+        stats->files++;
+        stats->bytes += st.size;
+    }
+    if (m_progress) {
+        m_progress->addFile();
+    }
+    return true;
+}
+
+bool BackupBundle::writeTree(struct archive *a, const QString &treePath, const QString &entryPath,
+                             const ExportState &state, QJsonArray *manifest, Stats *stats)
+{
+    DirWalker::FileStat root;
+    if (!DirWalker::stat(treePath, &root) || root.type != DirWalker::Dir) {
+        qWarning() << "Snapshot not found:" << treePath;
+        return false;
+    }
+    if (!writeHeader(a, entryPath, AE_IFDIR, 0755, 0, root.mtimeMs)) {
+        return false;
+    }
+    manifest->append(manifestEntry(entryPath, "dir"));
+
+    return DirWalker::walk(treePath, [&](const DirWalker::Entry &walked) {
+        const QString rel = walked.relativePath();
+        const QString path = entryPath + "/" + rel;
+        bool ok = true;
+        if (walked.type == DirWalker::Dir) {
+            ok = writeHeader(a, path, AE_IFDIR, 0755, 0, walked.mtimeMs);
+            manifest->append(manifestEntry(path, "dir"));
+        } else if (walked.type == DirWalker::Symlink) {
+            QString target = readLink(walked.filePath());
+            ok = writeHeader(a, path, AE_IFLNK, 0777, 0, walked.mtimeMs, target);
+            QJsonObject obj = manifestEntry(path, "symlink");
+            obj["target"] = target;
+            manifest->append(obj);
+        } else if (walked.type == DirWalker::File) {
+            // Shared with the previous snapshot on disk, so shared in the
+            // bundle too
+            DirWalker::FileStat old;
+            if (!state.previousTree.isEmpty() && DirWalker::stat(state.previousTree + "/" + rel, &old)
+                && old.type == DirWalker::File && old.inode == walked.inode) {
+                QString target = state.previousTreeEntry + "/" + rel;
+                ok = writeHeader(a, path, AE_IFREG, walked.executable ? 0755 : 0644, 0, walked.mtimeMs,
+                                 QString(), target);
+                QJsonObject obj = manifestEntry(path, "hardlink");
+                obj["target"] = target;
+                manifest->append(obj);
+                if (m_progress) {
+                    m_progress->addFile();
+                }
+            } else {
+                ok = writeFile(a, walked.filePath(), path, manifest, stats);
+            }
+        }
+        return ok ? DirWalker::Continue : DirWalker::Stop;
+    }, DirWalker::DirsFirst);
+}
+
+bool BackupBundle::read(QIODevice *in, QList<BackupInfo> *imported, Stats *stats)
+{
+    // Staged next to the backups, so committing is a rename
+    QDir().mkpath(m_backupDir);
+    QTemporaryDir staging(m_backupDir + "/.import-XXXXXX");
+    if (!staging.isValid()) {
+        qWarning() << "Failed to create import directory in" << m_backupDir;
+        return false;
+    }
+
+    struct archive *a = archive_read_new();
+    // Bundles piped through gzip or zstd are fine too
+    archive_read_support_filter_gzip(a);
+    archive_read_support_filter_zstd(a);
+    archive_read_support_format_tar(a);
+    ReadSource source{in, QByteArray(64 * 1024, Qt::Uninitialized)};
+    if (archive_read_open(a, &source, nullptr, deviceRead, nullptr) != ARCHIVE_OK) {
+        qWarning() << "Failed to open bundle:" << archive_error_string(a);
+        archive_read_free(a);
+        return false;
+    }
+
+    QHash<QString, Pending> pending;
+    bool sawHeader = false;
+    bool ok = true;
+    int r = ARCHIVE_OK;
+    struct archive_entry *entry;
+    while (ok && (r = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+        QString path = QString::fromUtf8(archive_entry_pathname_utf8(entry));
+        if (path.endsWith('/')) {
+            path.chop(1);
+        }
+
+        if (!sawHeader) {
+            bool read = false;
+            QJsonObject header;
+            if (path == kHeaderName) {
+                header = QJsonDocument::fromJson(readBlob(a, entry, kMaxHeaderSize, &read)).object();
+            }
+            sawHeader = read && header["format"].toString() == kFormatName;
+            if (!sawHeader) {
+                qWarning() << "Not a backup bundle";
+                ok = false;
+            } else if (header["version"].toInt() > kVersion) {
+                qWarning() << "Backup bundle was written by a newer version";
+                ok = false;
+            }
+        } else if (path.startsWith("manifests/")) {
+            bool read = false;
+            QByteArray data = readBlob(a, entry, kMaxManifestSize, &read);
+            ok = read && commitBackup(data, staging.path(), pending, imported, stats);
+        } else if (!isSafePath(path)) {
+            qWarning() << "Unexpected path in bundle:" << path;
+            ok = false;
+        } else {
+            ok = readEntry(a, entry, path, staging.path(), pending, stats);
+        }
+    }
+    if (ok && r != ARCHIVE_EOF) {
+        qWarning() << "Bundle read error:" << archive_error_string(a);
+        ok = false;
+    }
+    if (ok && !sawHeader) {
+        qWarning() << "Backup bundle is empty";
+        ok = false;
+    }
+    if (ok && !pending.isEmpty()) {
+        qWarning() << "Backup bundle ends in the middle of a backup";
+        ok = false;
+    }
+    archive_read_free(a);
+    return ok;
+}
+
+bool BackupBundle::readEntry(struct archive *a, struct archive_entry *entry, const QString &path,
+                             const QString &staging, QHash<QString, Pending> &pending, Stats *stats)
+{
+    if (pending.contains(path)) {
+        qWarning() << "Duplicate path in bundle:" << path;
+        return false;
+    }
+    if (throughSymlink(staging, path)) {
+        qWarning() << "Bundle path leads through a symlink:" << path;
+        return false;
+    }
+    const QString dest = staging + "/" + path;
+    QDir().mkpath(QFileInfo(dest).absolutePath());
+    std::error_code ec;
+    Pending staged;
+
+    if (const char *hardlink = archive_entry_hardlink_utf8(entry)) {
+        staged.type = "hardlink";
+        staged.target = QString::fromUtf8(hardlink);
+        if (!isSafePath(staged.target) || !staged.target.startsWith("games/")) {
+            qWarning() << "Unexpected link target in bundle:" << staged.target;
+            return false;
+        }
+        // A file of this backup, or of one committed before it
+        QString root = pending.contains(staged.target) ? staging : m_backupDir;
+        QString source = root + "/" + staged.target;
+        if (throughSymlink(root, staged.target) || !QFileInfo(source).isFile()) {
+            qWarning() << "Unexpected link target in bundle:" << staged.target;
+            return false;
+        }
+        std::filesystem::create_hard_link(QFile::encodeName(source).toStdString(),
+                                          QFile::encodeName(dest).toStdString(), ec);
+        if (ec && !FileCopy::copyFile(source, dest)) {
+            qWarning() << "Failed to link" << path << "to" << staged.target;
+            return false;
+        }
+        if (m_progress) {
+            m_progress->addFile();
+        }
+    } else if (archive_entry_filetype(entry) == AE_IFDIR) {
+        staged.type = "dir";
+        if (!QDir().mkpath(dest)) {
+            return false;
+        }
+    } else if (archive_entry_filetype(entry) == AE_IFLNK) {
+        staged.type = "symlink";
+        staged.target = QString::fromUtf8(archive_entry_symlink_utf8(entry));
+        std::filesystem::create_symlink(QFile::encodeName(staged.target).toStdString(),
+                                        QFile::encodeName(dest).toStdString(), ec);
+        if (ec) {
+            qWarning() << "Failed to create symlink:" << dest;
+            return false;
+        }
+    } else if (archive_entry_filetype(entry) == AE_IFREG) {
+        staged.type = "file";
+        QFile file(dest);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Failed to write" << dest;
+            return false;
+        }
+        if (m_buffer.isEmpty()) {
+            m_buffer.resize(kSlice);
+        }
+        FileChecksums::Hasher hasher;
+        la_ssize_t n;
+        while ((n = archive_read_data(a, m_buffer.data(), m_buffer.size())) > 0) {
+            if (file.write(m_buffer.constData(), n) != n) {
+                qWarning() << "Failed to write" << dest;
+                return false;
+            }
+            hasher.addData(m_buffer.constData(), n);
+            staged.size += n;
+            if (m_progress && !m_progress->addBytes(n)) {
+                return false;
+            }
+        }
+        if (n < 0) {
+            qWarning() << "Bundle read error:" << archive_error_string(a);
+            return false;
+        }
+        staged.hash = hasher.result();
+        if (archive_entry_perm(entry) & 0100) {
+            file.setPermissions(file.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeGroup
+                                | QFileDevice::ExeOther);
+        }
+        // Snapshot restores carry file times over from the tree
+        file.setFileTime(QDateTime::fromMSecsSinceEpoch(archive_entry_mtime(entry) * 1000
+                                                        + archive_entry_mtime_nsec(entry) / 1000000),
+                         QFileDevice::FileModificationTime);
+        file.close();
+        if (stats) {
+            stats->files++;
+            stats->bytes += staged.size;
+        }
+        if (m_progress) {
+            m_progress->addFile();
+        }
+    } else {
+        archive_read_data_skip(a);
+        return true;
+    }
+
+    pending.insert(path, staged);
+    return true;
+}
+
+bool BackupBundle::commitBackup(const QByteArray &manifestData, const QString &staging,
+                                QHash<QString, Pending> &pending, QList<BackupInfo> *imported, Stats *stats)
+{
+    const QJsonObject manifest = QJsonDocument::fromJson(manifestData).object();
+    const QString backupPath = manifest["backup"].toString();
+    const QString sidecarPath = backupPath + ".json";
+    if (!isSafePath(backupPath) || !backupPath.startsWith("games/") || backupPath.split('/').size() != 3) {
+        qWarning() << "Unexpected backup in bundle:" << backupPath;
+        return false;
+    }
+
+    // Everything staged since the previous manifest, exactly as listed
+    QStringList units;
+    QSet<QString> seenUnits;
+    bool hasSidecar = false;
+    const QJsonArray entries = manifest["entries"].toArray();
+    for (const QJsonValue &value : entries) {
+        const QJsonObject expected = value.toObject();
+        const QString path = expected["path"].toString();
+        auto it = pending.find(path);
+        if (it == pending.end() || it->type != expected["type"].toString()
+            || it->size != expected["size"].toInteger() || it->target != expected["target"].toString()
+            || it->hash != expected["blake2b"].toString().toLatin1()) {
+            qWarning() << "Bundle entry does not match its manifest:" << path;
+            return false;
+        }
+        hasSidecar = hasSidecar || (path == sidecarPath && it->type == "file");
+        pending.erase(it);
+        QString unit = commitUnit(path);
+        if (!seenUnits.contains(unit)) {
+            seenUnits.insert(unit);
+            units.append(unit);
+        }
+    }
+    if (!pending.isEmpty()) {
+        qWarning() << "Bundle has files the manifest of" << backupPath << "does not list";
+        return false;
+    }
+    if (!hasSidecar) {
+        qWarning() << "Bundle has no metadata for" << backupPath;
+        return false;
+    }
+
+    // Backups already here are kept as they are, without reading them
+    const bool present = QFile::exists(m_backupDir + "/" + sidecarPath);
+    bool ok = true;
+    for (const QString &unit : units) {
+        const bool ofBackup = unit.startsWith(backupPath);
+        if (unit == sidecarPath || (present && ofBackup)) {
+            continue;
+        }
+        const QString dest = m_backupDir + "/" + unit;
+        if (ofBackup) {
+            // Leftovers without metadata
+            if (QFileInfo(dest).isDir()) {
+                QDir(dest).removeRecursively();
+            } else {
+                QFile::remove(dest);
+            }
+        } else if (QFileInfo::exists(dest)) {
+            // Chunks are content-addressed; a game's own dictionary wins
+            continue;
+        }
+        QDir().mkpath(QFileInfo(dest).absolutePath());
+        if (!QDir().rename(staging + "/" + unit, dest)) {
+            qWarning() << "Failed to move imported file into place:" << dest;
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok && !present) {
+        // The sidecar goes last: it is what makes the backup show up
+        QFile sidecar(staging + "/" + sidecarPath);
+        QJsonObject obj;
+        if (sidecar.open(QIODevice::ReadWrite)) {
+            obj = QJsonDocument::fromJson(sidecar.readAll()).object();
+            obj["archivePath"] = m_backupDir + "/" + backupPath;
+            sidecar.resize(0);
+            sidecar.seek(0);
+            ok = sidecar.write(QJsonDocument(obj).toJson()) > 0;
+            sidecar.close();
+        } else {
+            ok = false;
+        }
+        QString dest = m_backupDir + "/" + sidecarPath;
+        if (!ok || !QDir().rename(sidecar.fileName(), dest)) {
+            qWarning() << "Failed to import backup metadata:" << dest;
+            ok = false;
+        }
+        BackupInfo backup = BackupCatalog::fromJson(obj);
+        if (ok && imported) {
+            imported->append(backup);
+        }
+        if (ok && stats) {
+            stats->backups++;
+        }
+    } else if (ok && stats) {
+        stats->skippedBackups++;
+    }
+
+    // Whatever was skipped goes with the staging area
+    QDir(staging).removeRecursively();
+    QDir().mkpath(staging);
+    return ok;
+}
@@ -0,0 +1,87 @@
+#ifndef BACKUPBUNDLE_H
+#define BACKUPBUNDLE_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QJsonArray>
+#include <QSet>
+#include "gameinfo.h"
+
+class QIODevice;
+class TransferProgress;
+struct archive;
+struct archive_entry;
+
+// Portable export of backup histories, for moving them between machines.
+//
+// A bundle is one uncompressed tar stream (the archives in it are compressed
+// already) that is written and read strictly front to back, so it can go
+// through a pipe and memory use does not grow with the history. It starts
+// with a small header, then carries each backup, oldest first per game, as
+// the files it consists of under games/<id>/ plus the chunks/ it needs from
+// the chunk store, followed by a manifest of those files with their BLAKE2b
+// hashes. Files of a hard-linked snapshot that are shared with the previous
+// snapshot in the bundle are tar hard links.
+//
+// Reading stages each backup next to the backup directory, hashing while it
+// streams, and moves it into place only once its manifest matches. Backups
+// whose metadata sidecar already exists are skipped without touching the
+// existing files, so importing the same bundle twice is harmless.
+class BackupBundle {
+public:
+    struct Stats {
+        int backups = 0;         // written, or imported
+        int skippedBackups = 0;  // already present when importing
+        int files = 0;
+        qint64 bytes = 0;
+    };
+
+    explicit BackupBundle(const QString &backupDir);
+
+    // Counts bytes streamed and aborts when cancelled
+    void setProgress(TransferProgress *progress);
+
+    // backups grouped by game, each game's oldest first, so delta bases and
+    // link targets come before what depends on them
+    bool write(QIODevice *out, const QList<BackupInfo> &backups, Stats *stats = nullptr);
+    // imported receives the new backups, with their archive paths (and
+    // sidecars) pointing into the backup directory
+    bool read(QIODevice *in, QList<BackupInfo> *imported = nullptr, Stats *stats = nullptr);
+
+private:
+    // Carried from one backup to the next while writing
+    struct ExportState {
+        QString gameId;
+        QString previousTree;       // last hard-linked snapshot of the game
+        QString previousTreeEntry;  // and its path in the bundle
+        QSet<QString> previousChunks;
+        bool dictionariesWritten = false;
+    };
+
+    // A file, directory or link staged since the last manifest
+    struct Pending {
+        QString type;  // "file", "dir", "symlink" or "hardlink"
+        qint64 size = 0;
+        QByteArray hash;
+        QString target;
+    };
+
+    bool writeBackup(struct archive *a, const BackupInfo &backup, ExportState &state, Stats *stats);
+    bool writeFile(struct archive *a, const QString &filePath, const QString &entryPath,
+                   QJsonArray *manifest, Stats *stats);
+    bool writeTree(struct archive *a, const QString &treePath, const QString &entryPath,
+                   const ExportState &state, QJsonArray *manifest, Stats *stats);
+    bool readEntry(struct archive *a, struct archive_entry *entry, const QString &path,
+                   const QString &staging, QHash<QString, Pending> &pending, Stats *stats);
+    bool commitBackup(const QByteArray &manifestData, const QString &staging,
+                      QHash<QString, Pending> &pending, QList<BackupInfo> *imported, Stats *stats);
+
+    QString m_backupDir;
+    TransferProgress *m_progress = nullptr;
+    QByteArray m_buffer;  // the one read buffer, reused for every file
+};
+
+#endif // BACKUPBUNDLE_H
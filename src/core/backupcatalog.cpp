@@ -0,0 +1,495 @@
+#include "backupcatalog.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QJsonDocument>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+std::atomic<quint64> s_nextId{1};
+
+quint64 threadToken()
+{
+    // Unlike thread ids, never reused by a later thread
+    thread_local const quint64 token = s_nextId++;
+    return token;
+}
+
+const char *const SelectColumns =
+    "SELECT id, game_id, game_name, display_name, notes, timestamp, archive_path, size,"
+    " profile_name, profile_id, format, pinned, compression_skipped FROM backups";
+
+// Relative to the games directory, like the rows' primary key
+QString sidecarKey(const QString &gameId, const BackupInfo &backup)
+{
+    return gameId + "/" + QFileInfo(backup.archivePath).fileName() + ".json";
+}
+
+QVariant toSecs(const QDateTime &time)
+{
+    return time.isValid() ? QVariant(time.toSecsSinceEpoch()) : QVariant();
+}
+
+QDateTime fromSecs(const QVariant &value)
+{
+    return value.isNull() ? QDateTime() : QDateTime::fromSecsSinceEpoch(value.toLongLong());
+}
+
+BackupInfo readRow(const QSqlQuery &query)
+{
+    BackupInfo backup;
+    backup.id = query.value(0).toString();
+    backup.gameId = query.value(1).toString();
+    backup.gameName = query.value(2).toString();
+    backup.displayName = query.value(3).toString();
+    backup.notes = query.value(4).toString();
+    backup.timestamp = fromSecs(query.value(5));
+    backup.archivePath = query.value(6).toString();
+    backup.size = query.value(7).toLongLong();
+    backup.profileName = query.value(8).toString();
+    backup.profileId = query.value(9).toInt();
+    backup.format = query.value(10).toString();
+    backup.pinned = query.value(11).toBool();
+    backup.compressionSkipped = query.value(12).toLongLong();
+    return backup;
+}
+
+bool writeRow(const QSqlDatabase &db, const QString &gameId, const BackupInfo &backup,
+              const QJsonValue &checksums)
+{
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO backups (sidecar, game_id, id, game_name, display_name,"
+                  " notes, timestamp, archive_path, size, profile_name, profile_id, format, pinned,"
+                  " compression_skipped, checksums) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    query.addBindValue(sidecarKey(gameId, backup));
+    query.addBindValue(gameId);
+    query.addBindValue(backup.id);
+    query.addBindValue(backup.gameName);
+    query.addBindValue(backup.displayName);
+    query.addBindValue(backup.notes);
+    query.addBindValue(toSecs(backup.timestamp));
+    query.addBindValue(backup.archivePath);
+    query.addBindValue(backup.size);
+    query.addBindValue(backup.profileName);
+    query.addBindValue(backup.profileId);
+    query.addBindValue(backup.format);
+    query.addBindValue(backup.pinned ? 1 : 0);
+    query.addBindValue(backup.compressionSkipped);
+    if (checksums.isObject()) {
+        query.addBindValue(QString::fromUtf8(
+            QJsonDocument(checksums.toObject()).toJson(QJsonDocument::Compact)));
+    } else {
+        query.addBindValue(QVariant());
+    }
+
+    if (!query.exec()) {
+        qWarning() << "Failed to update backup index:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+BackupCatalog::BackupCatalog(const QString &gamesDir)
+    : m_gamesDir(gamesDir)
+    , m_instance(s_nextId++)
+{
+}
+
+BackupCatalog::~BackupCatalog()
+{
+    closeConnections();
+}
+
+void BackupCatalog::setGamesDir(const QString &gamesDir)
+{
+    QMutexLocker locker(&m_syncMutex);
+    m_gamesDir = gamesDir;
+    m_synced = false;
+    m_cache.clear();
+}
+
+void BackupCatalog::setDatabasePath(const QString &path)
+{
+    QMutexLocker locker(&m_syncMutex);
+    closeConnections();
+    m_dbPath = path;
+    m_synced = false;
+    m_cache.clear();
+}
+
+bool BackupCatalog::usesDatabase()
+{
+    return ensureSynced();
+}
+
+QList<BackupInfo> BackupCatalog::backups(const QString &gameId)
+{
+    auto it = m_cache.constFind(gameId);
+    if (it != m_cache.constEnd()) {
+        return it.value();
+    }
+    QList<BackupInfo> list = ensureSynced() ? queryGame(gameId) : scan(gameId);
+    m_cache.insert(gameId, list);
+    return list;
+}
+
+void BackupCatalog::invalidate(const QString &gameId)
+{
+    m_cache.remove(gameId);
+}
+
+void BackupCatalog::clear()
+{
+    m_cache.clear();
+}
+
+QHash<QString, BackupSummary> BackupCatalog::summaries()
+{
+    QHash<QString, BackupSummary> result;
+
+    if (!ensureSynced()) {
+        for (const QString &gameId : gameDirs()) {
+            const QList<BackupInfo> list = backups(gameId);
+            if (list.isEmpty()) {
+                continue;
+            }
+            BackupSummary summary;
+            summary.gameId = gameId;
+            summary.gameName = list.first().gameName;
+            summary.latest = list.first().timestamp;
+            summary.count = list.size();
+            for (const BackupInfo &backup : list) {
+                summary.totalSize += backup.size;
+            }
+            result.insert(gameId, summary);
+        }
+        return result;
+    }
+
+    // SQLite takes the bare game_name from the row holding MAX(timestamp)
+    QSqlQuery query(connection());
+    if (!query.exec("SELECT game_id, game_name, MAX(timestamp), COUNT(*), SUM(size)"
+                    " FROM backups GROUP BY game_id")) {
+        qWarning() << "Failed to query backup index:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        BackupSummary summary;
+        summary.gameId = query.value(0).toString();
+        summary.gameName = query.value(1).toString();
+        summary.latest = fromSecs(query.value(2));
+        summary.count = query.value(3).toInt();
+        summary.totalSize = query.value(4).toLongLong();
+        result.insert(summary.gameId, summary);
+    }
+    return result;
+}
+
+BackupSummary BackupCatalog::totals()
+{
+    BackupSummary total;
+
+    if (!ensureSynced()) {
+        const QHash<QString, BackupSummary> perGame = summaries();
+        for (const BackupSummary &summary : perGame) {
+            total.count += summary.count;
+            total.totalSize += summary.totalSize;
+            if (!total.latest.isValid() || summary.latest > total.latest) {
+                total.latest = summary.latest;
+            }
+        }
+        return total;
+    }
+
+    QSqlQuery query(connection());
+    if (!query.exec("SELECT COUNT(*), COALESCE(SUM(size), 0), MAX(timestamp) FROM backups")
+        || !query.next()) {
+        qWarning() << "Failed to query backup index:" << query.lastError().text();
+        return total;
+    }
+    total.count = query.value(0).toInt();
+    total.totalSize = query.value(1).toLongLong();
+    total.latest = fromSecs(query.value(2));
+    return total;
+}
+
+QStringList BackupCatalog::staleGames(const QDateTime &cutoff)
+{
+    QStringList result;
+
+    if (!ensureSynced()) {
+        const QHash<QString, BackupSummary> perGame = summaries();
+        for (const BackupSummary &summary : perGame) {
+            if (summary.latest < cutoff) {
+                result.append(summary.gameId);
+            }
+        }
+        result.sort();
+        return result;
+    }
+
+    QSqlQuery query(connection());
+    query.prepare("SELECT game_id FROM backups GROUP BY game_id"
+                  " HAVING MAX(timestamp) < ? ORDER BY game_id");
+    query.addBindValue(cutoff.toSecsSinceEpoch());
+    if (!query.exec()) {
+        qWarning() << "Failed to query backup index:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        result.append(query.value(0).toString());
+    }
+    return result;
+}
+
+bool BackupCatalog::record(const BackupInfo &backup, const QJsonValue &checksums)
+{
+    if (!ensureSynced()) {
+        return false;
+    }
+    return writeRow(connection(), backup.gameId, backup, checksums);
+}
+
+bool BackupCatalog::remove(const BackupInfo &backup)
+{
+    if (!ensureSynced()) {
+        return false;
+    }
+    QSqlQuery query(connection());
+    query.prepare("DELETE FROM backups WHERE sidecar = ?");
+    query.addBindValue(sidecarKey(backup.gameId, backup));
+    if (!query.exec()) {
+        qWarning() << "Failed to update backup index:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QSqlDatabase BackupCatalog::connection() const
+{
+    const QString name = QString("backup-catalog-%1-%2").arg(m_instance).arg(threadToken());
+    if (QSqlDatabase::contains(name)) {
+        return QSqlDatabase::database(name);
+    }
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(m_dbPath);
+    {
+        QMutexLocker locker(&m_connectionsMutex);
+        m_connections.append(name);
+    }
+    if (!db.open()) {
+        qWarning() << "Failed to open backup index:" << db.lastError().text();
+        return db;
+    }
+
+    // Backup jobs on other threads write through their own connections
+    QSqlQuery query(db);
+    query.exec("PRAGMA busy_timeout=5000");
+    return db;
+}
+
+void BackupCatalog::closeConnections()
+{
+    QMutexLocker locker(&m_connectionsMutex);
+    for (const QString &name : std::as_const(m_connections)) {
+        QSqlDatabase::removeDatabase(name);
+    }
+    m_connections.clear();
+}
+
+bool BackupCatalog::ensureSynced()
+{
+    QMutexLocker locker(&m_syncMutex);
+    if (!m_synced) {
+        m_synced = true;
+        m_dbUsable = !m_dbPath.isEmpty() && !m_gamesDir.isEmpty() && sync();
+        if (!m_dbUsable && !m_dbPath.isEmpty()) {
+            qWarning() << "Backup index unavailable, reading sidecars instead";
+        }
+    }
+    return m_dbUsable;
+}
+
+bool BackupCatalog::sync()
+{
+    QSqlDatabase db = connection();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    QSet<QString> known;
+    if (!query.exec("SELECT sidecar FROM backups")) {
+        qWarning() << "Failed to read backup index:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        known.insert(query.value(0).toString());
+    }
+
+    db.transaction();
+    int imported = 0;
+    QSet<QString> seen;
+    for (const QString &gameId : gameDirs()) {
+        QDir dir(m_gamesDir + "/" + gameId);
+        // Index file of earlier versions, superseded by the table
+        QFile::remove(dir.filePath("catalog.jsonl"));
+
+        const QStringList sidecars = dir.entryList(QStringList() << "*.json", QDir::Files);
+        for (const QString &sidecar : sidecars) {
+            QString key = gameId + "/" + sidecar;
+            seen.insert(key);
+            if (known.contains(key)) {
+                continue;
+            }
+            QFile file(dir.absoluteFilePath(sidecar));
+            if (!file.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+            QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+            BackupInfo backup = fromJson(obj);
+            if (backup.id.isEmpty()) {
+                continue;
+            }
+            if (!writeRow(db, gameId, backup, obj.value("checksums"))) {
+                db.rollback();
+                return false;
+            }
+            ++imported;
+        }
+    }
+
+    int dropped = 0;
+    query.prepare("DELETE FROM backups WHERE sidecar = ?");
+    for (const QString &key : std::as_const(known)) {
+        if (seen.contains(key)) {
+            continue;
+        }
+        query.addBindValue(key);
+        if (!query.exec()) {
+            qWarning() << "Failed to update backup index:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+        ++dropped;
+    }
+
+    if (!db.commit()) {
+        qWarning() << "Failed to update backup index:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    if (imported > 0 || dropped > 0) {
+        qDebug() << "Backup index: imported" << imported << "sidecar(s), dropped" << dropped;
+    }
+    return true;
+}
+
+QList<BackupInfo> BackupCatalog::queryGame(const QString &gameId) const
+{
+    QList<BackupInfo> result;
+    QSqlQuery query(connection());
+    query.prepare(QString(SelectColumns) + " WHERE game_id = ? ORDER BY timestamp DESC");
+    query.addBindValue(gameId);
+    if (!query.exec()) {
+        qWarning() << "Failed to query backup index:" << query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        result.append(readRow(query));
+    }
+    return result;
+}
+
+QList<BackupInfo> BackupCatalog::scan(const QString &gameId) const
+{
+    if (m_gamesDir.isEmpty()) {
+        return QList<BackupInfo>();
+    }
+    return readSidecars(m_gamesDir + "/" + gameId);
+}
+
+QList<BackupInfo> BackupCatalog::readSidecars(const QString &gameDir)
+{
+    QList<BackupInfo> result;
+    QDir dir(gameDir);
+    if (!dir.exists()) {
+        return result;
+    }
+
+    const QStringList sidecars = dir.entryList(QStringList() << "*.json", QDir::Files);
+    for (const QString &sidecar : sidecars) {
+        QFile file(dir.absoluteFilePath(sidecar));
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        BackupInfo backup = fromJson(QJsonDocument::fromJson(file.readAll()).object());
+        if (!backup.id.isEmpty()) {
+            result.append(backup);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const BackupInfo &a, const BackupInfo &b) {
+        return a.timestamp > b.timestamp;
+    });
+    return result;
+}
+
+QStringList BackupCatalog::gameDirs() const
+{
+    if (m_gamesDir.isEmpty()) {
+        return QStringList();
+    }
+    return QDir(m_gamesDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+}
+
+QJsonObject BackupCatalog::toJson(const BackupInfo &backup)
+{
+    QJsonObject obj;
+    obj["id"] = backup.id;
+    obj["gameId"] = backup.gameId;
+    obj["gameName"] = backup.gameName;
+    obj["displayName"] = backup.displayName;
+    obj["notes"] = backup.notes;
+    obj["timestamp"] = backup.timestamp.toString(Qt::ISODate);
+    obj["archivePath"] = backup.archivePath;
+    obj["size"] = backup.size;
+    obj["profileName"] = backup.profileName;
+    obj["profileId"] = backup.profileId;
+    obj["format"] = backup.format;
+    if (backup.pinned) {
+        obj["pinned"] = true;
+    }
+    if (backup.compressionSkipped > 0) {
+        obj["compressionSkipped"] = backup.compressionSkipped;
+    }
+    return obj;
+}
+
+BackupInfo BackupCatalog::fromJson(const QJsonObject &obj)
+{
+    BackupInfo backup;
+    backup.id = obj["id"].toString();
+    backup.gameId = obj["gameId"].toString();
+    backup.gameName = obj["gameName"].toString();
+    backup.displayName = obj["displayName"].toString();
+    backup.notes = obj["notes"].toString();
+    backup.timestamp = QDateTime::fromString(obj["timestamp"].toString(), Qt::ISODate);
+    backup.archivePath = obj["archivePath"].toString();
+    backup.size = obj["size"].toInteger();
+    backup.profileName = obj["profileName"].toString();
+    backup.profileId = obj["profileId"].toInt(-1);
+    backup.format = obj["format"].toString("tar.gz");
+    backup.pinned = obj["pinned"].toBool();
+    backup.compressionSkipped = obj["compressionSkipped"].toInteger();
+    return backup;
+}
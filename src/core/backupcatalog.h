@@ -0,0 +1,84 @@
+#ifndef BACKUPCATALOG_H
+#define BACKUPCATALOG_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QSqlDatabase>
+#include "gameinfo.h"
+
+// Index of backup metadata, so listing backups and the per-game totals in
+// the game list do not parse every .json sidecar.
+//
+// With a database set, metadata lives in its backups table, indexed on
+// (game_id, timestamp), and totals are single aggregate queries. The first
+// query after the database or backup directory is set syncs the table with
+// the sidecars on disk: new sidecars are parsed and imported, rows whose
+// sidecar is gone are dropped. Only names are compared, so this is one
+// readdir per game.
+//
+// Sidecars are still written next to every archive and are what the table
+// is rebuilt from. Without a database, or if it cannot be opened, the
+// catalog reads them directly.
+class BackupCatalog {
+public:
+    explicit BackupCatalog(const QString &gamesDir = QString());
+    ~BackupCatalog();
+
+    void setGamesDir(const QString &gamesDir);
+
+    // SQLite file holding the backups table (Database creates it)
+    void setDatabasePath(const QString &path);
+    bool usesDatabase();
+
+    // Newest first. Served from memory until the game is invalidated.
+    QList<BackupInfo> backups(const QString &gameId);
+    void invalidate(const QString &gameId);
+    void clear();
+
+    // Per game, and the total over all games (gameId left empty)
+    QHash<QString, BackupSummary> summaries();
+    BackupSummary totals();
+    // Games whose newest backup is older than the cutoff
+    QStringList staleGames(const QDateTime &cutoff);
+
+    // Persist a change whose sidecar has already been written or removed
+    bool record(const BackupInfo &backup, const QJsonValue &checksums = QJsonValue());
+    bool remove(const BackupInfo &backup);
+
+    static QJsonObject toJson(const BackupInfo &backup);
+    static BackupInfo fromJson(const QJsonObject &obj);
+    // Parses the sidecars in one game's directory, newest first. Touches
+    // nothing but the files, so any thread may call it.
+    static QList<BackupInfo> readSidecars(const QString &gameDir);
+
+private:
+    QSqlDatabase connection() const;
+    void closeConnections();
+    bool ensureSynced();
+    bool sync();
+    QList<BackupInfo> queryGame(const QString &gameId) const;
+    QList<BackupInfo> scan(const QString &gameId) const;
+    QStringList gameDirs() const;
+
+    QString m_gamesDir;
+    QString m_dbPath;
+    QHash<QString, QList<BackupInfo>> m_cache;
+
+    // Qt SQL connections cannot be shared between threads, so each thread
+    // that touches the catalog gets its own
+    const quint64 m_instance;
+    mutable QMutex m_connectionsMutex;
+    mutable QStringList m_connections;
+
+    QMutex m_syncMutex;
+    bool m_synced = false;
+    bool m_dbUsable = false;
+};
+
+#endif // BACKUPCATALOG_H
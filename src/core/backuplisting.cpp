@@ -0,0 +1,97 @@
+#include "backuplisting.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+namespace {
+
+QJsonObject archiveStamp(const QString &archivePath)
+{
+    QFileInfo info(archivePath);
+    QJsonObject stamp;
+    stamp["size"] = info.size();
+    stamp["mtime"] = info.lastModified().toMSecsSinceEpoch();
+    return stamp;
+}
+
+} // namespace
+
+QString BackupListing::cachePath(const QString &archivePath)
+{
+    return archivePath + ".contents";
+}
+
+QList<BackupEntry> BackupListing::load(const QString &archivePath, bool *ok)
+{
+    QList<BackupEntry> entries;
+    if (ok) *ok = false;
+
+    QFileInfo archive(archivePath);
+    QFile file(cachePath(archivePath));
+    if (!archive.exists() || archive.isDir() || !file.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root["version"].toInt() != 1 || root["archive"].toObject() != archiveStamp(archivePath)) {
+        return entries;
+    }
+
+    const QJsonArray array = root["entries"].toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject obj = value.toObject();
+        BackupEntry entry;
+        entry.path = obj["path"].toString();
+        entry.type = obj["type"].toString();
+        entry.size = obj["size"].toInteger();
+        entry.mtime = QDateTime::fromSecsSinceEpoch(obj["mtime"].toInteger());
+        entry.hash = obj["hash"].toString().toLatin1();
+        entry.linkTarget = obj["target"].toString();
+        entries.append(entry);
+    }
+
+    if (ok) *ok = true;
+    return entries;
+}
+
+bool BackupListing::save(const QString &archivePath, const QList<BackupEntry> &entries)
+{
+    // A directory's mtime misses changes further down its tree, and walking
+    // it costs about as much as reading a cache would
+    if (QFileInfo(archivePath).isDir()) {
+        QFile::remove(cachePath(archivePath));
+        return true;
+    }
+
+    QJsonArray array;
+    for (const BackupEntry &entry : entries) {
+        QJsonObject obj;
+        obj["path"] = entry.path;
+        obj["type"] = entry.type;
+        obj["mtime"] = entry.mtime.toSecsSinceEpoch();
+        if (entry.type == "file") {
+            obj["size"] = entry.size;
+            if (!entry.hash.isEmpty()) {
+                obj["hash"] = QString::fromLatin1(entry.hash);
+            }
+        } else if (entry.type == "symlink") {
+            obj["target"] = entry.linkTarget;
+        }
+        array.append(obj);
+    }
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["archive"] = archiveStamp(archivePath);
+    root["entries"] = array;
+
+    QSaveFile file(cachePath(archivePath));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
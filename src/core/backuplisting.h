@@ -0,0 +1,22 @@
+#ifndef BACKUPLISTING_H
+#define BACKUPLISTING_H
+
+#include <QString>
+#include <QList>
+#include "gameinfo.h"
+
+// Cached contents of one backup, kept next to it as <archive>.contents so
+// browsing a backup again does not re-read its index or rescan the
+// compressed stream. The cache records the archive's size and mtime and is
+// ignored once either changes, e.g. after a delta backup is re-based.
+// Directory backups (hardlinks) are never cached: they are listed directly.
+class BackupListing {
+public:
+    static QString cachePath(const QString &archivePath);
+
+    // Fails when there is no cache or it no longer matches the archive
+    static QList<BackupEntry> load(const QString &archivePath, bool *ok = nullptr);
+    static bool save(const QString &archivePath, const QList<BackupEntry> &entries);
+};
+
+#endif // BACKUPLISTING_H
@@ -0,0 +1,494 @@
+#include "batchfilereader.h"
+#include "lowimpactio.h"
+#include <QFile>
+#include <QDebug>
+
+#if defined(Q_OS_LINUX) && __has_include(<linux/io_uring.h>)
+#define GAME_REWIND_IO_URING
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Prepared operations are handed to the kernel once this many pile up, or
+// as soon as the consumer has to wait
+constexpr unsigned kSubmitBatch = 8;
+
+} // namespace
+
+#ifdef GAME_REWIND_IO_URING
+
+// The raw io_uring interface: a submission and a completion ring shared with
+// the kernel through mmap, driven by io_uring_enter
+struct BatchFileReader::Ring {
+    int fd = -1;
+    unsigned entries = 0;
+    void *sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void *cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    void *sqes = MAP_FAILED;
+    size_t sqesSize = 0;
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+    // Next free submission slot; published to the kernel by enter()
+    unsigned localTail = 0;
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool setup(unsigned depth)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = int(::syscall(__NR_io_uring_setup, depth, &params));
+        if (fd < 0) {
+            return false;
+        }
+        entries = params.sq_entries;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        cqRing = singleMmap ? sqRing
+                            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                   IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char *sq = static_cast<char *>(sqRing);
+        sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        char *cq = static_cast<char *>(cqRing);
+        cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        localTail = *sqTail;
+        return supportsOperations();
+    }
+
+    // OPENAT, READ and CLOSE came with 5.6, as did the probe itself
+    bool supportsOperations()
+    {
+        const unsigned opCount = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op), 0);
+        auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, opCount) < 0) {
+            return false;
+        }
+        for (int op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A zeroed submission entry, or nullptr when the ring is full
+    io_uring_sqe *nextSqe()
+    {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (localTail - head >= entries) {
+            return nullptr;
+        }
+        unsigned index = localTail & *sqMask;
+        io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes) + index;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        localTail++;
+        return sqe;
+    }
+
+    unsigned unsubmitted() const
+    {
+        return localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    }
+
+    // Submits everything prepared and waits for minComplete completions
+    bool enter(unsigned minComplete)
+    {
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+        for (;;) {
+            long ret = ::syscall(__NR_io_uring_enter, fd, unsubmitted(), minComplete,
+                                 minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (ret >= 0) {
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            // Out of kernel resources for now; what is in flight still completes
+            return errno == EAGAIN || errno == EBUSY;
+        }
+    }
+
+    template <typename Handler>
+    void reap(Handler handler)
+    {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe &cqe = cqes[head & *cqMask];
+            handler(cqe.user_data, cqe.res);
+            head++;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+};
+
+#else
+
+struct BatchFileReader::Ring {
+};
+
+#endif
+
+BatchFileReader::BatchFileReader(bool useIoUring, int queueDepth)
+    : m_queueDepth(qMax(1, queueDepth))
+{
+#ifdef GAME_REWIND_IO_URING
+    if (useIoUring && ioUringAvailable()) {
+        // Room for one operation per queued file plus the closes behind them
+        m_ring = std::make_unique<Ring>();
+        if (!m_ring->setup(unsigned(m_queueDepth) * 2)) {
+            m_ring.reset();
+        }
+    }
+#else
+    Q_UNUSED(useIoUring);
+#endif
+}
+
+BatchFileReader::~BatchFileReader()
+{
+#ifdef GAME_REWIND_IO_URING
+    // The kernel may still be reading into files that were never consumed
+    m_draining = true;
+    while (m_ring && !m_ringBroken && m_inFlight > 0) {
+        if (!m_ring->enter(1)) {
+            break;
+        }
+        reap();
+    }
+    for (File &file : m_files) {
+        if (file.fd >= 0) {
+            ::close(file.fd);
+        }
+    }
+#endif
+}
+
+bool BatchFileReader::ioUringAvailable()
+{
+#ifdef GAME_REWIND_IO_URING
+    static const bool available = [] {
+        Ring ring;
+        return ring.setup(2);
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+bool BatchFileReader::usesIoUring() const
+{
+    return m_ring != nullptr;
+}
+
+int BatchFileReader::queueDepth() const
+{
+    return m_queueDepth;
+}
+
+void BatchFileReader::enqueue(const QString &path, qint64 size)
+{
+    File file;
+    file.path = path;
+    file.size = qMax<qint64>(0, size);
+    file.prefetch = m_ring && file.size <= PrefetchLimit;
+    if (file.prefetch) {
+        file.nativePath = QFile::encodeName(path);
+    }
+    m_files.push_back(std::move(file));
+
+#ifdef GAME_REWIND_IO_URING
+    if (m_ring) {
+        startPrefetches();
+        if (m_ring->unsubmitted() >= kSubmitBatch && !m_ring->enter(0)) {
+            qWarning() << "io_uring submission failed:" << strerror(errno);
+        }
+    }
+#endif
+}
+
+int BatchFileReader::pending() const
+{
+    return int(m_files.size());
+}
+
+bool BatchFileReader::readNext(const Sink &sink, bool *readOk)
+{
+    if (readOk) *readOk = false;
+    if (m_files.empty()) {
+        return true;
+    }
+    File &file = m_files.front();
+
+#ifdef GAME_REWIND_IO_URING
+    if (m_ring && file.prefetch) {
+        startPrefetches();
+        while (file.state == File::Opening || file.state == File::Reading) {
+            if (!m_ring->enter(1)) {
+                qWarning() << "io_uring_enter failed, reading directly:" << strerror(errno);
+                abandonRing();
+                break;
+            }
+            reap();
+        }
+    }
+#endif
+
+    bool ok = true;
+    bool accepted;
+    if (file.state == File::Done) {
+        accepted = file.data.isEmpty() || sink(file.data.constData(), file.data.size());
+    } else {
+        accepted = readDirect(file, sink, &ok);
+    }
+
+    if (file.prefetch && file.state != File::Queued) {
+        m_started--;
+    }
+    m_files.pop_front();
+    if (m_nextToStart > 0) {
+        m_nextToStart--;
+    }
+
+#ifdef GAME_REWIND_IO_URING
+    if (m_ring) {
+        startPrefetches();
+        if (m_ring->unsubmitted() > 0) {
+            m_ring->enter(0);
+        }
+    }
+#endif
+
+    if (readOk) *readOk = ok;
+    return accepted;
+}
+
+bool BatchFileReader::readDirect(const File &file, const Sink &sink, bool *readOk)
+{
+    QFile in(file.path);
+    if (!in.open(QIODevice::ReadOnly)) {
+        *readOk = false;
+        return true;
+    }
+    if (m_buffer.size() < ReadChunkSize) {
+        m_buffer.resize(ReadChunkSize);
+    }
+    qint64 remaining = file.size;
+    while (remaining > 0) {
+        qint64 n = in.read(m_buffer.data(), qMin(remaining, ReadChunkSize));
+        if (n < 0) {
+            *readOk = false;
+            return true;
+        }
+        if (n == 0) {
+            break;
+        }
+        remaining -= n;
+        if (!sink(m_buffer.constData(), n)) {
+            return false;
+        }
+    }
+    LowImpactIo::dropCache(in.handle());
+    return true;
+}
+
+void BatchFileReader::startPrefetches()
+{
+#ifdef GAME_REWIND_IO_URING
+    if (m_ringBroken) {
+        return;
+    }
+    for (; m_nextToStart < m_files.size() && m_started < m_queueDepth; ++m_nextToStart) {
+        File &file = m_files[m_nextToStart];
+        if (!file.prefetch) {
+            continue;
+        }
+        io_uring_sqe *sqe = m_ring->nextSqe();
+        if (!sqe) {
+            return;
+        }
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<quint64>(file.nativePath.constData());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        sqe->user_data = reinterpret_cast<quint64>(&file);
+        file.state = File::Opening;
+        m_started++;
+        m_inFlight++;
+    }
+#endif
+}
+
+void BatchFileReader::submitRead(File &file)
+{
+#ifdef GAME_REWIND_IO_URING
+    io_uring_sqe *sqe = m_draining ? nullptr : m_ring->nextSqe();
+    if (!sqe) {
+        // readNext falls back to reading it directly
+        finish(file, File::Failed);
+        return;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = file.fd;
+    sqe->addr = reinterpret_cast<quint64>(file.data.data() + file.bytesRead);
+    sqe->len = unsigned(file.size - file.bytesRead);
+    sqe->off = quint64(file.bytesRead);
+    sqe->user_data = reinterpret_cast<quint64>(&file);
+    file.state = File::Reading;
+    m_inFlight++;
+#else
+    Q_UNUSED(file);
+#endif
+}
+
+void BatchFileReader::finish(File &file, File::State state)
+{
+#ifdef GAME_REWIND_IO_URING
+    if (file.fd >= 0) {
+        if (state == File::Done) {
+            LowImpactIo::dropCache(file.fd);
+        }
+        io_uring_sqe *sqe = m_draining ? nullptr : m_ring->nextSqe();
+        if (sqe) {
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = file.fd;
+            sqe->user_data = 0;
+            m_inFlight++;
+        } else {
+            ::close(file.fd);
+        }
+        file.fd = -1;
+    }
+#endif
+    if (state == File::Failed) {
+        file.data.clear();
+    }
+    file.state = state;
+}
+
+void BatchFileReader::handleCompletion(quint64 userData, int result)
+{
+    m_inFlight--;
+    // A close
+    if (userData == 0) {
+        return;
+    }
+    File &file = *reinterpret_cast<File *>(userData);
+    if (file.state == File::Opening) {
+        if (result < 0) {
+            file.state = File::Failed;
+            return;
+        }
+        file.fd = result;
+        if (file.size == 0 || m_draining) {
+            finish(file, m_draining ? File::Failed : File::Done);
+            return;
+        }
+        file.data.resize(file.size);
+        submitRead(file);
+    } else if (file.state == File::Reading) {
+        if (result < 0) {
+            finish(file, File::Failed);
+            return;
+        }
+        file.bytesRead += result;
+        if (result == 0 || file.bytesRead >= file.size) {
+            // A file that shrank since its stat ends early
+            file.data.truncate(file.bytesRead);
+            finish(file, File::Done);
+        } else if (m_draining) {
+            finish(file, File::Failed);
+        } else {
+            submitRead(file);
+        }
+    }
+}
+
+void BatchFileReader::abandonRing()
+{
+#ifdef GAME_REWIND_IO_URING
+    // Completions are never reaped after this, so nothing in flight may be
+    // freed: keep the buffers the kernel may still write to
+    for (File &file : m_files) {
+        if (file.state != File::Opening && file.state != File::Reading) {
+            continue;
+        }
+        m_orphans.append(file.data);
+        file.data = QByteArray();
+        if (file.fd >= 0) {
+            ::close(file.fd);
+            file.fd = -1;
+        }
+        file.state = File::Failed;
+    }
+    m_ringBroken = true;
+#endif
+}
+
+void BatchFileReader::reap()
+{
+#ifdef GAME_REWIND_IO_URING
+    m_ring->reap([this](quint64 userData, int result) {
+        handleCompletion(userData, result);
+    });
+#endif
+}
@@ -0,0 +1,89 @@
+#ifndef BATCHFILEREADER_H
+#define BATCHFILEREADER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <deque>
+#include <functional>
+#include <memory>
+
+// Reads a sequence of files in order, opening and reading the next ones
+// while the current one is consumed. A save made of thousands of small files
+// spends most of a backup waiting on open/read/close one file at a time;
+// through io_uring the opens and reads of up to queueDepth small files are in
+// flight at once, submitted in batches, so their latency overlaps. Where
+// io_uring is missing (kernels before 5.6, Linux with it disabled, seccomp
+// sandboxes, other platforms) each file is read with a QFile loop when its
+// turn comes.
+//
+// Not thread safe: one reader per archive being written.
+class BatchFileReader {
+public:
+    static constexpr int DefaultQueueDepth = 32;
+    // Larger files are read when consumed: their time goes to reading, not
+    // to opening, and prefetching them would hold too much memory
+    static constexpr qint64 PrefetchLimit = 256 * 1024;
+    // Slices handed to the sink for files read directly
+    static constexpr qint64 ReadChunkSize = 64 * 1024;
+
+    // Returns false to stop reading
+    using Sink = std::function<bool(const char *data, qsizetype size)>;
+
+    explicit BatchFileReader(bool useIoUring = true, int queueDepth = DefaultQueueDepth);
+    ~BatchFileReader();
+
+    // True if io_uring with the operations used here can be set up (checked once)
+    static bool ioUringAvailable();
+    bool usesIoUring() const;
+    int queueDepth() const;
+
+    // Queues a file. size comes from a stat; at most that many bytes are read,
+    // so what is read always matches an archive header written from it.
+    void enqueue(const QString &path, qint64 size);
+    int pending() const;
+
+    // Feeds the oldest queued file to sink and dequeues it. Returns false only
+    // if the sink stopped; readOk is false if the file could not be read, in
+    // which case the sink may have received part of it or nothing.
+    bool readNext(const Sink &sink, bool *readOk = nullptr);
+
+private:
+    struct Ring;
+
+    struct File {
+        enum State { Queued, Opening, Reading, Done, Failed };
+        QString path;
+        QByteArray nativePath;
+        qint64 size = 0;
+        bool prefetch = false;
+        State state = Queued;
+        int fd = -1;
+        QByteArray data;
+        qint64 bytesRead = 0;
+    };
+
+    bool readDirect(const File &file, const Sink &sink, bool *readOk);
+    void startPrefetches();
+    void submitRead(File &file);
+    void finish(File &file, File::State state);
+    void handleCompletion(quint64 userData, int result);
+    void abandonRing();
+    void reap();
+
+    int m_queueDepth;
+    // A deque, so files stay put while the kernel works on them
+    std::deque<File> m_files;
+    size_t m_nextToStart = 0;
+    int m_started = 0;   // prefetched files not yet consumed
+    int m_inFlight = 0;  // submitted operations not yet completed
+    bool m_draining = false;
+    QByteArray m_buffer;
+    // Set when io_uring_enter failed; the rest is read directly
+    bool m_ringBroken = false;
+    // Buffers the kernel may still write to after that
+    QList<QByteArray> m_orphans;
+    std::unique_ptr<Ring> m_ring;
+};
+
+#endif // BATCHFILEREADER_H
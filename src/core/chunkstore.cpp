@@ -0,0 +1,617 @@
+#include "chunkstore.h"
+#include "archiveindex.h"
+#include "compressibility.h"
+#include "filechecksums.h"
+#include "lowimpactio.h"
+#include "transferprogress.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <array>
+
+namespace {
+
+// FastCDC-style boundaries: never cut before kMinChunkSize, force a cut at
+// kMaxChunkSize, and aim for an average of 2^kAverageBits bytes in between.
+constexpr qsizetype kMinChunkSize = 16 * 1024;
+constexpr qsizetype kMaxChunkSize = 256 * 1024;
+constexpr int kAverageBits = 16;
+// The gear hash mixes new bytes into the low bits, so test the high bits
+constexpr quint64 kBoundaryMask = ((quint64(1) << kAverageBits) - 1) << (64 - kAverageBits);
+
+// Chunk files start with a one-byte codec tag
+constexpr char kCodecZlib = 'z';
+// A zstd frame; its header names the dictionary in dicts/
+constexpr char kCodecZstdDictionary = 'd';
+constexpr char kCodecRaw = 'r';
+
+const std::array<quint64, 256> &gearTable()
+{
+    // splitmix64 with a fixed seed: the table must never change, otherwise
+    // chunk boundaries (and therefore deduplication) shift between versions.
+    static const std::array<quint64, 256> table = [] {
+        std::array<quint64, 256> t{};
+        quint64 state = 0x67616d6572657769ULL;
+        for (quint64 &value : t) {
+            state += 0x9E3779B97F4A7C15ULL;
+            quint64 z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            value = z ^ (z >> 31);
+        }
+        return t;
+    }();
+    return table;
+}
+
+qsizetype findChunkBoundary(const uchar *data, qsizetype size)
+{
+    if (size <= kMinChunkSize) {
+        return size;
+    }
+
+    const std::array<quint64, 256> &gear = gearTable();
+    const qsizetype limit = qMin(size, kMaxChunkSize);
+    quint64 hash = 0;
+    for (qsizetype i = kMinChunkSize; i < limit; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & kBoundaryMask) == 0) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
+
+QString hashChunk(const char *data, qsizetype size)
+{
+    return QString::fromLatin1(
+        QCryptographicHash::hash(QByteArray::fromRawData(data, size), QCryptographicHash::Blake2b_256).toHex());
+}
+
+} // namespace
+
+ChunkStore::ChunkStore(const QString &rootDir)
+    : m_rootDir(rootDir)
+{
+}
+
+QString ChunkStore::rootDir() const
+{
+    return m_rootDir;
+}
+
+void ChunkStore::setCompressionLevel(int level)
+{
+    if (level >= 1 && level <= 9) {
+        m_compressionLevel = level;
+    }
+}
+
+void ChunkStore::setDictionary(const ZstdDictionary &dictionary)
+{
+    m_dictionary = dictionary;
+    m_dictionaryStored = false;
+}
+
+void ChunkStore::setProgress(TransferProgress *progress)
+{
+    m_progress = progress;
+}
+
+void ChunkStore::setChecksums(FileChecksums *checksums)
+{
+    m_checksums = checksums;
+}
+
+QString ChunkStore::chunkPath(const QString &hash) const
+{
+    return m_rootDir + "/" + hash.left(2) + "/" + hash;
+}
+
+QString ChunkStore::dictionaryPath(quint32 id) const
+{
+    return m_rootDir + "/dicts/" + QString::number(id, 16).rightJustified(8, '0') + ".zdict";
+}
+
+bool ChunkStore::storeDictionary()
+{
+    QString path = dictionaryPath(m_dictionary.id());
+    if (QFile::exists(path)) {
+        // Ids are random 32-bit values; never mix up two dictionaries
+        ZstdDictionary stored = ZstdDictionary::load(path);
+        if (stored.data() != m_dictionary.data()) {
+            qWarning() << "Another dictionary with the same id is in the chunk store:" << path;
+            return false;
+        }
+        return true;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    return m_dictionary.save(path);
+}
+
+ZstdDictionary ChunkStore::loadDictionary(quint32 id) const
+{
+    auto it = m_dictionaries.constFind(id);
+    if (it != m_dictionaries.constEnd()) {
+        return it.value();
+    }
+    ZstdDictionary dictionary = ZstdDictionary::load(dictionaryPath(id));
+    if (dictionary.isNull() || dictionary.id() != id) {
+        qWarning() << "Missing compression dictionary" << dictionaryPath(id);
+        dictionary = ZstdDictionary();
+    }
+    m_dictionaries.insert(id, dictionary);
+    return dictionary;
+}
+
+bool ChunkStore::hasChunk(const QString &hash) const
+{
+    return QFile::exists(chunkPath(hash));
+}
+
+QString ChunkStore::storeChunk(const char *data, qsizetype size, Stats *stats)
+{
+    QString hash = hashChunk(data, size);
+    if (stats) stats->chunks++;
+
+    QString path = chunkPath(hash);
+    if (QFile::exists(path)) {
+        return hash;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    if (!m_dictionary.isNull() && !m_dictionaryStored && !storeDictionary()) {
+        m_dictionary = ZstdDictionary();
+    }
+    m_dictionaryStored = true;
+
+    char codec = kCodecZstdDictionary;
+    QByteArray payload;
+    if (Compressibility::isIncompressible(data, size)) {
+        codec = kCodecRaw;
+        payload = QByteArray(data, size);
+    } else {
+        payload = m_dictionary.compress(data, size, m_compressionLevel);
+    }
+    if (payload.isEmpty()) {
+        codec = kCodecZlib;
+        payload = qCompress(reinterpret_cast<const uchar *>(data), size, m_compressionLevel);
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write chunk:" << path;
+        return QString();
+    }
+    file.write(&codec, 1);
+    file.write(payload);
+    if (!file.commit()) {
+        qWarning() << "Failed to commit chunk:" << path;
+        return QString();
+    }
+    LowImpactIo::dropCache(path, true);
+
+    if (stats) {
+        stats->newChunks++;
+        stats->bytesStored += payload.size() + 1;
+        if (codec == kCodecRaw) {
+            stats->bytesSkipped += size;
+        }
+    }
+    return hash;
+}
+
+QByteArray ChunkStore::readChunk(const QString &hash, bool *ok) const
+{
+    if (ok) *ok = false;
+
+    QFile file(chunkPath(hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QByteArray raw = file.readAll();
+    file.close();
+
+    if (raw.isEmpty()) {
+        return QByteArray();
+    }
+
+    QByteArray data;
+    if (raw.at(0) == kCodecZlib) {
+        data = qUncompress(reinterpret_cast<const uchar *>(raw.constData()) + 1, raw.size() - 1);
+    } else if (raw.at(0) == kCodecRaw) {
+        // No checksum of its own, unlike a zlib or zstd frame
+        data = raw.mid(1);
+        if (hashChunk(data.constData(), data.size()) != hash) {
+            return QByteArray();
+        }
+    } else if (raw.at(0) == kCodecZstdDictionary) {
+        const char *frame = raw.constData() + 1;
+        ZstdDictionary dictionary = loadDictionary(ZstdDictionary::frameDictionaryId(frame, raw.size() - 1));
+        data = dictionary.decompress(frame, raw.size() - 1, kMaxChunkSize);
+    }
+    if (data.isEmpty()) {
+        return QByteArray();
+    }
+
+    if (ok) *ok = true;
+    return data;
+}
+
+bool ChunkStore::storeFile(const QString &filePath, Entry &entry, Stats *stats)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open file for chunking:" << filePath;
+        return false;
+    }
+
+    // Keep at least kMaxChunkSize bytes buffered (until EOF) so boundaries
+    // depend only on content, never on how the reads happened to split.
+    QByteArray buffer;
+    buffer.reserve(2 * kMaxChunkSize);
+    bool eof = false;
+    FileChecksums::Hasher hasher;
+
+    while (true) {
+        while (!eof && buffer.size() < kMaxChunkSize) {
+            qsizetype oldSize = buffer.size();
+            buffer.resize(2 * kMaxChunkSize);
+            qint64 n = file.read(buffer.data() + oldSize, buffer.size() - oldSize);
+            if (n < 0) {
+                qWarning() << "Failed to read file:" << filePath;
+                return false;
+            }
+            buffer.resize(oldSize + n);
+            if (n == 0) eof = true;
+        }
+
+        if (buffer.isEmpty()) {
+            break;
+        }
+
+        qsizetype cut = findChunkBoundary(reinterpret_cast<const uchar *>(buffer.constData()), buffer.size());
+        QString hash = storeChunk(buffer.constData(), cut, stats);
+        if (hash.isEmpty()) {
+            return false;
+        }
+        entry.chunks.append(hash);
+        entry.size += cut;
+        hasher.addData(buffer.constData(), cut);
+        buffer.remove(0, cut);
+        if (m_progress && !m_progress->addBytes(cut)) {
+            return false;
+        }
+    }
+
+    LowImpactIo::dropCache(file.handle());
+    if (m_checksums) {
+        m_checksums->insert(entry.path, hasher.result());
+    }
+
+    if (stats) {
+        stats->files++;
+        stats->bytesIn += entry.size;
+    }
+    if (m_progress) {
+        m_progress->addFile();
+    }
+    return true;
+}
+
+bool ChunkStore::addFile(const QFileInfo &fi, Entry &entry, Stats *stats,
+                         const QHash<QString, QStringList> &knownChunks)
+{
+    entry.type = "file";
+    entry.executable = fi.isExecutable();
+
+    auto known = knownChunks.constFind(entry.path);
+    if (known != knownChunks.constEnd()) {
+        bool complete = true;
+        for (const QString &hash : known.value()) {
+            if (!hasChunk(hash)) {
+                complete = false;
+                break;
+            }
+        }
+        if (complete) {
+            entry.chunks = known.value();
+            entry.size = fi.size();
+            if (stats) {
+                stats->files++;
+                stats->reusedFiles++;
+                stats->chunks += entry.chunks.size();
+            }
+            if (m_progress) {
+                m_progress->addBytes(entry.size);
+                m_progress->addFile();
+            }
+            return true;
+        }
+    }
+
+    return storeFile(fi.absoluteFilePath(), entry, stats);
+}
+
+void ChunkStore::addDirectory(const QString &baseDir, const QString &relativePath,
+                              QList<Entry> &entries, Stats *stats, bool &ok,
+                              const QHash<QString, QStringList> &knownChunks)
+{
+    QDir dir(baseDir + "/" + relativePath);
+    QFileInfoList infos = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden | QDir::System,
+                                            QDir::DirsFirst | QDir::Name);
+
+    for (const QFileInfo &fi : infos) {
+        if (!ok) return;
+
+        Entry entry;
+        entry.path = relativePath + "/" + fi.fileName();
+        entry.mtime = fi.lastModified().toSecsSinceEpoch();
+
+        if (fi.isSymLink()) {
+            entry.type = "symlink";
+            entry.linkTarget = fi.symLinkTarget();
+            entries.append(entry);
+        } else if (fi.isDir()) {
+            entry.type = "dir";
+            entries.append(entry);
+            addDirectory(baseDir, entry.path, entries, stats, ok, knownChunks);
+        } else if (fi.isFile()) {
+            if (!addFile(fi, entry, stats, knownChunks)) {
+                ok = false;
+                return;
+            }
+            entries.append(entry);
+        }
+    }
+}
+
+bool ChunkStore::writeSnapshot(const QString &baseDir, const QStringList &relativePaths,
+                               const QString &manifestPath, Stats *stats,
+                               const QHash<QString, QStringList> &knownChunks)
+{
+    QList<Entry> entries;
+    bool ok = true;
+    int found = 0;
+
+    for (const QString &relPath : relativePaths) {
+        QFileInfo fi(baseDir + "/" + relPath);
+        if (!fi.exists()) {
+            qWarning() << "Snapshot path not found, skipping:" << fi.filePath();
+            continue;
+        }
+        found++;
+
+        Entry entry;
+        entry.path = relPath;
+        entry.mtime = fi.lastModified().toSecsSinceEpoch();
+
+        if (fi.isDir()) {
+            entry.type = "dir";
+            entries.append(entry);
+            addDirectory(baseDir, relPath, entries, stats, ok, knownChunks);
+        } else {
+            ok = addFile(fi, entry, stats, knownChunks);
+            entries.append(entry);
+        }
+
+        if (!ok) break;
+    }
+
+    if (!ok || found == 0) {
+        return false;
+    }
+
+    return saveManifest(entries, manifestPath);
+}
+
+bool ChunkStore::saveManifest(const QList<Entry> &entries, const QString &manifestPath)
+{
+    QJsonArray array;
+    for (const Entry &entry : entries) {
+        QJsonObject obj;
+        obj["path"] = entry.path;
+        obj["type"] = entry.type;
+        obj["mtime"] = entry.mtime;
+        if (entry.type == "file") {
+            obj["size"] = entry.size;
+            obj["chunks"] = QJsonArray::fromStringList(entry.chunks);
+            if (entry.executable) obj["exec"] = true;
+        } else if (entry.type == "symlink") {
+            obj["target"] = entry.linkTarget;
+        }
+        array.append(obj);
+    }
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["entries"] = array;
+
+    QSaveFile file(manifestPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QList<ChunkStore::Entry> ChunkStore::loadManifest(const QString &manifestPath, bool *ok)
+{
+    QList<Entry> entries;
+    if (ok) *ok = false;
+
+    QFile file(manifestPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject() || doc.object()["version"].toInt() != 1) {
+        return entries;
+    }
+
+    const QJsonArray array = doc.object()["entries"].toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject obj = value.toObject();
+        Entry entry;
+        entry.path = obj["path"].toString();
+        entry.type = obj["type"].toString();
+        entry.mtime = obj["mtime"].toInteger();
+        entry.size = obj["size"].toInteger();
+        entry.executable = obj["exec"].toBool();
+        entry.linkTarget = obj["target"].toString();
+        for (const QJsonValue &chunk : obj["chunks"].toArray()) {
+            entry.chunks.append(chunk.toString());
+        }
+        entries.append(entry);
+    }
+
+    if (ok) *ok = true;
+    return entries;
+}
+
+QSet<QString> ChunkStore::referencedChunks(const QString &manifestPath, bool *ok)
+{
+    QSet<QString> hashes;
+    const QList<Entry> entries = loadManifest(manifestPath, ok);
+    for (const Entry &entry : entries) {
+        for (const QString &hash : entry.chunks) {
+            hashes.insert(hash);
+        }
+    }
+    return hashes;
+}
+
+bool ChunkStore::restoreSnapshot(const QString &manifestPath, const QString &targetDir,
+                                 const QStringList &paths) const
+{
+    bool ok = false;
+    const QList<Entry> entries = loadManifest(manifestPath, &ok);
+    if (!ok) {
+        qWarning() << "Failed to read snapshot manifest:" << manifestPath;
+        return false;
+    }
+
+    QDir().mkpath(targetDir);
+
+    for (const Entry &entry : entries) {
+        if (!ArchiveIndex::isSelected(entry.path, paths)) {
+            continue;
+        }
+        // Reject anything that would escape the target directory
+        QString cleanPath = QDir::cleanPath(entry.path);
+        if (entry.path.isEmpty() || QDir::isAbsolutePath(cleanPath)
+            || cleanPath == ".." || cleanPath.startsWith("../")) {
+            qWarning() << "Skipping unsafe snapshot path:" << entry.path;
+            continue;
+        }
+
+        QString outPath = targetDir + "/" + entry.path;
+
+        if (entry.type == "dir") {
+            QDir().mkpath(outPath);
+        } else if (entry.type == "symlink") {
+            QDir().mkpath(QFileInfo(outPath).absolutePath());
+            QFile::remove(outPath);
+            QFile::link(entry.linkTarget, outPath);
+        } else if (entry.type == "file") {
+            QDir().mkpath(QFileInfo(outPath).absolutePath());
+            QFile file(outPath);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qWarning() << "Failed to create file:" << outPath;
+                return false;
+            }
+            for (const QString &hash : entry.chunks) {
+                bool chunkOk = false;
+                QByteArray data = readChunk(hash, &chunkOk);
+                if (!chunkOk || file.write(data) != data.size()) {
+                    qWarning() << "Failed to restore chunk" << hash << "for" << entry.path;
+                    return false;
+                }
+                if (m_progress && !m_progress->addBytes(data.size())) {
+                    return false;
+                }
+            }
+            if (entry.executable) {
+                file.setPermissions(file.permissions() | QFileDevice::ExeOwner
+                                    | QFileDevice::ExeGroup | QFileDevice::ExeOther);
+            }
+            file.setFileTime(QDateTime::fromSecsSinceEpoch(entry.mtime), QFileDevice::FileModificationTime);
+            file.close();
+            if (m_progress) {
+                m_progress->addFile();
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ChunkStore::verifySnapshot(const QString &manifestPath) const
+{
+    bool ok = false;
+    const QList<Entry> entries = loadManifest(manifestPath, &ok);
+    if (!ok) {
+        return false;
+    }
+
+    QSet<QString> checked;
+    for (const Entry &entry : entries) {
+        qint64 size = 0;
+        for (const QString &hash : entry.chunks) {
+            bool chunkOk = false;
+            QByteArray data = readChunk(hash, &chunkOk);
+            if (!chunkOk) {
+                return false;
+            }
+            if (!checked.contains(hash)) {
+                if (hashChunk(data.constData(), data.size()) != hash) {
+                    qWarning() << "Chunk hash mismatch:" << hash;
+                    return false;
+                }
+                checked.insert(hash);
+            }
+            size += data.size();
+        }
+        if (entry.type == "file" && size != entry.size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ChunkStore::collectGarbage(const QStringList &liveManifests) const
+{
+    QSet<QString> live;
+    for (const QString &manifest : liveManifests) {
+        bool ok = false;
+        live.unite(referencedChunks(manifest, &ok));
+        if (!ok) {
+            // Never sweep with an incomplete mark set
+            qWarning() << "Unreadable snapshot manifest, skipping chunk cleanup:" << manifest;
+            return 0;
+        }
+    }
+
+    int removed = 0;
+    // Dictionaries are few and small, and any live chunk may need one
+    QDirIterator it(m_rootDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        if (it.fileInfo().dir().dirName() == "dicts") {
+            continue;
+        }
+        if (!live.contains(it.fileName()) && QFile::remove(path)) {
+            removed++;
+        }
+    }
+    return removed;
+}
@@ -0,0 +1,107 @@
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QSet>
+#include <QHash>
+#include <QFileInfo>
+#include "zstddictionary.h"
+
+class FileChecksums;
+class TransferProgress;
+
+// Content-addressed chunk pool shared by all games.
+//
+// Files are split into content-defined chunks (gear-hash rolling boundaries),
+// each chunk is compressed and stored once under <root>/<hh>/<hash>. A backup
+// is a small JSON snapshot manifest that lists every entry of the saved tree
+// and the chunk hashes that make up each file, so unchanged data costs no
+// additional disk space or write I/O.
+//
+// Chunks are zlib-compressed unless a game's trained ZstdDictionary is set;
+// the dictionaries chunks were written with are kept under <root>/dicts.
+// Chunks of already-compressed data are stored as they are.
+class ChunkStore {
+public:
+    struct Entry {
+        QString path;       // relative path inside the snapshot (tar-style)
+        QString type;       // "file", "dir" or "symlink"
+        bool executable = false;
+        qint64 mtime = 0;   // seconds since epoch
+        qint64 size = 0;
+        QStringList chunks; // chunk hashes in file order
+        QString linkTarget;
+    };
+
+    struct Stats {
+        int files = 0;
+        int chunks = 0;
+        int newChunks = 0;
+        int reusedFiles = 0;    // unchanged files taken from knownChunks
+        qint64 bytesIn = 0;     // logical bytes read from the save tree
+        qint64 bytesStored = 0; // compressed bytes newly written to the pool
+        qint64 bytesSkipped = 0; // new chunk bytes already compressed, stored as is
+    };
+
+    explicit ChunkStore(const QString &rootDir);
+
+    QString rootDir() const;
+    void setCompressionLevel(int level);
+    // New chunks are compressed with zstd and this dictionary instead of zlib
+    void setDictionary(const ZstdDictionary &dictionary);
+    // Counts bytes read or restored and aborts the snapshot when cancelled
+    void setProgress(TransferProgress *progress);
+    // Receives the hash of every file read for a snapshot, by entry path
+    void setChecksums(FileChecksums *checksums);
+
+    // Snapshot every path in relativePaths (files or directories, recursed)
+    // below baseDir and write the manifest to manifestPath. Files listed in
+    // knownChunks are known to be unchanged and reuse those chunk lists
+    // without being read again.
+    bool writeSnapshot(const QString &baseDir, const QStringList &relativePaths,
+                       const QString &manifestPath, Stats *stats = nullptr,
+                       const QHash<QString, QStringList> &knownChunks = QHash<QString, QStringList>());
+    bool restoreSnapshot(const QString &manifestPath, const QString &targetDir,
+                         const QStringList &paths = QStringList()) const;
+    bool verifySnapshot(const QString &manifestPath) const;
+
+    // Remove every chunk not referenced by one of the given manifests.
+    // Returns the number of chunks deleted.
+    int collectGarbage(const QStringList &liveManifests) const;
+
+    static QList<Entry> loadManifest(const QString &manifestPath, bool *ok = nullptr);
+    static QSet<QString> referencedChunks(const QString &manifestPath, bool *ok = nullptr);
+
+    bool hasChunk(const QString &hash) const;
+    QByteArray readChunk(const QString &hash, bool *ok = nullptr) const;
+    // <root>/<first two hex digits>/<hash>
+    QString chunkPath(const QString &hash) const;
+
+private:
+    QString dictionaryPath(quint32 id) const;
+    // Copies m_dictionary into the pool once, so its chunks stay readable
+    // after the game's dictionary is retrained or removed
+    bool storeDictionary();
+    ZstdDictionary loadDictionary(quint32 id) const;
+    QString storeChunk(const char *data, qsizetype size, Stats *stats);
+    bool storeFile(const QString &filePath, Entry &entry, Stats *stats);
+    bool addFile(const QFileInfo &fi, Entry &entry, Stats *stats,
+                 const QHash<QString, QStringList> &knownChunks);
+    void addDirectory(const QString &baseDir, const QString &relativePath,
+                      QList<Entry> &entries, Stats *stats, bool &ok,
+                      const QHash<QString, QStringList> &knownChunks);
+    static bool saveManifest(const QList<Entry> &entries, const QString &manifestPath);
+
+    QString m_rootDir;
+    int m_compressionLevel = 6;
+    TransferProgress *m_progress = nullptr;
+    FileChecksums *m_checksums = nullptr;
+    ZstdDictionary m_dictionary;
+    bool m_dictionaryStored = false;
+    mutable QHash<quint32, ZstdDictionary> m_dictionaries;
+};
+
+#endif // CHUNKSTORE_H
@@ -0,0 +1,46 @@
+#include "compressibility.h"
+#include <QByteArray>
+#include <zlib.h>
+
+namespace {
+
+constexpr int kSlices = 4;
+
+} // namespace
+
+bool Compressibility::isIncompressible(const char *data, qsizetype size)
+{
+    if (size < MinSize) {
+        return false;
+    }
+
+    // Headers are often plain even in compressed formats, so look at a few
+    // slices across the whole input rather than only its start
+    QByteArray sample;
+    if (size <= SampleSize) {
+        sample = QByteArray::fromRawData(data, size);
+    } else {
+        qsizetype slice = SampleSize / kSlices;
+        sample.reserve(SampleSize);
+        for (int i = 0; i < kSlices; ++i) {
+            sample.append(data + (size - slice) * i / (kSlices - 1), slice);
+        }
+    }
+
+    z_stream zs = {};
+    // Raw deflate at level 1: no header, cheapest match search
+    if (deflateInit2(&zs, 1, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    QByteArray out(static_cast<qsizetype>(deflateBound(&zs, static_cast<uLong>(sample.size()))),
+                   Qt::Uninitialized);
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(sample.constData()));
+    zs.avail_in = static_cast<uInt>(sample.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    qsizetype produced = out.size() - zs.avail_out;
+    deflateEnd(&zs);
+
+    return rc == Z_STREAM_END && produced * 100 >= sample.size() * 97;
+}
@@ -0,0 +1,22 @@
+#ifndef COMPRESSIBILITY_H
+#define COMPRESSIBILITY_H
+
+#include <QtGlobal>
+
+// Spots data that is already compressed (PNG screenshots, zipped worlds,
+// Unity and encrypted save blobs) before a full-strength compressor burns
+// CPU on it for nothing. A fast deflate of a few spread-out samples decides:
+// it runs many times faster than the real compression and is rarely wrong
+// about data that will not shrink.
+class Compressibility {
+public:
+    // Bytes deflated to decide, taken from the start, middle and end
+    static constexpr qsizetype SampleSize = 64 * 1024;
+    // Smaller inputs are cheap to compress anyway
+    static constexpr qsizetype MinSize = 4 * 1024;
+
+    // True if compressing data would save less than 3% of its size
+    static bool isIncompressible(const char *data, qsizetype size);
+};
+
+#endif // COMPRESSIBILITY_H
@@ -115,10 +115,39 @@ bool Database::createTables()
         return false;
     }
 
+    // Backup metadata, kept in sync with the .json sidecars by BackupCatalog.
+    // Timestamps are seconds since the epoch, so they sort and compare.
+    if (!query.exec(
+            "CREATE TABLE IF NOT EXISTS backups ("
+            "    sidecar             TEXT PRIMARY KEY,"
+            "    game_id             TEXT NOT NULL,"
+            "    id                  TEXT NOT NULL,"
+            "    game_name           TEXT NOT NULL DEFAULT '',"
+            "    display_name        TEXT NOT NULL DEFAULT '',"
+            "    notes               TEXT NOT NULL DEFAULT '',"
+            "    timestamp           INTEGER,"
+            "    archive_path        TEXT NOT NULL,"
+            "    size                INTEGER NOT NULL DEFAULT 0,"
+            "    profile_name        TEXT NOT NULL DEFAULT '',"
+            "    profile_id          INTEGER NOT NULL DEFAULT -1,"
+            "    format              TEXT NOT NULL DEFAULT 'tar.gz',"
+            "    pinned              INTEGER NOT NULL DEFAULT 0,"
+            "    compression_skipped INTEGER NOT NULL DEFAULT 0,"
+            "    checksums           TEXT"
+            ")")) {
+        qCritical() << "Failed to create backups table:" << query.lastError().text();
+        return false;
+    }
+
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_backups_game_time ON backups (game_id, timestamp)")) {
+        qCritical() << "Failed to create backups index:" << query.lastError().text();
+        return false;
+    }
+
     // Seed defaults on fresh install
     if (schemaVersion() == 0) {
         seedDefaults();
-        setSchemaVersion(4);
+        setSchemaVersion(5);
     }
 
     // Migrate schema v1 -> v2 (hidden_games table already created above)
@@ -136,6 +165,12 @@ bool Database::createTables()
         setSchemaVersion(4);
     }
 
+    // Migrate schema v4 -> v5 (backups table created above, filled from the
+    // sidecars by BackupCatalog)
+    if (schemaVersion() == 4) {
+        setSchemaVersion(5);
+    }
+
     return true;
 }
 
@@ -467,6 +502,51 @@ bool Database::setSetting(const QString &key, const QString &value)
     return true;
 }
 
+RetentionPolicy Database::getRetentionPolicy(const QString &gameId) const
+{
+    if (!gameId.isEmpty()) {
+        QJsonObject rules = retentionRules();
+        if (rules.contains(gameId)) {
+            return RetentionPolicy::fromJson(rules[gameId].toObject());
+        }
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(getSetting("retention_default").toUtf8());
+    return RetentionPolicy::fromJson(doc.object());
+}
+
+bool Database::hasRetentionPolicy(const QString &gameId) const
+{
+    return retentionRules().contains(gameId);
+}
+
+bool Database::setRetentionPolicy(const QString &gameId, const RetentionPolicy &policy)
+{
+    if (gameId.isEmpty()) {
+        return setSetting("retention_default",
+                          QString::fromUtf8(QJsonDocument(policy.toJson()).toJson(QJsonDocument::Compact)));
+    }
+    QJsonObject rules = retentionRules();
+    rules[gameId] = policy.toJson();
+    return setRetentionRules(rules);
+}
+
+bool Database::clearRetentionPolicy(const QString &gameId)
+{
+    QJsonObject rules = retentionRules();
+    rules.remove(gameId);
+    return setRetentionRules(rules);
+}
+
+QJsonObject Database::retentionRules() const
+{
+    return QJsonDocument::fromJson(getSetting("retention_rules").toUtf8()).object();
+}
+
+bool Database::setRetentionRules(const QJsonObject &rules)
+{
+    return setSetting("retention_rules", QString::fromUtf8(QJsonDocument(rules).toJson(QJsonDocument::Compact)));
+}
+
 QList<SaveProfile> Database::getProfilesForGame(const QString &gameId) const
 {
     QList<SaveProfile> profiles;
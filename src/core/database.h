@@ -5,7 +5,9 @@
 #include <QString>
 #include <QList>
 #include <QSet>
+#include <QJsonObject>
 #include "gameinfo.h"
+#include "retentionpolicy.h"
 
 class Database : public QObject {
     Q_OBJECT
@@ -44,6 +46,13 @@ public:
     QString getSetting(const QString &key, const QString &defaultValue = QString()) const;
     bool setSetting(const QString &key, const QString &value);
 
+    // Retention rules, kept as JSON in app settings. An empty game id means
+    // the default rules, which games without their own rules use.
+    RetentionPolicy getRetentionPolicy(const QString &gameId = QString()) const;
+    bool hasRetentionPolicy(const QString &gameId) const;
+    bool setRetentionPolicy(const QString &gameId, const RetentionPolicy &policy);
+    bool clearRetentionPolicy(const QString &gameId);
+
     QString databasePath() const;
 
 private:
@@ -54,6 +63,8 @@ private:
 
     static QString serializeSavePaths(const QStringList &paths);
     static QStringList deserializeSavePaths(const QString &json);
+    QJsonObject retentionRules() const;
+    bool setRetentionRules(const QJsonObject &rules);
 
     QString m_dbPath;
     QString m_connectionName;
@@ -0,0 +1,1529 @@
+#include "deltaarchive.h"
+#include "archiveindex.h"
+#include "compressibility.h"
+#include "filechecksums.h"
+#include "lowimpactio.h"
+#include "transferprogress.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryFile>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QHash>
+#include <QPair>
+#include <QtEndian>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <zlib.h>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+namespace {
+
+// Footer: little-endian manifest offset, then the magic
+constexpr char kMagic[] = "GRDELTA1";
+constexpr qint64 kFooterSize = 16;
+constexpr char kCodecZlib = 'z';
+// Already-compressed content, stored as is
+constexpr char kCodecRaw = 'r';
+// A bare zlib stream, for files compressed a slice at a time
+constexpr char kCodecStream = 's';
+constexpr char kOpCopy = 1;
+constexpr char kOpAdd = 2;
+// Restored files are written in slices so cancelling stays responsive
+constexpr qsizetype kWriteSlice = 1024 * 1024;
+
+using Entry = DeltaArchive::Entry;
+// Receives a file's content in order; returns false to stop
+using Sink = std::function<bool(const char *data, qsizetype size)>;
+// Fills data with up to size bytes; 0 at the end, -1 to fail
+using Source = std::function<qint64(char *data, qint64 size)>;
+
+void writeVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+bool readVarint(const QByteArray &in, qsizetype &pos, quint64 *value)
+{
+    quint64 result = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uchar byte = static_cast<uchar>(in.at(pos++));
+        result |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// rsync's weak checksum: two 16-bit sums that can be rolled one byte at a time
+void weakSums(const uchar *data, qsizetype length, quint32 *a, quint32 *b)
+{
+    *a = 0;
+    *b = 0;
+    for (qsizetype i = 0; i < length; ++i) {
+        *a += data[i];
+        *b += quint32(length - i) * data[i];
+    }
+}
+
+quint32 weakHash(quint32 a, quint32 b)
+{
+    return (a & 0xffff) | (b << 16);
+}
+
+quint32 updateCrc(quint32 crc, const char *data, qsizetype size)
+{
+    const Bytef *p = reinterpret_cast<const Bytef *>(data);
+    // crc32() takes a uInt length
+    while (size > 0) {
+        uInt n = static_cast<uInt>(qMin<qsizetype>(size, 1 << 30));
+        crc = static_cast<quint32>(crc32(crc, p, n));
+        p += n;
+        size -= n;
+    }
+    return crc;
+}
+
+quint32 contentCrc(const QByteArray &data)
+{
+    return updateCrc(static_cast<quint32>(crc32(0L, Z_NULL, 0)), data.constData(), data.size());
+}
+
+// Decodes a payload into sink a slice at a time, so a file stored in full
+// never has to fit in memory
+bool streamPayload(const QString &archivePath, const Entry &entry, const Sink &sink)
+{
+    if (entry.length == 0) {
+        return true;
+    }
+    QFile file(archivePath);
+    char codec = 0;
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(entry.offset) || !file.getChar(&codec)) {
+        return false;
+    }
+    qint64 left = entry.length - 1;
+    QByteArray in(kWriteSlice, Qt::Uninitialized);
+
+    if (codec == kCodecRaw) {
+        while (left > 0) {
+            qint64 n = file.read(in.data(), qMin<qint64>(left, kWriteSlice));
+            if (n <= 0 || !sink(in.constData(), n)) {
+                return false;
+            }
+            left -= n;
+        }
+        return true;
+    }
+    if (codec == kCodecZlib) {
+        // qCompress() puts the uncompressed size in front of the zlib stream
+        if (left < 4 || file.read(in.data(), 4) != 4) {
+            return false;
+        }
+        left -= 4;
+    } else if (codec != kCodecStream) {
+        return false;
+    }
+
+    z_stream zs = {};
+    if (inflateInit(&zs) != Z_OK) {
+        return false;
+    }
+    QByteArray out(kWriteSlice, Qt::Uninitialized);
+    int rc = Z_OK;
+    while (rc != Z_STREAM_END) {
+        if (zs.avail_in == 0) {
+            qint64 n = left > 0 ? file.read(in.data(), qMin<qint64>(left, kWriteSlice)) : 0;
+            if (n <= 0) {
+                break;
+            }
+            left -= n;
+            zs.next_in = reinterpret_cast<Bytef *>(in.data());
+            zs.avail_in = static_cast<uInt>(n);
+        }
+        zs.next_out = reinterpret_cast<Bytef *>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        rc = inflate(&zs, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END) {
+            break;
+        }
+        qsizetype produced = out.size() - zs.avail_out;
+        if (produced > 0 && !sink(out.constData(), produced)) {
+            rc = Z_STREAM_ERROR;
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    return rc == Z_STREAM_END;
+}
+
+QByteArray readPayload(const QString &archivePath, const Entry &entry, bool *ok)
+{
+    QByteArray data;
+    *ok = streamPayload(archivePath, entry, [&data](const char *p, qsizetype n) {
+        data.append(p, n);
+        return true;
+    });
+    // Empty files have no payload; a payload never decodes to nothing
+    if (*ok && entry.length > 0 && data.isEmpty()) {
+        *ok = false;
+    }
+    return *ok ? data : QByteArray();
+}
+
+// Applies a delta as its payload is decoded, copying from a base that is
+// read with seeks, so neither the delta nor either version is held whole
+class DeltaApplier {
+public:
+    DeltaApplier(QFile &base, const Sink &sink)
+        : m_base(base)
+        , m_sink(sink)
+    {
+    }
+
+    bool feed(const char *data, qsizetype size)
+    {
+        qsizetype pos = 0;
+        while (pos < size) {
+            if (m_literalLeft > 0) {
+                qsizetype n = static_cast<qsizetype>(qMin<quint64>(m_literalLeft, quint64(size - pos)));
+                if (!put(data + pos, n)) {
+                    return false;
+                }
+                m_literalLeft -= n;
+                pos += n;
+                continue;
+            }
+            m_pending.append(data[pos++]);
+            if (!parsePending()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether the delta ended after a whole instruction, with all of the
+    // promised content produced
+    bool finish() const
+    {
+        return m_haveSize && m_pending.isEmpty() && m_literalLeft == 0 && m_produced == m_targetSize;
+    }
+
+private:
+    // The size in front, or an instruction, is complete once its last
+    // varint is; one longer than any valid encoding is corrupt
+    bool parsePending()
+    {
+        qsizetype pos = 0;
+        quint64 first = 0;
+        if (!m_haveSize) {
+            if (!readVarint(m_pending, pos, &first)) {
+                return m_pending.size() < 10;
+            }
+            m_targetSize = first;
+            m_haveSize = true;
+            m_pending.clear();
+            return true;
+        }
+
+        const char op = m_pending.at(0);
+        if (op != kOpCopy && op != kOpAdd) {
+            return false;
+        }
+        pos = 1;
+        if (!readVarint(m_pending, pos, &first)) {
+            return m_pending.size() < 11;
+        }
+        if (op == kOpAdd) {
+            m_pending.clear();
+            m_literalLeft = first;
+            return m_literalLeft <= m_targetSize - m_produced;
+        }
+        quint64 length = 0;
+        if (!readVarint(m_pending, pos, &length)) {
+            return m_pending.size() < 21;
+        }
+        m_pending.clear();
+        return copy(first, length);
+    }
+
+    bool copy(quint64 offset, quint64 length)
+    {
+        const quint64 baseSize = static_cast<quint64>(m_base.size());
+        if (offset > baseSize || length > baseSize - offset || length > m_targetSize - m_produced
+            || !m_base.seek(static_cast<qint64>(offset))) {
+            return false;
+        }
+        if (m_buffer.isEmpty()) {
+            m_buffer.resize(kWriteSlice);
+        }
+        while (length > 0) {
+            qint64 n = m_base.read(m_buffer.data(), static_cast<qint64>(qMin<quint64>(length, kWriteSlice)));
+            if (n <= 0 || !put(m_buffer.constData(), n)) {
+                return false;
+            }
+            length -= n;
+        }
+        return true;
+    }
+
+    bool put(const char *data, qsizetype size)
+    {
+        if (quint64(size) > m_targetSize - m_produced) {
+            return false;
+        }
+        m_produced += size;
+        return m_sink(data, size);
+    }
+
+    QFile &m_base;
+    const Sink &m_sink;
+    QByteArray m_pending;
+    QByteArray m_buffer;
+    bool m_haveSize = false;
+    quint64 m_targetSize = 0;
+    quint64 m_produced = 0;
+    quint64 m_literalLeft = 0;
+};
+
+// Manifests of a whole chain, resolving any file to its content at the top
+class ChainReader {
+public:
+    bool open(const QString &archivePath)
+    {
+        bool ok = false;
+        const QStringList paths = DeltaArchive(archivePath).chain(&ok);
+        if (!ok) {
+            return false;
+        }
+        for (const QString &path : paths) {
+            Level level;
+            level.archivePath = path;
+            level.entries = DeltaArchive::loadManifest(path, nullptr, &ok);
+            if (!ok) {
+                qWarning() << "Failed to read delta manifest:" << path;
+                return false;
+            }
+            for (int i = 0; i < level.entries.size(); ++i) {
+                level.index.insert(level.entries.at(i).path, i);
+            }
+            m_levels.append(level);
+        }
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return !m_levels.isEmpty();
+    }
+
+    const QList<Entry> &entries() const
+    {
+        return m_levels.last().entries;
+    }
+
+    const Entry *file(const QString &path) const
+    {
+        return isOpen() ? fileAt(m_levels.size() - 1, path) : nullptr;
+    }
+
+    QByteArray content(const QString &path, bool *ok) const
+    {
+        *ok = false;
+        return isOpen() ? contentAt(m_levels.size() - 1, path, ok) : QByteArray();
+    }
+
+    // The entry that holds the file's data, following "base" entries down
+    // the chain, and the archive it is in
+    const Entry *stored(const QString &path, QString *archivePath) const
+    {
+        for (int level = m_levels.size() - 1; level >= 0; --level) {
+            const Entry *entry = fileAt(level, path);
+            if (!entry) {
+                return nullptr;
+            }
+            if (entry->encoding != "base") {
+                *archivePath = m_levels.at(level).archivePath;
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    // Files stored in full go from the archive to sink without being held
+    // in memory, and so do deltas that were written a slice at a time; other
+    // deltas are applied in memory and handed over in slices
+    bool stream(const QString &path, const Sink &sink) const
+    {
+        return isOpen() && streamAt(m_levels.size() - 1, path, sink);
+    }
+
+private:
+    struct Level {
+        QString archivePath;
+        QList<Entry> entries;
+        QHash<QString, int> index;
+    };
+
+    const Entry *fileAt(int level, const QString &path) const
+    {
+        const Level &l = m_levels.at(level);
+        auto it = l.index.constFind(path);
+        if (it == l.index.constEnd() || l.entries.at(it.value()).type != "file") {
+            return nullptr;
+        }
+        return &l.entries.at(it.value());
+    }
+
+    QByteArray contentAt(int level, const QString &path, bool *ok) const
+    {
+        *ok = false;
+        const Entry *entry = fileAt(level, path);
+        if (!entry) {
+            return QByteArray();
+        }
+        if (entry->encoding == "full") {
+            return readPayload(m_levels.at(level).archivePath, *entry, ok);
+        }
+        if (entry->streamed) {
+            QByteArray data;
+            *ok = streamAt(level, path, [&data](const char *p, qsizetype n) {
+                data.append(p, n);
+                return true;
+            });
+            return *ok ? data : QByteArray();
+        }
+        if (level == 0) {
+            qWarning() << "Delta entry without a base:" << path;
+            return QByteArray();
+        }
+        QByteArray base = contentAt(level - 1, path, ok);
+        if (!*ok || entry->encoding == "base") {
+            return base;
+        }
+        QByteArray delta = readPayload(m_levels.at(level).archivePath, *entry, ok);
+        if (!*ok) {
+            return QByteArray();
+        }
+        return DeltaArchive::applyDelta(base, delta, ok);
+    }
+
+    bool streamAt(int level, const QString &path, const Sink &sink) const
+    {
+        const Entry *entry = fileAt(level, path);
+        if (!entry) {
+            return false;
+        }
+        const QString &archivePath = m_levels.at(level).archivePath;
+        if (entry->encoding == "full") {
+            return streamPayload(archivePath, *entry, sink);
+        }
+        if (entry->encoding == "base" && level > 0) {
+            return streamAt(level - 1, path, sink);
+        }
+        if (!entry->streamed) {
+            bool ok = false;
+            QByteArray data = contentAt(level, path, &ok);
+            for (qsizetype pos = 0; ok && pos < data.size(); pos += kWriteSlice) {
+                ok = sink(data.constData() + pos, qMin(kWriteSlice, data.size() - pos));
+            }
+            return ok;
+        }
+        if (level == 0) {
+            qWarning() << "Delta entry without a base:" << path;
+            return false;
+        }
+
+        // Copies may point anywhere in the base, so it is rebuilt into a
+        // temporary file next to the archive and read from there
+        QTemporaryFile base(QFileInfo(archivePath).absolutePath() + "/.delta-base-XXXXXX");
+        if (!base.open()) {
+            qWarning() << "Failed to create a temporary file next to" << archivePath;
+            return false;
+        }
+        bool written = streamAt(level - 1, path, [&base](const char *data, qsizetype n) {
+            return base.write(data, n) == n;
+        });
+        if (!written) {
+            return false;
+        }
+        DeltaApplier applier(base, sink);
+        bool ok = streamPayload(archivePath, *entry, [&applier](const char *data, qsizetype n) {
+            return applier.feed(data, n);
+        });
+        return ok && applier.finish();
+    }
+
+    QList<Level> m_levels;
+};
+
+class ArchiveWriter {
+public:
+    ArchiveWriter(const QString &archivePath, int level)
+        : m_file(archivePath)
+        , m_level(level)
+    {
+    }
+
+    bool open(const QString &basePath)
+    {
+        // Stored relative, so the backup directory can be moved
+        m_baseName = basePath.isEmpty() ? QString() : QFileInfo(basePath).fileName();
+        return m_file.open(QIODevice::WriteOnly);
+    }
+
+    bool addPayload(Entry &entry, const QByteArray &data)
+    {
+        entry.offset = m_pos;
+        entry.length = 0;
+        if (data.isEmpty()) {
+            return true;
+        }
+        bool skip = Compressibility::isIncompressible(data.constData(), data.size());
+        QByteArray payload = skip ? data : qCompress(data, m_level);
+        const char codec = skip ? kCodecRaw : kCodecZlib;
+        entry.length = payload.size() + 1;
+        if (m_file.write(&codec, 1) != 1 || m_file.write(payload) != payload.size()) {
+            return false;
+        }
+        m_pos += entry.length;
+        if (skip) {
+            m_skippedBytes += data.size();
+        }
+        return true;
+    }
+
+    // For files too large to hold: read, checksummed and compressed a slice
+    // at a time
+    bool addStreamedPayload(Entry &entry, QFile &source, TransferProgress *progress,
+                            FileChecksums::Hasher *hasher)
+    {
+        entry.size = 0;
+        entry.crc = static_cast<quint32>(crc32(0L, Z_NULL, 0));
+        return addStream(entry, [&](char *data, qint64 size) -> qint64 {
+            qint64 n = source.read(data, size);
+            if (n > 0) {
+                entry.crc = updateCrc(entry.crc, data, n);
+                entry.size += n;
+                if (hasher) {
+                    hasher->addData(data, n);
+                }
+                if (progress && !progress->addBytes(n)) {
+                    return -1;
+                }
+            }
+            return n;
+        });
+    }
+
+    // Compresses what source hands over a slice at a time. Whether to
+    // compress is decided on the first slice.
+    bool addStream(Entry &entry, const Source &source)
+    {
+        entry.offset = m_pos;
+        entry.length = 0;
+
+        QByteArray in(kWriteSlice, Qt::Uninitialized);
+        QByteArray out(kWriteSlice, Qt::Uninitialized);
+        z_stream zs = {};
+        bool started = false;
+        bool compress = false;
+        bool ok = true;
+        auto put = [&](const char *data, qint64 size) {
+            if (m_file.write(data, size) != size) {
+                return false;
+            }
+            entry.length += size;
+            return true;
+        };
+
+        while (ok) {
+            qint64 n = source(in.data(), kWriteSlice);
+            if (n < 0 || (n == 0 && !started)) {
+                ok = n == 0;
+                break;
+            }
+            if (!started) {
+                bool incompressible = Compressibility::isIncompressible(in.constData(), n);
+                const char codec = incompressible ? kCodecRaw : kCodecStream;
+                if (!put(&codec, 1) || (!incompressible && deflateInit(&zs, m_level) != Z_OK)) {
+                    ok = false;
+                    break;
+                }
+                compress = !incompressible;
+                started = true;
+            }
+
+            if (!compress) {
+                ok = n == 0 || put(in.constData(), n);
+                m_skippedBytes += n;
+            } else {
+                zs.next_in = reinterpret_cast<Bytef *>(in.data());
+                zs.avail_in = static_cast<uInt>(n);
+                do {
+                    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+                    zs.avail_out = static_cast<uInt>(out.size());
+                    ok = deflate(&zs, n == 0 ? Z_FINISH : Z_NO_FLUSH) != Z_STREAM_ERROR
+                         && put(out.constData(), out.size() - zs.avail_out);
+                } while (ok && zs.avail_out == 0);
+            }
+            if (n == 0) {
+                break;
+            }
+        }
+        if (compress) {
+            deflateEnd(&zs);
+        }
+        m_pos += entry.length;
+        return ok;
+    }
+
+    // Takes a file's stored payload over from another archive unchanged
+    bool copyPayload(Entry &entry, const QString &archivePath, const Entry &stored)
+    {
+        entry.offset = m_pos;
+        entry.length = 0;
+        QFile file(archivePath);
+        if (stored.length > 0 && (!file.open(QIODevice::ReadOnly) || !file.seek(stored.offset))) {
+            return false;
+        }
+        QByteArray buffer(kWriteSlice, Qt::Uninitialized);
+        while (entry.length < stored.length) {
+            qint64 n = file.read(buffer.data(), qMin<qint64>(stored.length - entry.length, kWriteSlice));
+            if (n <= 0 || m_file.write(buffer.constData(), n) != n) {
+                return false;
+            }
+            entry.length += n;
+        }
+        m_pos += entry.length;
+        return true;
+    }
+
+    qint64 skippedBytes() const
+    {
+        return m_skippedBytes;
+    }
+
+    void addEntry(const Entry &entry)
+    {
+        m_entries.append(entry);
+    }
+
+    bool finish()
+    {
+        QJsonArray array;
+        for (const Entry &entry : std::as_const(m_entries)) {
+            QJsonObject obj;
+            obj["path"] = entry.path;
+            obj["type"] = entry.type;
+            obj["mtime"] = entry.mtime;
+            if (entry.type == "file") {
+                obj["size"] = entry.size;
+                obj["enc"] = entry.encoding;
+                obj["crc"] = static_cast<qint64>(entry.crc);
+                if (entry.encoding != "base") {
+                    obj["off"] = entry.offset;
+                    obj["len"] = entry.length;
+                }
+                if (entry.streamed) obj["stream"] = true;
+                if (entry.executable) obj["exec"] = true;
+            } else if (entry.type == "symlink") {
+                obj["target"] = entry.linkTarget;
+            }
+            array.append(obj);
+        }
+
+        QJsonObject root;
+        root["version"] = 1;
+        root["base"] = m_baseName;
+        root["entries"] = array;
+        QByteArray manifest = QJsonDocument(root).toJson(QJsonDocument::Compact);
+
+        QByteArray footer(kFooterSize, '\0');
+        qToLittleEndian<qint64>(m_pos, footer.data());
+        std::memcpy(footer.data() + 8, kMagic, 8);
+
+        if (m_file.write(manifest) != manifest.size() || m_file.write(footer) != footer.size()) {
+            m_file.cancelWriting();
+            return false;
+        }
+        return m_file.commit();
+    }
+
+    void cancel()
+    {
+        m_file.cancelWriting();
+    }
+
+private:
+    QSaveFile m_file;
+    QString m_baseName;
+    int m_level;
+    qint64 m_pos = 0;
+    qint64 m_skippedBytes = 0;
+    QList<Entry> m_entries;
+};
+
+// Store one file's content against base: nothing if unchanged, a delta when
+// that is smaller, otherwise the whole file. A base larger than memoryLimit
+// is not read.
+bool encodeFile(ArchiveWriter &writer, Entry entry, const QByteArray &content,
+                const ChainReader &base, qint64 memoryLimit, DeltaArchive::Stats *stats)
+{
+    entry.streamed = false;
+    entry.size = content.size();
+    entry.crc = contentCrc(content);
+
+    const Entry *baseEntry = base.file(entry.path);
+    if (baseEntry && (memoryLimit <= 0 || baseEntry->size <= memoryLimit)) {
+        bool ok = false;
+        QByteArray baseContent = base.content(entry.path, &ok);
+        if (ok && baseContent == content) {
+            entry.encoding = "base";
+            if (stats) stats->baseFiles++;
+            writer.addEntry(entry);
+            return true;
+        }
+        if (ok) {
+            QByteArray delta = DeltaArchive::encodeDelta(baseContent, content);
+            if (delta.size() < content.size()) {
+                entry.encoding = "delta";
+                if (stats) stats->deltaFiles++;
+                if (!writer.addPayload(entry, delta)) return false;
+                writer.addEntry(entry);
+                return true;
+            }
+        }
+    }
+
+    entry.encoding = "full";
+    if (stats) stats->fullFiles++;
+    if (!writer.addPayload(entry, content)) return false;
+    writer.addEntry(entry);
+    return true;
+}
+
+// A base known only by the sums of its blocks, as rsync keeps it: enough to
+// find its content again in a new version without reading the two together
+struct Signature {
+    struct Block {
+        qint64 offset;
+        quint64 strong;
+    };
+    qsizetype blockSize = 0;
+    QHash<quint32, Block> blocks;
+};
+
+// Confirms a weak match; the first 64 bits of MD5 are plenty for that
+quint64 strongSum(QCryptographicHash &md5, const char *data, qsizetype size)
+{
+    md5.reset();
+    md5.addData(QByteArrayView(data, size));
+    return qFromLittleEndian<quint64>(md5.result().constData());
+}
+
+// rsync's square-root rule without the upper bound encodeDelta has, so the
+// signature stays at about sqrt(size) blocks however large the file is
+bool buildSignature(const ChainReader &base, const QString &path, qint64 size, Signature *signature)
+{
+    const qsizetype blockSize = qMax<qsizetype>(1024, static_cast<qsizetype>(std::sqrt(double(size))));
+    signature->blockSize = blockSize;
+    signature->blocks.reserve(size / blockSize + 1);
+
+    QCryptographicHash md5(QCryptographicHash::Md5);
+    QByteArray block(blockSize, Qt::Uninitialized);
+    qsizetype filled = 0;
+    qint64 offset = 0;
+    // A trailing partial block is left out: a window never matches it
+    return base.stream(path, [&](const char *data, qsizetype n) {
+        while (n > 0) {
+            qsizetype take = qMin(n, blockSize - filled);
+            std::memcpy(block.data() + filled, data, take);
+            filled += take;
+            data += take;
+            n -= take;
+            if (filled == blockSize) {
+                quint32 a, s;
+                weakSums(reinterpret_cast<const uchar *>(block.constData()), blockSize, &a, &s);
+                // The first block for a hash, so runs of copies stay contiguous
+                quint32 hash = weakHash(a, s);
+                if (!signature->blocks.contains(hash)) {
+                    signature->blocks.insert(hash, {offset, strongSum(md5, block.constData(), blockSize)});
+                }
+                offset += blockSize;
+                filled = 0;
+            }
+        }
+        return true;
+    });
+}
+
+// encodeDelta for a target read from source a slice at a time, against a
+// base known by its signature. Instructions go to out as they are found and
+// literals at most a slice at a time, so memory stays at a block and two
+// slices however much changed. Adjacent copies are merged into one.
+bool encodeStreamedDelta(const Signature &signature, const Source &source, QFile &out)
+{
+    const qsizetype block = signature.blockSize;
+    const qsizetype chunk = qMax<qsizetype>(block, 64 * 1024);
+    QCryptographicHash md5(QCryptographicHash::Md5);
+    QByteArray buffer;
+    qsizetype literalStart = 0;
+    qsizetype i = 0;
+    bool eof = false;
+    qint64 copyOffset = 0;
+    qint64 copyLength = 0;
+
+    auto flushCopy = [&]() {
+        if (copyLength == 0) {
+            return true;
+        }
+        QByteArray op(1, kOpCopy);
+        writeVarint(op, static_cast<quint64>(copyOffset));
+        writeVarint(op, static_cast<quint64>(copyLength));
+        copyLength = 0;
+        return out.write(op) == op.size();
+    };
+    auto flushLiteral = [&]() {
+        if (i == literalStart) {
+            return true;
+        }
+        if (!flushCopy()) {
+            return false;
+        }
+        QByteArray op(1, kOpAdd);
+        writeVarint(op, static_cast<quint64>(i - literalStart));
+        bool written = out.write(op) == op.size()
+                       && out.write(buffer.constData() + literalStart, i - literalStart) == i - literalStart;
+        literalStart = i;
+        return written;
+    };
+    // Makes need bytes from the window on available, unless source ends
+    // first; what was already written out makes room
+    auto fill = [&](qsizetype need) {
+        if (i + need <= buffer.size() || eof) {
+            return true;
+        }
+        buffer.remove(0, literalStart);
+        i -= literalStart;
+        literalStart = 0;
+        while (!eof && buffer.size() < i + need) {
+            qsizetype old = buffer.size();
+            buffer.resize(old + chunk);
+            qint64 n = source(buffer.data() + old, chunk);
+            buffer.resize(old + qMax<qint64>(0, n));
+            if (n < 0) {
+                return false;
+            }
+            eof = n == 0;
+        }
+        return true;
+    };
+
+    quint32 a = 0;
+    quint32 s = 0;
+    bool summed = false;
+    while (true) {
+        // The window and the byte rolled in after it
+        if (!fill(block + 1)) {
+            return false;
+        }
+        if (buffer.size() - i < block) {
+            break;
+        }
+        const uchar *window = reinterpret_cast<const uchar *>(buffer.constData()) + i;
+        if (!summed) {
+            weakSums(window, block, &a, &s);
+            summed = true;
+        }
+        auto it = signature.blocks.constFind(weakHash(a, s));
+        if (it != signature.blocks.constEnd() && it->strong == strongSum(md5, buffer.constData() + i, block)) {
+            if (!flushLiteral()) {
+                return false;
+            }
+            if (copyLength > 0 && copyOffset + copyLength == it->offset) {
+                copyLength += block;
+            } else {
+                if (!flushCopy()) {
+                    return false;
+                }
+                copyOffset = it->offset;
+                copyLength = block;
+            }
+            i += block;
+            literalStart = i;
+            summed = false;
+            continue;
+        }
+
+        if (buffer.size() - i == block) {
+            break;
+        }
+        quint32 dropped = window[0];
+        a += window[block] - dropped;
+        s += a - quint32(block) * dropped;
+        ++i;
+        if (i - literalStart >= kWriteSlice && !flushLiteral()) {
+            return false;
+        }
+    }
+    i = buffer.size();
+    return flushLiteral() && flushCopy();
+}
+
+// encodeFile for a file too large to hold. It is diffed against the base's
+// signature as it is read, with the instructions spooled to a temporary
+// file in spoolDir, and stored in full when that is not smaller. hash, if
+// given, receives the content hash.
+bool encodeLargeFile(ArchiveWriter &writer, Entry &entry, QFile &source, const ChainReader &base,
+                     const QString &spoolDir, TransferProgress *progress, QByteArray *hash,
+                     DeltaArchive::Stats *stats)
+{
+    entry.streamed = false;
+    bool reread = false;
+
+    const Entry *baseEntry = base.file(entry.path);
+    Signature signature;
+    if (baseEntry && baseEntry->size > 0 && buildSignature(base, entry.path, baseEntry->size, &signature)) {
+        QTemporaryFile spool(spoolDir + "/.delta-spool-XXXXXX");
+        if (!spool.open()) {
+            qWarning() << "Failed to create a temporary file in" << spoolDir;
+            return false;
+        }
+        entry.size = 0;
+        entry.crc = static_cast<quint32>(crc32(0L, Z_NULL, 0));
+        FileChecksums::Hasher hasher;
+        bool encoded = encodeStreamedDelta(signature, [&](char *data, qint64 size) -> qint64 {
+            qint64 n = source.read(data, size);
+            if (n > 0) {
+                entry.crc = updateCrc(entry.crc, data, n);
+                entry.size += n;
+                hasher.addData(data, n);
+                if (progress && !progress->addBytes(n)) {
+                    return -1;
+                }
+            }
+            return n;
+        }, spool);
+        if (!encoded) {
+            return false;
+        }
+
+        QByteArray header;
+        writeVarint(header, static_cast<quint64>(entry.size));
+        if (header.size() + spool.size() < entry.size) {
+            if (!spool.seek(0)) {
+                return false;
+            }
+            entry.encoding = "delta";
+            entry.streamed = true;
+            qsizetype headerPos = 0;
+            bool ok = writer.addStream(entry, [&](char *data, qint64 size) -> qint64 {
+                if (headerPos < header.size()) {
+                    qint64 n = qMin<qint64>(size, header.size() - headerPos);
+                    std::memcpy(data, header.constData() + headerPos, n);
+                    headerPos += n;
+                    return n;
+                }
+                return spool.read(data, size);
+            });
+            if (!ok) {
+                return false;
+            }
+            writer.addEntry(entry);
+            if (hash) *hash = hasher.result();
+            if (stats) stats->deltaFiles++;
+            return true;
+        }
+
+        // Mostly new content: read again to store it in full, with the
+        // bytes already counted
+        if (!source.seek(0) || (progress && progress->isCancelled())) {
+            return false;
+        }
+        reread = true;
+    }
+
+    entry.encoding = "full";
+    FileChecksums::Hasher hasher;
+    if (!writer.addStreamedPayload(entry, source, reread ? nullptr : progress, &hasher)) {
+        return false;
+    }
+    writer.addEntry(entry);
+    if (hash) *hash = hasher.result();
+    if (stats) stats->fullFiles++;
+    return true;
+}
+
+bool isSafePath(const QString &path)
+{
+    QString cleanPath = QDir::cleanPath(path);
+    return !path.isEmpty() && !QDir::isAbsolutePath(cleanPath)
+           && cleanPath != ".." && !cleanPath.startsWith("../");
+}
+
+void collectEntries(const QString &baseDir, const QString &relativePath, QList<QPair<Entry, QFileInfo>> &out)
+{
+    QDir dir(baseDir + "/" + relativePath);
+    const QFileInfoList infos = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden | QDir::System,
+                                                  QDir::DirsFirst | QDir::Name);
+    for (const QFileInfo &fi : infos) {
+        Entry entry;
+        entry.path = relativePath + "/" + fi.fileName();
+        entry.mtime = fi.lastModified().toSecsSinceEpoch();
+        if (fi.isSymLink()) {
+            entry.type = "symlink";
+            entry.linkTarget = fi.symLinkTarget();
+            out.append(qMakePair(entry, fi));
+        } else if (fi.isDir()) {
+            entry.type = "dir";
+            out.append(qMakePair(entry, fi));
+            collectEntries(baseDir, entry.path, out);
+        } else if (fi.isFile()) {
+            entry.type = "file";
+            entry.executable = fi.isExecutable();
+            out.append(qMakePair(entry, fi));
+        }
+    }
+}
+
+} // namespace
+
+DeltaArchive::DeltaArchive(const QString &archivePath)
+    : m_archivePath(archivePath)
+{
+}
+
+QString DeltaArchive::archivePath() const
+{
+    return m_archivePath;
+}
+
+void DeltaArchive::setCompressionLevel(int level)
+{
+    if (level >= 1 && level <= 9) {
+        m_compressionLevel = level;
+    }
+}
+
+void DeltaArchive::setProgress(TransferProgress *progress)
+{
+    m_progress = progress;
+}
+
+void DeltaArchive::setChecksums(FileChecksums *checksums)
+{
+    m_checksums = checksums;
+}
+
+void DeltaArchive::setMemoryLimit(qint64 bytes)
+{
+    m_memoryLimit = qMax<qint64>(0, bytes);
+}
+
+bool DeltaArchive::write(const QString &baseDir, const QStringList &relativePaths, const QString &basePath,
+                         Stats *stats, const QSet<QString> &unchangedPaths)
+{
+    ChainReader base;
+    if (!basePath.isEmpty() && !base.open(basePath)) {
+        qWarning() << "Failed to open delta base:" << basePath;
+        return false;
+    }
+
+    QList<QPair<Entry, QFileInfo>> items;
+    for (const QString &relPath : relativePaths) {
+        QFileInfo fi(baseDir + "/" + relPath);
+        if (!fi.exists()) {
+            qWarning() << "Delta backup path not found, skipping:" << fi.filePath();
+            continue;
+        }
+        Entry entry;
+        entry.path = relPath;
+        entry.mtime = fi.lastModified().toSecsSinceEpoch();
+        if (fi.isDir()) {
+            entry.type = "dir";
+            items.append(qMakePair(entry, fi));
+            collectEntries(baseDir, relPath, items);
+        } else {
+            entry.type = "file";
+            entry.executable = fi.isExecutable();
+            items.append(qMakePair(entry, fi));
+        }
+    }
+    if (items.isEmpty()) {
+        return false;
+    }
+
+    ArchiveWriter writer(m_archivePath, m_compressionLevel);
+    if (!writer.open(basePath)) {
+        qWarning() << "Failed to open delta archive for writing:" << m_archivePath;
+        return false;
+    }
+
+    for (const auto &item : std::as_const(items)) {
+        Entry entry = item.first;
+        if (entry.type != "file") {
+            writer.addEntry(entry);
+            continue;
+        }
+
+        // Unchanged files only need the base's record, not their data
+        const Entry *baseEntry = base.isOpen() ? base.file(entry.path) : nullptr;
+        if (baseEntry && unchangedPaths.contains(entry.path)) {
+            entry.size = baseEntry->size;
+            entry.crc = baseEntry->crc;
+            entry.encoding = "base";
+            writer.addEntry(entry);
+            if (stats) {
+                stats->baseFiles++;
+                stats->bytesIn += entry.size;
+            }
+            if (m_progress) {
+                m_progress->addBytes(entry.size);
+                m_progress->addFile();
+            }
+            continue;
+        }
+
+        QFile file(item.second.absoluteFilePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed to open file for delta backup:" << file.fileName();
+            writer.cancel();
+            return false;
+        }
+
+        if (m_memoryLimit > 0 && item.second.size() > m_memoryLimit) {
+            QByteArray hash;
+            bool ok = encodeLargeFile(writer, entry, file, base, QFileInfo(m_archivePath).absolutePath(),
+                                      m_progress, &hash, stats);
+            LowImpactIo::dropCache(file.handle());
+            if (!ok) {
+                if (!m_progress || !m_progress->isCancelled()) {
+                    qWarning() << "Failed to write delta archive:" << m_archivePath;
+                }
+                writer.cancel();
+                return false;
+            }
+            if (m_checksums) {
+                m_checksums->insert(entry.path, hash);
+            }
+            if (stats) {
+                stats->bytesIn += entry.size;
+            }
+            if (m_progress) {
+                m_progress->addFile();
+            }
+            continue;
+        }
+
+        QByteArray content = file.readAll();
+        LowImpactIo::dropCache(file.handle());
+        file.close();
+        if (m_checksums) {
+            FileChecksums::Hasher hasher;
+            hasher.addData(content.constData(), content.size());
+            m_checksums->insert(entry.path, hasher.result());
+        }
+
+        if (!encodeFile(writer, entry, content, base, m_memoryLimit, stats)) {
+            qWarning() << "Failed to write delta archive:" << m_archivePath;
+            writer.cancel();
+            return false;
+        }
+        if (stats) stats->bytesIn += content.size();
+        if (m_progress) {
+            bool running = m_progress->addBytes(content.size());
+            m_progress->addFile();
+            if (!running) {
+                writer.cancel();
+                return false;
+            }
+        }
+    }
+
+    if (!writer.finish()) {
+        qWarning() << "Failed to finish delta archive:" << m_archivePath;
+        return false;
+    }
+    if (stats) {
+        stats->bytesStored = QFileInfo(m_archivePath).size();
+        stats->bytesSkipped = writer.skippedBytes();
+    }
+    return true;
+}
+
+bool DeltaArchive::restore(const QString &targetDir, const QStringList &paths) const
+{
+    ChainReader reader;
+    if (!reader.open(m_archivePath)) {
+        return false;
+    }
+
+    QDir().mkpath(targetDir);
+    for (const Entry &entry : reader.entries()) {
+        if (!ArchiveIndex::isSelected(entry.path, paths)) {
+            continue;
+        }
+        if (!isSafePath(entry.path)) {
+            qWarning() << "Skipping unsafe delta path:" << entry.path;
+            continue;
+        }
+
+        QString outPath = targetDir + "/" + entry.path;
+        if (entry.type == "dir") {
+            QDir().mkpath(outPath);
+        } else if (entry.type == "symlink") {
+            QDir().mkpath(QFileInfo(outPath).absolutePath());
+            QFile::remove(outPath);
+            QFile::link(entry.linkTarget, outPath);
+        } else if (entry.type == "file") {
+            QDir().mkpath(QFileInfo(outPath).absolutePath());
+            QFile file(outPath);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qWarning() << "Failed to create file:" << outPath;
+                return false;
+            }
+
+            // Checked as it is written; a file that does not match is removed
+            qint64 size = 0;
+            quint32 crc = static_cast<quint32>(crc32(0L, Z_NULL, 0));
+            bool writeFailed = false;
+            bool ok = reader.stream(entry.path, [&](const char *data, qsizetype n) {
+                if (file.write(data, n) != n) {
+                    writeFailed = true;
+                    return false;
+                }
+                size += n;
+                crc = updateCrc(crc, data, n);
+                return !m_progress || m_progress->addBytes(n);
+            });
+            if (!ok || size != entry.size || crc != entry.crc) {
+                if (writeFailed) {
+                    qWarning() << "Failed to write file:" << outPath;
+                } else if (!m_progress || !m_progress->isCancelled()) {
+                    qWarning() << "Failed to reconstruct" << entry.path << "from" << m_archivePath;
+                }
+                file.remove();
+                return false;
+            }
+            if (entry.executable) {
+                file.setPermissions(file.permissions() | QFileDevice::ExeOwner
+                                    | QFileDevice::ExeGroup | QFileDevice::ExeOther);
+            }
+            file.setFileTime(QDateTime::fromSecsSinceEpoch(entry.mtime), QFileDevice::FileModificationTime);
+            file.close();
+            if (m_progress) {
+                m_progress->addFile();
+            }
+        }
+    }
+    return true;
+}
+
+bool DeltaArchive::verify() const
+{
+    ChainReader reader;
+    if (!reader.open(m_archivePath)) {
+        return false;
+    }
+
+    for (const Entry &entry : reader.entries()) {
+        if (entry.type != "file") {
+            continue;
+        }
+        qint64 size = 0;
+        quint32 crc = static_cast<quint32>(crc32(0L, Z_NULL, 0));
+        bool ok = reader.stream(entry.path, [&](const char *data, qsizetype n) {
+            size += n;
+            crc = updateCrc(crc, data, n);
+            return true;
+        });
+        if (!ok || size != entry.size || crc != entry.crc) {
+            qWarning() << "Delta backup entry is corrupt:" << entry.path;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeltaArchive::rebase(const QString &newBasePath)
+{
+    ChainReader current;
+    if (!current.open(m_archivePath)) {
+        return false;
+    }
+    ChainReader base;
+    if (!newBasePath.isEmpty() && !base.open(newBasePath)) {
+        return false;
+    }
+
+    // QSaveFile replaces the archive only once it is complete
+    ArchiveWriter writer(m_archivePath, m_compressionLevel);
+    if (!writer.open(newBasePath)) {
+        return false;
+    }
+    for (const Entry &entry : current.entries()) {
+        if (entry.type != "file") {
+            writer.addEntry(entry);
+            continue;
+        }
+
+        // Large files stored in full keep their payload as it is; large
+        // deltas are rebuilt on disk and diffed against the new base
+        QString storedIn;
+        const Entry *stored = current.stored(entry.path, &storedIn);
+        if (m_memoryLimit > 0 && entry.size > m_memoryLimit && stored) {
+            Entry copy = entry;
+            bool ok;
+            if (stored->encoding == "full") {
+                copy.encoding = "full";
+                copy.streamed = false;
+                ok = writer.copyPayload(copy, storedIn, *stored);
+                if (ok) {
+                    writer.addEntry(copy);
+                }
+            } else {
+                const QString spoolDir = QFileInfo(m_archivePath).absolutePath();
+                QTemporaryFile content(spoolDir + "/.delta-rebase-XXXXXX");
+                ok = content.open() && current.stream(entry.path, [&content](const char *data, qsizetype n) {
+                         return content.write(data, n) == n;
+                     });
+                ok = ok && content.seek(0)
+                     && encodeLargeFile(writer, copy, content, base, spoolDir, nullptr, nullptr, nullptr);
+            }
+            if (!ok) {
+                qWarning() << "Failed to rebase" << entry.path << "in" << m_archivePath;
+                writer.cancel();
+                return false;
+            }
+            continue;
+        }
+
+        bool ok = false;
+        QByteArray content = current.content(entry.path, &ok);
+        if (!ok || !encodeFile(writer, entry, content, base, m_memoryLimit, nullptr)) {
+            qWarning() << "Failed to rebase" << entry.path << "in" << m_archivePath;
+            writer.cancel();
+            return false;
+        }
+    }
+    return writer.finish();
+}
+
+QString DeltaArchive::basePath(bool *ok) const
+{
+    QString base;
+    loadManifest(m_archivePath, &base, ok);
+    return base;
+}
+
+QStringList DeltaArchive::chain(bool *ok) const
+{
+    if (ok) *ok = false;
+    QStringList paths;
+    QString path = m_archivePath;
+    while (!path.isEmpty()) {
+        if (paths.contains(path)) {
+            qWarning() << "Delta chain loops at" << path;
+            return QStringList();
+        }
+        paths.prepend(path);
+        bool manifestOk = false;
+        path = DeltaArchive(path).basePath(&manifestOk);
+        if (!manifestOk) {
+            return QStringList();
+        }
+    }
+    if (ok) *ok = true;
+    return paths;
+}
+
+QList<DeltaArchive::Entry> DeltaArchive::loadManifest(const QString &archivePath, QString *basePath, bool *ok)
+{
+    QList<Entry> entries;
+    if (ok) *ok = false;
+
+    QFile file(archivePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < kFooterSize) {
+        return entries;
+    }
+    file.seek(file.size() - kFooterSize);
+    QByteArray footer = file.read(kFooterSize);
+    if (footer.size() != kFooterSize || std::memcmp(footer.constData() + 8, kMagic, 8) != 0) {
+        return entries;
+    }
+    qint64 manifestOffset = qFromLittleEndian<qint64>(footer.constData());
+    if (manifestOffset < 0 || manifestOffset > file.size() - kFooterSize) {
+        return entries;
+    }
+    file.seek(manifestOffset);
+    QByteArray json = file.read(file.size() - kFooterSize - manifestOffset);
+
+    QJsonDocument doc = QJsonDocument::fromJson(json);
+    if (!doc.isObject() || doc.object()["version"].toInt() != 1) {
+        return entries;
+    }
+
+    QString base = doc.object()["base"].toString();
+    if (basePath) {
+        *basePath = base.isEmpty() ? QString() : QFileInfo(archivePath).absolutePath() + "/" + base;
+    }
+
+    const QJsonArray array = doc.object()["entries"].toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject obj = value.toObject();
+        Entry entry;
+        entry.path = obj["path"].toString();
+        entry.type = obj["type"].toString();
+        entry.mtime = obj["mtime"].toInteger();
+        entry.size = obj["size"].toInteger();
+        entry.encoding = obj["enc"].toString();
+        entry.offset = obj["off"].toInteger();
+        entry.length = obj["len"].toInteger();
+        entry.executable = obj["exec"].toBool();
+        entry.streamed = obj["stream"].toBool();
+        entry.crc = static_cast<quint32>(obj["crc"].toInteger());
+        entry.linkTarget = obj["target"].toString();
+        entries.append(entry);
+    }
+
+    if (ok) *ok = true;
+    return entries;
+}
+
+QByteArray DeltaArchive::encodeDelta(const QByteArray &base, const QByteArray &target)
+{
+    QByteArray out;
+    writeVarint(out, static_cast<quint64>(target.size()));
+
+    const uchar *b = reinterpret_cast<const uchar *>(base.constData());
+    const uchar *t = reinterpret_cast<const uchar *>(target.constData());
+    const qsizetype bn = base.size();
+    const qsizetype tn = target.size();
+
+    auto addLiteral = [&](qsizetype from, qsizetype to) {
+        if (to > from) {
+            out.append(kOpAdd);
+            writeVarint(out, static_cast<quint64>(to - from));
+            out.append(target.constData() + from, to - from);
+        }
+    };
+
+    // rsync's square-root rule keeps the index small for large files
+    const qsizetype block = qBound<qsizetype>(32, static_cast<qsizetype>(std::sqrt(double(bn))), 4096);
+    if (bn < block || tn < block) {
+        addLiteral(0, tn);
+        return out;
+    }
+
+    QHash<quint32, qsizetype> index;
+    index.reserve(bn / block);
+    for (qsizetype off = 0; off + block <= bn; off += block) {
+        quint32 a, s;
+        weakSums(b + off, block, &a, &s);
+        // Keep the first block for a hash so matches can run on forward
+        quint32 hash = weakHash(a, s);
+        if (!index.contains(hash)) {
+            index.insert(hash, off);
+        }
+    }
+
+    qsizetype literalStart = 0;
+    qsizetype i = 0;
+    quint32 a, s;
+    weakSums(t, block, &a, &s);
+    while (i + block <= tn) {
+        auto it = index.constFind(weakHash(a, s));
+        if (it != index.constEnd() && std::memcmp(b + it.value(), t + i, block) == 0) {
+            // Grow the match both ways before emitting it
+            qsizetype start = i;
+            qsizetype baseStart = it.value();
+            while (start > literalStart && baseStart > 0 && t[start - 1] == b[baseStart - 1]) {
+                --start;
+                --baseStart;
+            }
+            qsizetype end = i + block;
+            qsizetype baseEnd = it.value() + block;
+            while (end < tn && baseEnd < bn && t[end] == b[baseEnd]) {
+                ++end;
+                ++baseEnd;
+            }
+
+            addLiteral(literalStart, start);
+            out.append(kOpCopy);
+            writeVarint(out, static_cast<quint64>(baseStart));
+            writeVarint(out, static_cast<quint64>(end - start));
+
+            i = literalStart = end;
+            if (i + block <= tn) {
+                weakSums(t + i, block, &a, &s);
+            }
+            continue;
+        }
+
+        if (i + block < tn) {
+            quint32 dropped = t[i];
+            a += t[i + block] - dropped;
+            s += a - quint32(block) * dropped;
+        }
+        ++i;
+    }
+    addLiteral(literalStart, tn);
+    return out;
+}
+
+QByteArray DeltaArchive::applyDelta(const QByteArray &base, const QByteArray &delta, bool *ok)
+{
+    if (ok) *ok = false;
+
+    qsizetype pos = 0;
+    quint64 targetSize = 0;
+    if (!readVarint(delta, pos, &targetSize)) {
+        return QByteArray();
+    }
+
+    QByteArray out;
+    out.reserve(static_cast<qsizetype>(qMin<quint64>(targetSize, quint64(base.size()) + quint64(delta.size()))));
+    while (pos < delta.size()) {
+        char op = delta.at(pos++);
+        if (op == kOpCopy) {
+            quint64 offset = 0;
+            quint64 length = 0;
+            if (!readVarint(delta, pos, &offset) || !readVarint(delta, pos, &length)
+                || offset > quint64(base.size()) || length > quint64(base.size()) - offset) {
+                return QByteArray();
+            }
+            out.append(base.constData() + offset, static_cast<qsizetype>(length));
+        } else if (op == kOpAdd) {
+            quint64 length = 0;
+            if (!readVarint(delta, pos, &length) || length > quint64(delta.size() - pos)) {
+                return QByteArray();
+            }
+            out.append(delta.constData() + pos, static_cast<qsizetype>(length));
+            pos += static_cast<qsizetype>(length);
+        } else {
+            return QByteArray();
+        }
+        if (quint64(out.size()) > targetSize) {
+            return QByteArray();
+        }
+    }
+
+    if (quint64(out.size()) != targetSize) {
+        return QByteArray();
+    }
+    if (ok) *ok = true;
+    return out;
+}
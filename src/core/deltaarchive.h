@@ -0,0 +1,95 @@
+#ifndef DELTAARCHIVE_H
+#define DELTAARCHIVE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QSet>
+
+class FileChecksums;
+class TransferProgress;
+
+// Binary delta backups for saves that rewrite one large file per session.
+//
+// An archive is a single file: the compressed payload of every stored file,
+// then a JSON manifest and a fixed footer. A keyframe stores every file in
+// full. A delta names its base archive (the previous backup of the same game
+// and profile) and stores each changed file as copy/insert instructions
+// against the same path in the base, and unchanged files not at all.
+// Restoring walks the chain of bases back to the keyframe. Files stored in
+// full are restored and verified a slice at a time. With a memory limit,
+// files larger than it are never held whole either: they are diffed rsync
+// style against a signature of the base's version while they are read, and
+// their deltas are applied against the base rebuilt in a temporary file.
+class DeltaArchive {
+public:
+    struct Entry {
+        QString path;       // relative path inside the backup (tar-style)
+        QString type;       // "file", "dir" or "symlink"
+        bool executable = false;
+        qint64 mtime = 0;   // seconds since epoch
+        qint64 size = 0;
+        QString encoding;   // files: "full", "delta" or "base" (same as in the base)
+        qint64 offset = 0;  // payload position for full and delta files
+        qint64 length = 0;
+        quint32 crc = 0;    // CRC-32 of the file's full content
+        bool streamed = false; // delta applied from disk, a slice at a time
+        QString linkTarget;
+    };
+
+    struct Stats {
+        int fullFiles = 0;
+        int deltaFiles = 0;
+        int baseFiles = 0;
+        qint64 bytesIn = 0;     // logical bytes of the saved tree
+        qint64 bytesStored = 0; // size of the archive file
+        qint64 bytesSkipped = 0; // payload bytes already compressed, stored as is
+    };
+
+    explicit DeltaArchive(const QString &archivePath);
+
+    QString archivePath() const;
+    void setCompressionLevel(int level);
+    // Counts bytes read or restored and aborts when cancelled
+    void setProgress(TransferProgress *progress);
+    // Receives the hash of every file read by write, by entry path
+    void setChecksums(FileChecksums *checksums);
+    // Files larger than bytes are never held in memory: they are read,
+    // diffed and written a slice at a time (0 = no limit, the default)
+    void setMemoryLimit(qint64 bytes);
+
+    // Back up relativePaths (files or directories, recursed) below baseDir.
+    // With an empty basePath the archive is a keyframe. Paths in
+    // unchangedPaths are known to match the base and are not read again.
+    bool write(const QString &baseDir, const QStringList &relativePaths, const QString &basePath,
+               Stats *stats = nullptr, const QSet<QString> &unchangedPaths = QSet<QString>());
+    // Restores everything, or only paths (and what is below them)
+    bool restore(const QString &targetDir, const QStringList &paths = QStringList()) const;
+    // Decodes every file of the chain without writing anything
+    bool verify() const;
+    // Re-encode this archive against newBasePath (empty = make it a keyframe)
+    // without changing its contents, so its current base can be deleted
+    bool rebase(const QString &newBasePath);
+
+    // Base archive path, empty for a keyframe
+    QString basePath(bool *ok = nullptr) const;
+    // Archive paths from the keyframe up to and including this one
+    QStringList chain(bool *ok = nullptr) const;
+
+    static QList<Entry> loadManifest(const QString &archivePath, QString *basePath = nullptr,
+                                     bool *ok = nullptr);
+
+    // Copy/insert instructions turning base into target, and back
+    static QByteArray encodeDelta(const QByteArray &base, const QByteArray &target);
+    static QByteArray applyDelta(const QByteArray &base, const QByteArray &delta, bool *ok = nullptr);
+
+private:
+    QString m_archivePath;
+    int m_compressionLevel = 6;
+    TransferProgress *m_progress = nullptr;
+    FileChecksums *m_checksums = nullptr;
+    qint64 m_memoryLimit = 0;
+};
+
+#endif // DELTAARCHIVE_H
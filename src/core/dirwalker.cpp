@@ -0,0 +1,316 @@
+#include "dirwalker.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_UNIX
+void fromStat(const struct stat &st, DirWalker::FileStat *out)
+{
+    if (S_ISREG(st.st_mode)) {
+        out->type = DirWalker::File;
+    } else if (S_ISDIR(st.st_mode)) {
+        out->type = DirWalker::Dir;
+    } else if (S_ISLNK(st.st_mode)) {
+        out->type = DirWalker::Symlink;
+    } else {
+        out->type = DirWalker::Other;
+    }
+    out->size = out->type == DirWalker::File ? qint64(st.st_size) : 0;
+#ifdef Q_OS_LINUX
+    out->mtimeMs = qint64(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#else
+    out->mtimeMs = qint64(st.st_mtime) * 1000;
+#endif
+    out->inode = quint64(st.st_ino);
+    out->executable = (st.st_mode & S_IXUSR) != 0;
+}
+#endif
+
+#ifdef Q_OS_LINUX
+
+// The kernel's record layout; glibc only exposes getdents64 from 2.30 on
+struct LinuxDirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+constexpr size_t kDentsBufferSize = 32 * 1024;
+
+struct Item {
+    qsizetype nameOffset = 0;
+    qsizetype nameSize = 0;
+    DirWalker::FileStat stat;
+};
+
+// One directory's names and stats. Kept per depth and reused by the next
+// sibling at that depth, so the buffers are only allocated while the walk
+// goes deeper than before.
+struct Level {
+    QByteArray names;  // NUL-terminated names back to back
+    std::vector<Item> items;
+};
+
+class Walk {
+public:
+    Walk(const DirWalker::Visitor &visit, DirWalker::Order order, const QByteArray &root)
+        : m_visit(visit)
+        , m_order(order)
+        , m_path(root)
+        , m_rootSize(root.size())
+        , m_dents(kDentsBufferSize)
+    {
+    }
+
+    // Returns false when the visitor stopped the walk
+    bool walkDir(int fd, int depth)
+    {
+        if (m_levels.size() <= size_t(depth)) {
+            m_levels.emplace_back();
+        }
+        Level &level = m_levels[size_t(depth)];
+        if (!readNames(fd, level)) {
+            return true;
+        }
+
+        size_t kept = 0;
+        for (Item &item : level.items) {
+            struct stat st;
+            // Gone since it was listed
+            if (::fstatat(fd, level.names.constData() + item.nameOffset, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            fromStat(st, &item.stat);
+            level.items[kept++] = item;
+        }
+        level.items.resize(kept);
+        sortItems(level);
+
+        const qsizetype parentSize = m_path.size();
+        bool finished = true;
+        for (const Item &item : level.items) {
+            const char *name = level.names.constData() + item.nameOffset;
+            m_path.truncate(parentSize);
+            m_path.append('/');
+            m_path.append(name, item.nameSize);
+
+            DirWalker::Entry entry;
+            static_cast<DirWalker::FileStat &>(entry) = item.stat;
+            entry.depth = depth;
+            entry.nativePath = m_path.constData();
+            entry.nativePathSize = m_path.size();
+            entry.relativeOffset = m_rootSize + 1;
+
+            DirWalker::Action action = m_visit(entry);
+            if (action == DirWalker::Stop) {
+                finished = false;
+                break;
+            }
+            if (item.stat.type != DirWalker::Dir || action == DirWalker::SkipChildren) {
+                continue;
+            }
+            int child = ::openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child < 0) {
+                continue;
+            }
+            finished = walkDir(child, depth + 1);
+            ::close(child);
+            if (!finished) {
+                break;
+            }
+        }
+        m_path.truncate(parentSize);
+        return finished;
+    }
+
+private:
+    bool readNames(int fd, Level &level)
+    {
+        level.names.truncate(0);
+        level.items.clear();
+        for (;;) {
+            long n = ::syscall(SYS_getdents64, fd, m_dents.data(), m_dents.size());
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (n == 0) {
+                return true;
+            }
+            for (long pos = 0; pos < n;) {
+                const auto *d = reinterpret_cast<const LinuxDirent64 *>(m_dents.data() + pos);
+                pos += d->d_reclen;
+                const char *name = d->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                    continue;
+                }
+                Item item;
+                item.nameOffset = level.names.size();
+                item.nameSize = qsizetype(std::strlen(name));
+                // With the terminator, for fstatat and openat
+                level.names.append(name, item.nameSize + 1);
+                level.items.push_back(item);
+            }
+        }
+    }
+
+    void sortItems(Level &level) const
+    {
+        if (m_order == DirWalker::Unsorted) {
+            return;
+        }
+        const char *names = level.names.constData();
+        const bool dirsFirst = m_order == DirWalker::DirsFirst;
+        std::sort(level.items.begin(), level.items.end(), [names, dirsFirst](const Item &a, const Item &b) {
+            if (dirsFirst) {
+                bool aDir = a.stat.type == DirWalker::Dir;
+                bool bDir = b.stat.type == DirWalker::Dir;
+                if (aDir != bDir) {
+                    return aDir;
+                }
+            }
+            return std::strcmp(names + a.nameOffset, names + b.nameOffset) < 0;
+        });
+    }
+
+    const DirWalker::Visitor &m_visit;
+    DirWalker::Order m_order;
+    QByteArray m_path;
+    qsizetype m_rootSize;
+    std::vector<char> m_dents;
+    // A deque, so a level stays put while deeper ones are added
+    std::deque<Level> m_levels;
+};
+
+#else
+
+bool walkQDir(const QString &dir, int depth, QByteArray &path, qsizetype relativeOffset,
+              const DirWalker::Visitor &visit, DirWalker::Order order)
+{
+    QDir::SortFlags sort = order == DirWalker::Unsorted ? QDir::Unsorted
+                         : order == DirWalker::DirsFirst ? QDir::DirsFirst | QDir::Name
+                                                         : QDir::Name;
+    const QStringList names = QDir(dir).entryList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden
+                                                      | QDir::System, sort);
+    const qsizetype parentSize = path.size();
+    for (const QString &name : names) {
+        QString filePath = dir + "/" + name;
+        DirWalker::Entry entry;
+        if (!DirWalker::stat(filePath, &entry)) {
+            continue;
+        }
+        path.truncate(parentSize);
+        path.append('/');
+        path.append(QFile::encodeName(name));
+        entry.depth = depth;
+        entry.nativePath = path.constData();
+        entry.nativePathSize = path.size();
+        entry.relativeOffset = relativeOffset;
+
+        DirWalker::Action action = visit(entry);
+        if (action == DirWalker::Stop) {
+            return false;
+        }
+        if (entry.type == DirWalker::Dir && action == DirWalker::Continue
+            && !walkQDir(filePath, depth + 1, path, relativeOffset, visit, order)) {
+            return false;
+        }
+    }
+    path.truncate(parentSize);
+    return true;
+}
+
+#endif
+
+} // namespace
+
+QString DirWalker::Entry::filePath() const
+{
+    return QFile::decodeName(nativePath);
+}
+
+QString DirWalker::Entry::relativePath() const
+{
+    return QFile::decodeName(nativePath + relativeOffset);
+}
+
+QString DirWalker::Entry::fileName() const
+{
+    const char *slash = std::strrchr(nativePath, '/');
+    return QFile::decodeName(slash ? slash + 1 : nativePath);
+}
+
+bool DirWalker::walk(const QString &rootDir, const Visitor &visit, Order order)
+{
+    QByteArray root = QFile::encodeName(QDir::cleanPath(rootDir));
+    if (root.endsWith('/')) {
+        root.chop(1);
+    }
+
+#ifdef Q_OS_LINUX
+    // The root may be a symlink (a save dir moved to another drive)
+    int fd = ::open(root.isEmpty() ? "/" : root.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    Walk walk(visit, order, root);
+    bool finished = walk.walkDir(fd, 0);
+    ::close(fd);
+    return finished;
+#else
+    if (!QFileInfo(rootDir).isDir()) {
+        return false;
+    }
+    return walkQDir(QDir::cleanPath(rootDir), 0, root, root.size() + 1, visit, order);
+#endif
+}
+
+bool DirWalker::stat(const QString &path, FileStat *out, bool followSymlinks)
+{
+#ifdef Q_OS_UNIX
+    QByteArray native = QFile::encodeName(path);
+    struct ::stat st;
+    int rc = followSymlinks ? ::stat(native.constData(), &st) : ::lstat(native.constData(), &st);
+    if (rc != 0) {
+        return false;
+    }
+    fromStat(st, out);
+    return true;
+#else
+    QFileInfo fi(path);
+    if (!fi.exists() && !fi.isSymLink()) {
+        return false;
+    }
+    if (!followSymlinks && fi.isSymLink()) {
+        out->type = Symlink;
+    } else {
+        out->type = fi.isDir() ? Dir : fi.isFile() ? File : Other;
+    }
+    out->size = out->type == File ? fi.size() : 0;
+    out->mtimeMs = fi.lastModified().toMSecsSinceEpoch();
+    out->inode = 0;
+    out->executable = fi.isExecutable();
+    return true;
+#endif
+}
@@ -0,0 +1,90 @@
+#include "filechecksums.h"
+#include <QFile>
+#include <QJsonDocument>
+
+FileChecksums::Hasher::Hasher()
+    : m_hash(QCryptographicHash::Blake2b_256)
+{
+}
+
+void FileChecksums::Hasher::addData(const char *data, qint64 length)
+{
+    m_hash.addData(QByteArrayView(data, length));
+}
+
+QByteArray FileChecksums::Hasher::result() const
+{
+    return m_hash.result().toHex();
+}
+
+void FileChecksums::insert(const QString &path, const QByteArray &hash)
+{
+    m_hashes.insert(path, hash);
+}
+
+QByteArray FileChecksums::value(const QString &path) const
+{
+    return m_hashes.value(path);
+}
+
+QStringList FileChecksums::paths() const
+{
+    return m_hashes.keys();
+}
+
+int FileChecksums::size() const
+{
+    return m_hashes.size();
+}
+
+bool FileChecksums::isEmpty() const
+{
+    return m_hashes.isEmpty();
+}
+
+QJsonObject FileChecksums::toJson() const
+{
+    QJsonObject files;
+    for (auto it = m_hashes.constBegin(); it != m_hashes.constEnd(); ++it) {
+        files[it.key()] = QString::fromLatin1(it.value());
+    }
+
+    QJsonObject obj;
+    obj["algorithm"] = QString::fromLatin1(Algorithm);
+    obj["files"] = files;
+    return obj;
+}
+
+FileChecksums FileChecksums::fromJson(const QJsonObject &obj, bool *ok)
+{
+    FileChecksums checksums;
+    if (ok) *ok = false;
+
+    // Hashes from another algorithm cannot be compared, treat them as absent
+    if (obj["algorithm"].toString() != QLatin1String(Algorithm)) {
+        return checksums;
+    }
+
+    const QJsonObject files = obj["files"].toObject();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        checksums.insert(it.key(), it.value().toString().toLatin1());
+    }
+
+    if (ok) *ok = true;
+    return checksums;
+}
+
+FileChecksums FileChecksums::loadMetadata(const QString &metadataPath, bool *ok)
+{
+    if (ok) *ok = false;
+
+    QFile file(metadataPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return FileChecksums();
+    }
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (!root.contains("checksums")) {
+        return FileChecksums();
+    }
+    return fromJson(root["checksums"].toObject(), ok);
+}
@@ -0,0 +1,46 @@
+#ifndef FILECHECKSUMS_H
+#define FILECHECKSUMS_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QCryptographicHash>
+
+// Content hashes of the files in a backup, keyed by archive entry path and
+// taken from the bytes as they went into the archive. Kept in the backup's
+// .json sidecar so a content verify can tell silent corruption from a
+// merely readable archive.
+class FileChecksums {
+public:
+    static constexpr const char *Algorithm = "blake2b-256";
+
+    // Incremental hash of one file's content
+    class Hasher {
+    public:
+        Hasher();
+        void addData(const char *data, qint64 length);
+        QByteArray result() const; // hex
+
+    private:
+        QCryptographicHash m_hash;
+    };
+
+    void insert(const QString &path, const QByteArray &hash);
+    // Empty when the path has no recorded hash
+    QByteArray value(const QString &path) const;
+    QStringList paths() const;
+    int size() const;
+    bool isEmpty() const;
+
+    QJsonObject toJson() const;
+    static FileChecksums fromJson(const QJsonObject &obj, bool *ok = nullptr);
+    // Reads the "checksums" object of a backup's metadata sidecar
+    static FileChecksums loadMetadata(const QString &metadataPath, bool *ok = nullptr);
+
+private:
+    QHash<QString, QByteArray> m_hashes;
+};
+
+#endif // FILECHECKSUMS_H
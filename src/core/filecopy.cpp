@@ -0,0 +1,207 @@
+#include "filecopy.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <QCoreApplication>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+constexpr qint64 kBufferSize = 1024 * 1024;
+
+// Hidden and unique per thread, in dest's directory so the final rename
+// stays on one filesystem
+QString tempPathFor(const QString &dest)
+{
+    QFileInfo info(dest);
+    return QString("%1/.%2.copy-%3-%4").arg(info.absolutePath(), info.fileName())
+        .arg(QCoreApplication::applicationPid())
+        .arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+}
+
+#ifdef Q_OS_UNIX
+bool writeAll(int fd, const char *data, qint64 size)
+{
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, static_cast<size_t>(size));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool copyData(int in, int out, qint64 size, FileCopy::Method *method)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    if (::ioctl(out, FICLONE, in) == 0) {
+        *method = FileCopy::Reflink;
+        return true;
+    }
+#endif
+
+#if defined(Q_OS_LINUX) && defined(SYS_copy_file_range)
+    // Falls back only before the first byte: a later failure is a real one
+    qint64 copied = 0;
+    while (copied < size) {
+        ssize_t n = ::syscall(SYS_copy_file_range, in, nullptr, out, nullptr,
+                              static_cast<size_t>(qMin<qint64>(size - copied, 1 << 30)), 0u);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (copied == 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP
+                                || errno == EINVAL || errno == EPERM)) {
+                break;
+            }
+            return false;
+        }
+        if (n == 0) {
+            // Source shrank while copying
+            *method = FileCopy::CopyFileRange;
+            return true;
+        }
+        copied += n;
+    }
+    if (copied > 0) {
+        *method = FileCopy::CopyFileRange;
+        return true;
+    }
+#else
+    Q_UNUSED(size);
+#endif
+
+    QByteArray buffer(kBufferSize, Qt::Uninitialized);
+    for (;;) {
+        ssize_t n = ::read(in, buffer.data(), static_cast<size_t>(buffer.size()));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (!writeAll(out, buffer.constData(), n)) {
+            return false;
+        }
+    }
+    *method = FileCopy::Buffered;
+    return true;
+}
+#endif
+
+} // namespace
+
+bool FileCopy::copyFile(const QString &source, const QString &dest, Method *method)
+{
+    QString temp = tempPathFor(dest);
+    QFile::remove(temp);
+
+    QFileInfo info(source);
+#ifdef Q_OS_UNIX
+    QByteArray sourceName = QFile::encodeName(source);
+    QByteArray tempName = QFile::encodeName(temp);
+    QByteArray destName = QFile::encodeName(dest);
+    if (info.isSymLink()) {
+        // Raw target, so relative links stay relative
+        char target[4096];
+        ssize_t length = ::readlink(sourceName.constData(), target, sizeof(target) - 1);
+        if (length < 0) {
+            return false;
+        }
+        target[length] = '\0';
+        if (::symlink(target, tempName.constData()) != 0
+            || ::rename(tempName.constData(), destName.constData()) != 0) {
+            qWarning() << "Failed to copy symlink" << source << strerror(errno);
+            ::unlink(tempName.constData());
+            return false;
+        }
+        return true;
+    }
+
+    int in = ::open(sourceName.constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        qWarning() << "Failed to open" << source << strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (::fstat(in, &st) != 0) {
+        ::close(in);
+        return false;
+    }
+    int out = ::open(tempName.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (out < 0) {
+        qWarning() << "Failed to create" << temp << strerror(errno);
+        ::close(in);
+        return false;
+    }
+
+    Method used = Buffered;
+    bool ok = copyData(in, out, st.st_size, &used);
+    if (ok) {
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+        ok = ::fchmod(out, st.st_mode & 07777) == 0 && ::futimens(out, times) == 0;
+    }
+    ok = ::close(out) == 0 && ok;
+    ::close(in);
+
+    if (ok && ::rename(tempName.constData(), destName.constData()) == 0) {
+        if (method) *method = used;
+        return true;
+    }
+    qWarning() << "Failed to copy" << source << "to" << dest << strerror(errno);
+    ::unlink(tempName.constData());
+    return false;
+#else
+    if (!QFile::copy(source, temp)) {
+        return false;
+    }
+    QFile copy(temp);
+    if (copy.open(QIODevice::ReadWrite)) {
+        copy.setFileTime(info.lastModified(), QFileDevice::FileModificationTime);
+        copy.close();
+    }
+    if (method) *method = Buffered;
+    QFile::remove(dest);
+    return QFile::rename(temp, dest);
+#endif
+}
+
+bool FileCopy::isMountPoint(const QString &path)
+{
+#ifdef Q_OS_UNIX
+    struct stat self;
+    struct stat parent;
+    QFileInfo info(path);
+    if (::stat(QFile::encodeName(info.absoluteFilePath()).constData(), &self) != 0
+        || ::stat(QFile::encodeName(info.absolutePath()).constData(), &parent) != 0) {
+        return false;
+    }
+    return self.st_dev != parent.st_dev;
+#else
+    Q_UNUSED(path);
+    return false;
+#endif
+}
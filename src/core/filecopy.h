@@ -0,0 +1,29 @@
+#ifndef FILECOPY_H
+#define FILECOPY_H
+
+#include <QString>
+
+// Copies files the cheapest way the filesystem allows: a reflink clone
+// (FICLONE on btrfs, XFS and bcachefs) shares the data blocks and is nearly
+// free, copy_file_range lets the kernel move the data without a round trip
+// through user space, and a read/write loop with a large buffer covers the
+// rest. Safe to call from any thread.
+class FileCopy {
+public:
+    enum Method {
+        Reflink,
+        CopyFileRange,
+        Buffered,
+    };
+
+    // Copies permissions and timestamps along with the data. The copy is
+    // written next to dest and renamed over it, so dest is never half-written.
+    // Symlinks are recreated, not followed.
+    static bool copyFile(const QString &source, const QString &dest, Method *method = nullptr);
+
+    // True if path is on a different filesystem than its parent directory,
+    // so it cannot be renamed or replaced by a rename
+    static bool isMountPoint(const QString &path);
+};
+
+#endif // FILECOPY_H
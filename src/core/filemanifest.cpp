@@ -0,0 +1,295 @@
+#include "filemanifest.h"
+#include "dirwalker.h"
+#include "filechecksums.h"
+#include "transferprogress.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+namespace {
+
+// Margin for filesystems with coarse timestamps (FAT, some network mounts)
+constexpr qint64 kRacyWindowMs = 2000;
+
+constexpr qint64 kReadSlice = 1024 * 1024;
+
+QByteArray hashFile(const QString &path, TransferProgress *progress = nullptr)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    FileChecksums::Hasher hasher;
+    QByteArray buffer(kReadSlice, Qt::Uninitialized);
+    qint64 n;
+    while ((n = file.read(buffer.data(), kReadSlice)) > 0) {
+        hasher.addData(buffer.constData(), n);
+        if (progress && !progress->addBytes(n)) {
+            return QByteArray();
+        }
+    }
+    return n == 0 ? hasher.result() : QByteArray();
+}
+
+} // namespace
+
+FileManifest FileManifest::scan(const QString &baseDir, const QStringList &relativePaths)
+{
+    return scan(baseDir, relativePaths, FileManifest());
+}
+
+FileManifest FileManifest::scan(const QString &baseDir, const QStringList &relativePaths,
+                                const FileManifest &previous, Hashing hashing)
+{
+    FileManifest manifest;
+    manifest.m_scannedAtMs = QDateTime::currentMSecsSinceEpoch();
+    for (const QString &relPath : relativePaths) {
+        manifest.scanPath(baseDir, relPath, previous, hashing);
+    }
+    return manifest;
+}
+
+void FileManifest::scanPath(const QString &baseDir, const QString &relativePath,
+                            const FileManifest &previous, Hashing hashing)
+{
+    DirWalker::FileStat st;
+    if (!DirWalker::stat(baseDir + "/" + relativePath, &st)) {
+        return;
+    }
+    addScanned(baseDir, relativePath, st, previous, hashing);
+    if (st.type == DirWalker::Dir) {
+        scanDirectory(baseDir, relativePath, previous, hashing);
+    }
+}
+
+void FileManifest::scanDirectory(const QString &baseDir, const QString &relativePath,
+                                 const FileManifest &previous, Hashing hashing)
+{
+    DirWalker::walk(baseDir + "/" + relativePath, [&](const DirWalker::Entry &fi) {
+        addScanned(baseDir, relativePath + "/" + fi.relativePath(), fi, previous, hashing);
+        return DirWalker::Continue;
+    });
+}
+
+void FileManifest::addScanned(const QString &baseDir, const QString &relativePath,
+                              const DirWalker::FileStat &st, const FileManifest &previous, Hashing hashing)
+{
+    Entry entry;
+    entry.path = relativePath;
+    entry.mtimeMs = st.mtimeMs;
+    entry.inode = st.inode;
+
+    if (st.type == DirWalker::Symlink) {
+        entry.type = "symlink";
+        entry.linkTarget = QFileInfo(baseDir + "/" + relativePath).symLinkTarget();
+        addEntry(entry);
+    } else if (st.type == DirWalker::Dir) {
+        entry.type = "dir";
+        addEntry(entry);
+    } else if (st.type == DirWalker::File) {
+        entry.type = "file";
+        entry.size = st.size;
+
+        const Entry *old = previous.find(relativePath);
+        if (old && old->type == "file" && old->size == entry.size && old->mtimeMs == entry.mtimeMs
+            && old->inode == entry.inode && !old->hash.isEmpty()
+            && old->mtimeMs < previous.m_scannedAtMs - kRacyWindowMs) {
+            entry.hash = old->hash;
+        } else if (hashing == HashFiles) {
+            entry.hash = hashFile(baseDir + "/" + relativePath);
+        }
+        addEntry(entry);
+    }
+}
+
+void FileManifest::addEntry(const Entry &entry)
+{
+    m_index.insert(entry.path, m_entries.size());
+    m_entries.append(entry);
+}
+
+FileManifest FileManifest::load(const QString &path, bool *ok)
+{
+    FileManifest manifest;
+    if (ok) *ok = false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return manifest;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject() || doc.object()["version"].toInt() != 1) {
+        return manifest;
+    }
+
+    manifest.m_scannedAtMs = doc.object()["scannedAt"].toInteger();
+    const QJsonArray array = doc.object()["entries"].toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject obj = value.toObject();
+        Entry entry;
+        entry.path = obj["path"].toString();
+        entry.type = obj["type"].toString();
+        entry.size = obj["size"].toInteger();
+        entry.mtimeMs = obj["mtime"].toInteger();
+        entry.inode = obj["inode"].toString().toULongLong();
+        entry.hash = obj["hash"].toString().toLatin1();
+        entry.linkTarget = obj["target"].toString();
+        manifest.addEntry(entry);
+    }
+
+    if (ok) *ok = true;
+    return manifest;
+}
+
+bool FileManifest::save(const QString &path) const
+{
+    QJsonArray array;
+    for (const Entry &entry : m_entries) {
+        QJsonObject obj;
+        obj["path"] = entry.path;
+        obj["type"] = entry.type;
+        obj["mtime"] = entry.mtimeMs;
+        // Inodes can exceed the 53 bits a JSON number holds exactly
+        obj["inode"] = QString::number(entry.inode);
+        if (entry.type == "file") {
+            obj["size"] = entry.size;
+            obj["hash"] = QString::fromLatin1(entry.hash);
+        } else if (entry.type == "symlink") {
+            obj["target"] = entry.linkTarget;
+        }
+        array.append(obj);
+    }
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["scannedAt"] = m_scannedAtMs;
+    root["entries"] = array;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+bool FileManifest::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+const QList<FileManifest::Entry> &FileManifest::entries() const
+{
+    return m_entries;
+}
+
+const FileManifest::Entry *FileManifest::find(const QString &path) const
+{
+    auto it = m_index.constFind(path);
+    if (it == m_index.constEnd()) {
+        return nullptr;
+    }
+    return &m_entries.at(it.value());
+}
+
+qint64 FileManifest::totalSize() const
+{
+    qint64 total = 0;
+    for (const Entry &entry : m_entries) {
+        total += entry.size;
+    }
+    return total;
+}
+
+int FileManifest::fileCount() const
+{
+    int count = 0;
+    for (const Entry &entry : m_entries) {
+        if (entry.type == "file") {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool FileManifest::sameContent(const FileManifest &other) const
+{
+    return m_entries.size() == other.m_entries.size() && changedPaths(other).isEmpty();
+}
+
+QStringList FileManifest::changedPaths(const FileManifest &other) const
+{
+    QStringList changed;
+    for (const Entry &entry : m_entries) {
+        const Entry *old = other.find(entry.path);
+        if (!old || old->type != entry.type) {
+            changed.append(entry.path);
+        } else if (entry.type == "file"
+                   && (old->size != entry.size || old->hash.isEmpty() || old->hash != entry.hash)) {
+            changed.append(entry.path);
+        } else if (entry.type == "symlink" && old->linkTarget != entry.linkTarget) {
+            changed.append(entry.path);
+        }
+    }
+    return changed;
+}
+
+bool FileManifest::maybeSameContent(const FileManifest &other) const
+{
+    if (m_entries.size() != other.m_entries.size()) {
+        return false;
+    }
+    for (const Entry &entry : m_entries) {
+        const Entry *old = other.find(entry.path);
+        if (!old || old->type != entry.type) {
+            return false;
+        }
+        if (entry.type == "file" && (old->size != entry.size || old->hash.isEmpty()
+                                     || (!entry.hash.isEmpty() && old->hash != entry.hash))) {
+            return false;
+        }
+        if (entry.type == "symlink" && old->linkTarget != entry.linkTarget) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FileManifest::setHash(const QString &path, const QByteArray &hash)
+{
+    auto it = m_index.constFind(path);
+    if (it != m_index.constEnd() && m_entries.at(it.value()).type == "file") {
+        m_entries[it.value()].hash = hash;
+    }
+}
+
+qint64 FileManifest::unhashedSize() const
+{
+    qint64 total = 0;
+    for (const Entry &entry : m_entries) {
+        if (entry.type == "file" && entry.hash.isEmpty()) {
+            total += entry.size;
+        }
+    }
+    return total;
+}
+
+bool FileManifest::hashMissing(const QString &baseDir, TransferProgress *progress)
+{
+    for (Entry &entry : m_entries) {
+        if (entry.type != "file" || !entry.hash.isEmpty()) {
+            continue;
+        }
+        entry.hash = hashFile(baseDir + "/" + entry.path, progress);
+        if (entry.hash.isEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef FILEMANIFEST_H
+#define FILEMANIFEST_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include "dirwalker.h"
+
+class TransferProgress;
+
+// Fingerprint of a save tree at backup time: path, type, size, mtime, inode
+// and a BLAKE2b content hash per file. Stored next to each backup as
+// <archive>.files and compared against a fresh scan to detect whether
+// anything changed since the last backup.
+class FileManifest {
+public:
+    enum Hashing {
+        HashFiles,  // read every file whose hash cannot be reused
+        StatOnly,   // leave those hashes empty, to be filled in later
+    };
+
+    struct Entry {
+        QString path;       // same layout as the backup archive
+        QString type;       // "file", "dir" or "symlink"
+        qint64 size = 0;
+        qint64 mtimeMs = 0;
+        quint64 inode = 0;
+        QByteArray hash;    // hex BLAKE2b-256 of the contents, files only
+        QString linkTarget;
+    };
+
+    // Scan relativePaths (files or directories, recursed) below baseDir.
+    // Hashes are reused from previous when size, mtime and inode are all
+    // unchanged, so an untouched tree is fingerprinted with stat() calls only.
+    // Files modified shortly before the previous scan are always re-hashed,
+    // since a same-size rewrite within the timestamp granularity is invisible.
+    // With StatOnly no file is read: what would be hashed is left empty and
+    // counts as changed.
+    static FileManifest scan(const QString &baseDir, const QStringList &relativePaths);
+    static FileManifest scan(const QString &baseDir, const QStringList &relativePaths,
+                             const FileManifest &previous, Hashing hashing = HashFiles);
+
+    static FileManifest load(const QString &path, bool *ok = nullptr);
+    bool save(const QString &path) const;
+
+    bool isEmpty() const;
+    const QList<Entry> &entries() const;
+    const Entry *find(const QString &path) const;
+    qint64 totalSize() const;
+    int fileCount() const;
+
+    // Same paths with the same content (mtime and inode are ignored, so a
+    // save that was rewritten with identical bytes still counts as unchanged)
+    bool sameContent(const FileManifest &other) const;
+    // Paths that are new or whose content differs from other
+    QStringList changedPaths(const FileManifest &other) const;
+    // Whether hashing the files without a hash could still make this
+    // sameContent as other: same paths, types, sizes and link targets
+    bool maybeSameContent(const FileManifest &other) const;
+
+    void setHash(const QString &path, const QByteArray &hash);
+    qint64 unhashedSize() const;
+    // Hashes the files without a hash from their copies below baseDir,
+    // counting the bytes on progress. False if cancelled or unreadable.
+    bool hashMissing(const QString &baseDir, TransferProgress *progress = nullptr);
+
+private:
+    void addEntry(const Entry &entry);
+    void scanDirectory(const QString &baseDir, const QString &relativePath,
+                       const FileManifest &previous, Hashing hashing);
+    void scanPath(const QString &baseDir, const QString &relativePath,
+                  const FileManifest &previous, Hashing hashing);
+    void addScanned(const QString &baseDir, const QString &relativePath, const DirWalker::FileStat &st,
+                    const FileManifest &previous, Hashing hashing);
+
+    QList<Entry> m_entries;
+    QHash<QString, int> m_index;
+    qint64 m_scannedAtMs = 0;
+};
+
+#endif // FILEMANIFEST_H
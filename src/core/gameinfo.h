@@ -4,6 +4,7 @@
 #include <QString>
 #include <QStringList>
 #include <QDateTime>
+#include <QByteArray>
 
 struct SaveProfile {
     int id;
@@ -41,9 +42,36 @@ struct BackupInfo {
     qint64 size;
     QString profileName; // empty = "All files"
     int profileId;       // -1 = full directory backup
+    QString format;      // "tar.gz", "tar.zst", "chunks", "delta" or "hardlinks"
+    bool pinned;         // never removed by retention pruning
+    qint64 compressionSkipped; // bytes already compressed, stored as is
 
     BackupInfo()
-        : size(0), profileId(-1) {}
+        : size(0), profileId(-1), format("tar.gz"), pinned(false), compressionSkipped(0) {}
+};
+
+// Totals over a game's backups
+struct BackupSummary {
+    QString gameId;
+    QString gameName;    // from the newest backup
+    int count;
+    qint64 totalSize;
+    QDateTime latest;
+
+    BackupSummary() : count(0), totalSize(0) {}
+};
+
+// One path inside a backup, relative to the archive root
+struct BackupEntry {
+    QString path;
+    QString type;        // "file", "dir" or "symlink"
+    qint64 size;
+    QDateTime mtime;
+    QByteArray hash;     // hex BLAKE2b-256 of the contents, files only; empty if unknown
+    QString linkTarget;
+
+    BackupEntry()
+        : size(0) {}
 };
 
 #endif // GAMEINFO_H
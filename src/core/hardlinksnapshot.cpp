@@ -0,0 +1,280 @@
+#include "hardlinksnapshot.h"
+#include "archiveindex.h"
+#include "dirwalker.h"
+#include "filechecksums.h"
+#include "filecopy.h"
+#include "filemanifest.h"
+#include "transferprogress.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QDebug>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+constexpr qint64 kReadSlice = 1024 * 1024;
+
+QString typeName(DirWalker::Type type)
+{
+    switch (type) {
+    case DirWalker::Dir:
+        return "dir";
+    case DirWalker::Symlink:
+        return "symlink";
+    default:
+        return "file";
+    }
+}
+
+// Raw target, so relative links stay relative
+QString readLink(const QString &path)
+{
+    std::error_code ec;
+    auto target = std::filesystem::read_symlink(QFile::encodeName(path).toStdString(), ec);
+    return ec ? QString() : QFile::decodeName(target.c_str());
+}
+
+QByteArray hashFile(const QString &path, TransferProgress *progress, bool *ok)
+{
+    *ok = false;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    FileChecksums::Hasher hasher;
+    QByteArray buffer(kReadSlice, Qt::Uninitialized);
+    qint64 n;
+    while ((n = file.read(buffer.data(), kReadSlice)) > 0) {
+        hasher.addData(buffer.constData(), n);
+        if (progress && !progress->addBytes(n)) {
+            return QByteArray();
+        }
+    }
+    *ok = n == 0;
+    return hasher.result();
+}
+
+} // namespace
+
+HardlinkSnapshot::HardlinkSnapshot(const QString &treePath)
+    : m_treePath(treePath)
+{
+}
+
+QString HardlinkSnapshot::treePath() const
+{
+    return m_treePath;
+}
+
+void HardlinkSnapshot::setProgress(TransferProgress *progress)
+{
+    m_progress = progress;
+}
+
+bool HardlinkSnapshot::write(const QString &baseDir, const QStringList &relativePaths,
+                             const QString &basePath, Stats *stats, const QSet<QString> &unchangedPaths)
+{
+    const QString staging = m_treePath + ".partial";
+    QDir(staging).removeRecursively();
+    if (!QDir().mkpath(staging)) {
+        qWarning() << "Failed to create snapshot directory:" << staging;
+        return false;
+    }
+
+    auto add = [&](const QString &source, const QString &path, const DirWalker::FileStat &st) {
+        QString dest = staging + "/" + path;
+        if (st.type == DirWalker::Dir) {
+            return QDir().mkpath(dest);
+        }
+        if (st.type == DirWalker::Symlink) {
+            return FileCopy::copyFile(source, dest);
+        }
+        if (st.type != DirWalker::File) {
+            return true;
+        }
+
+        if (!basePath.isEmpty() && unchangedPaths.contains(path)) {
+            // A damaged previous snapshot, or a file at the filesystem's
+            // link limit, falls back to a copy
+            QString previous = basePath + "/" + path;
+            DirWalker::FileStat old;
+            std::error_code ec;
+            if (DirWalker::stat(previous, &old) && old.type == DirWalker::File && old.size == st.size) {
+                std::filesystem::create_hard_link(QFile::encodeName(previous).toStdString(),
+                                                  QFile::encodeName(dest).toStdString(), ec);
+                if (!ec) {
+                    if (stats) {
+                        stats->linkedFiles++;
+                        stats->bytesIn += st.size;
+                    }
+                    if (m_progress) {
+                        m_progress->addFile();
+                        return m_progress->addBytes(st.size);
+                    }
+                    return true;
+                }
+            }
+        }
+
+        if (!FileCopy::copyFile(source, dest)) {
+            qWarning() << "Failed to copy file into snapshot:" << source;
+            return false;
+        }
+        if (stats) {
+            stats->copiedFiles++;
+            stats->bytesIn += st.size;
+            stats->bytesCopied += st.size;
+        }
+        if (m_progress) {
+            m_progress->addFile();
+            return m_progress->addBytes(st.size);
+        }
+        return true;
+    };
+
+    bool any = false;
+    bool ok = true;
+    for (const QString &relPath : relativePaths) {
+        QString source = baseDir + "/" + relPath;
+        // A symlinked save dir is backed up as the directory it points to
+        DirWalker::FileStat st;
+        if (!DirWalker::stat(source, &st, true)) {
+            qWarning() << "Snapshot path not found, skipping:" << source;
+            continue;
+        }
+        any = true;
+        QDir().mkpath(QFileInfo(staging + "/" + relPath).absolutePath());
+        ok = add(source, relPath, st);
+        if (ok && st.type == DirWalker::Dir) {
+            ok = DirWalker::walk(source, [&](const DirWalker::Entry &entry) {
+                return add(entry.filePath(), relPath + "/" + entry.relativePath(), entry)
+                    ? DirWalker::Continue : DirWalker::Stop;
+            }, DirWalker::DirsFirst);
+        }
+        if (!ok) {
+            break;
+        }
+    }
+
+    if (!ok || !any) {
+        QDir(staging).removeRecursively();
+        return false;
+    }
+    if (!QDir().rename(staging, m_treePath)) {
+        qWarning() << "Failed to move snapshot into place:" << m_treePath;
+        QDir(staging).removeRecursively();
+        return false;
+    }
+    return true;
+}
+
+bool HardlinkSnapshot::restore(const QString &targetDir, const QStringList &paths) const
+{
+    if (!QFileInfo(m_treePath).isDir()) {
+        return false;
+    }
+
+    QDir().mkpath(targetDir);
+    return DirWalker::walk(m_treePath, [&](const DirWalker::Entry &entry) {
+        QString path = entry.relativePath();
+        if (!ArchiveIndex::isSelected(path, paths)) {
+            return DirWalker::Continue;
+        }
+        QString dest = targetDir + "/" + path;
+        if (entry.type == DirWalker::Dir) {
+            return QDir().mkpath(dest) ? DirWalker::Continue : DirWalker::Stop;
+        }
+        if (entry.type != DirWalker::File && entry.type != DirWalker::Symlink) {
+            return DirWalker::Continue;
+        }
+
+        // Copied, never linked: the live save must not share an inode with
+        // the backup
+        QDir().mkpath(QFileInfo(dest).absolutePath());
+        if (!FileCopy::copyFile(entry.filePath(), dest)) {
+            qWarning() << "Failed to restore file from snapshot:" << path;
+            return DirWalker::Stop;
+        }
+        if (m_progress && entry.type == DirWalker::File) {
+            m_progress->addFile();
+            if (!m_progress->addBytes(entry.size)) {
+                return DirWalker::Stop;
+            }
+        }
+        return DirWalker::Continue;
+    }, DirWalker::DirsFirst);
+}
+
+bool HardlinkSnapshot::verify(const FileManifest &files, bool checkContent) const
+{
+    bool ok = false;
+    const QList<Entry> present = entries(m_treePath, &ok);
+    if (!ok) {
+        return false;
+    }
+
+    QHash<QString, const Entry *> byPath;
+    for (const Entry &entry : present) {
+        byPath.insert(entry.path, &entry);
+    }
+    for (const FileManifest::Entry &expected : files.entries()) {
+        const Entry *entry = byPath.value(expected.path);
+        // A symlinked save dir is fingerprinted as the link but stored as
+        // the directory it points to
+        if (!entry || (entry->type == "file") != (expected.type == "file")) {
+            qWarning() << "Snapshot is missing" << expected.path;
+            return false;
+        }
+        if (expected.type != "file") {
+            continue;
+        }
+        if (entry->size != expected.size) {
+            qWarning() << "Snapshot file has the wrong size:" << expected.path;
+            return false;
+        }
+        if (checkContent && !expected.hash.isEmpty()) {
+            bool read = false;
+            QByteArray hash = hashFile(m_treePath + "/" + expected.path, m_progress, &read);
+            if (!read || hash != expected.hash) {
+                qWarning() << "Snapshot file is damaged:" << expected.path;
+                return false;
+            }
+            if (m_progress) {
+                m_progress->addFile();
+            }
+        }
+    }
+    return true;
+}
+
+bool HardlinkSnapshot::remove() const
+{
+    return QDir(m_treePath).removeRecursively();
+}
+
+QList<HardlinkSnapshot::Entry> HardlinkSnapshot::entries(const QString &treePath, bool *ok)
+{
+    QList<Entry> result;
+    bool walked = DirWalker::walk(treePath, [&](const DirWalker::Entry &walkEntry) {
+        if (walkEntry.type == DirWalker::Other) {
+            return DirWalker::Continue;
+        }
+        Entry entry;
+        entry.path = walkEntry.relativePath();
+        entry.type = typeName(walkEntry.type);
+        entry.size = walkEntry.type == DirWalker::File ? walkEntry.size : 0;
+        entry.mtime = walkEntry.mtimeMs / 1000;
+        if (walkEntry.type == DirWalker::Symlink) {
+            entry.linkTarget = readLink(walkEntry.filePath());
+        }
+        result.append(entry);
+        return DirWalker::Continue;
+    }, DirWalker::DirsFirst);
+    if (ok) {
+        *ok = walked;
+    }
+    return result;
+}
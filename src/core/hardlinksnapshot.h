@@ -0,0 +1,70 @@
+#ifndef HARDLINKSNAPSHOT_H
+#define HARDLINKSNAPSHOT_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSet>
+
+class TransferProgress;
+class FileManifest;
+
+// Uncompressed backups for users who would rather spend disk than time
+// (rsnapshot style).
+//
+// A snapshot is a plain directory tree holding the backed-up paths as they
+// were. Files unchanged since the previous snapshot are hard links to its
+// copy, so they cost neither time nor space; changed files are copied, as a
+// reflink clone where the filesystem supports it. Backing up an untouched
+// save is one link() per file.
+//
+// A file in a snapshot may be shared with other snapshots, so it is never
+// written to: restores copy files out (reflinking where possible) instead of
+// linking them, and a game rewriting its save in place cannot reach into a
+// backup.
+class HardlinkSnapshot {
+public:
+    struct Entry {
+        QString path;       // relative path inside the snapshot (tar-style)
+        QString type;       // "file", "dir" or "symlink"
+        qint64 size = 0;
+        qint64 mtime = 0;   // seconds since epoch
+        QString linkTarget;
+    };
+
+    struct Stats {
+        int linkedFiles = 0;
+        int copiedFiles = 0;
+        qint64 bytesIn = 0;     // logical bytes of the saved tree
+        qint64 bytesCopied = 0; // bytes of the files that were not linked
+    };
+
+    explicit HardlinkSnapshot(const QString &treePath);
+
+    QString treePath() const;
+    // Counts bytes written, linked or restored and aborts when cancelled
+    void setProgress(TransferProgress *progress);
+
+    // Back up relativePaths (files or directories, recursed) below baseDir.
+    // Paths in unchangedPaths are linked from the snapshot at basePath
+    // instead of copied. The tree is built next to treePath and renamed into
+    // place, so a failed or cancelled snapshot leaves nothing behind.
+    bool write(const QString &baseDir, const QStringList &relativePaths,
+               const QString &basePath = QString(), Stats *stats = nullptr,
+               const QSet<QString> &unchangedPaths = QSet<QString>());
+    // Restores everything, or only paths (and what is below them)
+    bool restore(const QString &targetDir, const QStringList &paths = QStringList()) const;
+    // Every entry of the fingerprint taken at backup time is present with
+    // its size, and with checkContent its content hash too
+    bool verify(const FileManifest &files, bool checkContent) const;
+    // Other snapshots keep their links to shared files
+    bool remove() const;
+
+    static QList<Entry> entries(const QString &treePath, bool *ok = nullptr);
+
+private:
+    QString m_treePath;
+    TransferProgress *m_progress = nullptr;
+};
+
+#endif // HARDLINKSNAPSHOT_H
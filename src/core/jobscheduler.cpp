@@ -0,0 +1,277 @@
+#include "jobscheduler.h"
+#include "lowimpactio.h"
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QThread>
+#include <utility>
+
+JobContext::JobContext(JobScheduler *scheduler, quint64 id)
+    : m_scheduler(scheduler)
+    , m_id(id)
+{
+}
+
+quint64 JobContext::id() const
+{
+    return m_id;
+}
+
+bool JobContext::isCancelled() const
+{
+    return m_cancelled.load();
+}
+
+bool JobContext::isLowImpact() const
+{
+    return m_lowImpact;
+}
+
+void JobContext::reportProgress(qint64 done, qint64 total)
+{
+    // The scheduler outlives its workers (its destructor waits for the pool)
+    JobScheduler *scheduler = m_scheduler;
+    quint64 id = m_id;
+    QMetaObject::invokeMethod(scheduler, [scheduler, id, done, total]() {
+        emit scheduler->jobProgress(id, done, total);
+    }, Qt::QueuedConnection);
+}
+
+JobScheduler::JobScheduler(QObject *parent)
+    : QObject(parent)
+{
+    // Each job compresses on several threads already
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    m_lowImpactPool.setMaxThreadCount(m_pool.maxThreadCount());
+}
+
+JobScheduler::~JobScheduler()
+{
+    for (const Job &job : std::as_const(m_running)) {
+        job.context->m_cancelled = true;
+    }
+    m_pending.clear();
+    m_pool.waitForDone();
+    m_lowImpactPool.waitForDone();
+}
+
+void JobScheduler::setMaxConcurrentJobs(int count)
+{
+    m_pool.setMaxThreadCount(qMax(1, count));
+    m_lowImpactPool.setMaxThreadCount(qMax(1, count));
+    dispatch();
+}
+
+int JobScheduler::maxConcurrentJobs() const
+{
+    return m_pool.maxThreadCount();
+}
+
+void JobScheduler::setLowImpact(Priority priority, bool enabled)
+{
+    if (enabled) {
+        m_lowImpactMask |= 1 << priority;
+    } else {
+        m_lowImpactMask &= ~(1 << priority);
+    }
+}
+
+bool JobScheduler::isLowImpact(Priority priority) const
+{
+    return (m_lowImpactMask & (1 << priority)) != 0;
+}
+
+quint64 JobScheduler::submit(Priority priority, const QString &key, Work work, Done done)
+{
+    Keys keys;
+    if (!key.isEmpty()) {
+        keys.exclusive.append(key);
+    }
+    return submit(priority, keys, std::move(work), std::move(done));
+}
+
+quint64 JobScheduler::submit(Priority priority, const Keys &keys, Work work, Done done)
+{
+    Job job;
+    job.id = m_nextId++;
+    job.priority = priority;
+    job.keys = keys;
+    job.work = std::move(work);
+    job.done = std::move(done);
+    job.context = std::make_shared<JobContext>(this, job.id);
+
+    // Keep the queue ordered by priority, FIFO within a class
+    int pos = m_pending.size();
+    for (int i = 0; i < m_pending.size(); ++i) {
+        if (m_pending.at(i).priority > priority) {
+            pos = i;
+            break;
+        }
+    }
+    m_pending.insert(pos, job);
+
+    quint64 id = job.id;
+    dispatch();
+    return id;
+}
+
+bool JobScheduler::cancel(quint64 jobId)
+{
+    auto running = m_running.constFind(jobId);
+    if (running != m_running.constEnd()) {
+        running.value().context->m_cancelled = true;
+        return true;
+    }
+
+    for (int i = 0; i < m_pending.size(); ++i) {
+        if (m_pending.at(i).id == jobId) {
+            Job job = m_pending.takeAt(i);
+            job.context->m_cancelled = true;
+            complete(job);
+            if (isIdle()) {
+                emit idle();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobScheduler::cancelAll()
+{
+    for (const Job &job : std::as_const(m_running)) {
+        job.context->m_cancelled = true;
+    }
+
+    // Done callbacks may submit new jobs, so detach the queue first
+    QList<Job> pending = std::exchange(m_pending, QList<Job>());
+    for (const Job &job : std::as_const(pending)) {
+        job.context->m_cancelled = true;
+        complete(job);
+    }
+    if (!pending.isEmpty() && isIdle()) {
+        emit idle();
+    }
+}
+
+bool JobScheduler::isIdle() const
+{
+    return m_pending.isEmpty() && m_running.isEmpty();
+}
+
+int JobScheduler::pendingCount() const
+{
+    return m_pending.size();
+}
+
+int JobScheduler::runningCount() const
+{
+    return m_running.size();
+}
+
+bool JobScheduler::canStart(const Job &job) const
+{
+    if (job.keys.all) {
+        return m_runningKeys.isEmpty() && m_sharedKeys.isEmpty() && m_allKeysRunning == 0;
+    }
+    if (m_allKeysRunning > 0 && !isKeyless(job)) {
+        return false;
+    }
+    for (const QString &key : job.keys.exclusive) {
+        if (m_runningKeys.contains(key) || m_sharedKeys.contains(key)) {
+            return false;
+        }
+    }
+    for (const QString &key : job.keys.shared) {
+        if (m_runningKeys.contains(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JobScheduler::isKeyless(const Job &job)
+{
+    return !job.keys.all && job.keys.exclusive.isEmpty() && job.keys.shared.isEmpty();
+}
+
+void JobScheduler::dispatch()
+{
+    // Once a job waiting for every key is passed over, keyed jobs behind it
+    // wait too, or a steady stream of them would hold it off forever
+    bool allKeysWaiting = false;
+    for (int i = 0; i < m_pending.size() && m_running.size() < m_pool.maxThreadCount();) {
+        const Job &job = m_pending.at(i);
+        if ((allKeysWaiting && !isKeyless(job)) || !canStart(job)) {
+            allKeysWaiting = allKeysWaiting || job.keys.all;
+            ++i;
+            continue;
+        }
+        start(m_pending.takeAt(i));
+    }
+}
+
+void JobScheduler::start(const Job &job)
+{
+    m_running.insert(job.id, job);
+    if (job.keys.all) {
+        ++m_allKeysRunning;
+    }
+    for (const QString &key : job.keys.exclusive) {
+        m_runningKeys.insert(key);
+    }
+    for (const QString &key : job.keys.shared) {
+        ++m_sharedKeys[key];
+    }
+    emit jobStarted(job.id);
+
+    quint64 id = job.id;
+    Work work = job.work;
+    std::shared_ptr<JobContext> context = job.context;
+    bool lowImpact = isLowImpact(job.priority);
+    context->m_lowImpact = lowImpact;
+
+    auto *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher, id]() {
+        watcher->deleteLater();
+        finish(id);
+    });
+    watcher->setFuture(QtConcurrent::run(lowImpact ? &m_lowImpactPool : &m_pool, [work, context, lowImpact]() {
+        if (lowImpact) {
+            // Once per thread; the pool only ever runs low impact jobs
+            LowImpactIo::enterBackgroundMode();
+        }
+        if (!context->isCancelled()) {
+            work(*context);
+        }
+    }));
+}
+
+void JobScheduler::finish(quint64 jobId)
+{
+    Job job = m_running.take(jobId);
+    if (job.keys.all) {
+        --m_allKeysRunning;
+    }
+    for (const QString &key : job.keys.exclusive) {
+        m_runningKeys.remove(key);
+    }
+    for (const QString &key : job.keys.shared) {
+        if (--m_sharedKeys[key] == 0) {
+            m_sharedKeys.remove(key);
+        }
+    }
+
+    complete(job);
+    dispatch();
+    if (isIdle()) {
+        emit idle();
+    }
+}
+
+void JobScheduler::complete(const Job &job)
+{
+    if (job.done) {
+        job.done(*job.context);
+    }
+    emit jobFinished(job.id, job.context->isCancelled());
+}
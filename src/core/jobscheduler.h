@@ -0,0 +1,122 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class JobScheduler;
+
+// Handed to a running job's work function. Safe to use from the worker thread.
+class JobContext {
+public:
+    JobContext(JobScheduler *scheduler, quint64 id);
+
+    quint64 id() const;
+    bool isCancelled() const;
+    // Running on a background thread in LowImpactIo background mode
+    bool isLowImpact() const;
+    void reportProgress(qint64 done, qint64 total);
+
+private:
+    friend class JobScheduler;
+
+    JobScheduler *m_scheduler;
+    quint64 m_id;
+    std::atomic<bool> m_cancelled{false};
+    bool m_lowImpact = false;
+};
+
+// Runs jobs on a bounded private thread pool. Pending jobs start in priority
+// order (manual > auto > bulk, then submission order); jobs that share a key,
+// such as a game id, never run at the same time. A job may also hold keys
+// shared, running alongside others that share them but never with one that
+// holds them outright, or every key at once. Priorities marked low impact
+// run on threads of their own in LowImpactIo background mode.
+//
+// All methods and the done callbacks run on the scheduler's thread.
+class JobScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Manual = 0,
+        Auto = 1,
+        Bulk = 2,
+    };
+
+    using Work = std::function<void(JobContext &)>;
+    using Done = std::function<void(const JobContext &)>;
+
+    // What a job holds while it runs
+    struct Keys {
+        QStringList exclusive;
+        QStringList shared;
+        // Every key at once, for jobs that cannot tell up front which they
+        // touch. Keyed jobs queued behind one wait until it has run.
+        bool all = false;
+    };
+
+    explicit JobScheduler(QObject *parent = nullptr);
+    ~JobScheduler();
+
+    void setMaxConcurrentJobs(int count);
+    int maxConcurrentJobs() const;
+    // Applies to jobs that start afterwards (none are low impact by default)
+    void setLowImpact(Priority priority, bool enabled);
+    bool isLowImpact(Priority priority) const;
+
+    // work runs on a pool thread, done afterwards on this thread. A job
+    // cancelled before it started skips work but still gets done.
+    quint64 submit(Priority priority, const QString &key, Work work, Done done = Done());
+    quint64 submit(Priority priority, const Keys &keys, Work work, Done done = Done());
+    bool cancel(quint64 jobId);
+    void cancelAll();
+
+    bool isIdle() const;
+    int pendingCount() const;
+    int runningCount() const;
+
+signals:
+    void jobStarted(quint64 jobId);
+    void jobProgress(quint64 jobId, qint64 done, qint64 total);
+    void jobFinished(quint64 jobId, bool cancelled);
+    void idle();
+
+private:
+    struct Job {
+        quint64 id = 0;
+        Priority priority = Manual;
+        Keys keys;
+        Work work;
+        Done done;
+        std::shared_ptr<JobContext> context;
+    };
+
+    static bool isKeyless(const Job &job);
+    bool canStart(const Job &job) const;
+    void dispatch();
+    void start(const Job &job);
+    void finish(quint64 jobId);
+    void complete(const Job &job);
+
+    QThreadPool m_pool;
+    // Threads in background mode cannot come back to full priority
+    QThreadPool m_lowImpactPool;
+    int m_lowImpactMask = 0;  // bit per Priority
+    QList<Job> m_pending;
+    QHash<quint64, Job> m_running;
+    QSet<QString> m_runningKeys;
+    QHash<QString, int> m_sharedKeys;  // key -> running jobs sharing it
+    int m_allKeysRunning = 0;
+    quint64 m_nextId = 1;
+};
+
+#endif // JOBSCHEDULER_H
@@ -0,0 +1,100 @@
+#include "lowimpactio.h"
+#include <QFile>
+#include <QThread>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+thread_local bool t_background = false;
+
+#ifdef Q_OS_LINUX
+// From linux/ioprio.h, which older kernel headers do not ship
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle = 3;
+constexpr int kIoprioClassShift = 13;
+#endif
+
+} // namespace
+
+bool LowImpactIo::enterBackgroundMode()
+{
+    if (t_background) {
+        return true;
+    }
+    bool applied = false;
+#ifdef Q_OS_LINUX
+    // Who 0 is the calling thread, not the whole process
+    if (::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift) == 0) {
+        applied = true;
+    } else {
+        qWarning() << "ioprio_set failed:" << strerror(errno);
+    }
+    struct sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) == 0) {
+        applied = true;
+    }
+    // Linux keeps nice per thread
+    if (::setpriority(PRIO_PROCESS, id_t(::syscall(SYS_gettid)), 19) == 0) {
+        applied = true;
+    }
+#else
+    if (QThread *thread = QThread::currentThread()) {
+        thread->setPriority(QThread::IdlePriority);
+        applied = true;
+    }
+#endif
+    t_background = applied;
+    return applied;
+}
+
+bool LowImpactIo::isBackground()
+{
+    return t_background;
+}
+
+void LowImpactIo::dropCache(int fd, bool written)
+{
+#ifdef Q_OS_LINUX
+    if (!t_background || fd < 0) {
+        return;
+    }
+    // Dirty pages stay cached until they are written back
+    if (written) {
+        ::fdatasync(fd);
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(written);
+#endif
+}
+
+void LowImpactIo::dropCache(const QString &path, bool written)
+{
+#ifdef Q_OS_LINUX
+    if (!t_background) {
+        return;
+    }
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    dropCache(fd, written);
+    ::close(fd);
+#else
+    Q_UNUSED(path);
+    Q_UNUSED(written);
+#endif
+}
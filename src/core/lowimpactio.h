@@ -0,0 +1,29 @@
+#ifndef LOWIMPACTIO_H
+#define LOWIMPACTIO_H
+
+#include <QString>
+
+// Keeps auto-backups out of the way of a running game. A full-speed backup
+// on the drive the game streams from shows up as frame-time spikes, and the
+// save files it reads push the game's own data out of the page cache.
+//
+// Background mode is per thread: the idle I/O class (the disk serves it only
+// when nothing else is waiting), SCHED_IDLE and the lowest nice value. The
+// compression threads a job starts afterwards inherit all three. Elsewhere
+// than Linux only the Qt thread priority is lowered.
+class LowImpactIo {
+public:
+    // Puts the calling thread in background mode. An unprivileged thread
+    // cannot raise its priority again, so only call this on threads that
+    // run nothing but background work. Returns false if nothing applied.
+    static bool enterBackgroundMode();
+    static bool isBackground();
+
+    // In background mode, drops a file's pages from the page cache once it
+    // has been read or written in full; written data is flushed first so
+    // the pages can go. No-op otherwise.
+    static void dropCache(int fd, bool written = false);
+    static void dropCache(const QString &path, bool written = false);
+};
+
+#endif // LOWIMPACTIO_H
@@ -0,0 +1,100 @@
+#include "memorybudget.h"
+
+namespace {
+
+// zstd's parameters for input of unknown size, as a stream is (its
+// clevels.h): window, chain table and hash table logs for levels 1 to 19
+struct ZstdParams {
+    int windowLog;
+    int chainLog;
+    int hashLog;
+};
+
+constexpr ZstdParams kZstdParams[] = {
+    {19, 13, 14}, {20, 15, 16}, {21, 16, 17}, {21, 18, 18}, {21, 18, 19},
+    {21, 18, 19}, {21, 19, 20}, {21, 19, 20}, {22, 20, 21}, {22, 21, 22},
+    {22, 21, 22}, {22, 22, 23}, {22, 22, 22}, {22, 22, 23}, {22, 23, 23},
+    {22, 22, 22}, {23, 23, 22}, {23, 23, 22}, {23, 24, 22},
+};
+constexpr int kMaxZstdLevel = 19;
+constexpr int kMaxLongWindowLog = 27;
+// zlib's deflate state at the default window and memLevel, with slack
+constexpr qint64 kDeflateStateBytes = 320 * 1024;
+
+const ZstdParams &zstdParams(int level)
+{
+    return kZstdParams[qBound(1, level, kMaxZstdLevel) - 1];
+}
+
+// One worker's match tables, plus its window and the input and output
+// buffers of the job it compresses, which are about as large again
+qint64 zstdWorkerBytes(int level, int windowLog)
+{
+    const ZstdParams &p = zstdParams(level);
+    if (windowLog <= 0) {
+        windowLog = p.windowLog;
+    }
+    return (qint64(4) << p.chainLog) + (qint64(4) << p.hashLog) + (qint64(3) << windowLog);
+}
+
+} // namespace
+
+MemoryBudget::MemoryBudget(qint64 bytes)
+    : m_bytes(qMax(bytes, MinimumBytes))
+{
+}
+
+qint64 MemoryBudget::bytes() const
+{
+    return m_bytes;
+}
+
+qint64 MemoryBudget::readAheadBytes() const
+{
+    return m_bytes / 4;
+}
+
+qint64 MemoryBudget::compressionBytes() const
+{
+    return m_bytes - readAheadBytes();
+}
+
+int MemoryBudget::readAheadFiles(qint64 fileSize) const
+{
+    return static_cast<int>(qBound<qint64>(1, readAheadBytes() / qMax<qint64>(1, fileSize), 1 << 16));
+}
+
+int MemoryBudget::gzipBlocksInFlight(qsizetype blockSize) const
+{
+    qint64 perBlock = 2 * qint64(blockSize) + kDeflateStateBytes;
+    return static_cast<int>(qBound<qint64>(2, compressionBytes() / perBlock, 1 << 16));
+}
+
+int MemoryBudget::zstdLevel(int level) const
+{
+    level = qBound(1, level, kMaxZstdLevel);
+    while (level > 1 && zstdWorkerBytes(level, 0) > compressionBytes()) {
+        level--;
+    }
+    return level;
+}
+
+int MemoryBudget::zstdThreads(int threads, int level, int windowLog) const
+{
+    qint64 fit = compressionBytes() / zstdWorkerBytes(level, windowLog);
+    return static_cast<int>(qBound<qint64>(1, fit, qMax(1, threads)));
+}
+
+int MemoryBudget::zstdLongWindowLog(int level) const
+{
+    int windowLog = kMaxLongWindowLog;
+    while (windowLog > zstdParams(level).windowLog && zstdWorkerBytes(level, windowLog) > compressionBytes()) {
+        windowLog--;
+    }
+    return windowLog > zstdParams(level).windowLog ? windowLog : 0;
+}
+
+qint64 MemoryBudget::deltaFileLimit() const
+{
+    return m_bytes / 8;
+}
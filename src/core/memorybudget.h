@@ -0,0 +1,50 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QtGlobal>
+
+// The memory one backup or restore job may hold in buffers, and how it is
+// split between the stages of the pipeline. Every stage works through
+// fixed-size buffers that it reuses, and a stage that runs ahead waits for
+// the next one instead of queueing more, so a save of any size, and a file
+// of any size in it, runs in the same amount of memory.
+//
+// A quarter is read-ahead (files prefetched by BatchFileReader). The rest
+// is compression: gzip blocks in flight, or zstd's workers with their
+// tables and window. Delta backups keep a file, its base and the delta
+// between them in memory for files up to an eighth of the budget; larger
+// ones are diffed against a block signature of the base as they are read.
+class MemoryBudget {
+public:
+    static constexpr qint64 DefaultBytes = 64 * 1024 * 1024;
+    // Below this the stages are down to a single buffer each
+    static constexpr qint64 MinimumBytes = 16 * 1024 * 1024;
+
+    // Clamped to MinimumBytes
+    explicit MemoryBudget(qint64 bytes = DefaultBytes);
+
+    qint64 bytes() const;
+    qint64 readAheadBytes() const;
+    qint64 compressionBytes() const;
+
+    // Files of up to fileSize the reader may hold read ahead, at least 1
+    int readAheadFiles(qint64 fileSize) const;
+    // gzip blocks being compressed or waiting to be written, each holding
+    // its input, its output and a deflate state; at least 2
+    int gzipBlocksInFlight(qsizetype blockSize) const;
+    // The requested level, or the highest below it whose compressor fits
+    int zstdLevel(int level) const;
+    // At most threads workers at level (and windowLog, 0 = the level's own),
+    // at least 1
+    int zstdThreads(int threads, int level, int windowLog = 0) const;
+    // Largest long-distance window log (at most 27) one worker at level can
+    // use, or 0 when it would not be larger than the level's own window
+    int zstdLongWindowLog(int level) const;
+    // Largest file a delta backup encodes in memory
+    qint64 deltaFileLimit() const;
+
+private:
+    qint64 m_bytes;
+};
+
+#endif // MEMORYBUDGET_H
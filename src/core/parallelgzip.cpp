@@ -0,0 +1,193 @@
+#include "parallelgzip.h"
+#include "compressibility.h"
+#include <QtConcurrent>
+#include <QThread>
+#include <QDebug>
+#include <zlib.h>
+#include <utility>
+
+ParallelGzipWriter::ParallelGzipWriter(int level, int threads, qsizetype blockSize, int maxInFlight)
+    : m_level(level)
+    , m_blockSize(blockSize)
+{
+    int workers = qMax(1, threads > 0 ? threads : QThread::idealThreadCount());
+    m_maxInFlight = maxInFlight > 0 ? maxInFlight : 2 * workers;
+    // A private pool: the caller usually runs on the global pool already, and
+    // waiting on tasks queued behind ourselves there could deadlock. Workers
+    // beyond the blocks in flight would have nothing to do.
+    m_pool.setMaxThreadCount(qMin(workers, m_maxInFlight));
+    m_block.reserve(m_blockSize);
+}
+
+ParallelGzipWriter::~ParallelGzipWriter()
+{
+    m_pool.waitForDone();
+}
+
+bool ParallelGzipWriter::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ParallelGzipWriter::write(const char *data, qsizetype size)
+{
+    if (!m_error.isEmpty()) {
+        return false;
+    }
+
+    m_bytesIn += size;
+    while (size > 0) {
+        qsizetype n = qMin(size, m_blockSize - m_block.size());
+        m_block.append(data, n);
+        data += n;
+        size -= n;
+
+        if (m_block.size() == m_blockSize) {
+            submitBlock();
+            if (!writeFinished(false)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ParallelGzipWriter::close()
+{
+    // An empty stream still needs one (empty) member to be valid gzip
+    if (!m_block.isEmpty() || !m_wroteAnyBlock) {
+        submitBlock();
+    }
+    bool ok = writeFinished(true);
+    m_file.close();
+    return ok && m_error.isEmpty();
+}
+
+void ParallelGzipWriter::submitBlock()
+{
+    Member member;
+    member.block = std::move(m_block);
+    if (!m_freeOutputs.isEmpty()) {
+        member.data = m_freeOutputs.takeLast();
+    }
+    int level = m_level;
+    m_inFlight.enqueue(QtConcurrent::run(&m_pool, [member = std::move(member), level]() mutable {
+        if (level > 0 && Compressibility::isIncompressible(member.block.constData(), member.block.size())) {
+            member.skippedBytes = member.block.size();
+            level = 0;
+        }
+        member.ok = compressMember(member.block, level, &member.data);
+        return member;
+    }));
+    m_block = m_freeBlocks.isEmpty() ? QByteArray() : m_freeBlocks.takeLast();
+    m_block.reserve(m_blockSize);
+    m_wroteAnyBlock = true;
+}
+
+bool ParallelGzipWriter::writeFinished(bool waitForAll)
+{
+    // Write completed members in submission order. Block on the oldest one
+    // only when the queue is full (backpressure) or when draining on close.
+    while (!m_inFlight.isEmpty()) {
+        QFuture<Member> &oldest = m_inFlight.head();
+        if (!oldest.isFinished() && !waitForAll && m_inFlight.size() < m_maxInFlight) {
+            break;
+        }
+
+        Member member = oldest.result();
+        m_inFlight.dequeue();
+
+        if (!m_error.isEmpty()) {
+            continue; // keep draining so no task outlives its data
+        }
+        if (!member.ok) {
+            m_error = "gzip compression failed";
+        } else if (m_file.write(member.data) != member.data.size()) {
+            m_error = m_file.errorString();
+        } else {
+            m_bytesOut += member.data.size();
+            m_skippedBytes += member.skippedBytes;
+            m_memberSizes.append(member.data.size());
+        }
+
+        // The future held the only other reference, so both are ours again
+        member.block.truncate(0);
+        member.data.truncate(0);
+        m_freeBlocks.append(std::move(member.block));
+        m_freeOutputs.append(std::move(member.data));
+    }
+    return m_error.isEmpty();
+}
+
+QByteArray ParallelGzipWriter::compressMember(const QByteArray &block, int level)
+{
+    QByteArray out;
+    return compressMember(block, level, &out) ? out : QByteArray();
+}
+
+bool ParallelGzipWriter::compressMember(const QByteArray &block, int level, QByteArray *out)
+{
+    z_stream zs = {};
+    // windowBits 15 + 16: emit a gzip header and trailer around the deflate data
+    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    // Within the capacity of a recycled buffer, this does not allocate
+    out->resize(static_cast<qsizetype>(deflateBound(&zs, static_cast<uLong>(block.size()))));
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(block.constData()));
+    zs.avail_in = static_cast<uInt>(block.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out->data());
+    zs.avail_out = static_cast<uInt>(out->size());
+
+    int rc = deflate(&zs, Z_FINISH);
+    qsizetype produced = out->size() - zs.avail_out;
+    deflateEnd(&zs);
+
+    if (rc != Z_STREAM_END) {
+        qWarning() << "deflate failed:" << rc;
+        return false;
+    }
+    out->truncate(produced);
+    return true;
+}
+
+QString ParallelGzipWriter::errorString() const
+{
+    return m_error;
+}
+
+qint64 ParallelGzipWriter::bytesIn() const
+{
+    return m_bytesIn;
+}
+
+qint64 ParallelGzipWriter::bytesOut() const
+{
+    return m_bytesOut;
+}
+
+qint64 ParallelGzipWriter::skippedBytes() const
+{
+    return m_skippedBytes;
+}
+
+qsizetype ParallelGzipWriter::blockSize() const
+{
+    return m_blockSize;
+}
+
+int ParallelGzipWriter::maxInFlight() const
+{
+    return m_maxInFlight;
+}
+
+QList<qint64> ParallelGzipWriter::memberSizes() const
+{
+    return m_memberSizes;
+}
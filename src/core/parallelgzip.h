@@ -0,0 +1,78 @@
+#ifndef PARALLELGZIP_H
+#define PARALLELGZIP_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+#include <QList>
+#include <QQueue>
+#include <QThreadPool>
+
+// pigz-style gzip writer: input is cut into fixed-size blocks, each block is
+// compressed on a worker thread into an independent gzip member, and members
+// are written to the file in order. Concatenated members are a valid gzip
+// stream (RFC 1952) that gzip, zcat and libarchive read transparently.
+//
+// Not thread-safe: write() and close() must be called from a single thread.
+// At most maxInFlight blocks (2 * threads by default) are in flight: when
+// the queue is full, write() waits for the oldest one, so the caller never
+// reads further ahead than that. Block and output buffers are recycled, so
+// memory use stays at maxInFlight of each however much is written.
+// Blocks that are already compressed data are stored (deflate level 0)
+// rather than compressed again.
+class ParallelGzipWriter {
+public:
+    static constexpr qsizetype DefaultBlockSize = 1024 * 1024;
+
+    ParallelGzipWriter(int level, int threads, qsizetype blockSize = DefaultBlockSize, int maxInFlight = 0);
+    ~ParallelGzipWriter();
+
+    bool open(const QString &path);
+    bool write(const char *data, qsizetype size);
+    bool close();
+
+    QString errorString() const;
+    qint64 bytesIn() const;
+    qint64 bytesOut() const;
+    // Input bytes in blocks that were stored without compression
+    qint64 skippedBytes() const;
+    qsizetype blockSize() const;
+    int maxInFlight() const;
+    // Compressed size of every member written so far, in file order; member
+    // i holds input bytes [i * blockSize, (i + 1) * blockSize)
+    QList<qint64> memberSizes() const;
+
+    static QByteArray compressMember(const QByteArray &block, int level);
+    // Into out, reusing its capacity; false on failure
+    static bool compressMember(const QByteArray &block, int level, QByteArray *out);
+
+private:
+    struct Member {
+        QByteArray block;  // handed back for reuse
+        QByteArray data;
+        qint64 skippedBytes = 0;
+        bool ok = false;
+    };
+
+    void submitBlock();
+    bool writeFinished(bool waitForAll);
+
+    int m_level;
+    int m_maxInFlight;
+    qsizetype m_blockSize;
+    QFile m_file;
+    QThreadPool m_pool;
+    QByteArray m_block;
+    QQueue<QFuture<Member>> m_inFlight;
+    QList<QByteArray> m_freeBlocks;
+    QList<QByteArray> m_freeOutputs;
+    QString m_error;
+    qint64 m_bytesIn = 0;
+    qint64 m_bytesOut = 0;
+    qint64 m_skippedBytes = 0;
+    QList<qint64> m_memberSizes;
+    bool m_wroteAnyBlock = false;
+};
+
+#endif // PARALLELGZIP_H
@@ -0,0 +1,118 @@
+#include "retentionpolicy.h"
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+
+QList<BackupInfo> RetentionPolicy::plan(const QList<BackupInfo> &backups, const QDateTime &now) const
+{
+    if (!enabled) {
+        return QList<BackupInfo>();
+    }
+
+    QList<BackupInfo> sorted = backups;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const BackupInfo &a, const BackupInfo &b) {
+        return a.timestamp > b.timestamp;
+    });
+
+    // Newest first, so the first backup seen in a period represents it
+    QHash<int, int> recent;
+    QHash<int, QSet<qint64>> hours;
+    QHash<int, QSet<qint64>> days;
+    QHash<int, QSet<qint64>> weeks;
+    QList<bool> keep(sorted.size(), false);
+    for (int i = 0; i < sorted.size(); ++i) {
+        const BackupInfo &backup = sorted.at(i);
+        if (isExempt(backup)) {
+            keep[i] = true;
+            continue;
+        }
+
+        int profile = backup.profileId;
+        bool kept = false;
+        if (recent[profile] < keepLast) {
+            ++recent[profile];
+            kept = true;
+        }
+
+        if (backup.timestamp.isValid()) {
+            qint64 age = backup.timestamp.secsTo(now);
+            qint64 hour = backup.timestamp.toSecsSinceEpoch() / 3600;
+            if (age < qint64(hourly) * 3600 && !hours[profile].contains(hour)) {
+                hours[profile].insert(hour);
+                kept = true;
+            }
+
+            QDate date = backup.timestamp.date();
+            qint64 ageDays = date.daysTo(now.date());
+            if (ageDays < daily && !days[profile].contains(date.toJulianDay())) {
+                days[profile].insert(date.toJulianDay());
+                kept = true;
+            }
+
+            int year = 0;
+            int week = date.weekNumber(&year);
+            qint64 weekKey = qint64(year) * 100 + week;
+            if (ageDays < qint64(weekly) * 7 && !weeks[profile].contains(weekKey)) {
+                weeks[profile].insert(weekKey);
+                kept = true;
+            }
+        }
+        keep[i] = kept;
+    }
+
+    if (maxTotalSize > 0) {
+        qint64 total = 0;
+        int newest = -1;
+        for (int i = 0; i < sorted.size(); ++i) {
+            if (keep[i]) {
+                total += sorted.at(i).size;
+                if (newest < 0 && !isExempt(sorted.at(i))) {
+                    newest = i;
+                }
+            }
+        }
+        for (int i = sorted.size() - 1; i > newest && total > maxTotalSize; --i) {
+            if (keep[i] && !isExempt(sorted.at(i))) {
+                keep[i] = false;
+                total -= sorted.at(i).size;
+            }
+        }
+    }
+
+    QList<BackupInfo> prune;
+    for (int i = sorted.size() - 1; i >= 0; --i) {
+        if (!keep[i]) {
+            prune.append(sorted.at(i));
+        }
+    }
+    return prune;
+}
+
+bool RetentionPolicy::isExempt(const BackupInfo &backup)
+{
+    return backup.pinned || !backup.notes.trimmed().isEmpty();
+}
+
+QJsonObject RetentionPolicy::toJson() const
+{
+    QJsonObject obj;
+    obj["enabled"] = enabled;
+    obj["keepLast"] = keepLast;
+    obj["hourly"] = hourly;
+    obj["daily"] = daily;
+    obj["weekly"] = weekly;
+    obj["maxTotalSize"] = maxTotalSize;
+    return obj;
+}
+
+RetentionPolicy RetentionPolicy::fromJson(const QJsonObject &obj)
+{
+    RetentionPolicy policy;
+    policy.enabled = obj["enabled"].toBool(policy.enabled);
+    policy.keepLast = qMax(1, obj["keepLast"].toInt(policy.keepLast));
+    policy.hourly = qMax(0, obj["hourly"].toInt(policy.hourly));
+    policy.daily = qMax(0, obj["daily"].toInt(policy.daily));
+    policy.weekly = qMax(0, obj["weekly"].toInt(policy.weekly));
+    policy.maxTotalSize = qMax<qint64>(0, obj["maxTotalSize"].toInteger(policy.maxTotalSize));
+    return policy;
+}
@@ -0,0 +1,36 @@
+#ifndef RETENTIONPOLICY_H
+#define RETENTIONPOLICY_H
+
+#include <QList>
+#include <QDateTime>
+#include <QJsonObject>
+#include "gameinfo.h"
+
+// Grandfather-father-son pruning rules for the backups of one game. A backup
+// is kept if any rule wants it: it is one of the newest keepLast, or the
+// newest in its hour, day or ISO week while that period is within the
+// last hourly hours, daily days or weekly weeks. Each profile's backups
+// are bucketed separately. The size cap then drops the oldest remaining
+// backups until the game fits, but always leaves the newest one.
+//
+// Pinned backups and backups with notes are never pruned, though they do
+// count towards the size cap.
+struct RetentionPolicy {
+    bool enabled = false;
+    int keepLast = 5;
+    int hourly = 24;
+    int daily = 7;
+    int weekly = 4;
+    qint64 maxTotalSize = 0;  // bytes, 0 = no cap
+
+    // Backups to delete, oldest first. Reads only catalog fields, never the
+    // archives themselves.
+    QList<BackupInfo> plan(const QList<BackupInfo> &backups, const QDateTime &now) const;
+
+    static bool isExempt(const BackupInfo &backup);
+
+    QJsonObject toJson() const;
+    static RetentionPolicy fromJson(const QJsonObject &obj);
+};
+
+#endif // RETENTIONPOLICY_H
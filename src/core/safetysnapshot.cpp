@@ -0,0 +1,146 @@
+#include "safetysnapshot.h"
+#include "filecopy.h"
+#include "transferprogress.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+
+QString recordPath(const QString &backupDir, const QString &gameId)
+{
+    return backupDir + "/undo/" + gameId + ".json";
+}
+
+SafetySnapshot fromJson(const QJsonObject &obj)
+{
+    SafetySnapshot snapshot;
+    if (obj["version"].toInt() != 1) {
+        return snapshot;
+    }
+    snapshot.gameId = obj["gameId"].toString();
+    snapshot.targetPath = obj["targetPath"].toString();
+    snapshot.path = obj["path"].toString();
+    snapshot.backupName = obj["backupName"].toString();
+    snapshot.created = QDateTime::fromString(obj["created"].toString(), Qt::ISODate);
+    return snapshot;
+}
+
+} // namespace
+
+bool SafetySnapshot::isValid() const
+{
+    return !gameId.isEmpty() && !path.isEmpty() && created.isValid() && QFileInfo(treePath()).isDir();
+}
+
+bool SafetySnapshot::isExpired(const QDateTime &now) const
+{
+    return created.secsTo(now) >= MaxAgeSecs;
+}
+
+QString SafetySnapshot::treePath() const
+{
+    return path + "/restore/" + QFileInfo(QDir::cleanPath(targetPath)).fileName();
+}
+
+bool SafetySnapshot::save(const QString &backupDir) const
+{
+    QJsonObject obj;
+    obj["version"] = 1;
+    obj["gameId"] = gameId;
+    obj["targetPath"] = targetPath;
+    obj["path"] = path;
+    obj["backupName"] = backupName;
+    obj["created"] = created.toString(Qt::ISODate);
+
+    QDir().mkpath(backupDir + "/undo");
+    QSaveFile file(recordPath(backupDir, gameId));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+SafetySnapshot SafetySnapshot::load(const QString &backupDir, const QString &gameId)
+{
+    QFile file(recordPath(backupDir, gameId));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return SafetySnapshot();
+    }
+    return fromJson(QJsonDocument::fromJson(file.readAll()).object());
+}
+
+bool SafetySnapshot::remove(const QString &backupDir, const QString &gameId)
+{
+    QString record = recordPath(backupDir, gameId);
+    return !QFile::exists(record) || QFile::remove(record);
+}
+
+QList<SafetySnapshot> SafetySnapshot::loadAll(const QString &backupDir)
+{
+    QList<SafetySnapshot> snapshots;
+    const QStringList records = QDir(backupDir + "/undo").entryList(QStringList() << "*.json", QDir::Files);
+    for (const QString &name : records) {
+        QFile file(backupDir + "/undo/" + name);
+        if (file.open(QIODevice::ReadOnly)) {
+            snapshots.append(fromJson(QJsonDocument::fromJson(file.readAll()).object()));
+        }
+    }
+    return snapshots;
+}
+
+QString SafetySnapshot::newPath(const QString &targetPath)
+{
+    QFileInfo target(QDir::cleanPath(targetPath));
+    return QString("%1/.%2.undo-%3").arg(target.absolutePath(), target.fileName())
+        .arg(QDateTime::currentMSecsSinceEpoch());
+}
+
+bool SafetySnapshot::cloneTree(const QString &sourceDir, const QString &destDir, bool hardLinks,
+                               TransferProgress &progress)
+{
+    if (!QDir().mkpath(destDir)) {
+        return false;
+    }
+
+    QDirIterator it(sourceDir, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QFileInfo info = it.fileInfo();
+        QString dest = destDir + "/" + QDir(sourceDir).relativeFilePath(path);
+        if (info.isDir() && !info.isSymLink()) {
+            QDir().mkpath(dest);
+            continue;
+        }
+        QDir().mkpath(QFileInfo(dest).absolutePath());
+#ifdef Q_OS_UNIX
+        if (hardLinks && !info.isSymLink()
+            && ::link(QFile::encodeName(path).constData(), QFile::encodeName(dest).constData()) == 0) {
+            progress.addFile();
+            continue;
+        }
+#else
+        Q_UNUSED(hardLinks);
+#endif
+        if (!FileCopy::copyFile(path, dest)) {
+            qWarning() << "Failed to snapshot" << path;
+            return false;
+        }
+        progress.addFile();
+        if (!progress.addBytes(info.isSymLink() ? 0 : info.size())) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef SAFETYSNAPSHOT_H
+#define SAFETYSNAPSHOT_H
+
+#include <QString>
+#include <QDateTime>
+#include <QList>
+
+class TransferProgress;
+
+// The save directory as it was just before a restore overwrote it, so the
+// restore can be undone. The tree is kept in a hidden sibling of the save
+// dir (.<dir>.undo-<time>/restore/<dir>), the same layout a restore stages
+// in, so it is on the save's filesystem. A full restore moves the replaced
+// tree there with a rename. Restores that replace files by renaming them
+// over the live ones hard-link the tree first: the files they replace keep
+// their old inode in the snapshot. Restores that overwrite files in place
+// copy it instead, which is a reflink clone where the filesystem has them.
+//
+// Only the latest snapshot per game is kept. Its record lives in
+// <backup dir>/undo/<game id>.json; both expire after MaxAgeSecs.
+struct SafetySnapshot {
+    static constexpr qint64 MaxAgeSecs = 24 * 3600;
+
+    QString gameId;
+    QString targetPath;   // save dir the snapshot came from
+    QString path;         // the .undo-<time> directory
+    QString backupName;   // the backup that was restored over it
+    QDateTime created;
+
+    bool isValid() const;
+    bool isExpired(const QDateTime &now) const;
+    // Where the tree itself is
+    QString treePath() const;
+
+    bool save(const QString &backupDir) const;
+    static SafetySnapshot load(const QString &backupDir, const QString &gameId);
+    static bool remove(const QString &backupDir, const QString &gameId);
+    static QList<SafetySnapshot> loadAll(const QString &backupDir);
+
+    // A fresh, not yet existing snapshot directory for targetPath
+    static QString newPath(const QString &targetPath);
+    // Copies sourceDir to destDir with FileCopy, or as hard links where
+    // possible, stopping when cancelled
+    static bool cloneTree(const QString &sourceDir, const QString &destDir, bool hardLinks,
+                          TransferProgress &progress);
+};
+
+#endif // SAFETYSNAPSHOT_H
@@ -2,14 +2,63 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
+#include <QDirIterator>
 #include <QDateTime>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QStandardPaths>
 #include <QDebug>
+#include <QEventLoop>
+#include <QCryptographicHash>
 #include <QtConcurrent>
+#include <QThread>
+#include <QThreadPool>
+#include "backuplisting.h"
+#include "chunkstore.h"
+#include "deltaarchive.h"
+#include "filecopy.h"
+#include "filemanifest.h"
+#include "hardlinksnapshot.h"
+#include "lowimpactio.h"
+#include "safetysnapshot.h"
+#include "parallelgzip.h"
+#include "transferprogress.h"
+#include "zstddictionary.h"
+#include <atomic>
 #include <archive.h>
 #include <archive_entry.h>
+#include <cerrno>
+#include <deque>
+#include <filesystem>
+
+#ifdef Q_OS_LINUX
+#include <cstring>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)
+#endif
+#endif
+
+namespace {
+
+// Held shared by backups that add chunks, exclusively by garbage collection
+const QString kChunkStoreKey = QStringLiteral("chunk-store");
+
+// Keyed by game: two jobs never write the same game's backups at once
+JobScheduler::Keys backupJobKeys(const QString &gameId, const QString &format)
+{
+    JobScheduler::Keys keys;
+    keys.exclusive.append(gameId);
+    if (format == "chunks") {
+        keys.shared.append(kChunkStoreKey);
+    }
+    return keys;
+}
+
+} // namespace
 
 SaveManager::SaveManager(QObject *parent)
     : QObject(parent)
@@ -18,16 +67,23 @@ SaveManager::SaveManager(QObject *parent)
                                + "/game-rewind";
     setBackupDirectory(defaultBackupDir);
 
-    connect(&m_backupWatcher, &QFutureWatcher<AsyncResult>::finished,
-            this, &SaveManager::onAsyncBackupFinished);
-    connect(&m_restoreWatcher, &QFutureWatcher<AsyncResult>::finished,
-            this, &SaveManager::onAsyncRestoreFinished);
+    connect(&m_scheduler, &JobScheduler::jobProgress, this, &SaveManager::jobProgress);
+    connect(&m_scheduler, &JobScheduler::idle, this, &SaveManager::onSchedulerIdle);
+    m_scheduler.setLowImpact(JobScheduler::Auto, true);
+
+    // Every change to a game's backups goes through one of these signals
+    auto invalidateCatalog = [this](const QString &gameId) { m_catalog.invalidate(gameId); };
+    connect(this, &SaveManager::backupCreated, this, invalidateCatalog);
+    connect(this, &SaveManager::backupDeleted, this, invalidateCatalog);
+    connect(this, &SaveManager::backupUpdated, this, invalidateCatalog);
 }
 
 void SaveManager::setBackupDirectory(const QString &dir)
 {
     m_backupDir = dir;
     QDir().mkpath(m_backupDir);
+    m_catalog.setGamesDir(m_backupDir + "/games");
+    expireSafetySnapshots();
 }
 
 QString SaveManager::getBackupDirectory() const
@@ -35,15 +91,91 @@ QString SaveManager::getBackupDirectory() const
     return m_backupDir;
 }
 
+void SaveManager::setMetadataDatabase(const QString &path)
+{
+    m_catalog.setDatabasePath(path);
+}
+
 void SaveManager::setCompressionLevel(int level)
 {
-    if (level >= 1 && level <= 9) {
+    if (level >= 1 && level <= maxCompressionLevel(m_backupFormat)) {
         m_compressionLevel = level;
     }
 }
 
+int SaveManager::compressionLevel() const
+{
+    return m_compressionLevel;
+}
+
+int SaveManager::maxCompressionLevel(const QString &format)
+{
+    // Levels above 19 are zstd's "ultra" levels with very large memory needs
+    return format == "tar.zst" ? 19 : 9;
+}
+
+void SaveManager::setBackupFormat(const QString &format)
+{
+    if (format == "tar.gz" || format == "tar.zst" || format == "chunks" || format == "delta"
+        || format == "hardlinks") {
+        m_backupFormat = format;
+        m_compressionLevel = qMin(m_compressionLevel, maxCompressionLevel(format));
+    }
+}
+
+QString SaveManager::backupFormat() const
+{
+    return m_backupFormat;
+}
+
+void SaveManager::setCompressionThreads(int threads)
+{
+    m_compressionThreads = qMax(0, threads);
+}
+
+void SaveManager::setLongDistanceMatching(bool enabled)
+{
+    m_longDistanceMatching = enabled;
+}
+
+void SaveManager::setSafetySnapshots(bool enabled)
+{
+    m_safetySnapshots = enabled;
+}
+
+void SaveManager::setBatchedReads(bool enabled)
+{
+    m_batchedReads = enabled;
+}
+
+void SaveManager::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = MemoryBudget(bytes).bytes();
+}
+
+qint64 SaveManager::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+void SaveManager::setLowImpactAutoBackups(bool enabled)
+{
+    m_scheduler.setLowImpact(JobScheduler::Auto, enabled);
+}
+
+void SaveManager::setBackgroundBandwidthLimit(qint64 bytesPerSecond)
+{
+    m_backgroundBandwidthLimit = qMax<qint64>(0, bytesPerSecond);
+}
+
+void SaveManager::setDeltaKeyframeInterval(int interval)
+{
+    m_deltaKeyframeInterval = qMax(1, interval);
+}
+
 bool SaveManager::createBackup(const GameInfo &game, const QString &backupName,
-                               const QString &notes, const SaveProfile &profile)
+                               const QString &notes, const SaveProfile &profile,
+                               bool skipIfUnchanged)
 {
     if (!game.isDetected || game.detectedSavePath.isEmpty()) {
         emit error("Game save path not detected");
@@ -55,114 +187,188 @@ bool SaveManager::createBackup(const GameInfo &game, const QString &backupName,
         return false;
     }
 
-    QString gameBackupDir = getGameBackupDir(game.id);
-    QDir().mkpath(gameBackupDir);
-
-    BackupInfo backup;
-    backup.id = generateBackupId();
-    backup.gameId = game.id;
-    backup.gameName = game.name;
-    backup.notes = notes;
-    backup.timestamp = QDateTime::currentDateTime();
-    backup.profileId = profile.id;
-    backup.profileName = profile.name;
-
-    if (backupName.isEmpty()) {
-        backup.displayName = backup.timestamp.toString("yyyy-MM-dd HH:mm:ss");
-    } else {
-        backup.displayName = backupName;
+    BackupInfo backup = newBackupInfo(game, backupName, notes, profile);
+    CompressionOptions options = compressionOptions();
+    QString chunkStoreDir = getChunkStoreDir();
+    BackupInfo previous = findPreviousBackup(game.id, profile.id);
+
+    // Run as a job, under the same keys as createBackupAsync, so chunk
+    // collection cannot remove chunks this backup has just stored
+    AsyncResult result;
+    bool cancelled = false;
+    bool finished = false;
+    QEventLoop loop;
+    m_scheduler.submit(JobScheduler::Manual, backupJobKeys(game.id, options.format),
+        [&](JobContext &job) {
+            TransferProgress progress = jobTransferProgress(job, true);
+            result = runBackup(backup, game.detectedSavePath, profile.files, options,
+                               chunkStoreDir, previous, skipIfUnchanged, progress);
+        },
+        [&](const JobContext &job) {
+            cancelled = job.isCancelled();
+            finished = true;
+            loop.quit();
+        });
+    if (!finished) {
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
     }
 
-    QString archiveName = backup.id + ".tar.gz";
-    backup.archivePath = gameBackupDir + "/" + archiveName;
-
-    bool compressed;
-    if (profile.id == -1) {
-        compressed = compressDirectory(game.detectedSavePath, backup.archivePath, m_compressionLevel);
-    } else {
-        compressed = compressFiles(game.detectedSavePath, profile.files, backup.archivePath, m_compressionLevel);
+    if (cancelled) {
+        removeBackupFiles(backup);
+        m_jobsCancelled = true;
+        return false;
     }
-
-    if (!compressed) {
-        emit error("Failed to create backup archive");
+    if (result.skipped) {
+        emit backupSkipped(game.id, "unchanged, skipped");
+        return true;
+    }
+    if (!result.success) {
+        removeBackupFiles(backup);
+        emit error(result.errorMessage);
         return false;
     }
+    backup.size = result.storedSize;
+    backup.compressionSkipped = result.compressionSkipped;
 
-    backup.size = QFile(backup.archivePath).size();
-
-    if (!saveBackupMetadata(backup)) {
+    if (!saveBackupMetadata(backup, &result.checksums)) {
         emit error("Failed to save backup metadata");
-        QFile::remove(backup.archivePath);
+        removeBackupFiles(backup);
         return false;
     }
 
     emit backupCreated(game.id, backup.id);
+    if (!result.unreadFiles.isEmpty()) {
+        emit backupIncomplete(game.id, backup.id, result.unreadFiles);
+    }
     return true;
 }
 
-bool SaveManager::restoreBackup(const BackupInfo &backup, const QString &targetPath)
+bool SaveManager::restoreBackup(const BackupInfo &backup, const QString &targetPath, RestoreMode mode,
+                                RestoreReport *report)
 {
     if (!QFile::exists(backup.archivePath)) {
         emit error("Backup archive not found: " + backup.archivePath);
         return false;
     }
 
+    if (mode == RestoreReplace && backup.profileId == -1 && !canSwapInto(targetPath)) {
+        mode = RestoreDifferential;
+    }
+
+    // Restores that write into the live save clone it first
+    bool inPlace = mode == RestoreDifferential || backup.profileId != -1;
+    QString snapshotDir;
+    if (inPlace && m_safetySnapshots) {
+        TransferProgress snapshotProgress;
+        if (!takeSafetySnapshot(targetPath, mode == RestoreDifferential, &snapshotDir, snapshotProgress)) {
+            emit error("Failed to take a safety snapshot of the current save files");
+            return false;
+        }
+    }
+
+    if (mode == RestoreDifferential) {
+        RestoreReport result;
+        QString message;
+        TransferProgress progress;
+        bool ok = runDifferentialRestore(backup, targetPath, getChunkStoreDir(), progress, &result, &message);
+        keepSafetySnapshot(backup, targetPath, snapshotDir);
+        if (!ok) {
+            emit error(message);
+            return false;
+        }
+        if (report) {
+            *report = result;
+        }
+        emit restoreReported(backup.gameId, backup.id, result.written, result.removed, result.unchanged);
+        emit backupRestored(backup.gameId, backup.id);
+        return true;
+    }
+
     // Profile backups: extract directly, overwriting only specific files
     if (backup.profileId != -1) {
-        return restoreProfileBackup(backup, targetPath);
+        bool ok = restoreProfileBackup(backup, targetPath);
+        keepSafetySnapshot(backup, targetPath, snapshotDir);
+        return ok;
     }
 
-    // Full directory backup: extract to temp, replace entire directory
-    QString tempDir = m_backupDir + "/temp_restore_" + QString::number(QDateTime::currentMSecsSinceEpoch());
-
-    if (!extractArchive(backup.archivePath, tempDir)) {
+    // Full directory backup: extract next to the target, then swap it in
+    QString stagingDir = restoreStagingDir(targetPath);
+    TransferProgress progress;
+    if (!extractBackupData(backup, stagingDir + "/restore", getChunkStoreDir(), progress)) {
         emit error("Failed to extract backup archive");
-        removeDirectory(tempDir);
+        removeInBackground(stagingDir);
         return false;
     }
 
-    if (QFile::exists(targetPath)) {
-        if (!removeDirectory(targetPath)) {
-            emit error("Failed to remove existing save directory");
-            removeDirectory(tempDir);
-            return false;
-        }
+    QString previousTree;
+    if (!swapIntoPlace(stagingDir, targetPath, &previousTree)) {
+        emit error("Failed to restore backup to target location");
+        removeInBackground(stagingDir);
+        return false;
     }
 
-    QDir tempDirObj(tempDir);
-    QStringList entries = tempDirObj.entryList(QDir::NoDotAndDotDot | QDir::AllEntries);
+    // The staging dir now holds the previous save tree
+    adoptReplacedTree(backup, targetPath, previousTree);
+    removeInBackground(stagingDir);
 
-    QString sourceDir = tempDir;
-    if (entries.size() == 1) {
-        QFileInfo entryInfo(tempDir + "/" + entries.first());
-        if (entryInfo.isDir()) {
-            sourceDir = entryInfo.absoluteFilePath();
-        }
+    emit backupRestored(backup.gameId, backup.id);
+    return true;
+}
+
+bool SaveManager::restoreBackupPaths(const BackupInfo &backup, const QStringList &paths,
+                                     const QString &targetPath)
+{
+    if (!QFile::exists(backup.archivePath)) {
+        emit error("Backup archive not found: " + backup.archivePath);
+        return false;
     }
 
-    if (!copyDirectory(sourceDir, targetPath)) {
-        emit error("Failed to restore backup to target location");
-        removeDirectory(tempDir);
+    // Extract next to the target, then rename each file over its live copy,
+    // so no file is ever half-written
+    QString stagingDir = restoreStagingDir(targetPath);
+    QString extractDir = stagingDir + "/restore";
+    TransferProgress progress;
+    if (!extractBackupPaths(backup, paths, extractDir, getChunkStoreDir(), progress)) {
+        emit error("Failed to extract files from backup");
+        removeInBackground(stagingDir);
+        return false;
+    }
+
+    QString snapshotDir;
+    if (m_safetySnapshots && !takeSafetySnapshot(targetPath, true, &snapshotDir, progress)) {
+        emit error("Failed to take a safety snapshot of the current save files");
+        removeInBackground(stagingDir);
         return false;
     }
 
-    removeDirectory(tempDir);
+    bool ok = moveIntoPlace(extractDir, backup.profileId == -1, targetPath);
+    removeInBackground(stagingDir);
+    keepSafetySnapshot(backup, targetPath, snapshotDir);
 
+    if (!ok) {
+        emit error("Failed to restore some files to the target location");
+        return false;
+    }
     emit backupRestored(backup.gameId, backup.id);
     return true;
 }
 
 bool SaveManager::deleteBackup(const BackupInfo &backup)
 {
-    bool success = true;
+    // Later deltas must stop referring to this backup before it goes away
+    if (backup.format == "delta" && !rebaseDeltaDependents(backup)) {
+        emit error("Failed to re-base backups that depend on this one");
+        return false;
+    }
+
+    bool success = removeArchiveFiles(backup.archivePath);
 
-    if (QFile::exists(backup.archivePath)) {
-        success = QFile::remove(backup.archivePath);
+    if (success) {
+        m_catalog.remove(backup);
     }
 
-    QString metadataPath = backup.archivePath + ".json";
-    if (QFile::exists(metadataPath)) {
-        success = success && QFile::remove(metadataPath);
+    if (success && backup.format == "chunks") {
+        collectChunkGarbage();
     }
 
     if (success) {
@@ -192,30 +398,7 @@ bool SaveManager::updateBackupMetadata(const BackupInfo &backup)
 
 QList<BackupInfo> SaveManager::getBackupsForGame(const QString &gameId) const
 {
-    QList<BackupInfo> backups;
-    QString gameBackupDir = getGameBackupDir(gameId);
-
-    QDir dir(gameBackupDir);
-    if (!dir.exists()) {
-        return backups;
-    }
-
-    QStringList metadataFiles = dir.entryList(QStringList() << "*.json", QDir::Files);
-
-    for (const QString &metadataFile : metadataFiles) {
-        QString metadataPath = dir.absoluteFilePath(metadataFile);
-        BackupInfo backup = loadBackupMetadata(metadataPath);
-
-        if (!backup.id.isEmpty()) {
-            backups.append(backup);
-        }
-    }
-
-    std::sort(backups.begin(), backups.end(), [](const BackupInfo &a, const BackupInfo &b) {
-        return a.timestamp > b.timestamp;
-    });
-
-    return backups;
+    return m_catalog.backups(gameId);
 }
 
 BackupInfo SaveManager::getBackupById(const QString &gameId, const QString &backupId) const
@@ -231,324 +414,1703 @@ BackupInfo SaveManager::getBackupById(const QString &gameId, const QString &back
     return BackupInfo();
 }
 
-bool SaveManager::verifyBackup(const BackupInfo &backup)
+bool SaveManager::verifyBackup(const BackupInfo &backup, VerifyMode mode)
 {
-    if (!QFile::exists(backup.archivePath)) {
-        emit backupVerified(backup.gameId, backup.id, false);
-        return false;
-    }
-
-    struct archive *a = archive_read_new();
-    archive_read_support_filter_gzip(a);
-    archive_read_support_format_tar(a);
-
-    bool valid = false;
-    if (archive_read_open_filename(a, backup.archivePath.toLocal8Bit().constData(), 10240) == ARCHIVE_OK) {
-        struct archive_entry *entry;
-        valid = true;
-        while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
-            archive_read_data_skip(a);
-        }
-        if (archive_errno(a) != 0) {
-            valid = false;
-        }
-    }
-
-    archive_read_free(a);
+    TransferProgress progress;
+    bool valid = checkBackupData(backup, mode, getChunkStoreDir(), progress);
     emit backupVerified(backup.gameId, backup.id, valid);
     return valid;
 }
 
-bool SaveManager::isBusy() const
+quint64 SaveManager::verifyBackupAsync(const BackupInfo &backup, VerifyMode mode,
+                                      JobScheduler::Priority priority)
 {
-    return m_busy;
+    QString chunkStoreDir = getChunkStoreDir();
+    auto valid = std::make_shared<bool>(false);
+
+    emit operationStarted(QString("Verifying %1...").arg(backup.displayName));
+
+    // Deletes, prunes and re-bases write under the game's key, and chunk
+    // collection under the store's: a verify holds them shared so nothing
+    // is rewritten or removed while it reads, yet verifies run together
+    JobScheduler::Keys keys;
+    keys.shared.append(backup.gameId);
+    if (backup.format == "chunks") {
+        keys.shared.append(kChunkStoreKey);
+    }
+    return m_scheduler.submit(priority, keys,
+        [this, valid, backup, mode, chunkStoreDir](JobContext &job) {
+            TransferProgress progress = jobTransferProgress(job, true);
+            *valid = checkBackupData(backup, mode, chunkStoreDir, progress);
+        },
+        [this, valid, backup](const JobContext &job) {
+            if (job.isCancelled()) {
+                m_jobsCancelled = true;
+            } else {
+                emit backupVerified(backup.gameId, backup.id, *valid);
+            }
+            emit jobFinished(job.id());
+        });
 }
 
-void SaveManager::createBackupAsync(const GameInfo &game, const QString &backupName,
-                                     const QString &notes, const SaveProfile &profile)
+QList<quint64> SaveManager::verifyAllBackupsAsync(VerifyMode mode)
 {
-    if (isBusy()) {
-        emit error("Another operation is in progress");
-        return;
-    }
-
-    if (!game.isDetected || game.detectedSavePath.isEmpty()) {
-        emit error("Game save path not detected");
-        return;
-    }
-    if (!QFile::exists(game.detectedSavePath)) {
-        emit error("Save path does not exist: " + game.detectedSavePath);
-        return;
+    QList<quint64> jobIds;
+    const QStringList gameIds = getAllGameIdsWithBackups();
+    for (const QString &gameId : gameIds) {
+        const QList<BackupInfo> backups = getBackupsForGame(gameId);
+        for (const BackupInfo &backup : backups) {
+            quint64 jobId = verifyBackupAsync(backup, mode, JobScheduler::Bulk);
+            if (jobId != 0) {
+                jobIds.append(jobId);
+            }
+        }
     }
+    return jobIds;
+}
 
-    QString gameBackupDir = getGameBackupDir(game.id);
-    QDir().mkpath(gameBackupDir);
-
-    m_pendingBackup = BackupInfo();
-    m_pendingBackup.id = generateBackupId();
-    m_pendingBackup.gameId = game.id;
-    m_pendingBackup.gameName = game.name;
-    m_pendingBackup.notes = notes;
-    m_pendingBackup.timestamp = QDateTime::currentDateTime();
-    m_pendingBackup.profileId = profile.id;
-    m_pendingBackup.profileName = profile.name;
-    m_pendingBackup.displayName = backupName.isEmpty()
-        ? m_pendingBackup.timestamp.toString("yyyy-MM-dd HH:mm:ss")
-        : backupName;
-
-    QString archiveName = m_pendingBackup.id + ".tar.gz";
-    m_pendingBackup.archivePath = gameBackupDir + "/" + archiveName;
+quint64 SaveManager::deleteBackupAsync(const BackupInfo &backup)
+{
+    CompressionOptions options = compressionOptions();
+    QString gameDir = getGameBackupDir(backup.gameId);
+    auto result = std::make_shared<AsyncResult>();
+
+    emit operationStarted(QString("Deleting %1...").arg(backup.displayName));
+
+    // Keyed by game like a prune: no backup of the game is written while
+    // its chain changes. The game is listed when the job starts, since a
+    // backup queued before it may be a delta on this one.
+    return m_scheduler.submit(JobScheduler::Manual, backup.gameId,
+        [result, backup, gameDir, options](JobContext &job) {
+            removeBackups(QList<BackupInfo>() << backup, BackupCatalog::readSidecars(gameDir),
+                          options, job, result.get());
+        },
+        [this, result](const JobContext &job) {
+            finishRemovedBackups(*result);
+            if (job.isCancelled()) {
+                m_jobsCancelled = true;
+            } else if (!result->success) {
+                emit error(result->errorMessage);
+            }
+            emit jobFinished(job.id());
+        });
+}
 
-    m_busy = true;
-    m_cancelRequested = false;
-    emit operationStarted("Creating backup...");
+quint64 SaveManager::pruneBackupsAsync(const QString &gameId, const RetentionPolicy &policy)
+{
+    // Planned from the catalog up front only to skip the job when there is
+    // nothing to prune
+    const QList<BackupInfo> planned = policy.plan(getBackupsForGame(gameId), QDateTime::currentDateTime());
+    if (planned.isEmpty()) {
+        return 0;
+    }
 
-    QString savePath = game.detectedSavePath;
-    QString archivePath = m_pendingBackup.archivePath;
-    int compressionLevel = m_compressionLevel;
-    QStringList profileFiles = profile.files;
-    int profileId = profile.id;
+    CompressionOptions options = compressionOptions();
+    QString gameDir = getGameBackupDir(gameId);
+    auto result = std::make_shared<AsyncResult>();
+
+    emit operationStarted(QString("Pruning %1 old backup(s)...").arg(planned.size()));
+
+    // Keyed by game, so no backup of it is written while its chain changes.
+    // Backups queued ahead of this Bulk job may have added deltas on the
+    // ones it deletes, so the game is listed and planned again when it starts.
+    return m_scheduler.submit(JobScheduler::Bulk, gameId,
+        [result, gameDir, policy, options](JobContext &job) {
+            const QList<BackupInfo> backups = BackupCatalog::readSidecars(gameDir);
+            const QList<BackupInfo> doomed = policy.plan(backups, QDateTime::currentDateTime());
+            removeBackups(doomed, backups, options, job, result.get());
+        },
+        [this, result, gameId](const JobContext &job) {
+            finishPruneJob(gameId, *result, job);
+        });
+}
 
-    m_backupWatcher.setFuture(QtConcurrent::run([savePath, archivePath, compressionLevel,
-                                                  profileFiles, profileId]() -> AsyncResult {
-        AsyncResult result;
-        if (profileId == -1) {
-            result.success = compressDirectory(savePath, archivePath, compressionLevel);
-        } else {
-            result.success = compressFiles(savePath, profileFiles, archivePath, compressionLevel);
+void SaveManager::removeBackups(const QList<BackupInfo> &doomed, QList<BackupInfo> remaining,
+                                const CompressionOptions &options, JobContext &job, AsyncResult *result)
+{
+    result->success = true;
+    for (int i = 0; i < doomed.size() && !job.isCancelled(); ++i) {
+        const BackupInfo &backup = doomed.at(i);
+        if (backup.format == "delta") {
+            QList<BackupInfo> rebased;
+            if (!rebaseDeltaChain(backup, remaining, options, &rebased)) {
+                result->success = false;
+                result->errorMessage = "Failed to re-base backups that depend on " + backup.displayName;
+                break;
+            }
+            for (const BackupInfo &dependent : rebased) {
+                for (BackupInfo &other : remaining) {
+                    if (other.id == dependent.id) {
+                        other = dependent;
+                    }
+                }
+                result->rebased.append(dependent);
+            }
         }
-        if (!result.success) {
-            result.errorMessage = "Failed to create backup archive";
+        if (!removeArchiveFiles(backup.archivePath)) {
+            result->success = false;
+            result->errorMessage = "Failed to delete backup " + backup.displayName;
+            break;
         }
-        return result;
-    }));
+        remaining.removeIf([&backup](const BackupInfo &other) { return other.id == backup.id; });
+        result->pruned.append(backup);
+        job.reportProgress(i + 1, doomed.size());
+    }
 }
 
-void SaveManager::onAsyncBackupFinished()
+qint64 SaveManager::finishRemovedBackups(const AsyncResult &result)
 {
-    AsyncResult result = m_backupWatcher.result();
-    m_busy = false;
-
-    if (m_cancelRequested) {
-        QFile::remove(m_pendingBackup.archivePath);
-        emit operationCancelled();
-        return;
+    // Whatever was deleted before a cancel or failure is gone either way
+    QSet<QString> prunedIds;
+    qint64 freed = 0;
+    bool hadChunks = false;
+    for (const BackupInfo &backup : result.pruned) {
+        m_catalog.remove(backup);
+        prunedIds.insert(backup.id);
+        freed += backup.size;
+        hadChunks = hadChunks || backup.format == "chunks";
+        emit backupDeleted(backup.gameId, backup.id);
     }
 
-    if (!result.success) {
-        QFile::remove(m_pendingBackup.archivePath);
-        emit error(result.errorMessage);
-    } else {
-        m_pendingBackup.size = QFileInfo(m_pendingBackup.archivePath).size();
-        if (saveBackupMetadata(m_pendingBackup)) {
-            emit backupCreated(m_pendingBackup.gameId, m_pendingBackup.id);
-        } else {
-            QFile::remove(m_pendingBackup.archivePath);
-            emit error("Failed to save backup metadata");
+    // A delta may have been re-based more than once; the last one is current
+    QHash<QString, BackupInfo> rebased;
+    for (const BackupInfo &dependent : result.rebased) {
+        rebased.insert(dependent.id, dependent);
+    }
+    for (const BackupInfo &dependent : std::as_const(rebased)) {
+        if (!prunedIds.contains(dependent.id) && saveBackupMetadata(dependent)) {
+            emit backupUpdated(dependent.gameId, dependent.id);
         }
     }
-    emit operationFinished();
+
+    if (hadChunks) {
+        collectChunkGarbage();
+    }
+    return freed;
 }
 
-void SaveManager::restoreBackupAsync(const BackupInfo &backup, const QString &targetPath)
+void SaveManager::finishPruneJob(const QString &gameId, const AsyncResult &result, const JobContext &job)
 {
-    if (isBusy()) {
-        emit error("Another operation is in progress");
-        return;
-    }
+    qint64 freed = finishRemovedBackups(result);
 
-    if (!QFile::exists(backup.archivePath)) {
-        emit error("Backup archive not found: " + backup.archivePath);
-        return;
+    if (job.isCancelled()) {
+        m_jobsCancelled = true;
+    } else if (!result.success) {
+        emit error(result.errorMessage);
+    }
+    if (!result.pruned.isEmpty()) {
+        emit backupsPruned(gameId, result.pruned.size(), freed);
     }
+    emit jobFinished(job.id());
+}
 
-    m_pendingBackup = backup;
-    m_pendingRestoreTarget = targetPath;
-    m_pendingIsProfile = (backup.profileId != -1);
+quint64 SaveManager::trainDictionaryAsync(const QString &gameId)
+{
+    const QList<BackupInfo> backups = getBackupsForGame(gameId);
+    if (backups.isEmpty()) {
+        emit error("There are no backups to train a dictionary from");
+        return 0;
+    }
 
-    m_busy = true;
-    m_cancelRequested = false;
-    emit operationStarted("Restoring backup...");
+    QString chunkStoreDir = getChunkStoreDir();
+    QString path = dictionaryPath(getGameBackupDir(gameId));
+    auto result = std::make_shared<AsyncResult>();
 
-    if (m_pendingIsProfile) {
-        QDir().mkpath(targetPath);
-        QString archivePath = backup.archivePath;
+    emit operationStarted("Training compression dictionary...");
 
-        m_restoreWatcher.setFuture(QtConcurrent::run([archivePath, targetPath]() -> AsyncResult {
-            AsyncResult result;
-            result.success = extractArchive(archivePath, targetPath);
-            if (!result.success) {
-                result.errorMessage = "Failed to extract backup archive";
+    return m_scheduler.submit(JobScheduler::Bulk, gameId,
+        [result, backups, chunkStoreDir, path](JobContext &job) {
+            const QList<QByteArray> samples = collectDictionarySamples(backups, chunkStoreDir, job);
+            if (job.isCancelled()) {
+                return;
             }
-            return result;
-        }));
-    } else {
-        m_pendingTempDir = m_backupDir + "/temp_restore_" + QString::number(QDateTime::currentMSecsSinceEpoch());
-        QDir().mkpath(m_pendingTempDir);
-        QString archivePath = backup.archivePath;
-        QString tempDir = m_pendingTempDir;
-
-        m_restoreWatcher.setFuture(QtConcurrent::run([archivePath, tempDir]() -> AsyncResult {
-            AsyncResult result;
-            result.success = extractArchive(archivePath, tempDir);
-            if (!result.success) {
-                result.errorMessage = "Failed to extract backup archive";
+            ZstdDictionary dictionary = ZstdDictionary::train(samples, ZstdDictionary::DefaultCapacity,
+                                                              &result->errorMessage);
+            if (dictionary.isNull()) {
+                return;
             }
-            return result;
-        }));
-    }
+            result->success = dictionary.save(path);
+            if (!result->success) {
+                result->errorMessage = "Failed to save compression dictionary";
+            }
+            result->storedSize = dictionary.data().size();
+            result->samples = samples.size();
+        },
+        [this, result, gameId](const JobContext &job) {
+            if (job.isCancelled()) {
+                m_jobsCancelled = true;
+            } else if (result->success) {
+                emit dictionaryTrained(gameId, result->storedSize, result->samples);
+            } else {
+                emit error(result->errorMessage);
+            }
+            emit jobFinished(job.id());
+        });
 }
 
-void SaveManager::onAsyncRestoreFinished()
+bool SaveManager::hasDictionary(const QString &gameId) const
 {
-    AsyncResult result = m_restoreWatcher.result();
-    m_busy = false;
-
-    if (m_cancelRequested) {
-        if (!m_pendingTempDir.isEmpty()) {
-            removeDirectory(m_pendingTempDir);
-            m_pendingTempDir.clear();
-        }
-        emit operationCancelled();
-        return;
-    }
-
-    if (!result.success) {
-        if (!m_pendingTempDir.isEmpty()) {
-            removeDirectory(m_pendingTempDir);
-            m_pendingTempDir.clear();
-        }
-        emit error(result.errorMessage);
-    } else if (m_pendingIsProfile) {
-        emit backupRestored(m_pendingBackup.gameId, m_pendingBackup.id);
-    } else {
-        // Full restore: move from temp dir to target
-        QString targetPath = m_pendingRestoreTarget;
-        if (QFile::exists(targetPath)) {
-            removeDirectory(targetPath);
-        }
+    return QFile::exists(dictionaryPath(getGameBackupDir(gameId)));
+}
 
-        QDir tempDirObj(m_pendingTempDir);
-        QStringList entries = tempDirObj.entryList(QDir::NoDotAndDotDot | QDir::AllEntries);
-        QString sourceDir = m_pendingTempDir;
-        if (entries.size() == 1) {
-            QFileInfo entryInfo(m_pendingTempDir + "/" + entries.first());
-            if (entryInfo.isDir()) {
-                sourceDir = entryInfo.absoluteFilePath();
-            }
-        }
+bool SaveManager::removeDictionary(const QString &gameId)
+{
+    QString path = dictionaryPath(getGameBackupDir(gameId));
+    return !QFile::exists(path) || QFile::remove(path);
+}
 
-        if (copyDirectory(sourceDir, targetPath)) {
-            emit backupRestored(m_pendingBackup.gameId, m_pendingBackup.id);
-        } else {
-            emit error("Failed to restore backup to target location");
+QList<BackupInfo> SaveManager::bundleBackups(const QStringList &gameIds) const
+{
+    QList<BackupInfo> result;
+    const QStringList ids = gameIds.isEmpty() ? getAllGameIdsWithBackups() : gameIds;
+    for (const QString &gameId : ids) {
+        const QList<BackupInfo> backups = getBackupsForGame(gameId);
+        for (auto it = backups.crbegin(); it != backups.crend(); ++it) {
+            result.append(*it);
         }
-        removeDirectory(m_pendingTempDir);
-        m_pendingTempDir.clear();
     }
-    emit operationFinished();
+    return result;
 }
 
-void SaveManager::cancelOperation()
+bool SaveManager::exportBackups(const QStringList &gameIds, QIODevice *out, BackupBundle::Stats *stats)
 {
-    m_cancelRequested = true;
-    // The running QtConcurrent task will complete, but we'll discard the result
+    BackupBundle bundle(m_backupDir);
+    return bundle.write(out, bundleBackups(gameIds), stats);
 }
 
-QStringList SaveManager::getAllGameIdsWithBackups() const
+bool SaveManager::importBackups(QIODevice *in, BackupBundle::Stats *stats)
 {
-    QStringList gameIds;
-    QDir gamesDir(m_backupDir + "/games");
-    if (!gamesDir.exists()) return gameIds;
-
-    QStringList subdirs = gamesDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    for (const QString &subdir : subdirs) {
-        QDir gameDir(gamesDir.absoluteFilePath(subdir));
-        QStringList archives = gameDir.entryList(QStringList() << "*.tar.gz", QDir::Files);
-        if (!archives.isEmpty()) {
-            gameIds.append(subdir);
-        }
+    BackupBundle bundle(m_backupDir);
+    BackupBundle::Stats bundleStats;
+    QList<BackupInfo> imported;
+    bool ok = bundle.read(in, &imported, &bundleStats);
+    // Backups committed before a failure are complete and stay
+    finishImport(imported);
+    if (ok || !imported.isEmpty()) {
+        emit backupsImported(bundleStats.backups, bundleStats.skippedBackups);
     }
-    return gameIds;
+    if (stats) {
+        *stats = bundleStats;
+    }
+    return ok;
 }
 
-QString SaveManager::getGameNameFromBackups(const QString &gameId) const
+quint64 SaveManager::exportBackupsAsync(const QStringList &gameIds, const QString &filePath)
 {
-    QList<BackupInfo> backups = getBackupsForGame(gameId);
-    if (!backups.isEmpty()) {
-        return backups.first().gameName;
+    const QList<BackupInfo> backups = bundleBackups(gameIds);
+    if (backups.isEmpty()) {
+        emit error("There are no backups to export");
+        return 0;
     }
-    return gameId;
+
+    QString backupDir = m_backupDir;
+    auto result = std::make_shared<AsyncResult>();
+
+    emit operationStarted("Exporting backups...");
+
+    // Holds every exported game, so none is pruned or re-based mid-export
+    JobScheduler::Keys keys;
+    for (const BackupInfo &backup : backups) {
+        if (!keys.exclusive.contains(backup.gameId)) {
+            keys.exclusive.append(backup.gameId);
+        }
+    }
+    return m_scheduler.submit(JobScheduler::Manual, keys,
+        [this, result, backups, backupDir, filePath](JobContext &job) {
+            TransferProgress progress = jobTransferProgress(job, true);
+            QSaveFile file(filePath);
+            if (!file.open(QIODevice::WriteOnly)) {
+                result->errorMessage = "Cannot write " + filePath;
+                return;
+            }
+            BackupBundle bundle(backupDir);
+            bundle.setProgress(&progress);
+            result->success = bundle.write(&file, backups, &result->bundleStats) && file.commit();
+            if (!result->success) {
+                result->errorMessage = "Failed to export backups to " + filePath;
+            }
+            progress.finish();
+        },
+        [this, result, filePath](const JobContext &job) {
+            if (job.isCancelled()) {
+                m_jobsCancelled = true;
+            } else if (result->success) {
+                emit backupsExported(filePath, result->bundleStats.backups, result->bundleStats.bytes);
+            } else {
+                emit error(result->errorMessage);
+            }
+            emit jobFinished(job.id());
+        });
 }
 
-QString SaveManager::getGameBackupDir(const QString &gameId) const
+quint64 SaveManager::importBackupsAsync(const QString &filePath)
 {
-    return m_backupDir + "/games/" + gameId;
+    if (!QFile::exists(filePath)) {
+        emit error("Bundle not found: " + filePath);
+        return 0;
+    }
+
+    QString backupDir = m_backupDir;
+    auto result = std::make_shared<AsyncResult>();
+
+    emit operationStarted("Importing backups...");
+
+    // Which games the bundle holds is only known once it is read, and it
+    // may add chunks to the store: it waits for every other job and holds
+    // all of them off while it commits
+    JobScheduler::Keys keys;
+    keys.all = true;
+    return m_scheduler.submit(JobScheduler::Manual, keys,
+        [this, result, backupDir, filePath](JobContext &job) {
+            TransferProgress progress = jobTransferProgress(job, true);
+            QFile file(filePath);
+            if (!file.open(QIODevice::ReadOnly)) {
+                result->errorMessage = "Cannot read " + filePath;
+                return;
+            }
+            progress.setTotals(file.size(), 0);
+            BackupBundle bundle(backupDir);
+            bundle.setProgress(&progress);
+            result->success = bundle.read(&file, &result->imported, &result->bundleStats);
+            if (!result->success) {
+                result->errorMessage = "Failed to import " + filePath + ": the bundle is damaged or incomplete";
+            }
+            progress.finish();
+        },
+        [this, result](const JobContext &job) {
+            // Backups committed before a failure or cancel are complete
+            finishImport(result->imported);
+            if (job.isCancelled()) {
+                m_jobsCancelled = true;
+            } else if (!result->success) {
+                emit error(result->errorMessage);
+            }
+            if (!result->imported.isEmpty() || result->success) {
+                emit backupsImported(result->bundleStats.backups, result->bundleStats.skippedBackups);
+            }
+            emit jobFinished(job.id());
+        });
 }
 
-QString SaveManager::generateBackupId() const
+void SaveManager::finishImport(const QList<BackupInfo> &imported)
 {
-    return QString::number(QDateTime::currentMSecsSinceEpoch());
+    for (const BackupInfo &backup : imported) {
+        saveBackupMetadata(backup);
+        m_catalog.invalidate(backup.gameId);
+    }
 }
 
-// --- libarchive-based compression/extraction ---
-
-void SaveManager::addDirectoryToArchive(struct archive *a, const QString &baseDir,
-                                         const QString &relativePath)
+QList<QByteArray> SaveManager::collectDictionarySamples(const QList<BackupInfo> &backups,
+                                                       const QString &chunkStoreDir, JobContext &job)
 {
-    QDir dir(baseDir + "/" + relativePath);
-    QFileInfoList entries = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden,
-                                              QDir::DirsFirst);
+    // zstd suggests about 100 times the dictionary size in samples; backups
+    // of one game mostly repeat each other, so only distinct files count
+    constexpr qint64 kSampleBudget = 100 * qint64(ZstdDictionary::DefaultCapacity);
+    constexpr int kMaxBackups = 10;
+
+    QList<QByteArray> samples;
+    QSet<QByteArray> seen;
+    qint64 total = 0;
+    auto add = [&](const QByteArray &data) {
+        if (data.isEmpty() || total >= kSampleBudget) {
+            return;
+        }
+        QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Blake2b_256);
+        if (!seen.contains(hash)) {
+            seen.insert(hash);
+            samples.append(data);
+            total += data.size();
+        }
+    };
 
-    for (const QFileInfo &fi : entries) {
-        QString entryRelPath = relativePath.isEmpty()
-            ? fi.fileName()
-            : relativePath + "/" + fi.fileName();
+    // Delta backups hold a few large files, which a dictionary cannot help
+    int sampled = 0;
+    for (int i = 0; i < backups.size() && sampled < kMaxBackups && total < kSampleBudget; ++i) {
+        if (job.isCancelled()) {
+            break;
+        }
+        const BackupInfo &backup = backups.at(i);
+        if (backup.format == "delta") {
+            continue;
+        }
+        ++sampled;
+        job.reportProgress(sampled, qMin<int>(kMaxBackups, backups.size()));
 
-        if (fi.isDir()) {
-            // Write directory entry
-            struct archive_entry *entry = archive_entry_new();
-            archive_entry_set_pathname(entry, entryRelPath.toUtf8().constData());
-            archive_entry_set_filetype(entry, AE_IFDIR);
-            archive_entry_set_perm(entry, 0755);
-            archive_entry_set_mtime(entry, fi.lastModified().toSecsSinceEpoch(), 0);
-            archive_write_header(a, entry);
-            archive_entry_free(entry);
+        if (backup.format == "hardlinks") {
+            for (const HardlinkSnapshot::Entry &entry : HardlinkSnapshot::entries(backup.archivePath)) {
+                if (entry.type != "file" || entry.size > ZstdDictionary::MaxSampleSize) {
+                    continue;
+                }
+                QFile file(backup.archivePath + "/" + entry.path);
+                if (file.open(QIODevice::ReadOnly)) {
+                    add(file.readAll());
+                }
+            }
+            continue;
+        }
 
-            addDirectoryToArchive(a, baseDir, entryRelPath);
-        } else if (fi.isFile()) {
-            struct archive_entry *entry = archive_entry_new();
-            archive_entry_set_pathname(entry, entryRelPath.toUtf8().constData());
-            archive_entry_set_filetype(entry, AE_IFREG);
-            archive_entry_set_perm(entry, fi.isExecutable() ? 0755 : 0644);
-            archive_entry_set_size(entry, fi.size());
-            archive_entry_set_mtime(entry, fi.lastModified().toSecsSinceEpoch(), 0);
-            archive_write_header(a, entry);
+        if (backup.format == "chunks") {
+            ChunkStore store(chunkStoreDir);
+            for (const ChunkStore::Entry &entry : ChunkStore::loadManifest(backup.archivePath)) {
+                if (entry.type != "file" || entry.size > ZstdDictionary::MaxSampleSize) {
+                    continue;
+                }
+                QByteArray data;
+                bool ok = true;
+                for (const QString &hash : entry.chunks) {
+                    data.append(store.readChunk(hash, &ok));
+                    if (!ok) {
+                        break;
+                    }
+                }
+                if (ok) {
+                    add(data);
+                }
+            }
+            continue;
+        }
+
+        struct archive *a = openArchiveForReading(backup.archivePath);
+        if (!a) {
+            continue;
+        }
+        struct archive_entry *entry;
+        while (archive_read_next_header(a, &entry) == ARCHIVE_OK && total < kSampleBudget) {
+            qint64 size = archive_entry_size(entry);
+            if (archive_entry_filetype(entry) != AE_IFREG || size <= 0 || size > ZstdDictionary::MaxSampleSize) {
+                archive_read_data_skip(a);
+                continue;
+            }
+            QByteArray data(size, Qt::Uninitialized);
+            la_ssize_t n = archive_read_data(a, data.data(), static_cast<size_t>(size));
+            if (n == size) {
+                add(data);
+            }
+        }
+        archive_read_free(a);
+    }
+    return samples;
+}
+
+bool SaveManager::isBusy() const
+{
+    return !m_scheduler.isIdle();
+}
+
+quint64 SaveManager::createBackupAsync(const GameInfo &game, const QString &backupName,
+                                      const QString &notes, const SaveProfile &profile,
+                                      bool skipIfUnchanged, JobScheduler::Priority priority)
+{
+    if (!game.isDetected || game.detectedSavePath.isEmpty()) {
+        emit error("Game save path not detected");
+        return 0;
+    }
+    if (!QFile::exists(game.detectedSavePath)) {
+        emit error("Save path does not exist: " + game.detectedSavePath);
+        return 0;
+    }
+
+    BackupInfo backup = newBackupInfo(game, backupName, notes, profile);
+    QString savePath = game.detectedSavePath;
+    CompressionOptions options = compressionOptions();
+    QStringList profileFiles = profile.files;
+    QString chunkStoreDir = getChunkStoreDir();
+    BackupInfo previous = findPreviousBackup(game.id, profile.id);
+    auto result = std::make_shared<AsyncResult>();
+
+    emit operationStarted(QString("Backing up %1...").arg(game.name));
+
+    return m_scheduler.submit(priority, backupJobKeys(game.id, options.format),
+        [this, result, backup, savePath, options, profileFiles, chunkStoreDir, previous,
+         skipIfUnchanged](JobContext &job) {
+            TransferProgress progress = jobTransferProgress(job, true);
+            *result = runBackup(backup, savePath, profileFiles, options,
+                                chunkStoreDir, previous, skipIfUnchanged, progress);
+        },
+        [this, result, backup](const JobContext &job) {
+            finishBackupJob(backup, *result, job);
+        });
+}
+
+void SaveManager::finishBackupJob(BackupInfo backup, const AsyncResult &result, const JobContext &job)
+{
+    if (job.isCancelled()) {
+        removeBackupFiles(backup);
+        m_jobsCancelled = true;
+    } else if (result.skipped) {
+        emit backupSkipped(backup.gameId, "unchanged, skipped");
+    } else if (!result.success) {
+        removeBackupFiles(backup);
+        emit error(result.errorMessage);
+    } else {
+        backup.size = result.storedSize;
+        backup.compressionSkipped = result.compressionSkipped;
+        if (saveBackupMetadata(backup, &result.checksums)) {
+            emit backupCreated(backup.gameId, backup.id);
+            if (!result.unreadFiles.isEmpty()) {
+                emit backupIncomplete(backup.gameId, backup.id, result.unreadFiles);
+            }
+        } else {
+            removeBackupFiles(backup);
+            emit error("Failed to save backup metadata");
+        }
+    }
+    emit jobFinished(job.id());
+}
+
+quint64 SaveManager::restoreBackupAsync(const BackupInfo &backup, const QString &targetPath, RestoreMode mode)
+{
+    if (!QFile::exists(backup.archivePath)) {
+        emit error("Backup archive not found: " + backup.archivePath);
+        return 0;
+    }
 
-            QFile file(fi.absoluteFilePath());
-            if (file.open(QIODevice::ReadOnly)) {
-                char buf[8192];
-                qint64 bytesRead;
-                while ((bytesRead = file.read(buf, sizeof(buf))) > 0) {
-                    archive_write_data(a, buf, static_cast<size_t>(bytesRead));
+    QString chunkStoreDir = getChunkStoreDir();
+    if (mode == RestoreReplace && backup.profileId == -1 && !canSwapInto(targetPath)) {
+        mode = RestoreDifferential;
+    }
+    bool snapshots = m_safetySnapshots;
+    if (mode == RestoreDifferential) {
+        auto result = std::make_shared<AsyncResult>();
+        result->differential = true;
+        emit operationStarted("Restoring changed files...");
+        return m_scheduler.submit(JobScheduler::Manual, backup.gameId,
+            [this, result, backup, targetPath, chunkStoreDir, snapshots](JobContext &job) {
+                // Nothing live is touched until the changed files are staged
+                TransferProgress progress = jobTransferProgress(job, true);
+                if (snapshots && !takeSafetySnapshot(targetPath, true, &result->snapshotDir, progress)) {
+                    result->errorMessage = "Failed to take a safety snapshot of the current save files";
+                    return;
                 }
+                result->success = runDifferentialRestore(backup, targetPath, chunkStoreDir, progress,
+                                                         &result->restoreReport, &result->errorMessage);
+            },
+            [this, result, backup, targetPath](const JobContext &job) {
+                finishRestoreJob(backup, targetPath, QString(), *result, job);
+            });
+    }
+
+    bool isProfile = backup.profileId != -1;
+    // Profile restores overwrite single files in place; full restores are
+    // staged next to the target and swapped in when done
+    QString stagingDir = isProfile ? QString() : restoreStagingDir(targetPath);
+    QString extractDir = isProfile ? targetPath : stagingDir + "/restore";
+    if (isProfile) {
+        QDir().mkpath(targetPath);
+    }
+    auto result = std::make_shared<AsyncResult>();
+
+    emit operationStarted("Restoring backup...");
+
+    return m_scheduler.submit(JobScheduler::Manual, backup.gameId,
+        [this, result, backup, targetPath, extractDir, chunkStoreDir, isProfile, snapshots](JobContext &job) {
+            if (isProfile && snapshots) {
+                TransferProgress snapshotProgress = jobTransferProgress(job, true);
+                if (!takeSafetySnapshot(targetPath, false, &result->snapshotDir, snapshotProgress)) {
+                    result->errorMessage = "Failed to take a safety snapshot of the current save files";
+                    return;
+                }
+            }
+            // Profile restores write straight into the save dir, so stopping
+            // halfway would leave a torn file; only staged restores stop early
+            TransferProgress progress = jobTransferProgress(job, !isProfile);
+            result->success = extractBackupData(backup, extractDir, chunkStoreDir, progress);
+            if (!result->success) {
+                result->errorMessage = "Failed to extract backup archive";
             }
+        },
+        [this, result, backup, targetPath, stagingDir](const JobContext &job) {
+            finishRestoreJob(backup, targetPath, stagingDir, *result, job);
+        });
+}
 
-            archive_entry_free(entry);
-        } else if (fi.isSymLink()) {
-            struct archive_entry *entry = archive_entry_new();
-            archive_entry_set_pathname(entry, entryRelPath.toUtf8().constData());
+void SaveManager::finishRestoreJob(const BackupInfo &backup, const QString &targetPath,
+                                   const QString &stagingDir, const AsyncResult &result,
+                                   const JobContext &job)
+{
+    // Kept even after a failure: an in-place restore may have written
+    // some files before it stopped
+    keepSafetySnapshot(backup, targetPath, result.snapshotDir);
+
+    QString previousTree;
+    if (job.isCancelled()) {
+        m_jobsCancelled = true;
+    } else if (!result.success) {
+        emit error(result.errorMessage);
+    } else if (stagingDir.isEmpty()) {
+        if (result.differential) {
+            const RestoreReport &report = result.restoreReport;
+            emit restoreReported(backup.gameId, backup.id, report.written, report.removed, report.unchanged);
+        }
+        emit backupRestored(backup.gameId, backup.id);
+    } else if (swapIntoPlace(stagingDir, targetPath, &previousTree)) {
+        // Full restore: only renames here, so the GUI thread never copies data
+        adoptReplacedTree(backup, targetPath, previousTree);
+        emit backupRestored(backup.gameId, backup.id);
+    } else {
+        emit error("Failed to restore backup to target location");
+    }
+
+    if (!stagingDir.isEmpty()) {
+        removeInBackground(stagingDir);
+    }
+    emit jobFinished(job.id());
+}
+
+void SaveManager::onSchedulerIdle()
+{
+    // Finished once the collection is done too
+    if (m_chunkGcPending) {
+        submitChunkGarbageCollection();
+        return;
+    }
+
+    bool cancelled = m_jobsCancelled;
+    m_jobsCancelled = false;
+    if (cancelled) {
+        emit operationCancelled();
+    } else {
+        emit operationFinished();
+    }
+}
+
+void SaveManager::cancelOperation()
+{
+    // Queued jobs are dropped; running ones stop at their next block
+    m_scheduler.cancelAll();
+}
+
+TransferProgress SaveManager::jobTransferProgress(JobContext &job, bool cancellable)
+{
+    // Runs on the worker; the context outlives the job's work function
+    JobContext *context = &job;
+    TransferProgress::CancelCheck cancelCheck;
+    if (cancellable) {
+        cancelCheck = [context]() { return context->isCancelled(); };
+    }
+    TransferProgress progress(cancelCheck, [this, context](const TransferProgress::Stats &stats) {
+        context->reportProgress(stats.bytesDone, stats.bytesTotal);
+        quint64 id = context->id();
+        QMetaObject::invokeMethod(this, [this, id, stats]() {
+            emit transferProgress(id, stats.bytesDone, stats.bytesTotal,
+                                  stats.filesDone, stats.filesTotal, stats.bytesPerSecond);
+        }, Qt::QueuedConnection);
+    });
+    if (job.isLowImpact()) {
+        progress.setBandwidthLimit(m_backgroundBandwidthLimit);
+    }
+    return progress;
+}
+
+void SaveManager::setMaxConcurrentJobs(int count)
+{
+    m_scheduler.setMaxConcurrentJobs(count);
+}
+
+QStringList SaveManager::getAllGameIdsWithBackups() const
+{
+    QStringList gameIds = m_catalog.summaries().keys();
+    gameIds.sort();
+    return gameIds;
+}
+
+QString SaveManager::getGameNameFromBackups(const QString &gameId) const
+{
+    QList<BackupInfo> backups = getBackupsForGame(gameId);
+    if (!backups.isEmpty()) {
+        return backups.first().gameName;
+    }
+    return gameId;
+}
+
+QHash<QString, BackupSummary> SaveManager::getBackupSummaries() const
+{
+    return m_catalog.summaries();
+}
+
+BackupSummary SaveManager::getBackupTotals() const
+{
+    return m_catalog.totals();
+}
+
+QStringList SaveManager::getStaleGameIds(const QDateTime &cutoff) const
+{
+    return m_catalog.staleGames(cutoff);
+}
+
+QList<BackupEntry> SaveManager::listBackupContents(const BackupInfo &backup) const
+{
+    return loadBackupContents(backup);
+}
+
+QList<BackupEntry> SaveManager::loadBackupContents(const BackupInfo &backup, bool *ok)
+{
+    bool cached = false;
+    QList<BackupEntry> contents = BackupListing::load(backup.archivePath, &cached);
+    if (ok) *ok = cached;
+    if (cached) {
+        return contents;
+    }
+
+    bool scanned = false;
+    contents = scanBackupContents(backup, &scanned);
+    if (ok) *ok = scanned;
+    if (!scanned) {
+        return contents;
+    }
+
+    // Prefer hashes of what was archived; older backups and the chunk and
+    // delta formats only have the fingerprint taken at backup time
+    FileChecksums checksums = FileChecksums::loadMetadata(backup.archivePath + ".json");
+    FileManifest files = FileManifest::load(backup.archivePath + ".files");
+    for (BackupEntry &entry : contents) {
+        if (entry.type != "file") {
+            continue;
+        }
+        entry.hash = checksums.value(entry.path);
+        const FileManifest::Entry *scanned = files.find(entry.path);
+        if (entry.hash.isEmpty() && scanned && scanned->size == entry.size) {
+            entry.hash = scanned->hash;
+        }
+    }
+
+    if (!BackupListing::save(backup.archivePath, contents)) {
+        qWarning() << "Failed to cache backup contents:" << BackupListing::cachePath(backup.archivePath);
+    }
+    return contents;
+}
+
+QList<BackupEntry> SaveManager::scanBackupContents(const BackupInfo &backup, bool *ok)
+{
+    QList<BackupEntry> contents;
+    *ok = false;
+    auto add = [&contents](const QString &path, const QString &type, qint64 size, qint64 mtime,
+                           const QString &linkTarget) {
+        BackupEntry entry;
+        entry.path = path;
+        entry.type = type;
+        entry.size = size;
+        entry.mtime = QDateTime::fromSecsSinceEpoch(mtime);
+        entry.linkTarget = linkTarget;
+        contents.append(entry);
+    };
+
+    if (backup.format == "chunks") {
+        for (const ChunkStore::Entry &entry : ChunkStore::loadManifest(backup.archivePath, ok)) {
+            add(entry.path, entry.type, entry.size, entry.mtime, entry.linkTarget);
+        }
+        return contents;
+    }
+    if (backup.format == "delta") {
+        for (const DeltaArchive::Entry &entry : DeltaArchive::loadManifest(backup.archivePath, nullptr, ok)) {
+            add(entry.path, entry.type, entry.size, entry.mtime, entry.linkTarget);
+        }
+        return contents;
+    }
+    if (backup.format == "hardlinks") {
+        for (const HardlinkSnapshot::Entry &entry : HardlinkSnapshot::entries(backup.archivePath, ok)) {
+            add(entry.path, entry.type, entry.size, entry.mtime, entry.linkTarget);
+        }
+        return contents;
+    }
+
+    ArchiveIndex index = ArchiveIndex::load(backup.archivePath + ".index", ok);
+    if (*ok) {
+        for (const ArchiveIndex::Entry &entry : index.entries()) {
+            add(entry.path, entry.type, entry.size, entry.mtime, entry.linkTarget);
+        }
+        return contents;
+    }
+
+    // No index: walk the headers, which decompresses the whole stream
+    struct archive *a = openArchiveForReading(backup.archivePath);
+    if (!a) {
+        return contents;
+    }
+    struct archive_entry *entry;
+    int r;
+    while ((r = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+        QString type = "file";
+        if (archive_entry_filetype(entry) == AE_IFDIR) {
+            type = "dir";
+        } else if (archive_entry_filetype(entry) == AE_IFLNK) {
+            type = "symlink";
+        }
+        QString path = QString::fromUtf8(archive_entry_pathname(entry));
+        if (path.endsWith('/')) {
+            path.chop(1);
+        }
+        add(path, type, archive_entry_size(entry), archive_entry_mtime(entry),
+            QString::fromUtf8(archive_entry_symlink(entry)));
+        archive_read_data_skip(a);
+    }
+    *ok = r == ARCHIVE_EOF;
+    archive_read_free(a);
+    return contents;
+}
+
+QString SaveManager::getGameBackupDir(const QString &gameId) const
+{
+    return m_backupDir + "/games/" + gameId;
+}
+
+QString SaveManager::dictionaryPath(const QString &gameBackupDir)
+{
+    return gameBackupDir + "/zstd.dict";
+}
+
+QString SaveManager::generateBackupId()
+{
+    // Millisecond timestamps collide when jobs start together; hand out a
+    // strictly increasing value instead, which still reads as a timestamp
+    static std::atomic<qint64> lastId{0};
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 last = lastId.load();
+    qint64 id;
+    do {
+        id = qMax(now, last + 1);
+    } while (!lastId.compare_exchange_weak(last, id));
+    return QString::number(id);
+}
+
+BackupInfo SaveManager::newBackupInfo(const GameInfo &game, const QString &backupName,
+                                      const QString &notes, const SaveProfile &profile) const
+{
+    QString gameBackupDir = getGameBackupDir(game.id);
+    QDir().mkpath(gameBackupDir);
+
+    BackupInfo backup;
+    backup.id = generateBackupId();
+    backup.gameId = game.id;
+    backup.gameName = game.name;
+    backup.notes = notes;
+    backup.timestamp = QDateTime::currentDateTime();
+    backup.profileId = profile.id;
+    backup.profileName = profile.name;
+    backup.displayName = backupName.isEmpty()
+        ? backup.timestamp.toString("yyyy-MM-dd HH:mm:ss")
+        : backupName;
+    backup.format = m_backupFormat;
+    backup.archivePath = gameBackupDir + "/" + backup.id + archiveSuffix(backup.format);
+    return backup;
+}
+
+QString SaveManager::getChunkStoreDir() const
+{
+    return m_backupDir + "/chunks";
+}
+
+SaveManager::CompressionOptions SaveManager::compressionOptions() const
+{
+    CompressionOptions options;
+    options.format = m_backupFormat;
+    options.level = m_compressionLevel;
+    options.threads = m_compressionThreads;
+    options.longDistance = m_longDistanceMatching;
+    options.keyframeInterval = m_deltaKeyframeInterval;
+    options.batchedReads = m_batchedReads;
+    options.memoryBudget = m_memoryBudget;
+    return options;
+}
+
+QString SaveManager::archiveSuffix(const QString &format)
+{
+    if (format == "chunks") return ".snap";
+    if (format == "delta") return ".delta";
+    if (format == "hardlinks") return ".tree";
+    if (format == "tar.zst") return ".tar.zst";
+    return ".tar.gz";
+}
+
+BackupInfo SaveManager::findPreviousBackup(const QString &gameId, int profileId) const
+{
+    const QList<BackupInfo> backups = getBackupsForGame(gameId);
+    for (const BackupInfo &backup : backups) {
+        if (backup.profileId == profileId && QFile::exists(backup.archivePath + ".files")) {
+            return backup;
+        }
+    }
+    return BackupInfo();
+}
+
+void SaveManager::backupLayout(const QString &savePath, int profileId, const QStringList &profileFiles,
+                               QString *baseDir, QStringList *relativePaths)
+{
+    if (profileId == -1) {
+        // Full backups hold a top-level entry named after the save dir (like tar)
+        QFileInfo sourceInfo(savePath);
+        *baseDir = sourceInfo.absolutePath();
+        *relativePaths = QStringList() << sourceInfo.fileName();
+    } else {
+        *baseDir = savePath;
+        *relativePaths = profileFiles;
+    }
+}
+
+SaveManager::AsyncResult SaveManager::runBackup(const BackupInfo &backup, const QString &savePath,
+                                                const QStringList &profileFiles, const CompressionOptions &options,
+                                                const QString &chunkStoreDir, const BackupInfo &previous,
+                                                bool skipIfUnchanged, TransferProgress &progress)
+{
+    AsyncResult result;
+
+    QString baseDir;
+    QStringList relativePaths;
+    backupLayout(savePath, backup.profileId, profileFiles, &baseDir, &relativePaths);
+
+    bool havePrevious = false;
+    FileManifest previousFiles;
+    if (!previous.id.isEmpty()) {
+        previousFiles = FileManifest::load(previous.archivePath + ".files", &havePrevious);
+    }
+
+    // Fingerprint before reading any data, so a file changing mid-backup
+    // shows up as changed next time rather than being skipped. Only stats:
+    // files are hashed as they are archived, so a backup reads them once.
+    FileManifest currentFiles = FileManifest::scan(baseDir, relativePaths, previousFiles,
+                                                   FileManifest::StatOnly);
+
+    // Files rewritten at the same size may still hold the same bytes; that
+    // takes hashing them, which only pays when it can skip the backup
+    if (skipIfUnchanged && havePrevious && currentFiles.maybeSameContent(previousFiles)) {
+        progress.setTotals(currentFiles.unhashedSize(), 0);
+        if (!currentFiles.hashMissing(baseDir, &progress) && progress.isCancelled()) {
+            result.errorMessage = "Backup cancelled";
+            return result;
+        }
+        if (currentFiles.sameContent(previousFiles)) {
+            result.success = true;
+            result.skipped = true;
+            return result;
+        }
+    }
+
+    // Chunk and delta backups only need to read the files that actually changed
+    IncrementalBase incremental;
+    if (havePrevious && backup.format == previous.format) {
+        const QStringList changedList = currentFiles.changedPaths(previousFiles);
+        const QSet<QString> changed(changedList.cbegin(), changedList.cend());
+        for (const FileManifest::Entry &entry : currentFiles.entries()) {
+            if (entry.type == "file" && !changed.contains(entry.path)) {
+                incremental.unchangedPaths.insert(entry.path);
+            }
+        }
+    }
+    if (!incremental.unchangedPaths.isEmpty() && backup.format == "chunks") {
+        const QList<ChunkStore::Entry> oldEntries = ChunkStore::loadManifest(previous.archivePath);
+        for (const ChunkStore::Entry &entry : oldEntries) {
+            if (entry.type == "file" && incremental.unchangedPaths.contains(entry.path)) {
+                incremental.knownChunks.insert(entry.path, entry.chunks);
+            }
+        }
+    }
+    if (!incremental.unchangedPaths.isEmpty() && backup.format == "hardlinks") {
+        incremental.linkBasePath = previous.archivePath;
+    }
+    if (havePrevious && backup.format == "delta" && previous.format == "delta") {
+        // Start a new chain with a full keyframe every keyframeInterval backups
+        bool chainOk = false;
+        int chainLength = DeltaArchive(previous.archivePath).chain(&chainOk).size();
+        if (chainOk && chainLength < options.keyframeInterval) {
+            incremental.deltaBasePath = previous.archivePath;
+        }
+    }
+
+    // Snapshot copies are made by the kernel, so their hashes take a read of
+    // the copies afterwards
+    const bool hashCopies = backup.format == "hardlinks";
+    progress.setTotals(progress.stats().bytesDone + currentFiles.totalSize()
+                           + (hashCopies ? currentFiles.unhashedSize() : 0),
+                       currentFiles.fileCount());
+    ArchiveRecord record;
+    result.success = writeBackupData(backup, savePath, profileFiles, options,
+                                     chunkStoreDir, &result.storedSize, incremental, &record, progress);
+    if (!result.success) {
+        progress.finish();
+        result.errorMessage = progress.isCancelled() ? "Backup cancelled" : "Failed to create backup archive";
+        return result;
+    }
+    // Chunks were dropped as they were written
+    LowImpactIo::dropCache(backup.archivePath, true);
+
+    for (const QString &path : record.checksums.paths()) {
+        currentFiles.setHash(path, record.checksums.value(path));
+    }
+    // Not in the backup as they are, so never "unchanged" next time
+    for (const QString &path : std::as_const(record.unreadFiles)) {
+        currentFiles.setHash(path, QByteArray());
+    }
+    // Left without hashes, files count as changed next time: the backup is
+    // complete either way
+    if (hashCopies) {
+        currentFiles.hashMissing(backup.archivePath, &progress);
+    }
+    progress.finish();
+
+    result.checksums = record.checksums;
+    result.compressionSkipped = record.compressionSkipped;
+    result.unreadFiles = record.unreadFiles;
+    if (!currentFiles.save(backup.archivePath + ".files")) {
+        qWarning() << "Failed to save file fingerprint for backup" << backup.id;
+    }
+    if (!record.index.isEmpty() && !record.index.save(backup.archivePath + ".index")) {
+        qWarning() << "Failed to save archive index for backup" << backup.id;
+    }
+    return result;
+}
+
+bool SaveManager::writeBackupData(const BackupInfo &backup, const QString &savePath,
+                                  const QStringList &profileFiles, const CompressionOptions &options,
+                                  const QString &chunkStoreDir, qint64 *storedSize,
+                                  const IncrementalBase &incremental, ArchiveRecord *record,
+                                  TransferProgress &progress)
+{
+    if (backup.format == "chunks") {
+        ChunkStore store(chunkStoreDir);
+        store.setCompressionLevel(options.level);
+        store.setProgress(&progress);
+        if (record) store.setChecksums(&record->checksums);
+        ZstdDictionary dictionary = ZstdDictionary::load(dictionaryPath(QFileInfo(backup.archivePath).absolutePath()));
+        if (!dictionary.isNull()) {
+            store.setDictionary(dictionary);
+        }
+        ChunkStore::Stats stats;
+
+        if (backup.profileId == -1 && !QFileInfo(savePath).isDir()) {
+            qWarning() << "Source directory does not exist:" << savePath;
+            return false;
+        }
+
+        QString baseDir;
+        QStringList relativePaths;
+        backupLayout(savePath, backup.profileId, profileFiles, &baseDir, &relativePaths);
+        bool ok = store.writeSnapshot(baseDir, relativePaths, backup.archivePath, &stats,
+                                      incremental.knownChunks);
+        if (record) record->compressionSkipped = stats.bytesSkipped;
+
+        // Only newly stored chunks count, so sizes add up to real disk usage
+        if (ok && storedSize) {
+            *storedSize = QFileInfo(backup.archivePath).size() + stats.bytesStored;
+        }
+        return ok;
+    }
+
+    if (backup.format == "delta") {
+        if (backup.profileId == -1 && !QFileInfo(savePath).isDir()) {
+            qWarning() << "Source directory does not exist:" << savePath;
+            return false;
+        }
+
+        QString baseDir;
+        QStringList relativePaths;
+        backupLayout(savePath, backup.profileId, profileFiles, &baseDir, &relativePaths);
+        DeltaArchive archive(backup.archivePath);
+        archive.setCompressionLevel(options.level);
+        archive.setMemoryLimit(MemoryBudget(options.memoryBudget).deltaFileLimit());
+        archive.setProgress(&progress);
+        if (record) archive.setChecksums(&record->checksums);
+        // Unchanged paths are relative to the previous backup, which is only
+        // the base when the chain continues
+        QSet<QString> unchanged = incremental.deltaBasePath.isEmpty() ? QSet<QString>()
+                                                                      : incremental.unchangedPaths;
+        DeltaArchive::Stats stats;
+        bool ok = archive.write(baseDir, relativePaths, incremental.deltaBasePath, &stats, unchanged);
+        if (record) record->compressionSkipped = stats.bytesSkipped;
+        if (ok && storedSize) {
+            *storedSize = QFileInfo(backup.archivePath).size();
+        }
+        return ok;
+    }
+
+    if (backup.format == "hardlinks") {
+        if (backup.profileId == -1 && !QFileInfo(savePath).isDir()) {
+            qWarning() << "Source directory does not exist:" << savePath;
+            return false;
+        }
+
+        QString baseDir;
+        QStringList relativePaths;
+        backupLayout(savePath, backup.profileId, profileFiles, &baseDir, &relativePaths);
+        HardlinkSnapshot snapshot(backup.archivePath);
+        snapshot.setProgress(&progress);
+        HardlinkSnapshot::Stats stats;
+        bool ok = snapshot.write(baseDir, relativePaths, incremental.linkBasePath, &stats,
+                                 incremental.unchangedPaths);
+        // Linked files are already counted by the backup they came from
+        if (ok && storedSize) {
+            *storedSize = stats.bytesCopied;
+        }
+        return ok;
+    }
+
+    bool ok;
+    if (backup.profileId == -1) {
+        ok = compressDirectory(savePath, backup.archivePath, options, record, progress);
+    } else {
+        ok = compressFiles(savePath, profileFiles, backup.archivePath, options, record, progress);
+    }
+    if (ok && storedSize) {
+        *storedSize = QFileInfo(backup.archivePath).size();
+    }
+    return ok;
+}
+
+bool SaveManager::extractBackupData(const BackupInfo &backup, const QString &targetDir,
+                                    const QString &chunkStoreDir, TransferProgress &progress)
+{
+    // The fingerprint taken at backup time knows the uncompressed size;
+    // backups made before fingerprints existed report no total
+    FileManifest files = FileManifest::load(backup.archivePath + ".files");
+    progress.setTotals(files.totalSize(), files.fileCount());
+
+    bool ok;
+    if (backup.format == "chunks") {
+        ChunkStore store(chunkStoreDir);
+        store.setProgress(&progress);
+        ok = store.restoreSnapshot(backup.archivePath, targetDir);
+    } else if (backup.format == "delta") {
+        DeltaArchive archive(backup.archivePath);
+        archive.setProgress(&progress);
+        ok = archive.restore(targetDir);
+    } else if (backup.format == "hardlinks") {
+        HardlinkSnapshot snapshot(backup.archivePath);
+        snapshot.setProgress(&progress);
+        ok = snapshot.restore(targetDir);
+    } else {
+        ok = extractArchive(backup.archivePath, targetDir, progress);
+    }
+    progress.finish();
+    return ok;
+}
+
+bool SaveManager::extractBackupPaths(const BackupInfo &backup, const QStringList &paths,
+                                     const QString &targetDir, const QString &chunkStoreDir,
+                                     TransferProgress &progress)
+{
+    bool ok;
+    if (backup.format == "chunks") {
+        ChunkStore store(chunkStoreDir);
+        store.setProgress(&progress);
+        ok = store.restoreSnapshot(backup.archivePath, targetDir, paths);
+    } else if (backup.format == "delta") {
+        DeltaArchive archive(backup.archivePath);
+        archive.setProgress(&progress);
+        ok = archive.restore(targetDir, paths);
+    } else if (backup.format == "hardlinks") {
+        HardlinkSnapshot snapshot(backup.archivePath);
+        snapshot.setProgress(&progress);
+        ok = snapshot.restore(targetDir, paths);
+    } else {
+        bool indexed = false;
+        ArchiveIndex index = ArchiveIndex::load(backup.archivePath + ".index", &indexed);
+        index.setProgress(&progress);
+        ok = indexed && index.extract(backup.archivePath, paths, targetDir);
+        if (!ok && !progress.isCancelled()) {
+            // zstd, older gzip backups or a stale index: read the whole stream
+            ok = extractArchive(backup.archivePath, targetDir, progress, paths);
+        }
+    }
+    progress.finish();
+    return ok;
+}
+
+bool SaveManager::checkBackupData(const BackupInfo &backup, VerifyMode mode, const QString &chunkStoreDir,
+                                  TransferProgress &progress)
+{
+    if (!QFile::exists(backup.archivePath)) {
+        return false;
+    }
+
+    // Chunks and deltas carry their own content hashes and always check them
+    if (backup.format == "chunks") {
+        return ChunkStore(chunkStoreDir).verifySnapshot(backup.archivePath);
+    }
+    if (backup.format == "delta") {
+        return DeltaArchive(backup.archivePath).verify();
+    }
+    // Snapshots are checked against the fingerprint taken at backup time
+    if (backup.format == "hardlinks") {
+        FileManifest files = FileManifest::load(backup.archivePath + ".files");
+        HardlinkSnapshot snapshot(backup.archivePath);
+        snapshot.setProgress(&progress);
+        if (mode == VerifyContent) {
+            progress.setTotals(files.totalSize(), files.fileCount());
+        }
+        bool ok = snapshot.verify(files, mode == VerifyContent);
+        progress.finish();
+        return ok;
+    }
+
+    if (mode == VerifyContent) {
+        FileManifest files = FileManifest::load(backup.archivePath + ".files");
+        progress.setTotals(files.totalSize(), files.fileCount());
+        // Backups made before checksums were recorded still get every
+        // compressed block decoded, which catches most damage
+        FileChecksums checksums = FileChecksums::loadMetadata(backup.archivePath + ".json");
+        bool ok = checkArchiveContent(backup.archivePath, checksums, progress);
+        progress.finish();
+        return ok;
+    }
+
+    struct archive *a = openArchiveForReading(backup.archivePath);
+    if (!a) {
+        return false;
+    }
+    bool valid = true;
+    struct archive_entry *entry;
+    while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+        archive_read_data_skip(a);
+    }
+    if (archive_errno(a) != 0) {
+        valid = false;
+    }
+    archive_read_free(a);
+    return valid;
+}
+
+void SaveManager::removeBackupFiles(const BackupInfo &backup)
+{
+    removeArchiveFiles(backup.archivePath);
+    if (backup.format == "chunks") {
+        collectChunkGarbage();
+    }
+}
+
+bool SaveManager::removeArchiveFiles(const QString &archivePath)
+{
+    bool success = true;
+
+    // Hard-link snapshots are directories
+    if (QFileInfo(archivePath).isDir()) {
+        success = HardlinkSnapshot(archivePath).remove();
+    } else if (QFile::exists(archivePath)) {
+        success = QFile::remove(archivePath);
+    }
+
+    QString metadataPath = archivePath + ".json";
+    if (QFile::exists(metadataPath)) {
+        success = success && QFile::remove(metadataPath);
+    }
+
+    // Fingerprint, index and listing cache are only optimisations, leftovers
+    // are harmless
+    QFile::remove(archivePath + ".files");
+    QFile::remove(archivePath + ".index");
+    QFile::remove(BackupListing::cachePath(archivePath));
+    return success;
+}
+
+void SaveManager::collectChunkGarbage()
+{
+    // Waits for the queue to drain, then runs as a job of its own
+    m_chunkGcPending = true;
+    if (m_scheduler.isIdle()) {
+        submitChunkGarbageCollection();
+    }
+}
+
+void SaveManager::submitChunkGarbageCollection()
+{
+    m_chunkGcPending = false;
+
+    // Chunk backups share the store's key: one that starts meanwhile stores
+    // chunks no snapshot references yet, so it waits until this is done
+    JobScheduler::Keys keys;
+    keys.exclusive.append(kChunkStoreKey);
+    QString backupDir = m_backupDir;
+    QString chunkStoreDir = getChunkStoreDir();
+    m_scheduler.submit(JobScheduler::Bulk, keys, [backupDir, chunkStoreDir](JobContext &) {
+        removeUnreferencedChunks(backupDir, chunkStoreDir);
+    });
+}
+
+void SaveManager::removeUnreferencedChunks(const QString &backupDir, const QString &chunkStoreDir)
+{
+    QStringList manifests;
+    QDirIterator it(backupDir + "/games", QStringList() << "*.snap", QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        manifests.append(it.next());
+    }
+
+    int removed = ChunkStore(chunkStoreDir).collectGarbage(manifests);
+    if (removed > 0) {
+        qDebug() << "Removed" << removed << "unreferenced chunks";
+    }
+}
+
+bool SaveManager::rebaseDeltaDependents(const BackupInfo &backup)
+{
+    QList<BackupInfo> rebased;
+    bool success = rebaseDeltaChain(backup, getBackupsForGame(backup.gameId), compressionOptions(), &rebased);
+    for (const BackupInfo &dependent : rebased) {
+        if (saveBackupMetadata(dependent)) {
+            emit backupUpdated(dependent.gameId, dependent.id);
+        }
+    }
+    return success;
+}
+
+bool SaveManager::rebaseDeltaChain(const BackupInfo &backup, const QList<BackupInfo> &candidates,
+                                   const CompressionOptions &options, QList<BackupInfo> *rebased)
+{
+    QString backupName = QFileInfo(backup.archivePath).fileName();
+    QString newBase = DeltaArchive(backup.archivePath).basePath();
+
+    for (BackupInfo dependent : candidates) {
+        if (dependent.format != "delta" || dependent.id == backup.id) {
+            continue;
+        }
+        DeltaArchive archive(dependent.archivePath);
+        if (QFileInfo(archive.basePath()).fileName() != backupName) {
+            continue;
+        }
+
+        // Same contents, re-encoded against our base (or as a new keyframe)
+        archive.setCompressionLevel(options.level);
+        archive.setMemoryLimit(MemoryBudget(options.memoryBudget).deltaFileLimit());
+        if (!archive.rebase(newBase)) {
+            qWarning() << "Failed to re-base delta backup" << dependent.id;
+            return false;
+        }
+        dependent.size = QFileInfo(dependent.archivePath).size();
+        rebased->append(dependent);
+    }
+    return true;
+}
+
+// --- libarchive-based compression/extraction ---
+
+void SaveManager::recordEntry(ArchiveRecord *record, struct archive_entry *entry)
+{
+    if (!record || !record->gzip) {
+        return;
+    }
+
+    // Called right after the header went out, so the tar position is where
+    // the entry's data starts
+    ArchiveIndex::Entry indexed;
+    indexed.path = QString::fromUtf8(archive_entry_pathname(entry));
+    indexed.mtime = archive_entry_mtime(entry);
+    indexed.offset = record->gzip->bytesIn();
+    if (archive_entry_filetype(entry) == AE_IFDIR) {
+        indexed.type = "dir";
+    } else if (archive_entry_filetype(entry) == AE_IFLNK) {
+        indexed.type = "symlink";
+        indexed.linkTarget = QString::fromUtf8(archive_entry_symlink(entry));
+    } else {
+        indexed.type = "file";
+        indexed.size = archive_entry_size(entry);
+        indexed.executable = (archive_entry_perm(entry) & 0111) != 0;
+    }
+    record->index.addEntry(indexed);
+}
+
+void SaveManager::finishRecord(ArchiveRecord *record, ParallelGzipWriter *gzipWriter)
+{
+    if (!record) {
+        return;
+    }
+    if (gzipWriter) {
+        record->index.setMembers(gzipWriter->blockSize(), gzipWriter->memberSizes());
+        record->compressionSkipped = gzipWriter->skippedBytes();
+    }
+    // The writer is about to go away
+    record->gzip = nullptr;
+}
+
+bool SaveManager::addFileToArchive(struct archive *a, BatchFileReader &reader, DirWalker::FileStat st,
+                                   const QString &filePath, const QString &entryPath, ArchiveRecord *record,
+                                   TransferProgress &progress)
+{
+    // The header goes out with the first data, so a file that could not be
+    // opened leaves nothing behind and can be tried again
+    bool headerWritten = false;
+    auto writeHeader = [&]() {
+        struct archive_entry *entry = archive_entry_new();
+        archive_entry_set_pathname(entry, entryPath.toUtf8().constData());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, st.executable ? 0755 : 0644);
+        archive_entry_set_size(entry, st.size);
+        archive_entry_set_mtime(entry, st.mtimeMs / 1000, 0);
+        headerWritten = archive_write_header(a, entry) == ARCHIVE_OK;
+        if (headerWritten) {
+            recordEntry(record, entry);
+        } else {
+            qWarning() << "Failed to write archive header:" << archive_error_string(a);
+        }
+        archive_entry_free(entry);
+        return headerWritten;
+    };
+
+    // Hash exactly what goes into the archive, not what the file holds later
+    FileChecksums::Hasher hasher;
+    qint64 hashed = 0;
+    BatchFileReader::Sink write = [&](const char *data, qsizetype size) {
+        if (!headerWritten && !writeHeader()) {
+            return false;
+        }
+        if (archive_write_data(a, data, static_cast<size_t>(size)) < 0) {
+            qWarning() << "Failed to write archive data:" << archive_error_string(a);
+            return false;
+        }
+        hasher.addData(data, size);
+        hashed += size;
+        return progress.addBytes(size);
+    };
+
+    // Small files are taken whole and checked before anything is written;
+    // larger ones go out as they are read
+    const bool whole = st.size <= BatchFileReader::PrefetchLimit;
+    QByteArray data;
+    BatchFileReader::Sink collect = [&data](const char *p, qsizetype size) {
+        data.append(p, size);
+        return true;
+    };
+    auto readAll = [&]() {
+        return (whole ? qint64(data.size()) : hashed) == st.size;
+    };
+
+    bool readOk = false;
+    if (!reader.readNext(whole ? collect : write, &readOk)) {
+        return false;
+    }
+    bool complete = readOk && readAll();
+    if (!complete && !headerWritten) {
+        // Locked, or changed while it was read: once more, from a fresh stat
+        data.clear();
+        BatchFileReader retry(false, 1);
+        if (DirWalker::stat(filePath, &st, true) && st.type == DirWalker::File) {
+            retry.enqueue(filePath, st.size);
+            if (!retry.readNext(whole ? collect : write, &readOk)) {
+                return false;
+            }
+            complete = readOk && readAll();
+        }
+    }
+    if (whole && complete) {
+        if ((!headerWritten && !writeHeader()) || (!data.isEmpty() && !write(data.constData(), data.size()))) {
+            return false;
+        }
+    }
+
+    if (!complete) {
+        // Nothing of it is in the archive, or, for a large file that changed
+        // midway, what was read padded out with zeros and left without a hash
+        qWarning() << "Failed to read" << entryPath << "in full; it may be locked or have changed"
+                   << (headerWritten ? "during the backup, stored incomplete" : "during the backup, skipped");
+        if (record) {
+            record->unreadFiles.append(entryPath);
+        }
+        progress.addFile();
+        return true;
+    }
+    if (record) {
+        record->checksums.insert(entryPath, hasher.result());
+    }
+    progress.addFile();
+    return true;
+}
+
+bool SaveManager::addDirectoryToArchive(struct archive *a, BatchFileReader &reader, const QString &baseDir,
+                                        const QString &relativePath, ArchiveRecord *record,
+                                        TransferProgress &progress)
+{
+    // Entries are written in walk order but trail the walk by the reader's
+    // queue depth, so the files in between are already being read
+    struct Pending {
+        QString entryPath;
+        QString filePath;
+        DirWalker::FileStat stat;
+    };
+    std::deque<Pending> window;
+
+    auto writeOldest = [&]() {
+        Pending p = std::move(window.front());
+        window.pop_front();
+        if (p.stat.type == DirWalker::File) {
+            return addFileToArchive(a, reader, p.stat, p.filePath, p.entryPath, record, progress);
+        }
+        struct archive_entry *entry = archive_entry_new();
+        archive_entry_set_pathname(entry, p.entryPath.toUtf8().constData());
+        if (p.stat.type == DirWalker::Dir) {
+            archive_entry_set_filetype(entry, AE_IFDIR);
+            archive_entry_set_perm(entry, 0755);
+            archive_entry_set_mtime(entry, p.stat.mtimeMs / 1000, 0);
+        } else {
             archive_entry_set_filetype(entry, AE_IFLNK);
-            archive_entry_set_symlink(entry, fi.symLinkTarget().toUtf8().constData());
+            archive_entry_set_symlink(entry, QFileInfo(p.filePath).symLinkTarget().toUtf8().constData());
             archive_entry_set_perm(entry, 0777);
-            archive_write_header(a, entry);
-            archive_entry_free(entry);
         }
+        archive_write_header(a, entry);
+        recordEntry(record, entry);
+        archive_entry_free(entry);
+        return true;
+    };
+
+    bool ok = true;
+    DirWalker::walk(baseDir + "/" + relativePath, [&](const DirWalker::Entry &fi) {
+        if (progress.isCancelled()) {
+            ok = false;
+            return DirWalker::Stop;
+        }
+        if (fi.type != DirWalker::Dir && fi.type != DirWalker::File && fi.type != DirWalker::Symlink) {
+            return DirWalker::Continue;
+        }
+
+        QString entryRelPath = relativePath.isEmpty()
+            ? fi.relativePath()
+            : relativePath + "/" + fi.relativePath();
+        window.push_back({entryRelPath, fi.type == DirWalker::Dir ? QString() : fi.filePath(), fi});
+        if (fi.type == DirWalker::File) {
+            reader.enqueue(window.back().filePath, fi.size);
+        }
+
+        while (reader.pending() > reader.queueDepth()) {
+            if (!writeOldest()) {
+                ok = false;
+                return DirWalker::Stop;
+            }
+        }
+        return DirWalker::Continue;
+    }, DirWalker::DirsFirst);
+
+    while (ok && !window.empty()) {
+        if (progress.isCancelled() || !writeOldest()) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+namespace {
+
+// libarchive client callbacks feeding the uncompressed tar stream into the
+// parallel gzip pipeline
+la_ssize_t gzipPipelineWrite(struct archive *a, void *clientData, const void *buffer, size_t length)
+{
+    auto *writer = static_cast<ParallelGzipWriter *>(clientData);
+    if (!writer->write(static_cast<const char *>(buffer), static_cast<qsizetype>(length))) {
+        archive_set_error(a, EIO, "%s", writer->errorString().toUtf8().constData());
+        return -1;
+    }
+    return static_cast<la_ssize_t>(length);
+}
+
+int gzipPipelineClose(struct archive *a, void *clientData)
+{
+    auto *writer = static_cast<ParallelGzipWriter *>(clientData);
+    if (!writer->close()) {
+        archive_set_error(a, EIO, "%s", writer->errorString().toUtf8().constData());
+        return ARCHIVE_FATAL;
+    }
+    return ARCHIVE_OK;
+}
+
+} // namespace
+
+int SaveManager::readQueueDepth(const CompressionOptions &options)
+{
+    int files = MemoryBudget(options.memoryBudget).readAheadFiles(BatchFileReader::PrefetchLimit);
+    return qMin(files, BatchFileReader::DefaultQueueDepth);
+}
+
+struct archive *SaveManager::openArchiveForWriting(const QString &archivePath, const CompressionOptions &options,
+                                                   std::unique_ptr<ParallelGzipWriter> &gzipWriter)
+{
+    struct archive *a = archive_write_new();
+    archive_write_set_format_pax_restricted(a);
+
+    if (options.format == "tar.zst") {
+        if (!setupZstdFilter(a, options)) {
+            archive_write_free(a);
+            return nullptr;
+        }
+        if (archive_write_open_filename(a, archivePath.toLocal8Bit().constData()) != ARCHIVE_OK) {
+            qWarning() << "Failed to open archive for writing:" << archive_error_string(a);
+            archive_write_free(a);
+            return nullptr;
+        }
+        return a;
+    }
+
+    // gzip: libarchive emits plain tar and the pipeline compresses it in
+    // blocks across all cores, writing a multi-member .tar.gz. Its queue of
+    // blocks in flight is what the budget allows; when it is full, writing
+    // the tar (and so reading the save) waits for compression.
+    int blocks = MemoryBudget(options.memoryBudget).gzipBlocksInFlight(ParallelGzipWriter::DefaultBlockSize);
+    int threads = options.threads > 0 ? options.threads : QThread::idealThreadCount();
+    gzipWriter = std::make_unique<ParallelGzipWriter>(options.level, qMin(threads, blocks),
+                                                      ParallelGzipWriter::DefaultBlockSize, blocks);
+    if (!gzipWriter->open(archivePath)) {
+        qWarning() << "Failed to open archive for writing:" << gzipWriter->errorString();
+        archive_write_free(a);
+        return nullptr;
+    }
+    archive_write_add_filter_none(a);
+    // Unblocked: the tar stream reaches the pipeline as it is written, so its
+    // input count is the tar position the archive index records, and the end
+    // is padded only to the tar record, not to a 10 KiB block
+    archive_write_set_bytes_per_block(a, 0);
+    if (archive_write_open2(a, gzipWriter.get(), nullptr, gzipPipelineWrite, gzipPipelineClose, nullptr)
+        != ARCHIVE_OK) {
+        qWarning() << "Failed to open archive for writing:" << archive_error_string(a);
+        archive_write_free(a);
+        return nullptr;
+    }
+    return a;
+}
+
+bool SaveManager::setupZstdFilter(struct archive *a, const CompressionOptions &options)
+{
+    if (archive_write_add_filter_zstd(a) != ARCHIVE_OK) {
+        qWarning() << "zstd compression not available:" << archive_error_string(a);
+        return false;
+    }
+
+    // Levels, workers and window are cut down to what fits the budget; the
+    // window is also what a restore needs to decode the archive
+    MemoryBudget budget(options.memoryBudget);
+    int level = budget.zstdLevel(options.level);
+    int windowLog = options.longDistance ? budget.zstdLongWindowLog(level) : 0;
+    int threads = budget.zstdThreads(options.threads > 0 ? options.threads : QThread::idealThreadCount(),
+                                     level, windowLog);
+    if (level != options.level) {
+        qWarning() << "zstd level" << options.level << "needs more than the memory budget, using" << level;
+    }
+    QString filterOpts = QString("zstd:compression-level=%1,zstd:threads=%2").arg(level).arg(threads);
+    if (windowLog > 0) {
+        // At most 128 MiB: the largest zstd decoders accept without extra flags
+        filterOpts += QString(",zstd:long=%1").arg(windowLog);
+    }
+    if (archive_write_set_options(a, filterOpts.toUtf8().constData()) != ARCHIVE_OK) {
+        // Older libarchive lacks threads/long; fall back to the level alone
+        qWarning() << "zstd options not fully supported:" << archive_error_string(a);
+        filterOpts = QString("zstd:compression-level=%1").arg(level);
+        return archive_write_set_options(a, filterOpts.toUtf8().constData()) == ARCHIVE_OK;
+    }
+    return true;
+}
+
+struct archive *SaveManager::openArchiveForReading(const QString &archivePath)
+{
+    // The filter is detected from the stream, so .tar.gz and .tar.zst both work
+    struct archive *a = archive_read_new();
+    archive_read_support_filter_gzip(a);
+    archive_read_support_filter_zstd(a);
+    archive_read_support_format_tar(a);
+
+    if (archive_read_open_filename(a, archivePath.toLocal8Bit().constData(), 10240) != ARCHIVE_OK) {
+        qWarning() << "Failed to open archive:" << archive_error_string(a);
+        archive_read_free(a);
+        return nullptr;
     }
+    return a;
 }
 
 bool SaveManager::compressDirectory(const QString &sourceDir, const QString &archivePath,
-                                     int compressionLevel)
+                                     const CompressionOptions &options, ArchiveRecord *record,
+                                     TransferProgress &progress)
 {
     QFileInfo sourceInfo(sourceDir);
     if (!sourceInfo.exists() || !sourceInfo.isDir()) {
@@ -556,19 +2118,14 @@ bool SaveManager::compressDirectory(const QString &sourceDir, const QString &arc
         return false;
     }
 
-    struct archive *a = archive_write_new();
-    archive_write_add_filter_gzip(a);
-    archive_write_set_format_pax_restricted(a);
-
-    // Set compression level
-    QString filterOpts = QString("gzip:compression-level=%1").arg(compressionLevel);
-    archive_write_set_options(a, filterOpts.toUtf8().constData());
-
-    if (archive_write_open_filename(a, archivePath.toLocal8Bit().constData()) != ARCHIVE_OK) {
-        qWarning() << "Failed to open archive for writing:" << archive_error_string(a);
-        archive_write_free(a);
+    std::unique_ptr<ParallelGzipWriter> gzipWriter;
+    struct archive *a = openArchiveForWriting(archivePath, options, gzipWriter);
+    if (!a) {
         return false;
     }
+    if (record) {
+        record->gzip = gzipWriter.get();
+    }
 
     // Use the directory name as the top-level entry (like tar does)
     QString dirName = sourceInfo.fileName();
@@ -581,36 +2138,51 @@ bool SaveManager::compressDirectory(const QString &sourceDir, const QString &arc
     archive_entry_set_perm(dirEntry, 0755);
     archive_entry_set_mtime(dirEntry, sourceInfo.lastModified().toSecsSinceEpoch(), 0);
     archive_write_header(a, dirEntry);
+    recordEntry(record, dirEntry);
     archive_entry_free(dirEntry);
 
     // Add all contents under the directory name prefix.
     // We use parentDir as baseDir and dirName as the relative prefix so that
     // addDirectoryToArchive produces paths like "dirName/subdir/file.txt".
-    addDirectoryToArchive(a, parentDir, dirName);
+    BatchFileReader reader(options.batchedReads, readQueueDepth(options));
+    bool added = addDirectoryToArchive(a, reader, parentDir, dirName, record, progress);
 
-    archive_write_close(a);
+    // Closing after a cancel only flushes what is already in flight
+    bool ok = archive_write_close(a) == ARCHIVE_OK;
+    if (!ok) {
+        qWarning() << "Failed to finish archive:" << archive_error_string(a);
+    }
     archive_write_free(a);
-    return true;
+    finishRecord(record, gzipWriter.get());
+    ok = ok && added;
+    if (!ok) {
+        QFile::remove(archivePath);
+    }
+    return ok;
 }
 
 bool SaveManager::compressFiles(const QString &baseDir, const QStringList &relativePaths,
-                                const QString &archivePath, int compressionLevel)
+                                const QString &archivePath, const CompressionOptions &options,
+                                ArchiveRecord *record, TransferProgress &progress)
 {
-    struct archive *a = archive_write_new();
-    archive_write_add_filter_gzip(a);
-    archive_write_set_format_pax_restricted(a);
-
-    QString filterOpts = QString("gzip:compression-level=%1").arg(compressionLevel);
-    archive_write_set_options(a, filterOpts.toUtf8().constData());
-
-    if (archive_write_open_filename(a, archivePath.toLocal8Bit().constData()) != ARCHIVE_OK) {
-        qWarning() << "Failed to open archive for writing:" << archive_error_string(a);
-        archive_write_free(a);
+    std::unique_ptr<ParallelGzipWriter> gzipWriter;
+    struct archive *a = openArchiveForWriting(archivePath, options, gzipWriter);
+    if (!a) {
         return false;
     }
+    if (record) {
+        record->gzip = gzipWriter.get();
+    }
 
+    BatchFileReader reader(options.batchedReads, readQueueDepth(options));
     int filesAdded = 0;
+    bool added = true;
     for (const QString &relPath : relativePaths) {
+        if (progress.isCancelled()) {
+            added = false;
+            break;
+        }
+
         QString fullPath = baseDir + "/" + relPath;
         QFileInfo fi(fullPath);
         if (!fi.exists()) {
@@ -618,24 +2190,13 @@ bool SaveManager::compressFiles(const QString &baseDir, const QStringList &relat
             continue;
         }
 
-        if (fi.isFile()) {
-            struct archive_entry *entry = archive_entry_new();
-            archive_entry_set_pathname(entry, relPath.toUtf8().constData());
-            archive_entry_set_filetype(entry, AE_IFREG);
-            archive_entry_set_perm(entry, fi.isExecutable() ? 0755 : 0644);
-            archive_entry_set_size(entry, fi.size());
-            archive_entry_set_mtime(entry, fi.lastModified().toSecsSinceEpoch(), 0);
-            archive_write_header(a, entry);
-
-            QFile file(fullPath);
-            if (file.open(QIODevice::ReadOnly)) {
-                char buf[8192];
-                qint64 bytesRead;
-                while ((bytesRead = file.read(buf, sizeof(buf))) > 0) {
-                    archive_write_data(a, buf, static_cast<size_t>(bytesRead));
-                }
+        DirWalker::FileStat st;
+        if (fi.isFile() && DirWalker::stat(fullPath, &st, true)) {
+            reader.enqueue(fullPath, st.size);
+            if (!addFileToArchive(a, reader, st, fullPath, relPath, record, progress)) {
+                added = false;
+                break;
             }
-            archive_entry_free(entry);
             filesAdded++;
         } else if (fi.isDir()) {
             struct archive_entry *entry = archive_entry_new();
@@ -644,16 +2205,28 @@ bool SaveManager::compressFiles(const QString &baseDir, const QStringList &relat
             archive_entry_set_perm(entry, 0755);
             archive_entry_set_mtime(entry, fi.lastModified().toSecsSinceEpoch(), 0);
             archive_write_header(a, entry);
+            recordEntry(record, entry);
             archive_entry_free(entry);
 
-            addDirectoryToArchive(a, baseDir, relPath);
+            if (!addDirectoryToArchive(a, reader, baseDir, relPath, record, progress)) {
+                added = false;
+                break;
+            }
             filesAdded++;
         }
     }
 
-    archive_write_close(a);
+    bool ok = archive_write_close(a) == ARCHIVE_OK;
+    if (!ok) {
+        qWarning() << "Failed to finish archive:" << archive_error_string(a);
+    }
     archive_write_free(a);
+    finishRecord(record, gzipWriter.get());
 
+    if (!ok || !added) {
+        QFile::remove(archivePath);
+        return false;
+    }
     if (filesAdded == 0) {
         qWarning() << "No profile files found on disk";
         QFile::remove(archivePath);
@@ -663,30 +2236,39 @@ bool SaveManager::compressFiles(const QString &baseDir, const QStringList &relat
     return true;
 }
 
-bool SaveManager::extractArchive(const QString &archivePath, const QString &targetDir)
+bool SaveManager::extractArchive(const QString &archivePath, const QString &targetDir,
+                                 TransferProgress &progress, const QStringList &paths)
 {
     QDir().mkpath(targetDir);
 
-    struct archive *a = archive_read_new();
-    archive_read_support_filter_gzip(a);
-    archive_read_support_format_tar(a);
+    struct archive *a = openArchiveForReading(archivePath);
+    if (!a) {
+        return false;
+    }
 
     struct archive *ext = archive_write_disk_new();
     archive_write_disk_set_options(ext, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
     archive_write_disk_set_standard_lookup(ext);
 
-    if (archive_read_open_filename(a, archivePath.toLocal8Bit().constData(), 10240) != ARCHIVE_OK) {
-        qWarning() << "Failed to open archive:" << archive_error_string(a);
-        archive_read_free(a);
-        archive_write_free(ext);
-        return false;
-    }
-
     bool success = true;
     struct archive_entry *entry;
     while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+        if (progress.isCancelled()) {
+            success = false;
+            break;
+        }
+
+        QString name = QString::fromUtf8(archive_entry_pathname(entry));
+        if (name.endsWith('/')) {
+            name.chop(1);
+        }
+        if (!ArchiveIndex::isSelected(name, paths)) {
+            archive_read_data_skip(a);
+            continue;
+        }
+
         // Prepend target directory to entry pathname
-        QString entryPath = targetDir + "/" + QString::fromUtf8(archive_entry_pathname(entry));
+        QString entryPath = targetDir + "/" + name;
         archive_entry_set_pathname(entry, entryPath.toLocal8Bit().constData());
 
         int r = archive_write_header(ext, entry);
@@ -706,14 +2288,21 @@ bool SaveManager::extractArchive(const QString &archivePath, const QString &targ
                     success = false;
                     break;
                 }
+                if (!progress.addBytes(static_cast<qint64>(size))) {
+                    success = false;
+                    break;
+                }
             }
         }
         archive_write_finish_entry(ext);
+        if (archive_entry_filetype(entry) == AE_IFREG) {
+            progress.addFile();
+        }
 
         if (!success) break;
     }
 
-    if (archive_errno(a) != 0) {
+    if (success && archive_errno(a) != 0) {
         qWarning() << "Archive read error:" << archive_error_string(a);
         success = false;
     }
@@ -723,11 +2312,69 @@ bool SaveManager::extractArchive(const QString &archivePath, const QString &targ
     return success;
 }
 
+bool SaveManager::checkArchiveContent(const QString &archivePath, const FileChecksums &checksums,
+                                      TransferProgress &progress)
+{
+    struct archive *a = openArchiveForReading(archivePath);
+    if (!a) {
+        return false;
+    }
+
+    bool valid = true;
+    int checked = 0;
+    struct archive_entry *entry;
+    while (valid && archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+        if (archive_entry_filetype(entry) != AE_IFREG) {
+            continue;
+        }
+
+        FileChecksums::Hasher hasher;
+        const void *buff;
+        size_t size;
+        la_int64_t offset;
+        int r;
+        while ((r = archive_read_data_block(a, &buff, &size, &offset)) == ARCHIVE_OK) {
+            hasher.addData(static_cast<const char *>(buff), static_cast<qint64>(size));
+            if (!progress.addBytes(static_cast<qint64>(size))) {
+                valid = false;
+                break;
+            }
+        }
+        if (r < ARCHIVE_WARN) {
+            valid = false;
+        }
+        progress.addFile();
+
+        if (valid && !checksums.isEmpty()) {
+            QString path = QString::fromUtf8(archive_entry_pathname(entry));
+            QByteArray expected = checksums.value(path);
+            if (expected.isEmpty() || expected != hasher.result()) {
+                qWarning() << "Checksum mismatch in" << archivePath << "for" << path;
+                valid = false;
+            }
+            checked++;
+        }
+    }
+
+    if (valid && archive_errno(a) != 0) {
+        qWarning() << "Archive read error:" << archive_error_string(a);
+        valid = false;
+    }
+    // A truncated archive can end cleanly on an entry boundary
+    if (valid && checked != checksums.size()) {
+        qWarning() << "Archive is missing files:" << archivePath;
+        valid = false;
+    }
+    archive_read_free(a);
+    return valid;
+}
+
 bool SaveManager::restoreProfileBackup(const BackupInfo &backup, const QString &targetPath)
 {
     QDir().mkpath(targetPath);
 
-    if (!extractArchive(backup.archivePath, targetPath)) {
+    TransferProgress progress;
+    if (!extractBackupData(backup, targetPath, getChunkStoreDir(), progress)) {
         emit error("Failed to restore profile backup");
         return false;
     }
@@ -736,86 +2383,508 @@ bool SaveManager::restoreProfileBackup(const BackupInfo &backup, const QString &
     return true;
 }
 
-bool SaveManager::copyDirectory(const QString &source, const QString &destination)
+namespace {
+
+// Restore into the directory a symlinked save dir points to, keeping the link
+QString resolveRestoreTarget(const QString &targetPath)
+{
+    QFileInfo info(targetPath);
+    if (info.isSymLink() && info.exists()) {
+        return info.canonicalFilePath();
+    }
+    return targetPath;
+}
+
+} // namespace
+
+QString SaveManager::restoreStagingDir(const QString &targetPath)
+{
+    // A hidden sibling of the target: same filesystem, so the swap is a rename
+    QFileInfo target(resolveRestoreTarget(targetPath));
+    return QString("%1/.%2.restore-%3").arg(target.absolutePath(), target.fileName())
+        .arg(QDateTime::currentMSecsSinceEpoch());
+}
+
+bool SaveManager::canSwapInto(const QString &targetPath)
+{
+    return !FileCopy::isMountPoint(resolveRestoreTarget(targetPath));
+}
+
+bool SaveManager::swapIntoPlace(const QString &stagingDir, const QString &requestedTarget,
+                                QString *previousTree)
 {
-    QDir sourceDir(source);
-    if (!sourceDir.exists()) {
+    QString targetPath = resolveRestoreTarget(requestedTarget);
+
+    // Archives of full backups hold a single top-level directory named after
+    // the save dir; its contents become the target
+    QString stagedDir = stagingDir + "/restore";
+    QStringList entries = QDir(stagedDir).entryList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden);
+    if (entries.size() == 1 && QFileInfo(stagedDir + "/" + entries.first()).isDir()) {
+        stagedDir += "/" + entries.first();
+    }
+
+    QFileInfo target(targetPath);
+    if (!target.exists()) {
+        QDir().mkpath(target.absolutePath());
+        return QDir().rename(stagedDir, targetPath);
+    }
+
+#if defined(Q_OS_LINUX) && defined(SYS_renameat2)
+    // Atomic exchange: the old tree lands where the staged one was
+    QByteArray from = QFile::encodeName(stagedDir);
+    QByteArray to = QFile::encodeName(targetPath);
+    if (::syscall(SYS_renameat2, AT_FDCWD, from.constData(), AT_FDCWD, to.constData(), RENAME_EXCHANGE) == 0) {
+        if (previousTree) {
+            *previousTree = stagedDir;
+        }
+        return true;
+    }
+    // EINVAL/ENOSYS: filesystem or kernel without exchange support
+    qWarning() << "renameat2 exchange failed, falling back to rename:" << strerror(errno);
+#endif
+
+    // Two renames; the target is briefly missing but never half-written
+    QString previous = stagingDir + "/previous";
+    if (!QDir().rename(targetPath, previous)) {
+        qWarning() << "Failed to move aside existing save directory:" << targetPath;
         return false;
     }
+    if (!QDir().rename(stagedDir, targetPath)) {
+        qWarning() << "Failed to move restored directory into place:" << targetPath;
+        QDir().rename(previous, targetPath);
+        return false;
+    }
+    if (previousTree) {
+        *previousTree = previous;
+    }
+    return true;
+}
 
-    QDir destDir(destination);
-    if (!destDir.exists()) {
-        if (!QDir().mkpath(destination)) {
-            return false;
+void SaveManager::removeInBackground(const QString &path)
+{
+    QThreadPool::globalInstance()->start([path]() {
+        if (!QDir(path).removeRecursively()) {
+            qWarning() << "Failed to clean up" << path;
         }
+    });
+}
+
+bool SaveManager::takeSafetySnapshot(const QString &targetPath, bool hardLinks, QString *snapshotDir,
+                                     TransferProgress &progress)
+{
+    QString source = resolveRestoreTarget(targetPath);
+    if (!QFileInfo(source).isDir()) {
+        return true;  // nothing to lose
+    }
+
+    SafetySnapshot snapshot;
+    snapshot.targetPath = targetPath;
+    snapshot.path = SafetySnapshot::newPath(source);
+    if (!SafetySnapshot::cloneTree(source, snapshot.treePath(), hardLinks, progress)) {
+        QDir(snapshot.path).removeRecursively();
+        return false;
     }
+    *snapshotDir = snapshot.path;
+    return true;
+}
 
-    QStringList entries = sourceDir.entryList(QDir::NoDotAndDotDot | QDir::AllEntries);
+void SaveManager::keepSafetySnapshot(const BackupInfo &backup, const QString &targetPath,
+                                     const QString &snapshotDir)
+{
+    if (snapshotDir.isEmpty()) {
+        return;
+    }
 
-    for (const QString &entry : entries) {
-        QString srcPath = source + "/" + entry;
-        QString dstPath = destination + "/" + entry;
+    SafetySnapshot previous = SafetySnapshot::load(m_backupDir, backup.gameId);
+    if (!previous.path.isEmpty() && previous.path != snapshotDir) {
+        removeInBackground(previous.path);
+    }
 
-        QFileInfo info(srcPath);
+    SafetySnapshot snapshot;
+    snapshot.gameId = backup.gameId;
+    snapshot.targetPath = targetPath;
+    snapshot.path = snapshotDir;
+    snapshot.backupName = backup.displayName;
+    snapshot.created = QDateTime::currentDateTime();
+    if (!snapshot.save(m_backupDir)) {
+        qWarning() << "Failed to record safety snapshot" << snapshotDir;
+        removeInBackground(snapshotDir);
+        return;
+    }
+    emit safetySnapshotChanged(backup.gameId);
+    expireSafetySnapshots();
+}
 
-        if (info.isDir()) {
-            if (!copyDirectory(srcPath, dstPath)) {
-                return false;
-            }
-        } else {
-            if (!QFile::copy(srcPath, dstPath)) {
-                return false;
+void SaveManager::adoptReplacedTree(const BackupInfo &backup, const QString &targetPath,
+                                    const QString &previousTree)
+{
+    if (!m_safetySnapshots || previousTree.isEmpty()) {
+        return;
+    }
+
+    // Sibling of the target like the staging dir, so this is a rename
+    SafetySnapshot snapshot;
+    snapshot.targetPath = targetPath;
+    snapshot.path = SafetySnapshot::newPath(resolveRestoreTarget(targetPath));
+    QDir().mkpath(snapshot.path + "/restore");
+    if (!QDir().rename(previousTree, snapshot.treePath())) {
+        qWarning() << "Failed to keep replaced save files as a safety snapshot";
+        QDir(snapshot.path).removeRecursively();
+        return;
+    }
+    keepSafetySnapshot(backup, targetPath, snapshot.path);
+}
+
+SafetySnapshot SaveManager::safetySnapshot(const QString &gameId) const
+{
+    SafetySnapshot snapshot = SafetySnapshot::load(m_backupDir, gameId);
+    if (!snapshot.isValid() || snapshot.isExpired(QDateTime::currentDateTime())) {
+        return SafetySnapshot();
+    }
+    return snapshot;
+}
+
+void SaveManager::expireSafetySnapshots()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    const QList<SafetySnapshot> snapshots = SafetySnapshot::loadAll(m_backupDir);
+    for (const SafetySnapshot &snapshot : snapshots) {
+        if (snapshot.isValid() && !snapshot.isExpired(now)) {
+            continue;
+        }
+        if (!snapshot.path.isEmpty() && QFileInfo::exists(snapshot.path)) {
+            removeInBackground(snapshot.path);
+        }
+        if (!snapshot.gameId.isEmpty()) {
+            SafetySnapshot::remove(m_backupDir, snapshot.gameId);
+            emit safetySnapshotChanged(snapshot.gameId);
+        }
+    }
+}
+
+bool SaveManager::undoRestore(const QString &gameId)
+{
+    SafetySnapshot snapshot = safetySnapshot(gameId);
+    if (!snapshot.isValid()) {
+        emit error("There is no restore to undo");
+        return false;
+    }
+
+    bool ok = canSwapInto(snapshot.targetPath) ? swapIntoPlace(snapshot.path, snapshot.targetPath)
+                                               : putBackSnapshot(snapshot);
+    return finishUndoRestore(snapshot, ok);
+}
+
+quint64 SaveManager::undoRestoreAsync(const QString &gameId)
+{
+    SafetySnapshot snapshot = safetySnapshot(gameId);
+    if (!snapshot.isValid()) {
+        emit error("There is no restore to undo");
+        return 0;
+    }
+
+    // A mount point cannot be swapped, so its files are copied back in the
+    // job; everything else is a rename in the done callback
+    bool swap = canSwapInto(snapshot.targetPath);
+    auto result = std::make_shared<AsyncResult>();
+
+    emit operationStarted("Undoing restore...");
+
+    return m_scheduler.submit(JobScheduler::Manual, gameId,
+        [result, snapshot, swap](JobContext &) {
+            result->success = swap || putBackSnapshot(snapshot);
+        },
+        [this, result, snapshot, swap](const JobContext &job) {
+            bool ok = result->success;
+            if (ok && swap) {
+                ok = swapIntoPlace(snapshot.path, snapshot.targetPath);
             }
+            finishUndoRestore(snapshot, ok);
+            emit jobFinished(job.id());
+        });
+}
+
+bool SaveManager::putBackSnapshot(const SafetySnapshot &snapshot)
+{
+    QString target = resolveRestoreTarget(snapshot.targetPath);
+    QString tree = snapshot.treePath();
+
+    // Files the restore added go first, then the snapshot is moved back
+    QStringList added;
+    QDirIterator it(target, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QFileInfo info = it.fileInfo();
+        if (info.isDir() && !info.isSymLink()) {
+            continue;
         }
+        QFileInfo kept(tree + "/" + QDir(target).relativeFilePath(path));
+        if (!kept.exists() && !kept.isSymLink()) {
+            added.append(path);
+        }
+    }
+    for (const QString &path : std::as_const(added)) {
+        QFile::remove(path);
     }
+    return moveIntoPlace(tree, false, target);
+}
 
+bool SaveManager::finishUndoRestore(const SafetySnapshot &snapshot, bool ok)
+{
+    if (!ok) {
+        emit error("Failed to undo the restore");
+        return false;
+    }
+    // The snapshot dir now holds the save files the undone restore wrote
+    SafetySnapshot::remove(m_backupDir, snapshot.gameId);
+    removeInBackground(snapshot.path);
+    emit safetySnapshotChanged(snapshot.gameId);
+    emit restoreUndone(snapshot.gameId);
     return true;
 }
 
-bool SaveManager::removeDirectory(const QString &path)
+bool SaveManager::moveIntoPlace(const QString &extractDir, bool fullBackup, const QString &targetPath)
 {
-    QDir dir(path);
-    return dir.removeRecursively();
+    // Full backups hold the save dir itself as the single top-level entry
+    QString root = extractDir;
+    if (fullBackup) {
+        QStringList top = QDir(extractDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden);
+        if (top.size() == 1) {
+            root += "/" + top.first();
+        }
+    }
+
+    QString target = resolveRestoreTarget(targetPath);
+    QDir().mkpath(target);
+
+    QStringList restored;
+    QDirIterator it(root, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        restored.append(it.next());
+    }
+
+    // Rename each file over its live copy, so no file is ever half-written
+    bool ok = true;
+    for (const QString &path : std::as_const(restored)) {
+        QFileInfo info(path);
+        QString dest = target + "/" + QDir(root).relativeFilePath(path);
+        if (info.isDir() && !info.isSymLink()) {
+            QDir().mkpath(dest);
+            continue;
+        }
+        QDir().mkpath(QFileInfo(dest).absolutePath());
+        std::error_code ec;
+        std::filesystem::rename(QFile::encodeName(path).toStdString(), QFile::encodeName(dest).toStdString(), ec);
+        // Part of the target is another filesystem (a mount point, or the
+        // whole save dir); copy there instead, still replacing atomically
+        if (ec == std::errc::cross_device_link && FileCopy::copyFile(path, dest)) {
+            continue;
+        }
+        if (ec) {
+            qWarning() << "Failed to move restored file into place:" << dest << ec.message().c_str();
+            ok = false;
+        }
+    }
+    return ok;
 }
 
-qint64 SaveManager::getDirectorySize(const QString &path) const
+bool SaveManager::runDifferentialRestore(const BackupInfo &backup, const QString &targetPath,
+                                         const QString &chunkStoreDir, TransferProgress &progress,
+                                         RestoreReport *report, QString *errorMessage)
 {
-    qint64 size = 0;
-    QDir dir(path);
+    bool ok = false;
+    const QList<BackupEntry> contents = loadBackupContents(backup, &ok);
+    if (!ok || contents.isEmpty()) {
+        *errorMessage = "Failed to read backup contents";
+        return false;
+    }
+
+    // Compare paths relative to the target: full backups name their top
+    // directory after the save dir they came from, which may differ
+    bool full = backup.profileId == -1;
+    QString archivePrefix;
+    if (full) {
+        archivePrefix = contents.first().path.section('/', 0, 0) + "/";
+    }
+    QHash<QString, const BackupEntry *> wanted;
+    QStringList wantedOrder;
+    for (const BackupEntry &entry : contents) {
+        if (!entry.path.startsWith(archivePrefix) || entry.path.size() == archivePrefix.size()) {
+            continue;
+        }
+        QString path = entry.path.mid(archivePrefix.size());
+        wanted.insert(path, &entry);
+        wantedOrder.append(path);
+    }
+
+    // The fingerprint taken at backup time lets files that were not touched
+    // since skip hashing, so matching trees cost one stat() per file
+    QString target = resolveRestoreTarget(targetPath);
+    QString liveBase = target;
+    QString livePrefix;
+    QStringList liveRoots;
+    if (full) {
+        QFileInfo info(target);
+        liveBase = info.absolutePath();
+        liveRoots.append(info.fileName());
+        livePrefix = info.fileName() + "/";
+    } else {
+        for (const QString &path : std::as_const(wantedOrder)) {
+            if (!wanted.contains(path.section('/', 0, -2))) {
+                liveRoots.append(path);
+            }
+        }
+    }
+    FileManifest live = FileManifest::scan(liveBase, liveRoots,
+                                           FileManifest::load(backup.archivePath + ".files"));
+    QHash<QString, const FileManifest::Entry *> present;
+    QStringList presentOrder;
+    for (const FileManifest::Entry &entry : live.entries()) {
+        if (!entry.path.startsWith(livePrefix) || entry.path.size() == livePrefix.size()) {
+            continue;
+        }
+        QString path = entry.path.mid(livePrefix.size());
+        present.insert(path, &entry);
+        presentOrder.append(path);
+    }
+
+    auto matches = [&](const BackupEntry &entry, const FileManifest::Entry &current) {
+        if (entry.type != current.type) {
+            return false;
+        }
+        if (entry.type == "symlink") {
+            std::error_code ec;
+            auto link = std::filesystem::read_symlink(QFile::encodeName(liveBase + "/" + current.path).toStdString(), ec);
+            return !ec && QFile::decodeName(link.c_str()) == entry.linkTarget;
+        }
+        if (entry.type == "file") {
+            if (entry.size != current.size) {
+                return false;
+            }
+            // Backups without hashes fall back to the mtime tar restores
+            if (entry.hash.isEmpty()) {
+                return current.mtimeMs / 1000 == entry.mtime.toSecsSinceEpoch();
+            }
+            return entry.hash == current.hash;
+        }
+        return true;
+    };
+
+    RestoreReport result;
+    QStringList changed;
+    QStringList inTheWay;
+    qint64 changedBytes = 0;
+    for (const QString &path : std::as_const(wantedOrder)) {
+        const BackupEntry *entry = wanted.value(path);
+        const FileManifest::Entry *current = present.value(path);
+        if (current && matches(*entry, *current)) {
+            if (entry->type != "dir") {
+                ++result.unchanged;
+            }
+            continue;
+        }
+        if (current) {
+            inTheWay.append(path);
+        }
+        if (entry->type != "dir") {
+            changed.append(archivePrefix + path);
+            result.written.append(path);
+            changedBytes += entry->size;
+        }
+    }
 
-    QStringList entries = dir.entryList(QDir::NoDotAndDotDot | QDir::AllEntries);
+    // Profile restores never delete, as in a regular restore
+    if (full) {
+        for (const QString &path : std::as_const(presentOrder)) {
+            bool belowRemoved = !result.removed.isEmpty() && path.startsWith(result.removed.last() + "/");
+            if (!wanted.contains(path) && !belowRemoved) {
+                result.removed.append(path);
+            }
+        }
+    }
 
-    for (const QString &entry : entries) {
-        QString entryPath = path + "/" + entry;
-        QFileInfo info(entryPath);
+    // Extract first: until the changed files are staged nothing live is
+    // touched, so failing or cancelling here leaves the save as it was
+    QString stagingDir = restoreStagingDir(targetPath);
+    if (!changed.isEmpty()) {
+        progress.setTotals(changedBytes, changed.size());
+        if (!extractBackupPaths(backup, changed, stagingDir + "/restore", chunkStoreDir, progress)) {
+            *errorMessage = "Failed to extract changed files from backup";
+            removeInBackground(stagingDir);
+            return false;
+        }
+    }
 
-        if (info.isDir()) {
-            size += getDirectorySize(entryPath);
-        } else {
-            size += info.size();
+    ok = true;
+    for (const QString &path : result.removed + inTheWay) {
+        QString livePath = target + "/" + path;
+        QFileInfo info(livePath);
+        if (!info.exists() && !info.isSymLink()) {
+            continue; // went with a directory removed before it
         }
+        bool removed = info.isDir() && !info.isSymLink() ? QDir(livePath).removeRecursively()
+                                                         : QFile::remove(livePath);
+        if (!removed) {
+            qWarning() << "Failed to remove" << livePath;
+            ok = false;
+        }
+    }
+    for (const QString &path : std::as_const(wantedOrder)) {
+        if (wanted.value(path)->type == "dir") {
+            QDir().mkpath(target + "/" + path);
+        }
+    }
+    if (!changed.isEmpty()) {
+        ok = moveIntoPlace(stagingDir + "/restore", full, targetPath) && ok;
+        removeInBackground(stagingDir);
     }
 
+    *report = result;
+    if (!ok) {
+        *errorMessage = "Failed to restore some files to the target location";
+    }
+    return ok;
+}
+
+bool SaveManager::removeDirectory(const QString &path)
+{
+    QDir dir(path);
+    return dir.removeRecursively();
+}
+
+qint64 SaveManager::getDirectorySize(const QString &path) const
+{
+    qint64 size = 0;
+    DirWalker::walk(path, [&size](const DirWalker::Entry &entry) {
+        size += entry.size;
+        return DirWalker::Continue;
+    }, DirWalker::Unsorted);
     return size;
 }
 
-bool SaveManager::saveBackupMetadata(const BackupInfo &backup)
+bool SaveManager::saveBackupMetadata(const BackupInfo &backup, const FileChecksums *checksums)
 {
-    QJsonObject obj;
-    obj["id"] = backup.id;
-    obj["gameId"] = backup.gameId;
-    obj["gameName"] = backup.gameName;
-    obj["displayName"] = backup.displayName;
-    obj["notes"] = backup.notes;
-    obj["timestamp"] = backup.timestamp.toString(Qt::ISODate);
-    obj["archivePath"] = backup.archivePath;
-    obj["size"] = backup.size;
-    obj["profileName"] = backup.profileName;
-    obj["profileId"] = backup.profileId;
+    QJsonObject obj = BackupCatalog::toJson(backup);
 
+    QString metadataPath = backup.archivePath + ".json";
+    if (checksums) {
+        if (!checksums->isEmpty()) {
+            obj["checksums"] = checksums->toJson();
+        }
+    } else {
+        // Renames and notes edits keep the checksums from backup time
+        QFile existing(metadataPath);
+        if (existing.open(QIODevice::ReadOnly)) {
+            QJsonObject old = QJsonDocument::fromJson(existing.readAll()).object();
+            if (old.contains("checksums")) {
+                obj["checksums"] = old["checksums"];
+            }
+        }
+    }
     QJsonDocument doc(obj);
 
-    QString metadataPath = backup.archivePath + ".json";
     QFile file(metadataPath);
 
     if (!file.open(QIODevice::WriteOnly)) {
@@ -825,36 +2894,7 @@ bool SaveManager::saveBackupMetadata(const BackupInfo &backup)
     file.write(doc.toJson());
     file.close();
 
+    m_catalog.record(backup, obj.value("checksums"));
     return true;
 }
 
-BackupInfo SaveManager::loadBackupMetadata(const QString &metadataPath) const
-{
-    BackupInfo backup;
-
-    QFile file(metadataPath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return backup;
-    }
-
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    file.close();
-
-    if (!doc.isObject()) {
-        return backup;
-    }
-
-    QJsonObject obj = doc.object();
-    backup.id = obj["id"].toString();
-    backup.gameId = obj["gameId"].toString();
-    backup.gameName = obj["gameName"].toString();
-    backup.displayName = obj["displayName"].toString();
-    backup.notes = obj["notes"].toString();
-    backup.timestamp = QDateTime::fromString(obj["timestamp"].toString(), Qt::ISODate);
-    backup.archivePath = obj["archivePath"].toString();
-    backup.size = obj["size"].toInteger();
-    backup.profileName = obj["profileName"].toString();
-    backup.profileId = obj["profileId"].toInt(-1);
-
-    return backup;
-}
@@ -2,90 +2,400 @@
 #define SAVEMANAGER_H
 
 #include <QObject>
-#include <QFutureWatcher>
 #include <QString>
+#include <QStringList>
 #include <QList>
+#include <QHash>
+#include <QSet>
+#include <atomic>
+#include <memory>
 #include "gameinfo.h"
+#include "archiveindex.h"
+#include "backupbundle.h"
+#include "backupcatalog.h"
+#include "batchfilereader.h"
+#include "dirwalker.h"
+#include "filechecksums.h"
+#include "jobscheduler.h"
+#include "memorybudget.h"
+#include "retentionpolicy.h"
+#include "safetysnapshot.h"
+
+class ParallelGzipWriter;
+class TransferProgress;
+class QFileInfo;
+class QIODevice;
 
 class SaveManager : public QObject {
     Q_OBJECT
 
 public:
+    // Structure walks the archive headers; Content also decompresses every
+    // file and compares it with the checksums recorded at backup time
+    enum VerifyMode {
+        VerifyStructure,
+        VerifyContent,
+    };
+
+    // Replace swaps a freshly extracted tree in for the save dir; Differential
+    // only rewrites what differs from the save on disk
+    enum RestoreMode {
+        RestoreReplace,
+        RestoreDifferential,
+    };
+
+    // What a differential restore did, with paths relative to the target
+    struct RestoreReport {
+        QStringList written;
+        QStringList removed;
+        int unchanged = 0;
+    };
+
     explicit SaveManager(QObject *parent = nullptr);
 
     void setBackupDirectory(const QString &dir);
     QString getBackupDirectory() const;
+    // SQLite file with the backups table (Database::databasePath()). Without
+    // one, backups are listed from their .json sidecars.
+    void setMetadataDatabase(const QString &path);
+    // Valid range depends on the format: 1-9 for gzip and chunks, 1-19 for zstd
     void setCompressionLevel(int level);
+    int compressionLevel() const;
+    static int maxCompressionLevel(const QString &format);
+    // "tar.gz" (default), "tar.zst", "chunks" for the deduplicating chunk store,
+    // "delta" for binary deltas against the previous backup or "hardlinks" for
+    // uncompressed snapshots that hard-link unchanged files to the previous one
+    void setBackupFormat(const QString &format);
+    QString backupFormat() const;
+    // Worker threads for gzip and zstd (0 = one per core)
+    void setCompressionThreads(int threads);
+    // zstd only
+    void setLongDistanceMatching(bool enabled);
+    // delta only: every Nth backup in a chain is stored in full
+    void setDeltaKeyframeInterval(int interval);
+    // Keep the save files a restore replaces as a SafetySnapshot (default on)
+    void setSafetySnapshots(bool enabled);
+    // tar formats: read small files ahead through io_uring where the kernel
+    // offers it (default on)
+    void setBatchedReads(bool enabled);
+    // Auto-backups run in LowImpactIo background mode (default on), capped
+    // at bytesPerSecond of save data read when set (0 = unlimited). Manual
+    // backups always run at full speed.
+    void setLowImpactAutoBackups(bool enabled);
+    void setBackgroundBandwidthLimit(qint64 bytesPerSecond);
+    // Memory each backup or restore job may hold in buffers (see
+    // MemoryBudget); at least MemoryBudget::MinimumBytes
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
 
     // Synchronous methods
+    // With skipIfUnchanged, no backup is written when the save files match the
+    // fingerprint of the game's latest backup; backupSkipped is emitted instead.
+    // Runs as a manual job and waits for it, queued behind jobs that hold
+    // the game's key or collect chunks.
     bool createBackup(const GameInfo &game, const QString &backupName = QString(),
-                      const QString &notes = QString(), const SaveProfile &profile = SaveProfile());
-    bool restoreBackup(const BackupInfo &backup, const QString &targetPath);
+                      const QString &notes = QString(), const SaveProfile &profile = SaveProfile(),
+                      bool skipIfUnchanged = false);
+    // Differential restores write only files whose size or hash differ and
+    // delete files the backup does not have (full backups only). Each file
+    // is replaced atomically, but unlike a replace not the tree as a whole.
+    bool restoreBackup(const BackupInfo &backup, const QString &targetPath,
+                       RestoreMode mode = RestoreReplace, RestoreReport *report = nullptr);
+    // Restore only the given archive paths (each with everything below it)
+    // over targetPath, which is the save directory as for restoreBackup.
+    // Indexed .tar.gz backups read just the blocks those files live in.
+    bool restoreBackupPaths(const BackupInfo &backup, const QStringList &paths, const QString &targetPath);
     bool deleteBackup(const BackupInfo &backup);
     bool updateBackupMetadata(const BackupInfo &backup);
+    // The game's snapshot from before its last restore; invalid when there
+    // is none or it has expired
+    SafetySnapshot safetySnapshot(const QString &gameId) const;
+    // Puts the snapshot back in place of the save dir and drops it
+    bool undoRestore(const QString &gameId);
+    void expireSafetySnapshots();
 
-    // Async methods
-    void createBackupAsync(const GameInfo &game, const QString &backupName = QString(),
-                           const QString &notes = QString(), const SaveProfile &profile = SaveProfile());
-    void restoreBackupAsync(const BackupInfo &backup, const QString &targetPath);
+    // Async methods: queued on the job scheduler and return the job id (0 if
+    // rejected). Jobs for different games run concurrently.
+    quint64 createBackupAsync(const GameInfo &game, const QString &backupName = QString(),
+                              const QString &notes = QString(), const SaveProfile &profile = SaveProfile(),
+                              bool skipIfUnchanged = false,
+                              JobScheduler::Priority priority = JobScheduler::Manual);
+    quint64 restoreBackupAsync(const BackupInfo &backup, const QString &targetPath,
+                               RestoreMode mode = RestoreReplace);
+    quint64 undoRestoreAsync(const QString &gameId);
     void cancelOperation();
     bool isBusy() const;
+    void setMaxConcurrentJobs(int count);
 
     QList<BackupInfo> getBackupsForGame(const QString &gameId) const;
     BackupInfo getBackupById(const QString &gameId, const QString &backupId) const;
     QStringList getAllGameIdsWithBackups() const;
     QString getGameNameFromBackups(const QString &gameId) const;
-    bool verifyBackup(const BackupInfo &backup);
+    // Aggregates over the backup index, without listing any game
+    QHash<QString, BackupSummary> getBackupSummaries() const;
+    BackupSummary getBackupTotals() const;
+    QStringList getStaleGameIds(const QDateTime &cutoff) const;
+    // Paths are archive paths: full backups have the save dir name on top.
+    // The first call per backup reads its index (or the whole archive) and
+    // caches the listing as <archive>.contents; later calls read the cache.
+    QList<BackupEntry> listBackupContents(const BackupInfo &backup) const;
+    bool verifyBackup(const BackupInfo &backup, VerifyMode mode = VerifyStructure);
+    // Backups of one game are checked in parallel, but never while a job
+    // writes to the game (or, for chunks, collects the store). The result
+    // arrives as backupVerified.
+    quint64 verifyBackupAsync(const BackupInfo &backup, VerifyMode mode = VerifyContent,
+                              JobScheduler::Priority priority = JobScheduler::Manual);
+    QList<quint64> verifyAllBackupsAsync(VerifyMode mode = VerifyContent);
+    // Re-bases the deltas that depend on the backup, deletes it and reports
+    // backupDeleted
+    quint64 deleteBackupAsync(const BackupInfo &backup);
+    // Deletes what the policy plans to drop from the game's catalog in one
+    // bulk job (delta chains are re-based first) and reports it as
+    // backupsPruned. Returns 0 when nothing is due.
+    quint64 pruneBackupsAsync(const QString &gameId, const RetentionPolicy &policy);
+    // Trains a ZstdDictionary on the small files in the game's latest
+    // backups and keeps it in the game's backup directory; chunk store
+    // backups of the game compress new chunks with it from then on.
+    // Reports dictionaryTrained.
+    quint64 trainDictionaryAsync(const QString &gameId);
+    bool hasDictionary(const QString &gameId) const;
+    // Chunks already written with it stay readable
+    bool removeDictionary(const QString &gameId);
+
+    // Every backup of the given games (all games when empty) as one
+    // BackupBundle stream, to a file or a pipe
+    bool exportBackups(const QStringList &gameIds, QIODevice *out, BackupBundle::Stats *stats = nullptr);
+    // Merges a bundle into the catalog; backups already here are skipped
+    // without being read. Each backup is verified against the bundle's
+    // checksums before it is added.
+    bool importBackups(QIODevice *in, BackupBundle::Stats *stats = nullptr);
+    // The file is only replaced once the bundle is complete. Reports
+    // backupsExported and backupsImported.
+    quint64 exportBackupsAsync(const QStringList &gameIds, const QString &filePath);
+    quint64 importBackupsAsync(const QString &filePath);
 
 signals:
     void backupCreated(const QString &gameId, const QString &backupId);
+    void backupSkipped(const QString &gameId, const QString &reason);
+    // After backupCreated, for files that were locked or kept changing while
+    // they were read: they are missing from the backup, or stored incomplete
+    void backupIncomplete(const QString &gameId, const QString &backupId, const QStringList &paths);
     void backupRestored(const QString &gameId, const QString &backupId);
+    // Sent before backupRestored by differential restores; paths are
+    // relative to the target
+    void restoreReported(const QString &gameId, const QString &backupId, const QStringList &written,
+                         const QStringList &removed, int unchanged);
+    void restoreUndone(const QString &gameId);
+    // A game's safety snapshot was taken, used up or expired
+    void safetySnapshotChanged(const QString &gameId);
     void backupDeleted(const QString &gameId, const QString &backupId);
     void backupUpdated(const QString &gameId, const QString &backupId);
     void backupVerified(const QString &gameId, const QString &backupId, bool valid);
+    // After backupDeleted for each pruned backup
+    void backupsPruned(const QString &gameId, int count, qint64 freedBytes);
+    void dictionaryTrained(const QString &gameId, qint64 dictionarySize, int sampleCount);
+    void backupsExported(const QString &filePath, int count, qint64 bytes);
+    void backupsImported(int count, int skipped);
+    // operationStarted fires per queued job; operationFinished/Cancelled once
+    // the queue has drained
     void operationStarted(const QString &description);
     void operationFinished();
     void operationCancelled();
+    void jobProgress(quint64 jobId, qint64 done, qint64 total);
+    // Uncompressed bytes read (backup) or written (restore); bytesTotal and
+    // filesTotal are 0 when unknown. Throttled to a few updates per second.
+    void transferProgress(quint64 jobId, qint64 bytesDone, qint64 bytesTotal,
+                          int filesDone, int filesTotal, qint64 bytesPerSecond);
+    void jobFinished(quint64 jobId);
     void error(const QString &message);
 
 private slots:
-    void onAsyncBackupFinished();
-    void onAsyncRestoreFinished();
+    void onSchedulerIdle();
 
 private:
+    struct CompressionOptions {
+        QString format = "tar.gz";
+        int level = 6;
+        int threads = 0;
+        bool longDistance = false;
+        int keyframeInterval = 10;
+        bool batchedReads = true;
+        qint64 memoryBudget = MemoryBudget::DefaultBytes;
+    };
+
+    // What an incremental backup can take from the previous one
+    struct IncrementalBase {
+        QSet<QString> unchangedPaths;
+        QHash<QString, QStringList> knownChunks;
+        QString deltaBasePath;
+        QString linkBasePath;  // previous snapshot to hard-link unchanged files from
+    };
+
+    // Collected while a backup is written
+    struct ArchiveRecord {
+        FileChecksums checksums;             // tar formats only
+        ArchiveIndex index;                  // gzip only
+        ParallelGzipWriter *gzip = nullptr;  // its input count is the tar position
+        qint64 compressionSkipped = 0;       // bytes stored without compression
+        QStringList unreadFiles;             // tar formats: left out or incomplete
+    };
+
     struct AsyncResult {
         bool success = false;
         QString errorMessage;
         BackupInfo backup;
+        qint64 storedSize = 0;
+        qint64 compressionSkipped = 0;
+        QStringList unreadFiles;
+        bool skipped = false;
+        FileChecksums checksums;
+        bool differential = false;
+        RestoreReport restoreReport;
+        QList<BackupInfo> pruned;
+        QList<BackupInfo> rebased;
+        QString snapshotDir;
+        int samples = 0;
+        BackupBundle::Stats bundleStats;
+        QList<BackupInfo> imported;
     };
 
     QString getGameBackupDir(const QString &gameId) const;
-    QString generateBackupId() const;
-    static bool compressDirectory(const QString &sourceDir, const QString &archivePath, int compressionLevel);
+    static QString dictionaryPath(const QString &gameBackupDir);
+    // Oldest first per game, as BackupBundle wants them
+    QList<BackupInfo> bundleBackups(const QStringList &gameIds) const;
+    // Records what an import added
+    void finishImport(const QList<BackupInfo> &imported);
+    // Distinct small files from the newest backups first, up to a budget
+    static QList<QByteArray> collectDictionarySamples(const QList<BackupInfo> &backups,
+                                                      const QString &chunkStoreDir, JobContext &job);
+    static QString generateBackupId();
+    BackupInfo newBackupInfo(const GameInfo &game, const QString &backupName,
+                             const QString &notes, const SaveProfile &profile) const;
+    void finishBackupJob(BackupInfo backup, const AsyncResult &result, const JobContext &job);
+    void finishRestoreJob(const BackupInfo &backup, const QString &targetPath,
+                          const QString &stagingDir, const AsyncResult &result, const JobContext &job);
+    TransferProgress jobTransferProgress(JobContext &job, bool cancellable);
+    QString getChunkStoreDir() const;
+    CompressionOptions compressionOptions() const;
+    static QString archiveSuffix(const QString &format);
+    BackupInfo findPreviousBackup(const QString &gameId, int profileId) const;
+    static void backupLayout(const QString &savePath, int profileId, const QStringList &profileFiles,
+                             QString *baseDir, QStringList *relativePaths);
+    static AsyncResult runBackup(const BackupInfo &backup, const QString &savePath,
+                                 const QStringList &profileFiles, const CompressionOptions &options,
+                                 const QString &chunkStoreDir, const BackupInfo &previous,
+                                 bool skipIfUnchanged, TransferProgress &progress);
+    static bool writeBackupData(const BackupInfo &backup, const QString &savePath,
+                                const QStringList &profileFiles, const CompressionOptions &options,
+                                const QString &chunkStoreDir, qint64 *storedSize,
+                                const IncrementalBase &incremental, ArchiveRecord *record,
+                                TransferProgress &progress);
+    static bool extractBackupData(const BackupInfo &backup, const QString &targetDir,
+                                  const QString &chunkStoreDir, TransferProgress &progress);
+    static QList<BackupEntry> loadBackupContents(const BackupInfo &backup, bool *ok = nullptr);
+    static QList<BackupEntry> scanBackupContents(const BackupInfo &backup, bool *ok);
+    static bool extractBackupPaths(const BackupInfo &backup, const QStringList &paths,
+                                   const QString &targetDir, const QString &chunkStoreDir,
+                                   TransferProgress &progress);
+    static bool checkBackupData(const BackupInfo &backup, VerifyMode mode, const QString &chunkStoreDir,
+                                TransferProgress &progress);
+    void removeBackupFiles(const BackupInfo &backup);
+    // False if the archive or its metadata could not be removed
+    static bool removeArchiveFiles(const QString &archivePath);
+    // Queues removal of chunks no snapshot references, once no job runs
+    void collectChunkGarbage();
+    void submitChunkGarbageCollection();
+    static void removeUnreferencedChunks(const QString &backupDir, const QString &chunkStoreDir);
+    bool rebaseDeltaDependents(const BackupInfo &backup);
+    // Re-encodes the deltas in candidates that are based on backup and
+    // appends them, with their new size, to rebased
+    static bool rebaseDeltaChain(const BackupInfo &backup, const QList<BackupInfo> &candidates,
+                                 const CompressionOptions &options, QList<BackupInfo> *rebased);
+    // Removes doomed in order, re-basing the deltas in remaining that
+    // depend on each; result->pruned and result->rebased receive what was
+    // done, up to a failure or cancel
+    static void removeBackups(const QList<BackupInfo> &doomed, QList<BackupInfo> remaining,
+                              const CompressionOptions &options, JobContext &job, AsyncResult *result);
+    // Catalog, metadata and signals for what removeBackups did; returns the
+    // bytes freed
+    qint64 finishRemovedBackups(const AsyncResult &result);
+    void finishPruneJob(const QString &gameId, const AsyncResult &result, const JobContext &job);
+    static bool setupZstdFilter(struct archive *a, const CompressionOptions &options);
+    // Files BatchFileReader may prefetch within the budget's read-ahead
+    static int readQueueDepth(const CompressionOptions &options);
+    static struct archive *openArchiveForWriting(const QString &archivePath, const CompressionOptions &options,
+                                                 std::unique_ptr<ParallelGzipWriter> &gzipWriter);
+    static struct archive *openArchiveForReading(const QString &archivePath);
+    static bool compressDirectory(const QString &sourceDir, const QString &archivePath,
+                                  const CompressionOptions &options, ArchiveRecord *record,
+                                  TransferProgress &progress);
     static bool compressFiles(const QString &baseDir, const QStringList &relativePaths,
-                              const QString &archivePath, int compressionLevel);
-    static bool extractArchive(const QString &archivePath, const QString &targetDir);
+                              const QString &archivePath, const CompressionOptions &options,
+                              ArchiveRecord *record, TransferProgress &progress);
+    // An empty selection extracts everything
+    static bool extractArchive(const QString &archivePath, const QString &targetDir,
+                               TransferProgress &progress, const QStringList &paths = QStringList());
+    static bool checkArchiveContent(const QString &archivePath, const FileChecksums &checksums,
+                                    TransferProgress &progress);
     bool restoreProfileBackup(const BackupInfo &backup, const QString &targetPath);
-    bool copyDirectory(const QString &source, const QString &destination);
+    static QString restoreStagingDir(const QString &targetPath);
+    static bool moveIntoPlace(const QString &extractDir, bool fullBackup, const QString &targetPath);
+    static bool runDifferentialRestore(const BackupInfo &backup, const QString &targetPath,
+                                       const QString &chunkStoreDir, TransferProgress &progress,
+                                       RestoreReport *report, QString *errorMessage);
+    // False when the save dir is a mount point: it cannot be renamed, so a
+    // full restore into it goes file by file like a differential one
+    static bool canSwapInto(const QString &targetPath);
+    // previousTree receives where the replaced save tree ended up, if any
+    static bool swapIntoPlace(const QString &stagingDir, const QString &targetPath,
+                              QString *previousTree = nullptr);
+    // Clones the live save before a restore writes into it; snapshotDir
+    // stays empty when there is no save yet. Hard links are only safe when
+    // the restore replaces files by rename rather than rewriting them.
+    static bool takeSafetySnapshot(const QString &targetPath, bool hardLinks, QString *snapshotDir,
+                                   TransferProgress &progress);
+    // Makes snapshotDir the game's snapshot, dropping the one before it
+    void keepSafetySnapshot(const BackupInfo &backup, const QString &targetPath, const QString &snapshotDir);
+    // Keeps the tree a full restore swapped out instead of deleting it
+    void adoptReplacedTree(const BackupInfo &backup, const QString &targetPath, const QString &previousTree);
+    static bool putBackSnapshot(const SafetySnapshot &snapshot);
+    bool finishUndoRestore(const SafetySnapshot &snapshot, bool ok);
+    static void removeInBackground(const QString &path);
     bool removeDirectory(const QString &path);
     qint64 getDirectorySize(const QString &path) const;
-    bool saveBackupMetadata(const BackupInfo &backup);
-    BackupInfo loadBackupMetadata(const QString &metadataPath) const;
-    static void addDirectoryToArchive(struct archive *a, const QString &baseDir,
-                                      const QString &relativePath);
+    // Without checksums the ones already in the sidecar are kept
+    bool saveBackupMetadata(const BackupInfo &backup, const FileChecksums *checksums = nullptr);
+    static void recordEntry(ArchiveRecord *record, struct archive_entry *entry);
+    static void finishRecord(ArchiveRecord *record, ParallelGzipWriter *gzipWriter);
+    // Writes the file the reader has next in line
+    // A file that cannot be read in full is tried once more, then left out
+    // (or, if large and already partly written, stored incomplete) and
+    // listed in record's unreadFiles; false only if the archive failed
+    static bool addFileToArchive(struct archive *a, BatchFileReader &reader, DirWalker::FileStat st,
+                                 const QString &filePath, const QString &entryPath, ArchiveRecord *record,
+                                 TransferProgress &progress);
+    static bool addDirectoryToArchive(struct archive *a, BatchFileReader &reader, const QString &baseDir,
+                                      const QString &relativePath, ArchiveRecord *record,
+                                      TransferProgress &progress);
 
     QString m_backupDir;
+    // Listing is const for callers but fills the catalog's cache
+    mutable BackupCatalog m_catalog;
     int m_compressionLevel = 6;
+    QString m_backupFormat = "tar.gz";
+    int m_compressionThreads = 0;
+    bool m_longDistanceMatching = false;
+    int m_deltaKeyframeInterval = 10;
+    bool m_safetySnapshots = true;
+    bool m_batchedReads = true;
+    qint64 m_memoryBudget = MemoryBudget::DefaultBytes;
+    // Read by workers when their job starts
+    std::atomic<qint64> m_backgroundBandwidthLimit{0};
 
     // Async state
-    bool m_busy = false;
-    QFutureWatcher<AsyncResult> m_backupWatcher;
-    QFutureWatcher<AsyncResult> m_restoreWatcher;
-    BackupInfo m_pendingBackup;
-    QString m_pendingRestoreTarget;
-    bool m_pendingIsProfile = false;
-    QString m_pendingTempDir;
-    std::atomic<bool> m_cancelRequested{false};
+    JobScheduler m_scheduler;
+    bool m_jobsCancelled = false;
+    bool m_chunkGcPending = false;
 };
 
 #endif // SAVEMANAGER_H
@@ -0,0 +1,92 @@
+#include "transferprogress.h"
+#include <QThread>
+#include <utility>
+
+TransferProgress::TransferProgress(CancelCheck cancelCheck, Reporter reporter, int intervalMs)
+    : m_cancelCheck(std::move(cancelCheck))
+    , m_reporter(std::move(reporter))
+    , m_intervalMs(intervalMs)
+{
+    m_timer.start();
+}
+
+void TransferProgress::setTotals(qint64 bytes, int files)
+{
+    m_stats.bytesTotal = bytes;
+    m_stats.filesTotal = files;
+    report(true);
+}
+
+void TransferProgress::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    m_bytesPerSecond = qMax<qint64>(0, bytesPerSecond);
+    m_tokens = m_bytesPerSecond / 4.0;
+    m_refillNs = m_timer.nsecsElapsed();
+}
+
+bool TransferProgress::addBytes(qint64 bytes)
+{
+    if (m_bytesPerSecond > 0) {
+        throttle(bytes);
+    }
+    m_stats.bytesDone += bytes;
+    report(false);
+    return !isCancelled();
+}
+
+void TransferProgress::addFile()
+{
+    m_stats.filesDone++;
+    report(false);
+}
+
+bool TransferProgress::isCancelled() const
+{
+    return m_cancelCheck && m_cancelCheck();
+}
+
+void TransferProgress::finish()
+{
+    report(true);
+}
+
+TransferProgress::Stats TransferProgress::stats() const
+{
+    Stats stats = m_stats;
+    stats.elapsedMs = m_timer.elapsed();
+    if (stats.elapsedMs > 0) {
+        stats.bytesPerSecond = stats.bytesDone * 1000 / stats.elapsedMs;
+    }
+    return stats;
+}
+
+void TransferProgress::throttle(qint64 bytes)
+{
+    // Token bucket: refills at the limit and holds at most a quarter second
+    auto refill = [this]() {
+        qint64 now = m_timer.nsecsElapsed();
+        m_tokens = qMin(m_bytesPerSecond / 4.0, m_tokens + double(now - m_refillNs) * m_bytesPerSecond / 1e9);
+        m_refillNs = now;
+    };
+    refill();
+    m_tokens -= double(bytes);
+    while (m_tokens < 0 && !isCancelled()) {
+        // Short sleeps, so a cancel is still noticed within one
+        qint64 waitMs = qint64(-m_tokens * 1000 / m_bytesPerSecond) + 1;
+        QThread::msleep(static_cast<unsigned long>(qMin<qint64>(waitMs, 50)));
+        refill();
+    }
+}
+
+void TransferProgress::report(bool force)
+{
+    if (!m_reporter) {
+        return;
+    }
+    qint64 now = m_timer.elapsed();
+    if (!force && m_lastReportMs >= 0 && now - m_lastReportMs < m_intervalMs) {
+        return;
+    }
+    m_lastReportMs = now;
+    m_reporter(stats());
+}
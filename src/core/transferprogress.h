@@ -0,0 +1,62 @@
+#ifndef TRANSFERPROGRESS_H
+#define TRANSFERPROGRESS_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <functional>
+
+// Byte and file counters for one backup or restore. The worker loop calls
+// addBytes() once per block and stops as soon as it returns false, so a
+// cancelled job gives up its disk and CPU within one block instead of
+// finishing the archive first. Reports are throttled to one per interval.
+//
+// Not thread-safe: owned and updated by the worker thread only. The reporter
+// runs on that thread too and must forward the stats itself.
+class TransferProgress {
+public:
+    struct Stats {
+        qint64 bytesDone = 0;
+        qint64 bytesTotal = 0;  // 0 when unknown
+        int filesDone = 0;
+        int filesTotal = 0;
+        qint64 bytesPerSecond = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    using CancelCheck = std::function<bool()>;
+    using Reporter = std::function<void(const Stats &)>;
+
+    static constexpr int DefaultIntervalMs = 100;
+
+    explicit TransferProgress(CancelCheck cancelCheck = CancelCheck(), Reporter reporter = Reporter(),
+                              int intervalMs = DefaultIntervalMs);
+
+    void setTotals(qint64 bytes, int files);
+    // Caps throughput at bytesPerSecond (0 = unlimited): addBytes() sleeps
+    // once a quarter second's worth of burst is used up
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    // Returns false once the transfer has been cancelled
+    bool addBytes(qint64 bytes);
+    void addFile();
+    bool isCancelled() const;
+    // Sends a final report regardless of the interval
+    void finish();
+
+    Stats stats() const;
+
+private:
+    void report(bool force);
+    void throttle(qint64 bytes);
+
+    CancelCheck m_cancelCheck;
+    Reporter m_reporter;
+    int m_intervalMs;
+    QElapsedTimer m_timer;
+    qint64 m_lastReportMs = -1;
+    Stats m_stats;
+    qint64 m_bytesPerSecond = 0;
+    double m_tokens = 0;
+    qint64 m_refillNs = 0;
+};
+
+#endif // TRANSFERPROGRESS_H
@@ -0,0 +1,192 @@
+#include "zstddictionary.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDebug>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <zstd.h>
+#include <zdict.h>
+
+namespace {
+
+// One context per thread: creating them costs more than compressing a
+// small chunk
+ZSTD_CCtx *threadCCtx()
+{
+    thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    return cctx.get();
+}
+
+ZSTD_DCtx *threadDCtx()
+{
+    thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx *)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    return dctx.get();
+}
+
+} // namespace
+
+struct ZstdDictionary::Data {
+    QByteArray bytes;
+    quint32 id = 0;
+    ZSTD_DDict *ddict = nullptr;
+    // Digested per compression level on first use
+    std::mutex mutex;
+    std::map<int, ZSTD_CDict *> cdicts;
+
+    ~Data()
+    {
+        ZSTD_freeDDict(ddict);
+        for (auto &entry : cdicts) {
+            ZSTD_freeCDict(entry.second);
+        }
+    }
+};
+
+ZstdDictionary::ZstdDictionary() = default;
+
+ZstdDictionary ZstdDictionary::train(const QList<QByteArray> &samples, int capacity, QString *errorString)
+{
+    QByteArray buffer;
+    std::vector<size_t> sizes;
+    for (const QByteArray &sample : samples) {
+        if (!sample.isEmpty() && sample.size() <= MaxSampleSize) {
+            buffer.append(sample);
+            sizes.push_back(static_cast<size_t>(sample.size()));
+        }
+    }
+    if (sizes.size() < size_t(MinSamples)) {
+        if (errorString) {
+            *errorString = QString("Not enough small save files to train a dictionary (%1 found, %2 needed)")
+                               .arg(sizes.size()).arg(MinSamples);
+        }
+        return ZstdDictionary();
+    }
+
+    // A dictionary larger than everything it was trained on cannot help
+    QByteArray dict(qMin<qsizetype>(capacity, buffer.size()), Qt::Uninitialized);
+    size_t size = ZDICT_trainFromBuffer(dict.data(), static_cast<size_t>(dict.size()), buffer.constData(),
+                                        sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size)) {
+        if (errorString) {
+            *errorString = QString("Dictionary training failed: %1").arg(ZDICT_getErrorName(size));
+        }
+        return ZstdDictionary();
+    }
+    dict.resize(static_cast<qsizetype>(size));
+    return fromData(dict);
+}
+
+ZstdDictionary ZstdDictionary::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return ZstdDictionary();
+    }
+    return fromData(file.readAll());
+}
+
+ZstdDictionary ZstdDictionary::fromData(const QByteArray &data)
+{
+    ZstdDictionary dictionary;
+    quint32 id = ZDICT_getDictID(data.constData(), static_cast<size_t>(data.size()));
+    if (id == 0) {
+        // Raw content dictionaries are never produced by train()
+        return dictionary;
+    }
+    ZSTD_DDict *ddict = ZSTD_createDDict(data.constData(), static_cast<size_t>(data.size()));
+    if (!ddict) {
+        return dictionary;
+    }
+    dictionary.d = std::make_shared<Data>();
+    dictionary.d->bytes = data;
+    dictionary.d->id = id;
+    dictionary.d->ddict = ddict;
+    return dictionary;
+}
+
+bool ZstdDictionary::save(const QString &path) const
+{
+    if (isNull()) {
+        return false;
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(d->bytes);
+    return file.commit();
+}
+
+bool ZstdDictionary::isNull() const
+{
+    return !d;
+}
+
+quint32 ZstdDictionary::id() const
+{
+    return d ? d->id : 0;
+}
+
+QByteArray ZstdDictionary::data() const
+{
+    return d ? d->bytes : QByteArray();
+}
+
+QByteArray ZstdDictionary::compress(const char *data, qsizetype size, int level) const
+{
+    if (isNull()) {
+        return QByteArray();
+    }
+
+    ZSTD_CDict *cdict;
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        ZSTD_CDict *&cached = d->cdicts[level];
+        if (!cached) {
+            cached = ZSTD_createCDict(d->bytes.constData(), static_cast<size_t>(d->bytes.size()), level);
+        }
+        cdict = cached;
+    }
+    if (!cdict) {
+        return QByteArray();
+    }
+
+    QByteArray frame(static_cast<qsizetype>(ZSTD_compressBound(static_cast<size_t>(size))), Qt::Uninitialized);
+    size_t written = ZSTD_compress_usingCDict(threadCCtx(), frame.data(), static_cast<size_t>(frame.size()),
+                                              data, static_cast<size_t>(size), cdict);
+    if (ZSTD_isError(written)) {
+        qWarning() << "zstd compression failed:" << ZSTD_getErrorName(written);
+        return QByteArray();
+    }
+    frame.resize(static_cast<qsizetype>(written));
+    return frame;
+}
+
+QByteArray ZstdDictionary::decompress(const char *frame, qsizetype size, qsizetype maxSize, bool *ok) const
+{
+    if (ok) *ok = false;
+    if (isNull()) {
+        return QByteArray();
+    }
+
+    unsigned long long contentSize = ZSTD_getFrameContentSize(frame, static_cast<size_t>(size));
+    if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR
+        || contentSize > static_cast<unsigned long long>(maxSize)) {
+        return QByteArray();
+    }
+
+    QByteArray data(static_cast<qsizetype>(contentSize), Qt::Uninitialized);
+    size_t n = ZSTD_decompress_usingDDict(threadDCtx(), data.data(), static_cast<size_t>(data.size()),
+                                          frame, static_cast<size_t>(size), d->ddict);
+    if (ZSTD_isError(n) || n != contentSize) {
+        return QByteArray();
+    }
+    if (ok) *ok = true;
+    return data;
+}
+
+quint32 ZstdDictionary::frameDictionaryId(const char *frame, qsizetype size)
+{
+    return ZSTD_getDictID_fromFrame(frame, static_cast<size_t>(size));
+}
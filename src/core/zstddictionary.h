@@ -0,0 +1,54 @@
+#ifndef ZSTDDICTIONARY_H
+#define ZSTDDICTIONARY_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <memory>
+
+// A zstd dictionary trained on a game's own save files. Small files
+// compressed one at a time (chunk store chunks) start without any history,
+// so a 2 KiB save slot compresses barely at all; primed with a dictionary of
+// the strings and structures its sibling files share, it compresses like the
+// tail of a large file.
+//
+// Copies share the dictionary and its digested forms. Safe to use from
+// several threads at once.
+class ZstdDictionary {
+public:
+    // zstd's own default: large enough for the shared structure of typical
+    // save formats, small next to the backups it is used for
+    static constexpr int DefaultCapacity = 112640;
+    // Larger files bring their own context and are not worth sampling
+    static constexpr qint64 MaxSampleSize = 128 * 1024;
+    static constexpr int MinSamples = 8;
+
+    ZstdDictionary();
+
+    // Returns a null dictionary, with the reason in errorString, when there
+    // are too few samples or zstd finds nothing worth keeping in them
+    static ZstdDictionary train(const QList<QByteArray> &samples, int capacity = DefaultCapacity,
+                                QString *errorString = nullptr);
+    static ZstdDictionary load(const QString &path);
+    static ZstdDictionary fromData(const QByteArray &data);
+    bool save(const QString &path) const;
+
+    bool isNull() const;
+    // Recorded in every frame compressed with the dictionary
+    quint32 id() const;
+    QByteArray data() const;
+
+    // A complete zstd frame, or an empty array on failure
+    QByteArray compress(const char *data, qsizetype size, int level) const;
+    // Fails on frames that do not record their size or exceed maxSize
+    QByteArray decompress(const char *frame, qsizetype size, qsizetype maxSize, bool *ok = nullptr) const;
+
+    // The dictionary id a frame was compressed with, 0 for none
+    static quint32 frameDictionaryId(const char *frame, qsizetype size);
+
+private:
+    struct Data;
+    std::shared_ptr<Data> d;
+};
+
+#endif // ZSTDDICTIONARY_H
@@ -1,9 +1,16 @@
 #include "ui/mainwindow.h"
 #include "ui/style.h"
+#include "core/database.h"
+#include "core/savemanager.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QSaveFile>
 #include <QStyleFactory>
 #include <QLocalSocket>
+#include <QTextStream>
 #include <csignal>
+#include <cstdio>
 
 static const char *SERVER_NAME = "game-rewind";
 
@@ -12,8 +19,94 @@ static void signalHandler(int)
     QApplication::quit();
 }
 
+static bool isBundleCommand(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        QByteArray arg(argv[i]);
+        if (arg.startsWith("--export-backups") || arg.startsWith("--import-backups")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Headless export/import of backup bundles, for scripts and pipes
+// (game-rewind --export-backups - | ssh host game-rewind --import-backups -)
+static int runBundleCommand(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Game Rewind");
+    app.setOrganizationName("GameRewind");
+    app.setApplicationVersion("0.4.0");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption exportOption("export-backups",
+        "Write every backup as one bundle to <file>, or - for stdout.", "file");
+    QCommandLineOption importOption("import-backups",
+        "Add the backups in bundle <file>, or - for stdin, to the backup directory.", "file");
+    QCommandLineOption gameOption("game", "Export only the backups of game <id> (repeatable).", "id");
+    parser.addOptions({exportOption, importOption, gameOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    Database database;
+    if (!database.open()) {
+        err << "Failed to open the database\n";
+        return 1;
+    }
+    SaveManager manager;
+    manager.setMetadataDatabase(database.databasePath());
+    QString backupDir = database.getSetting("backup_directory");
+    if (!backupDir.isEmpty()) {
+        manager.setBackupDirectory(backupDir);
+    }
+
+    bool ok = false;
+    BackupBundle::Stats stats;
+    if (parser.isSet(exportOption)) {
+        QString path = parser.value(exportOption);
+        if (path == "-") {
+            QFile out;
+            ok = out.open(stdout, QIODevice::WriteOnly)
+                 && manager.exportBackups(parser.values(gameOption), &out, &stats) && out.flush();
+        } else {
+            // Only replaces the file once the bundle is complete
+            QSaveFile out(path);
+            ok = out.open(QIODevice::WriteOnly)
+                 && manager.exportBackups(parser.values(gameOption), &out, &stats) && out.commit();
+        }
+        if (ok) {
+            err << QString("Exported %1 backup(s), %2 file(s), %3 bytes\n")
+                       .arg(stats.backups).arg(stats.files).arg(stats.bytes);
+        } else {
+            err << "Export failed\n";
+        }
+    } else {
+        QString path = parser.value(importOption);
+        QFile in;
+        if (path == "-") {
+            ok = in.open(stdin, QIODevice::ReadOnly);
+        } else {
+            in.setFileName(path);
+            ok = in.open(QIODevice::ReadOnly);
+        }
+        ok = ok && manager.importBackups(&in, &stats);
+        err << QString("Imported %1 backup(s), %2 already present\n").arg(stats.backups).arg(stats.skippedBackups);
+        if (!ok) {
+            err << "Import failed: the bundle is damaged or incomplete\n";
+        }
+    }
+    return ok ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
+    if (isBundleCommand(argc, argv)) {
+        return runBundleCommand(argc, argv);
+    }
+
     Q_INIT_RESOURCE(icons);
     QApplication app(argc, argv);
 
@@ -65,11 +65,12 @@ void BulkBackupDialog::populateList()
 {
     m_treeWidget->clear();
     QDateTime now = QDateTime::currentDateTime();
+    const QHash<QString, BackupSummary> summaries = m_saveManager->getBackupSummaries();
 
     for (const GameInfo &game : m_games) {
         if (!game.isDetected || game.detectedSavePath.isEmpty()) continue;
 
-        QList<BackupInfo> backups = m_saveManager->getBackupsForGame(game.id);
+        BackupSummary summary = summaries.value(game.id);
 
         QTreeWidgetItem *item = new QTreeWidgetItem(m_treeWidget);
         item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
@@ -77,11 +78,11 @@ void BulkBackupDialog::populateList()
         item->setText(0, game.name);
         item->setData(0, Qt::UserRole, game.id);
 
-        if (backups.isEmpty()) {
+        if (summary.count == 0) {
             item->setText(1, "Never");
             item->setText(2, "No backups");
         } else {
-            QDateTime last = backups.first().timestamp;
+            QDateTime last = summary.latest;
             int daysAgo = last.daysTo(now);
             if (daysAgo == 0) {
                 item->setText(1, "Today");
@@ -104,14 +105,15 @@ void BulkBackupDialog::onSelectAll()
 
 void BulkBackupDialog::onSelectStale()
 {
-    QDateTime now = QDateTime::currentDateTime();
+    // Games with no backups at all count as stale too
+    QDateTime cutoff = QDateTime::currentDateTime().addDays(-STALE_DAYS);
+    const QStringList staleIds = m_saveManager->getStaleGameIds(cutoff);
+    const QStringList backedUpIds = m_saveManager->getAllGameIdsWithBackups();
     for (int i = 0; i < m_treeWidget->topLevelItemCount(); ++i) {
         QTreeWidgetItem *item = m_treeWidget->topLevelItem(i);
         QString gameId = item->data(0, Qt::UserRole).toString();
-        QList<BackupInfo> backups = m_saveManager->getBackupsForGame(gameId);
 
-        bool stale = backups.isEmpty() ||
-                     backups.first().timestamp.daysTo(now) > STALE_DAYS;
+        bool stale = staleIds.contains(gameId) || !backedUpIds.contains(gameId);
         item->setCheckState(0, stale ? Qt::Checked : Qt::Unchecked);
     }
 }
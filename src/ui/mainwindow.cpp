@@ -9,6 +9,7 @@
 #include "addgamedialog.h"
 #include "onboardingdialog.h"
 #include "profiledialog.h"
+#include "retentiondialog.h"
 #include "settingsdialog.h"
 #include "bulkbackupdialog.h"
 #include <QMessageBox>
@@ -22,9 +23,11 @@
 #include <QListWidget>
 #include <QLineEdit>
 #include <QTextEdit>
+#include <QCheckBox>
 #include <QDialogButtonBox>
 #include <QStandardPaths>
 #include <QDir>
+#include <QFileInfo>
 #include <QTreeWidgetItem>
 #include <QFont>
 #include <QShortcut>
@@ -43,6 +46,10 @@
 #include <QToolButton>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QMap>
+#include <QSharedPointer>
+#include <algorithm>
+#include <utility>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -58,7 +65,7 @@ MainWindow::MainWindow(QWidget *parent)
     QList<QAction*> textActions = {
         ui->actionAddGame, ui->actionScanGame,
         ui->actionManageConfigs, ui->actionHiddenGames,
-        ui->actionBackUpAll
+        ui->actionBackUpAll, ui->actionVerifyAll
     };
     for (QAction *action : textActions) {
         QToolButton *btn = qobject_cast<QToolButton*>(ui->toolBar->widgetForAction(action));
@@ -87,12 +94,19 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Add progress bar and storage usage label to status bar
     m_progressBar = new QProgressBar(this);
-    m_progressBar->setMaximumWidth(200);
+    m_progressBar->setMaximumWidth(260);
     m_progressBar->setMaximumHeight(16);
-    m_progressBar->setRange(0, 0);  // Indeterminate
+    m_progressBar->setRange(0, 0);  // Indeterminate until the first progress report
     m_progressBar->setVisible(false);
     ui->statusbar->addPermanentWidget(m_progressBar);
 
+    m_cancelButton = new QToolButton(this);
+    m_cancelButton->setText("Cancel");
+    m_cancelButton->setToolTip("Cancel running and queued backups");
+    m_cancelButton->setVisible(false);
+    connect(m_cancelButton, &QToolButton::clicked, m_saveManager, &SaveManager::cancelOperation);
+    ui->statusbar->addPermanentWidget(m_cancelButton);
+
     m_storageLabel = new QLabel(this);
     m_storageLabel->setFrameStyle(QFrame::Panel | QFrame::Sunken);
     ui->statusbar->addPermanentWidget(m_storageLabel);
@@ -100,6 +114,8 @@ MainWindow::MainWindow(QWidget *parent)
     // Open database
     if (!m_database->open()) {
         qCritical() << "Failed to open database";
+    } else {
+        m_saveManager->setMetadataDatabase(m_database->databasePath());
     }
 
     // Apply saved settings
@@ -107,8 +123,18 @@ MainWindow::MainWindow(QWidget *parent)
     if (!savedBackupDir.isEmpty()) {
         m_saveManager->setBackupDirectory(savedBackupDir);
     }
+    // Format first: the valid compression level range depends on it
+    m_saveManager->setBackupFormat(m_database->getSetting("backup_format", "tar.gz"));
     int compression = m_database->getSetting("compression_level", "6").toInt();
     m_saveManager->setCompressionLevel(compression);
+    m_saveManager->setCompressionThreads(m_database->getSetting("compression_threads", "0").toInt());
+    m_saveManager->setLongDistanceMatching(m_database->getSetting("zstd_long", "0") == "1");
+    m_saveManager->setDeltaKeyframeInterval(m_database->getSetting("delta_keyframe_interval", "10").toInt());
+    m_saveManager->setSafetySnapshots(m_database->getSetting("safety_snapshots", "1") == "1");
+    m_saveManager->setMemoryBudget(m_database->getSetting("memory_budget_mb", "64").toLongLong() * 1024 * 1024);
+    m_saveManager->setLowImpactAutoBackups(m_database->getSetting("low_impact_auto_backup", "1") == "1");
+    m_saveManager->setBackgroundBandwidthLimit(
+        m_database->getSetting("auto_backup_bandwidth_mb", "0").toLongLong() * 1000 * 1000);
 
     // Set up manifest manager
     m_gameDetector->setManifestManager(m_manifestManager);
@@ -182,12 +208,21 @@ void MainWindow::setupConnections()
             this, &MainWindow::onRestoreBackup);
     connect(m_deleteBackupBtn, &QPushButton::clicked,
             this, &MainWindow::onDeleteBackup);
+    connect(m_undoRestoreBtn, &QPushButton::clicked,
+            this, &MainWindow::onUndoRestore);
     connect(ui->actionAddGame, &QAction::triggered,
             this, &MainWindow::onAddCustomGame);
     connect(ui->actionScanGame, &QAction::triggered,
             this, &MainWindow::onScanGame);
     connect(ui->actionBackUpAll, &QAction::triggered,
             this, &MainWindow::onBackUpAll);
+    connect(ui->actionVerifyAll, &QAction::triggered,
+            this, &MainWindow::onVerifyAll);
+    connect(ui->actionExportBackups, &QAction::triggered, this, [this]() {
+        exportBackups(QStringList(), "game-rewind-backups");
+    });
+    connect(ui->actionImportBackups, &QAction::triggered,
+            this, &MainWindow::onImportBackups);
     connect(ui->actionRefresh, &QAction::triggered,
             this, &MainWindow::onRefreshGames);
     connect(ui->actionManageConfigs, &QAction::triggered,
@@ -204,12 +239,35 @@ void MainWindow::setupConnections()
 
     connect(m_saveManager, &SaveManager::backupCreated,
             this, &MainWindow::onBackupCreated);
+    connect(m_saveManager, &SaveManager::backupSkipped,
+            this, &MainWindow::onBackupSkipped);
+    connect(m_saveManager, &SaveManager::backupIncomplete,
+            this, &MainWindow::onBackupIncomplete);
     connect(m_saveManager, &SaveManager::backupRestored,
             this, &MainWindow::onBackupRestored);
+    connect(m_saveManager, &SaveManager::restoreReported,
+            this, &MainWindow::onRestoreReported);
     connect(m_saveManager, &SaveManager::backupDeleted,
             this, &MainWindow::onBackupDeleted);
     connect(m_saveManager, &SaveManager::backupUpdated,
             this, &MainWindow::onBackupUpdated);
+    connect(m_saveManager, &SaveManager::backupVerified,
+            this, &MainWindow::onBackupVerified);
+    connect(m_saveManager, &SaveManager::backupsPruned,
+            this, &MainWindow::onBackupsPruned);
+    connect(m_saveManager, &SaveManager::dictionaryTrained,
+            this, &MainWindow::onDictionaryTrained);
+    connect(m_saveManager, &SaveManager::backupsExported,
+            this, &MainWindow::onBackupsExported);
+    connect(m_saveManager, &SaveManager::backupsImported,
+            this, &MainWindow::onBackupsImported);
+    connect(m_saveManager, &SaveManager::restoreUndone,
+            this, &MainWindow::onRestoreUndone);
+    connect(m_saveManager, &SaveManager::safetySnapshotChanged, this, [this](const QString &gameId) {
+        if (gameId == m_currentGameId) {
+            updateUndoRestoreButton();
+        }
+    });
     connect(m_saveManager, &SaveManager::operationStarted, this, [this](const QString &msg) {
         setOperationInProgress(true, msg);
     });
@@ -220,6 +278,10 @@ void MainWindow::setupConnections()
         setOperationInProgress(false);
         ui->statusbar->showMessage("Operation cancelled", 3000);
     });
+    connect(m_saveManager, &SaveManager::jobFinished,
+            this, &MainWindow::onJobFinished);
+    connect(m_saveManager, &SaveManager::transferProgress,
+            this, &MainWindow::onTransferProgress);
     connect(m_saveManager, &SaveManager::error,
             this, &MainWindow::onError);
 }
@@ -319,12 +381,14 @@ void MainWindow::setupEmptyStates()
     m_createBackupBtn = new QPushButton(AppStyle::icon("document-save"), "Create Backup", this);
     m_restoreBackupBtn = new QPushButton(AppStyle::icon("document-revert"), "Restore", this);
     m_deleteBackupBtn = new QPushButton(AppStyle::icon("edit-delete"), "Delete", this);
+    m_undoRestoreBtn = new QPushButton(AppStyle::icon("edit-undo"), "Undo Restore", this);
+    m_undoRestoreBtn->setVisible(false);
 
     m_createBackupBtn->setEnabled(false);
     m_restoreBackupBtn->setEnabled(false);
     m_deleteBackupBtn->setEnabled(false);
 
-    for (QPushButton *btn : {m_createBackupBtn, m_restoreBackupBtn, m_deleteBackupBtn}) {
+    for (QPushButton *btn : {m_createBackupBtn, m_restoreBackupBtn, m_deleteBackupBtn, m_undoRestoreBtn}) {
         btn->setFlat(true);
         btn->setCursor(Qt::PointingHandCursor);
     }
@@ -333,6 +397,7 @@ void MainWindow::setupEmptyStates()
     backupActionsLayout->addWidget(m_restoreBackupBtn);
     backupActionsLayout->addWidget(m_deleteBackupBtn);
     backupActionsLayout->addStretch();
+    backupActionsLayout->addWidget(m_undoRestoreBtn);
 
     QVBoxLayout *rightLayout = qobject_cast<QVBoxLayout *>(ui->rightPanel->layout());
     // Insert button row after selectedGameLabel (index 1)
@@ -525,6 +590,9 @@ void MainWindow::populateGameTree(const QList<GameInfo> &games)
         platformGames[game.platform].append(game);
     }
 
+    // Backup count, size and last backup of every game in one query
+    const QHash<QString, BackupSummary> summaries = m_saveManager->getBackupSummaries();
+
     // Platform display names and order
     QStringList platformOrder = {"steam", "native", "custom"};
     QMap<QString, QString> platformNames = {
@@ -548,13 +616,7 @@ void MainWindow::populateGameTree(const QList<GameInfo> &games)
 
         // Add games under this platform
         for (const GameInfo &game : platformGames[platform]) {
-            // Get backup stats
-            QList<BackupInfo> backups = m_saveManager->getBackupsForGame(game.id);
-            int backupCount = backups.size();
-            qint64 totalSize = 0;
-            for (const BackupInfo &backup : backups) {
-                totalSize += backup.size;
-            }
+            BackupSummary summary = summaries.value(game.id);
 
             // Get full-resolution capsule image (no scaling down)
             QPixmap capsule = GameIconProvider::getHighResCapsule(game);
@@ -564,15 +626,11 @@ void MainWindow::populateGameTree(const QList<GameInfo> &games)
             gameItem->setData(0, GameCardRoles::GameIdRole, game.id);
             gameItem->setData(0, GameCardRoles::GameNameRole, game.name);
             gameItem->setData(0, GameCardRoles::GameIconRole, capsule);
-            gameItem->setData(0, GameCardRoles::BackupCountRole, backupCount);
-            gameItem->setData(0, GameCardRoles::TotalSizeRole, totalSize);
+            gameItem->setData(0, GameCardRoles::BackupCountRole, summary.count);
+            gameItem->setData(0, GameCardRoles::TotalSizeRole, summary.totalSize);
             gameItem->setData(0, GameCardRoles::SavePathRole, game.detectedSavePath);
             gameItem->setData(0, GameCardRoles::PlatformRole, game.platform);
-            QDateTime lastBackupTime;
-            if (!backups.isEmpty()) {
-                lastBackupTime = backups.first().timestamp;
-            }
-            gameItem->setData(0, GameCardRoles::LastBackupRole, lastBackupTime);
+            gameItem->setData(0, GameCardRoles::LastBackupRole, summary.latest);
             gameItem->setData(0, Qt::UserRole, game.id); // Keep for compatibility
             gameItem->setToolTip(0, game.detectedSavePath);
         }
@@ -584,7 +642,8 @@ void MainWindow::populateGameTree(const QList<GameInfo> &games)
         detectedIds.insert(game.id);
     }
 
-    QStringList allBackupGameIds = m_saveManager->getAllGameIdsWithBackups();
+    QStringList allBackupGameIds = summaries.keys();
+    allBackupGameIds.sort();
     QStringList orphanedIds;
     for (const QString &id : allBackupGameIds) {
         if (!detectedIds.contains(id) && !m_database->isGameHidden(id)) {
@@ -601,29 +660,19 @@ void MainWindow::populateGameTree(const QList<GameInfo> &games)
         orphanCategory->setExpanded(true);
 
         for (const QString &orphanId : orphanedIds) {
-            QList<BackupInfo> backups = m_saveManager->getBackupsForGame(orphanId);
-            int backupCount = backups.size();
-            qint64 totalSize = 0;
-            for (const BackupInfo &backup : backups) {
-                totalSize += backup.size;
-            }
-            QDateTime lastBackupTime;
-            if (!backups.isEmpty()) {
-                lastBackupTime = backups.first().timestamp;
-            }
-
-            QString gameName = m_saveManager->getGameNameFromBackups(orphanId);
+            BackupSummary summary = summaries.value(orphanId);
+            QString gameName = summary.gameName.isEmpty() ? orphanId : summary.gameName;
 
             QTreeWidgetItem *gameItem = new QTreeWidgetItem(orphanCategory);
             gameItem->setData(0, GameCardRoles::IsCategoryRole, false);
             gameItem->setData(0, GameCardRoles::GameIdRole, orphanId);
             gameItem->setData(0, GameCardRoles::GameNameRole, gameName);
             gameItem->setData(0, GameCardRoles::GameIconRole, QPixmap());
-            gameItem->setData(0, GameCardRoles::BackupCountRole, backupCount);
-            gameItem->setData(0, GameCardRoles::TotalSizeRole, totalSize);
+            gameItem->setData(0, GameCardRoles::BackupCountRole, summary.count);
+            gameItem->setData(0, GameCardRoles::TotalSizeRole, summary.totalSize);
             gameItem->setData(0, GameCardRoles::SavePathRole, QString());
             gameItem->setData(0, GameCardRoles::PlatformRole, "undetected");
-            gameItem->setData(0, GameCardRoles::LastBackupRole, lastBackupTime);
+            gameItem->setData(0, GameCardRoles::LastBackupRole, summary.latest);
             gameItem->setData(0, Qt::UserRole, orphanId);
             gameItem->setToolTip(0, "This game is no longer detected. Its backups are still available.");
         }
@@ -650,6 +699,7 @@ void MainWindow::loadBackupsForGame(const QString &gameId)
 
     setBackupsEnabled(true);
     updateBackupsEmptyState();
+    updateUndoRestoreButton();
 }
 
 void MainWindow::updateGameCard(const QString &gameId)
@@ -718,6 +768,11 @@ void MainWindow::styleBackupItem(QListWidgetItem *item, const BackupInfo &backup
      .arg(backup.timestamp.toString("MMMM d, yyyy 'at' h:mm AP"))
      .arg(formatFileSize(backup.size));
 
+    if (backup.compressionSkipped > 0) {
+        tooltip += QString("<p style='margin: 4px 0; color: gray;'>Already compressed: %1 stored as is</p>")
+                       .arg(formatFileSize(backup.compressionSkipped));
+    }
+
     if (!backup.notes.isEmpty()) {
         tooltip += QString("<hr style='margin: 8px 0; border: 1px solid #444;'>"
                           "<p style='margin: 4px 0;'><b>Notes:</b></p>"
@@ -842,8 +897,6 @@ void MainWindow::onBackupSelected(QListWidgetItem *current, QListWidgetItem *pre
 
 void MainWindow::onCreateBackup()
 {
-    if (m_saveManager->isBusy()) return;
-
     GameInfo game = getCurrentGame();
     if (game.id.isEmpty()) {
         return;
@@ -904,7 +957,39 @@ void MainWindow::onRestoreBackup()
         if (restorePath.isEmpty()) return;
     }
 
-    m_saveManager->restoreBackupAsync(backup, restorePath);
+    bool differential = m_database->getSetting("differential_restore", "0") == "1";
+    m_saveManager->restoreBackupAsync(backup, restorePath,
+                                      differential ? SaveManager::RestoreDifferential : SaveManager::RestoreReplace);
+}
+
+void MainWindow::onUndoRestore()
+{
+    SafetySnapshot snapshot = m_saveManager->safetySnapshot(m_currentGameId);
+    if (!snapshot.isValid()) {
+        updateUndoRestoreButton();
+        return;
+    }
+
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Undo Restore",
+        QString("Put back the save files as they were before '%1' was restored (%2)?\n\n"
+                "Changes made since that restore will be lost.")
+            .arg(snapshot.backupName, formatTimestamp(snapshot.created)),
+        QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes) {
+        return;
+    }
+
+    m_saveManager->undoRestoreAsync(m_currentGameId);
+}
+
+void MainWindow::updateUndoRestoreButton()
+{
+    SafetySnapshot snapshot = m_saveManager->safetySnapshot(m_currentGameId);
+    m_undoRestoreBtn->setVisible(snapshot.isValid());
+    if (snapshot.isValid()) {
+        m_undoRestoreBtn->setToolTip(QString("Put back the save files from before restoring '%1' (%2)")
+                                         .arg(snapshot.backupName, formatTimestamp(snapshot.created)));
+    }
 }
 
 void MainWindow::onDeleteBackup()
@@ -924,11 +1009,7 @@ void MainWindow::onDeleteBackup()
         return;
     }
 
-    if (m_saveManager->deleteBackup(backup)) {
-        ui->statusbar->showMessage("Backup deleted successfully", 3000);
-    } else {
-        ui->statusbar->showMessage("Failed to delete backup", 3000);
-    }
+    m_saveManager->deleteBackupAsync(backup);
 }
 
 void MainWindow::onAddCustomGame()
@@ -1037,6 +1118,28 @@ void MainWindow::onBackupContextMenu(const QPoint &pos)
     menu.addSeparator();
     QAction *verifyAction = menu.addAction(AppStyle::icon("dialog-ok-apply"), "Verify Integrity");
 
+    // Contents are only listed when the submenu is opened, and each folder
+    // only when it is opened in turn
+    BackupInfo browsed = m_saveManager->getBackupById(m_currentGameId, item->data(Qt::UserRole).toString());
+    QMenu *browseMenu = menu.addMenu(AppStyle::icon("document-open"), "Browse Files");
+    connect(browseMenu, &QMenu::aboutToShow, browseMenu, [this, browseMenu, browsed]() {
+        if (!browseMenu->isEmpty()) return;
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        auto contents = QSharedPointer<QList<BackupEntry>>::create(m_saveManager->listBackupContents(browsed));
+        QApplication::restoreOverrideCursor();
+
+        // Full backups hold the save dir itself; start inside it
+        QString root;
+        if (browsed.profileId == -1 && !contents->isEmpty()) {
+            QString top = contents->first().path.section('/', 0, 0);
+            bool single = std::all_of(contents->cbegin(), contents->cend(), [&top](const BackupEntry &entry) {
+                return entry.path == top || entry.path.startsWith(top + "/");
+            });
+            if (single) root = top;
+        }
+        populateContentsMenu(browseMenu, contents, root);
+    });
+
     QAction *selected = menu.exec(ui->backupsListWidget->viewport()->mapToGlobal(pos));
     if (!selected) return;
 
@@ -1051,17 +1154,58 @@ void MainWindow::onBackupContextMenu(const QPoint &pos)
     } else if (selected == verifyAction) {
         BackupInfo backup = getCurrentBackup();
         if (!backup.id.isEmpty()) {
-            ui->statusbar->showMessage("Verifying backup...");
-            bool valid = m_saveManager->verifyBackup(backup);
-            if (valid) {
-                ui->statusbar->showMessage("Backup integrity verified", 3000);
-            } else {
-                QMessageBox::warning(this, "Integrity Check",
-                    "Backup archive may be corrupted or incomplete.");
-                ui->statusbar->showMessage("Backup verification FAILED", 5000);
+            // Result arrives through onBackupVerified
+            m_saveManager->verifyBackupAsync(backup);
+        }
+    }
+}
+
+void MainWindow::populateContentsMenu(QMenu *menu, const QSharedPointer<QList<BackupEntry>> &contents,
+                                      const QString &dirPath)
+{
+    menu->setToolTipsVisible(true);
+
+    // Direct children of dirPath; folders only implied by deeper paths get
+    // no entry of their own
+    QString prefix = dirPath.isEmpty() ? QString() : dirPath + "/";
+    QStringList dirs;
+    QMap<QString, const BackupEntry *> files;
+    for (const BackupEntry &entry : *contents) {
+        if (!entry.path.startsWith(prefix) || entry.path.size() == prefix.size()) continue;
+        QString name = entry.path.mid(prefix.size());
+        if (name.contains('/') || entry.type == "dir") {
+            dirs.append(name.section('/', 0, 0));
+        } else {
+            files.insert(name, &entry);
+        }
+    }
+
+    dirs.sort();
+    dirs.removeDuplicates();
+    for (const QString &name : std::as_const(dirs)) {
+        QMenu *sub = menu->addMenu(AppStyle::icon("folder"), name);
+        QString path = prefix + name;
+        connect(sub, &QMenu::aboutToShow, sub, [this, sub, contents, path]() {
+            if (sub->isEmpty()) populateContentsMenu(sub, contents, path);
+        });
+    }
+    for (auto it = files.cbegin(); it != files.cend(); ++it) {
+        const BackupEntry *entry = it.value();
+        if (entry->type == "symlink") {
+            menu->addAction(it.key() + " -> " + entry->linkTarget);
+        } else {
+            QAction *action = menu->addAction(QString("%1  (%2)").arg(it.key(), formatFileSize(entry->size)));
+            QString tip = "Modified: " + entry->mtime.toString("MMM d, yyyy hh:mm:ss");
+            if (!entry->hash.isEmpty()) {
+                tip += "\nBLAKE2b: " + QString::fromLatin1(entry->hash);
             }
+            action->setToolTip(tip);
         }
     }
+
+    if (menu->isEmpty()) {
+        menu->addAction("(empty)")->setEnabled(false);
+    }
 }
 
 void MainWindow::onEditBackup()
@@ -1087,6 +1231,10 @@ void MainWindow::onEditBackup()
     layout->addWidget(notesLabel);
     layout->addWidget(notesEdit);
 
+    QCheckBox *pinnedCheck = new QCheckBox("Keep forever (never deleted by retention rules)", &dialog);
+    pinnedCheck->setChecked(backup.pinned);
+    layout->addWidget(pinnedCheck);
+
     QDialogButtonBox *buttons = new QDialogButtonBox(
         QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
     connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
@@ -1100,6 +1248,7 @@ void MainWindow::onEditBackup()
         backup.displayName = backup.timestamp.toString("yyyy-MM-dd HH:mm:ss");
     }
     backup.notes = notesEdit->toPlainText().trimmed();
+    backup.pinned = pinnedCheck->isChecked();
 
     m_saveManager->updateBackupMetadata(backup);
 }
@@ -1114,49 +1263,204 @@ void MainWindow::onBackupUpdated(const QString &gameId, const QString &backupId)
 
 void MainWindow::onBackUpAll()
 {
-    if (m_saveManager->isBusy()) {
-        QMessageBox::warning(this, "Busy", "A backup operation is already in progress.");
-        return;
-    }
-
     QList<GameInfo> games = m_gameDetector->getDetectedGames();
     BulkBackupDialog dialog(games, m_saveManager, this);
     if (dialog.exec() != QDialog::Accepted) return;
 
-    m_bulkBackupQueue = dialog.getSelectedGames();
-    if (m_bulkBackupQueue.isEmpty()) return;
+    QList<GameInfo> selected = dialog.getSelectedGames();
+    if (selected.isEmpty()) return;
+
+    // Queued behind manual and auto backups; games run in parallel
+    for (const GameInfo &game : selected) {
+        quint64 jobId = m_saveManager->createBackupAsync(game, QString(), QString(), SaveProfile(),
+                                                         false, JobScheduler::Bulk);
+        if (jobId != 0) {
+            m_bulkBackupJobs.insert(jobId);
+            ++m_bulkBackupTotal;
+        }
+    }
 
-    ui->statusbar->showMessage(QString("Backing up %1 games...").arg(m_bulkBackupQueue.size()));
-    processNextBulkBackup();
+    ui->statusbar->showMessage(QString("Backing up %1 games...").arg(m_bulkBackupTotal));
 }
 
-void MainWindow::processNextBulkBackup()
+void MainWindow::onVerifyAll()
 {
-    if (m_bulkBackupQueue.isEmpty()) {
-        ui->statusbar->showMessage("Bulk backup complete", 5000);
+    if (!m_verifyJobs.isEmpty()) return;
+
+    const QList<quint64> jobIds = m_saveManager->verifyAllBackupsAsync();
+    if (jobIds.isEmpty()) {
+        ui->statusbar->showMessage("No backups to verify", 3000);
         return;
     }
 
-    GameInfo game = m_bulkBackupQueue.takeFirst();
+    m_verifyJobs = QSet<quint64>(jobIds.cbegin(), jobIds.cend());
+    m_verifyTotal = jobIds.size();
+    m_verifyChecked = 0;
+    m_verifyFailures.clear();
+    ui->statusbar->showMessage(QString("Verifying %1 backups...").arg(m_verifyTotal));
+}
 
-    QMetaObject::Connection *conn = new QMetaObject::Connection;
-    *conn = connect(m_saveManager, &SaveManager::operationFinished, this, [this, conn]() {
-        disconnect(*conn);
-        delete conn;
-        processNextBulkBackup();
-    });
+void MainWindow::exportBackups(const QStringList &gameIds, const QString &suggestedName)
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Backups",
+        QDir::homePath() + "/" + suggestedName + ".grbundle", "Backup bundles (*.grbundle);;All files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+    m_saveManager->exportBackupsAsync(gameIds, path);
+}
 
-    QMetaObject::Connection *errConn = new QMetaObject::Connection;
-    *errConn = connect(m_saveManager, &SaveManager::error, this, [this, errConn](const QString &) {
-        disconnect(*errConn);
-        delete errConn;
-    });
+void MainWindow::onImportBackups()
+{
+    QString path = QFileDialog::getOpenFileName(this, "Import Backups", QDir::homePath(),
+        "Backup bundles (*.grbundle);;All files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+    m_saveManager->importBackupsAsync(path);
+}
 
-    int remaining = m_bulkBackupQueue.size() + 1;
-    ui->statusbar->showMessage(QString("Backing up %1 (%2 remaining)...")
-        .arg(game.name).arg(remaining));
+void MainWindow::onBackupsExported(const QString &filePath, int count, qint64 bytes)
+{
+    ui->statusbar->showMessage(QString("Exported %1 backup%2 (%3) to %4")
+                                   .arg(count).arg(count == 1 ? "" : "s")
+                                   .arg(formatFileSize(bytes), QFileInfo(filePath).fileName()), 5000);
+}
+
+void MainWindow::onBackupsImported(int count, int skipped)
+{
+    QString message = QString("Imported %1 backup%2").arg(count).arg(count == 1 ? "" : "s");
+    if (skipped > 0) {
+        message += QString(", %1 already present").arg(skipped);
+    }
+    ui->statusbar->showMessage(message, 5000);
 
-    m_saveManager->createBackupAsync(game);
+    // Imported games may have had no backups here before
+    loadGamesAsync();
+    if (!m_currentGameId.isEmpty()) {
+        loadBackupsForGame(m_currentGameId);
+    }
+    updateStorageUsage();
+}
+
+void MainWindow::onBackupVerified(const QString &gameId, const QString &backupId, bool valid)
+{
+    BackupInfo backup = m_saveManager->getBackupById(gameId, backupId);
+    QString name = QString("%1: %2").arg(backup.gameName, backup.displayName);
+
+    // Batch results are summed up once the last job is done
+    if (!m_verifyJobs.isEmpty()) {
+        ++m_verifyChecked;
+        if (!valid) {
+            m_verifyFailures.append(name);
+        }
+        return;
+    }
+
+    if (valid) {
+        ui->statusbar->showMessage("Backup integrity verified", 3000);
+    } else {
+        QMessageBox::warning(this, "Integrity Check",
+            QString("Backup \"%1\" may be corrupted or incomplete.").arg(backup.displayName));
+        ui->statusbar->showMessage("Backup verification FAILED", 5000);
+    }
+}
+
+void MainWindow::onJobFinished(quint64 jobId)
+{
+    if (m_jobTransfers.remove(jobId)) {
+        updateTransferProgress();
+    }
+
+    if (m_verifyJobs.remove(jobId)) {
+        if (!m_verifyJobs.isEmpty()) {
+            ui->statusbar->showMessage(QString("Verifying backups (%1 of %2 done)...")
+                .arg(m_verifyTotal - m_verifyJobs.size()).arg(m_verifyTotal));
+            return;
+        }
+        if (!m_verifyFailures.isEmpty()) {
+            ui->statusbar->showMessage("Backup verification FAILED", 5000);
+            QMessageBox::warning(this, "Integrity Check",
+                QString("%1 of %2 backups may be corrupted or incomplete:\n\n%3")
+                    .arg(m_verifyFailures.size()).arg(m_verifyTotal)
+                    .arg(m_verifyFailures.join("\n")));
+        } else if (m_verifyChecked < m_verifyTotal) {
+            ui->statusbar->showMessage(QString("Verification cancelled (%1 of %2 checked)")
+                .arg(m_verifyChecked).arg(m_verifyTotal), 5000);
+        } else {
+            ui->statusbar->showMessage(QString("All %1 backups verified").arg(m_verifyTotal), 5000);
+        }
+        m_verifyTotal = 0;
+        m_verifyFailures.clear();
+        return;
+    }
+
+    if (m_bulkBackupJobs.remove(jobId)) {
+        if (m_bulkBackupJobs.isEmpty()) {
+            ui->statusbar->showMessage("Bulk backup complete", 5000);
+            m_bulkBackupTotal = 0;
+        } else {
+            ui->statusbar->showMessage(QString("Backing up games (%1 of %2 done)...")
+                .arg(m_bulkBackupTotal - m_bulkBackupJobs.size()).arg(m_bulkBackupTotal));
+        }
+        return;
+    }
+
+    if (m_autoBackupJobs.contains(jobId)) {
+        GameInfo game = m_autoBackupJobs.take(jobId);
+        // Directory touches often leave the save data itself untouched
+        bool skipped = m_skippedAutoBackups.remove(game.id);
+        if (!skipped && m_trayIcon && m_trayIcon->isVisible()) {
+            m_trayIcon->showMessage("Game Rewind",
+                QString("Auto-backup created for %1").arg(game.name),
+                QSystemTrayIcon::Information, 3000);
+        }
+    }
+}
+
+void MainWindow::onTransferProgress(quint64 jobId, qint64 bytesDone, qint64 bytesTotal,
+                                    int filesDone, int filesTotal, qint64 bytesPerSecond)
+{
+    Q_UNUSED(filesDone);
+    Q_UNUSED(filesTotal);
+    JobTransfer &transfer = m_jobTransfers[jobId];
+    transfer.bytesDone = bytesDone;
+    transfer.bytesTotal = bytesTotal;
+    transfer.bytesPerSecond = bytesPerSecond;
+    updateTransferProgress();
+}
+
+void MainWindow::updateTransferProgress()
+{
+    // Concurrent jobs are shown as one combined transfer
+    qint64 done = 0;
+    qint64 total = 0;
+    qint64 rate = 0;
+    bool totalKnown = !m_jobTransfers.isEmpty();
+    for (const JobTransfer &transfer : std::as_const(m_jobTransfers)) {
+        done += transfer.bytesDone;
+        total += transfer.bytesTotal;
+        rate += transfer.bytesPerSecond;
+        totalKnown = totalKnown && transfer.bytesTotal > 0;
+    }
+
+    if (!totalKnown) {
+        m_progressBar->setRange(0, 0);
+        m_progressBar->setTextVisible(false);
+        return;
+    }
+
+    m_progressBar->setRange(0, 1000);
+    m_progressBar->setValue(static_cast<int>(qMin(done, total) * 1000 / total));
+    QString text = "%p%";
+    if (rate > 0) {
+        text += QString(" - %1/s").arg(formatFileSize(rate));
+        qint64 secondsLeft = qMax<qint64>(0, total - done) / rate;
+        text += secondsLeft >= 60 ? QString(", %1 min left").arg(secondsLeft / 60 + 1)
+                                  : QString(", %1 s left").arg(secondsLeft + 1);
+    }
+    m_progressBar->setFormat(text);
+    m_progressBar->setTextVisible(true);
 }
 
 void MainWindow::onSearchTextChanged(const QString &text)
@@ -1213,6 +1517,17 @@ void MainWindow::onGameContextMenu(const QPoint &pos)
     }
 
     QAction *profilesAction = menu.addAction("Manage Profiles...");
+    QAction *retentionAction = menu.addAction("Retention Rules...");
+    bool hasDictionary = m_saveManager->hasDictionary(gameId);
+    QAction *dictionaryAction = menu.addAction(hasDictionary ? "Retrain Compression Dictionary"
+                                                             : "Train Compression Dictionary");
+    dictionaryAction->setEnabled(!m_saveManager->getBackupsForGame(gameId).isEmpty());
+    QAction *removeDictionaryAction = nullptr;
+    if (hasDictionary) {
+        removeDictionaryAction = menu.addAction("Remove Compression Dictionary");
+    }
+    QAction *exportAction = menu.addAction("Export Backups...");
+    exportAction->setEnabled(dictionaryAction->isEnabled());
     QAction *hideAction = menu.addAction("Hide Game");
 
     QAction *selected = menu.exec(ui->gamesTreeWidget->viewport()->mapToGlobal(pos));
@@ -1223,6 +1538,19 @@ void MainWindow::onGameContextMenu(const QPoint &pos)
     if (selected == profilesAction) {
         ProfileDialog dialog(m_database, game, this);
         dialog.exec();
+    } else if (selected == retentionAction) {
+        RetentionDialog dialog(m_database, gameId, gameName, this);
+        if (dialog.exec() == QDialog::Accepted) {
+            pruneBackups(gameId);
+        }
+    } else if (selected == dictionaryAction) {
+        m_saveManager->trainDictionaryAsync(gameId);
+    } else if (removeDictionaryAction && selected == removeDictionaryAction) {
+        if (m_saveManager->removeDictionary(gameId)) {
+            ui->statusbar->showMessage(QString("%1: compression dictionary removed").arg(gameName), 3000);
+        }
+    } else if (selected == exportAction) {
+        exportBackups(QStringList() << gameId, gameId + "-backups");
     } else if (selected == hideAction) {
         m_database->hideGame(gameId, gameName);
         loadGamesAsync();
@@ -1317,7 +1645,15 @@ void MainWindow::onSettings()
         if (!backupDir.isEmpty()) {
             m_saveManager->setBackupDirectory(backupDir);
         }
+        m_saveManager->setBackupFormat(dialog.backupFormat());
         m_saveManager->setCompressionLevel(dialog.compressionLevel());
+        m_saveManager->setCompressionThreads(dialog.compressionThreads());
+        m_saveManager->setLongDistanceMatching(dialog.longDistanceMatching());
+        m_saveManager->setDeltaKeyframeInterval(dialog.deltaKeyframeInterval());
+        m_saveManager->setSafetySnapshots(dialog.safetySnapshots());
+        m_saveManager->setMemoryBudget(qint64(dialog.memoryBudgetMB()) * 1024 * 1024);
+        m_saveManager->setLowImpactAutoBackups(dialog.lowImpactAutoBackups());
+        m_saveManager->setBackgroundBandwidthLimit(qint64(dialog.autoBackupBandwidthMB()) * 1000 * 1000);
 
         if (m_trayIcon) {
             bool trayEnabled = m_database->getSetting("minimize_to_tray", "0") == "1";
@@ -1348,6 +1684,60 @@ void MainWindow::onBackupCreated(const QString &gameId, const QString &backupId)
     }
     updateGameCard(gameId);  // Update the game card stats
     updateStorageUsage();
+    pruneBackups(gameId);
+}
+
+void MainWindow::pruneBackups(const QString &gameId)
+{
+    RetentionPolicy policy = m_database->getRetentionPolicy(gameId);
+    if (policy.enabled) {
+        m_saveManager->pruneBackupsAsync(gameId, policy);
+    }
+}
+
+void MainWindow::onBackupsPruned(const QString &gameId, int count, qint64 freedBytes)
+{
+    GameInfo game = m_gameDetector->getGameById(gameId);
+    QString name = game.name.isEmpty() ? gameId : game.name;
+    ui->statusbar->showMessage(QString("%1: removed %2 old backup%3, freed %4")
+                                   .arg(name).arg(count).arg(count == 1 ? "" : "s")
+                                   .arg(formatFileSize(freedBytes)), 5000);
+}
+
+void MainWindow::onDictionaryTrained(const QString &gameId, qint64 dictionarySize, int sampleCount)
+{
+    GameInfo game = m_gameDetector->getGameById(gameId);
+    QString name = game.name.isEmpty() ? gameId : game.name;
+    QString message = QString("%1: trained a %2 compression dictionary from %3 files")
+                          .arg(name, formatFileSize(dictionarySize)).arg(sampleCount);
+    if (m_saveManager->backupFormat() != "chunks") {
+        message += " (used by the chunk store backup format)";
+    }
+    ui->statusbar->showMessage(message, 5000);
+}
+
+void MainWindow::onBackupSkipped(const QString &gameId, const QString &reason)
+{
+    m_skippedAutoBackups.insert(gameId);
+    GameInfo game = m_gameDetector->getGameById(gameId);
+    QString name = game.name.isEmpty() ? gameId : game.name;
+    ui->statusbar->showMessage(QString("%1: %2").arg(name, reason), 3000);
+}
+
+void MainWindow::onBackupIncomplete(const QString &gameId, const QString &backupId, const QStringList &paths)
+{
+    Q_UNUSED(backupId);
+    GameInfo game = m_gameDetector->getGameById(gameId);
+    QString name = game.name.isEmpty() ? gameId : game.name;
+    // Usually the game writing its save during an auto-backup
+    QString message = QString("%1: %2 file%3 could not be read in full and %4 missing or incomplete in the backup: %5")
+                          .arg(name).arg(paths.size()).arg(paths.size() == 1 ? "" : "s")
+                          .arg(paths.size() == 1 ? "is" : "are")
+                          .arg(QStringList(paths.mid(0, 3)).join(", ") + (paths.size() > 3 ? ", ..." : ""));
+    ui->statusbar->showMessage(message, 10000);
+    if (m_trayIcon && m_trayIcon->isVisible()) {
+        m_trayIcon->showMessage("Game Rewind", message, QSystemTrayIcon::Warning, 5000);
+    }
 }
 
 void MainWindow::onBackupRestored(const QString &gameId, const QString &backupId)
@@ -1356,6 +1746,26 @@ void MainWindow::onBackupRestored(const QString &gameId, const QString &backupId
     Q_UNUSED(backupId);
 }
 
+void MainWindow::onRestoreUndone(const QString &gameId)
+{
+    Q_UNUSED(gameId);
+    ui->statusbar->showMessage("Restore undone", 5000);
+}
+
+void MainWindow::onRestoreReported(const QString &gameId, const QString &backupId, const QStringList &written,
+                                   const QStringList &removed, int unchanged)
+{
+    Q_UNUSED(gameId);
+    Q_UNUSED(backupId);
+    if (written.isEmpty() && removed.isEmpty()) {
+        ui->statusbar->showMessage("Save files already match the backup", 5000);
+        return;
+    }
+    ui->statusbar->showMessage(QString("Restored %1 file%2, removed %3, %4 unchanged")
+                                   .arg(written.size()).arg(written.size() == 1 ? "" : "s")
+                                   .arg(removed.size()).arg(unchanged), 5000);
+}
+
 void MainWindow::onBackupDeleted(const QString &gameId, const QString &backupId)
 {
     Q_UNUSED(backupId);
@@ -1365,6 +1775,7 @@ void MainWindow::onBackupDeleted(const QString &gameId, const QString &backupId)
     }
     updateGameCard(gameId);  // Update the game card stats
     updateStorageUsage();
+    ui->statusbar->showMessage("Backup deleted successfully", 3000);
 }
 
 void MainWindow::onError(const QString &message)
@@ -1380,23 +1791,13 @@ void MainWindow::onManifestReady()
 
 void MainWindow::updateStorageUsage()
 {
-    qint64 totalSize = 0;
-    int totalBackups = 0;
-
-    // Calculate total storage used by all backups
-    QList<GameInfo> games = m_gameDetector->getDetectedGames();
-    for (const GameInfo &game : games) {
-        QList<BackupInfo> backups = m_saveManager->getBackupsForGame(game.id);
-        totalBackups += backups.size();
-        for (const BackupInfo &backup : backups) {
-            totalSize += backup.size;
-        }
-    }
+    // Storage used by all backups, undetected games included
+    BackupSummary totals = m_saveManager->getBackupTotals();
 
     // Format and display
     QString storageText = QString("Storage: %1 (%2 backups)")
-                             .arg(formatFileSize(totalSize))
-                             .arg(totalBackups);
+                             .arg(formatFileSize(totals.totalSize))
+                             .arg(totals.count);
 
     m_storageLabel->setText(storageText);
 }
@@ -1404,10 +1805,16 @@ void MainWindow::updateStorageUsage()
 void MainWindow::setOperationInProgress(bool inProgress, const QString &message)
 {
     m_progressBar->setVisible(inProgress);
+    m_cancelButton->setVisible(inProgress);
+    if (!inProgress) {
+        m_jobTransfers.clear();
+        updateTransferProgress();
+    }
 
     GameInfo game = getCurrentGame();
     bool hasGame = !game.id.isEmpty() && game.isDetected && !game.detectedSavePath.isEmpty();
-    bool canCreate = !inProgress && hasGame;
+    // Backups queue on the scheduler, so creating one is always allowed
+    bool canCreate = hasGame;
     bool canRestore = !inProgress && ui->backupsListWidget->currentItem();
     bool canDelete = !inProgress && ui->backupsListWidget->currentItem();
     ui->actionCreateBackup->setEnabled(canCreate);
@@ -1416,6 +1823,7 @@ void MainWindow::setOperationInProgress(bool inProgress, const QString &message)
     m_createBackupBtn->setEnabled(canCreate);
     m_restoreBackupBtn->setEnabled(canRestore);
     m_deleteBackupBtn->setEnabled(canDelete);
+    m_undoRestoreBtn->setEnabled(!inProgress);
 
     if (inProgress && !message.isEmpty()) {
         ui->statusbar->showMessage(message);
@@ -1530,16 +1938,11 @@ void MainWindow::onSaveDirectoryChanged(const QString &path)
 
 void MainWindow::onAutoBackupTimer()
 {
-    if (m_pendingAutoBackups.isEmpty()) return;
-    if (m_saveManager->isBusy()) {
-        m_autoBackupTimer->start(10000);
-        return;
+    // The scheduler runs one job per game at a time, so queue them all
+    const QSet<QString> gameIds = std::exchange(m_pendingAutoBackups, QSet<QString>());
+    for (const QString &gameId : gameIds) {
+        performAutoBackup(gameId);
     }
-
-    QString gameId = *m_pendingAutoBackups.begin();
-    m_pendingAutoBackups.remove(gameId);
-
-    performAutoBackup(gameId);
 }
 
 void MainWindow::performAutoBackup(const QString &gameId)
@@ -1549,23 +1952,11 @@ void MainWindow::performAutoBackup(const QString &gameId)
 
     qDebug() << "Auto-backing up" << game.name;
 
-    m_saveManager->createBackupAsync(game, "Auto-backup");
-
-    QMetaObject::Connection *conn = new QMetaObject::Connection;
-    *conn = connect(m_saveManager, &SaveManager::operationFinished, this, [this, conn, game]() {
-        disconnect(*conn);
-        delete conn;
-
-        if (m_trayIcon && m_trayIcon->isVisible()) {
-            m_trayIcon->showMessage("Game Rewind",
-                QString("Auto-backup created for %1").arg(game.name),
-                QSystemTrayIcon::Information, 3000);
-        }
-
-        if (!m_pendingAutoBackups.isEmpty()) {
-            QTimer::singleShot(1000, this, &MainWindow::onAutoBackupTimer);
-        }
-    });
+    quint64 jobId = m_saveManager->createBackupAsync(game, "Auto-backup", QString(), SaveProfile(),
+                                                     true, JobScheduler::Auto);
+    if (jobId != 0) {
+        m_autoBackupJobs.insert(jobId, game);
+    }
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
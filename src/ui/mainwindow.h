@@ -4,6 +4,7 @@
 #include <QMainWindow>
 #include <QListWidgetItem>
 #include <QSystemTrayIcon>
+#include <QSharedPointer>
 #include "steam/gamedetector.h"
 #include "core/savemanager.h"
 #include "steam/manifestmanager.h"
@@ -11,6 +12,7 @@
 #include "core/gameinfo.h"
 
 class QLabel;
+class QMenu;
 class QLineEdit;
 class QPushButton;
 class QProgressBar;
@@ -41,6 +43,7 @@ private slots:
     void onCreateBackup();
     void onRestoreBackup();
     void onDeleteBackup();
+    void onUndoRestore();
     void onAddCustomGame();
     void onScanGame();
     void onRefreshGames();
@@ -49,9 +52,17 @@ private slots:
     void onAbout();
 
     void onBackupCreated(const QString &gameId, const QString &backupId);
+    void onBackupSkipped(const QString &gameId, const QString &reason);
+    void onBackupIncomplete(const QString &gameId, const QString &backupId, const QStringList &paths);
     void onBackupRestored(const QString &gameId, const QString &backupId);
+    void onRestoreReported(const QString &gameId, const QString &backupId, const QStringList &written,
+                           const QStringList &removed, int unchanged);
+    void onRestoreUndone(const QString &gameId);
     void onBackupDeleted(const QString &gameId, const QString &backupId);
     void onError(const QString &message);
+    void onJobFinished(quint64 jobId);
+    void onTransferProgress(quint64 jobId, qint64 bytesDone, qint64 bytesTotal,
+                            int filesDone, int filesTotal, qint64 bytesPerSecond);
 
     void onManifestReady();
     void onGameContextMenu(const QPoint &pos);
@@ -60,6 +71,13 @@ private slots:
     void onBackupUpdated(const QString &gameId, const QString &backupId);
     void onSearchTextChanged(const QString &text);
     void onBackUpAll();
+    void onVerifyAll();
+    void onImportBackups();
+    void onBackupsExported(const QString &filePath, int count, qint64 bytes);
+    void onBackupsImported(int count, int skipped);
+    void onBackupVerified(const QString &gameId, const QString &backupId, bool valid);
+    void onBackupsPruned(const QString &gameId, int count, qint64 freedBytes);
+    void onDictionaryTrained(const QString &gameId, qint64 dictionarySize, int sampleCount);
     void onTrayActivated(QSystemTrayIcon::ActivationReason reason);
     void onSaveDirectoryChanged(const QString &path);
     void onAutoBackupTimer();
@@ -82,18 +100,26 @@ private:
     void loadBackupsForGame(const QString &gameId);
     void updateGameCard(const QString &gameId);
     void setBackupsEnabled(bool enabled);
+    void updateUndoRestoreButton();
     void styleBackupItem(QListWidgetItem *item, const BackupInfo &backup);
     QString formatFileSize(qint64 bytes) const;
     QString formatTimestamp(const QDateTime &timestamp) const;
     GameInfo getCurrentGame() const;
     BackupInfo getCurrentBackup() const;
+    void populateContentsMenu(QMenu *menu, const QSharedPointer<QList<BackupEntry>> &contents,
+                              const QString &dirPath);
 
     void updateStorageUsage();
+    // All games when gameIds is empty
+    void exportBackups(const QStringList &gameIds, const QString &suggestedName);
     void setOperationInProgress(bool inProgress, const QString &message = QString());
+    void updateTransferProgress();
     void setupTrayIcon();
     void setupFileWatcher();
     void updateFileWatcher();
     void performAutoBackup(const QString &gameId);
+    // Applies the game's retention rules, if enabled
+    void pruneBackups(const QString &gameId);
 
     QMap<QString, QString> loadSavePathOverrides() const;
     void saveSavePathOverride(const QString &gameId, const QString &path);
@@ -106,13 +132,25 @@ private:
     QString m_currentGameId;
     QLabel *m_storageLabel;
     QProgressBar *m_progressBar;
+    QToolButton *m_cancelButton;
     QLineEdit *m_searchEdit;
     QStackedWidget *m_gamesStack;
     QLabel *m_gamesEmptyLabel;
     QStackedWidget *m_backupsStack;
     QLabel *m_backupsEmptyLabel;
-    QList<GameInfo> m_bulkBackupQueue;
-    void processNextBulkBackup();
+    QSet<quint64> m_bulkBackupJobs;
+    int m_bulkBackupTotal = 0;
+    QSet<quint64> m_verifyJobs;
+    int m_verifyTotal = 0;
+    int m_verifyChecked = 0;
+    QStringList m_verifyFailures;
+    // Latest progress per running job: done, total, bytes per second
+    struct JobTransfer {
+        qint64 bytesDone = 0;
+        qint64 bytesTotal = 0;
+        qint64 bytesPerSecond = 0;
+    };
+    QHash<quint64, JobTransfer> m_jobTransfers;
 
     OnboardingDialog *m_onboardingDialog = nullptr;
 
@@ -120,6 +158,7 @@ private:
     QPushButton *m_createBackupBtn = nullptr;
     QPushButton *m_restoreBackupBtn = nullptr;
     QPushButton *m_deleteBackupBtn = nullptr;
+    QPushButton *m_undoRestoreBtn = nullptr;
 
     QLocalServer *m_localServer = nullptr;
     QSystemTrayIcon *m_trayIcon = nullptr;
@@ -127,6 +166,8 @@ private:
     QTimer *m_autoBackupTimer = nullptr;
     QMap<QString, QString> m_watchedPathToGameId;
     QSet<QString> m_pendingAutoBackups;
+    QHash<quint64, GameInfo> m_autoBackupJobs;
+    QSet<QString> m_skippedAutoBackups;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,127 @@
+#include "retentiondialog.h"
+#include "core/database.h"
+#include <QVBoxLayout>
+#include <QFormLayout>
+#include <QLabel>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QGroupBox>
+#include <QDialogButtonBox>
+
+RetentionDialog::RetentionDialog(Database *database, const QString &gameId, const QString &gameName,
+                                 QWidget *parent)
+    : QDialog(parent)
+    , m_database(database)
+    , m_gameId(gameId)
+{
+    setWindowTitle(gameId.isEmpty() ? QString("Default Retention Rules")
+                                    : QString("Retention Rules - %1").arg(gameName));
+    setMinimumWidth(420);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    QLabel *infoLabel = new QLabel(
+        "After each backup, older backups are thinned out: a backup is kept if it is one of "
+        "the newest, or the newest of its hour, day or week within the ranges below. "
+        "Backups with notes or marked \"Keep forever\" are never deleted.", this);
+    infoLabel->setWordWrap(true);
+    mainLayout->addWidget(infoLabel);
+
+    if (!gameId.isEmpty()) {
+        m_useDefaultCheck = new QCheckBox("Use default rules", this);
+        m_useDefaultCheck->setChecked(!m_database->hasRetentionPolicy(gameId));
+        connect(m_useDefaultCheck, &QCheckBox::toggled, this, &RetentionDialog::updateEnabledState);
+        mainLayout->addWidget(m_useDefaultCheck);
+    }
+
+    m_rulesGroup = new QGroupBox("Rules", this);
+    QFormLayout *form = new QFormLayout(m_rulesGroup);
+
+    m_enabledCheck = new QCheckBox("Delete old backups automatically", this);
+    connect(m_enabledCheck, &QCheckBox::toggled, this, &RetentionDialog::updateEnabledState);
+    form->addRow("", m_enabledCheck);
+
+    m_keepLastSpin = new QSpinBox(this);
+    m_keepLastSpin->setRange(1, 1000);
+    m_keepLastSpin->setSuffix(" backups");
+    form->addRow("Always Keep Newest:", m_keepLastSpin);
+
+    m_hourlySpin = new QSpinBox(this);
+    m_hourlySpin->setRange(0, 24 * 14);
+    m_hourlySpin->setSuffix(" hours");
+    m_hourlySpin->setSpecialValueText("Off");
+    form->addRow("One per Hour For:", m_hourlySpin);
+
+    m_dailySpin = new QSpinBox(this);
+    m_dailySpin->setRange(0, 365);
+    m_dailySpin->setSuffix(" days");
+    m_dailySpin->setSpecialValueText("Off");
+    form->addRow("One per Day For:", m_dailySpin);
+
+    m_weeklySpin = new QSpinBox(this);
+    m_weeklySpin->setRange(0, 520);
+    m_weeklySpin->setSuffix(" weeks");
+    m_weeklySpin->setSpecialValueText("Off");
+    form->addRow("One per Week For:", m_weeklySpin);
+
+    m_sizeCapSpin = new QSpinBox(this);
+    m_sizeCapSpin->setRange(0, 1024 * 1024);
+    m_sizeCapSpin->setSuffix(" MB");
+    m_sizeCapSpin->setSpecialValueText("No limit");
+    m_sizeCapSpin->setToolTip("Oldest backups are deleted until the game's backups fit; "
+                              "the newest backup is always kept");
+    form->addRow("Size Limit:", m_sizeCapSpin);
+
+    mainLayout->addWidget(m_rulesGroup);
+
+    mainLayout->addStretch();
+    QDialogButtonBox *buttons = new QDialogButtonBox(
+        QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &RetentionDialog::onAccept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    mainLayout->addWidget(buttons);
+
+    // Games on the default rules start from them when switching to their own
+    RetentionPolicy current = m_database->getRetentionPolicy(gameId);
+    m_enabledCheck->setChecked(current.enabled);
+    m_keepLastSpin->setValue(current.keepLast);
+    m_hourlySpin->setValue(current.hourly);
+    m_dailySpin->setValue(current.daily);
+    m_weeklySpin->setValue(current.weekly);
+    m_sizeCapSpin->setValue(static_cast<int>(current.maxTotalSize / (1024 * 1024)));
+    updateEnabledState();
+}
+
+RetentionPolicy RetentionDialog::policy() const
+{
+    RetentionPolicy policy;
+    policy.enabled = m_enabledCheck->isChecked();
+    policy.keepLast = m_keepLastSpin->value();
+    policy.hourly = m_hourlySpin->value();
+    policy.daily = m_dailySpin->value();
+    policy.weekly = m_weeklySpin->value();
+    policy.maxTotalSize = qint64(m_sizeCapSpin->value()) * 1024 * 1024;
+    return policy;
+}
+
+void RetentionDialog::updateEnabledState()
+{
+    bool custom = !m_useDefaultCheck || !m_useDefaultCheck->isChecked();
+    m_rulesGroup->setEnabled(custom);
+    bool enabled = m_enabledCheck->isChecked();
+    m_keepLastSpin->setEnabled(enabled);
+    m_hourlySpin->setEnabled(enabled);
+    m_dailySpin->setEnabled(enabled);
+    m_weeklySpin->setEnabled(enabled);
+    m_sizeCapSpin->setEnabled(enabled);
+}
+
+void RetentionDialog::onAccept()
+{
+    if (m_useDefaultCheck && m_useDefaultCheck->isChecked()) {
+        m_database->clearRetentionPolicy(m_gameId);
+    } else {
+        m_database->setRetentionPolicy(m_gameId, policy());
+    }
+    accept();
+}
@@ -0,0 +1,40 @@
+#ifndef RETENTIONDIALOG_H
+#define RETENTIONDIALOG_H
+
+#include <QDialog>
+#include "core/retentionpolicy.h"
+
+class QCheckBox;
+class QSpinBox;
+class QGroupBox;
+class Database;
+
+// Edits the default retention rules (empty game id) or one game's own rules
+class RetentionDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    RetentionDialog(Database *database, const QString &gameId, const QString &gameName,
+                    QWidget *parent = nullptr);
+
+    RetentionPolicy policy() const;
+
+private slots:
+    void onAccept();
+    void updateEnabledState();
+
+private:
+    Database *m_database;
+    QString m_gameId;
+    QCheckBox *m_useDefaultCheck = nullptr;
+    QGroupBox *m_rulesGroup;
+    QCheckBox *m_enabledCheck;
+    QSpinBox *m_keepLastSpin;
+    QSpinBox *m_hourlySpin;
+    QSpinBox *m_dailySpin;
+    QSpinBox *m_weeklySpin;
+    QSpinBox *m_sizeCapSpin;
+};
+
+#endif // RETENTIONDIALOG_H
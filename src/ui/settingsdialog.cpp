@@ -1,5 +1,6 @@
 #include "settingsdialog.h"
 #include "core/database.h"
+#include "retentiondialog.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
@@ -36,12 +37,65 @@ SettingsDialog::SettingsDialog(Database *database, QWidget *parent)
     dirLayout->addWidget(browseButton);
     backupForm->addRow("Backup Directory:", dirLayout);
 
+    m_formatCombo = new QComboBox(this);
+    m_formatCombo->addItem("Compressed archive (.tar.gz)", "tar.gz");
+    m_formatCombo->addItem("Compressed archive (.tar.zst)", "tar.zst");
+    m_formatCombo->addItem("Deduplicated chunk store", "chunks");
+    m_formatCombo->addItem("Binary deltas (large single-file saves)", "delta");
+    m_formatCombo->addItem("Hard-linked snapshots (fastest, uncompressed)", "hardlinks");
+    m_formatCombo->setToolTip("zstd is faster and smaller than gzip on large world saves; "
+                              "the chunk store keeps data shared between backups only once; "
+                              "binary deltas store only the bytes that changed since the previous backup; "
+                              "hard-linked snapshots copy only changed files and link the rest to the previous backup");
+    backupForm->addRow("Backup Format:", m_formatCombo);
+
     m_compressionCombo = new QComboBox(this);
-    m_compressionCombo->addItem("Fast (gzip -1)", 1);
-    m_compressionCombo->addItem("Default (gzip -6)", 6);
-    m_compressionCombo->addItem("Best (gzip -9)", 9);
     backupForm->addRow("Compression Level:", m_compressionCombo);
 
+    m_threadsSpin = new QSpinBox(this);
+    m_threadsSpin->setRange(0, 64);
+    m_threadsSpin->setSpecialValueText("Auto");
+    m_threadsSpin->setToolTip("Worker threads used for gzip and zstd compression");
+    backupForm->addRow("Compression Threads:", m_threadsSpin);
+
+    m_longDistanceCheck = new QCheckBox("Long-distance matching (better ratio on large saves)", this);
+    backupForm->addRow("", m_longDistanceCheck);
+
+    m_keyframeSpin = new QSpinBox(this);
+    m_keyframeSpin->setRange(1, 100);
+    m_keyframeSpin->setSuffix(" backups");
+    m_keyframeSpin->setToolTip("Store a full copy every N backups so restores never replay a long chain");
+    backupForm->addRow("Full Copy Every:", m_keyframeSpin);
+
+    m_differentialRestoreCheck = new QCheckBox("Only rewrite files that changed when restoring", this);
+    m_differentialRestoreCheck->setToolTip("Compares the backup with the save on disk and leaves matching files alone "
+                                           "instead of replacing the whole save folder");
+    backupForm->addRow("", m_differentialRestoreCheck);
+
+    m_memoryBudgetSpin = new QSpinBox(this);
+    m_memoryBudgetSpin->setRange(16, 4096);
+    m_memoryBudgetSpin->setSuffix(" MB");
+    m_memoryBudgetSpin->setToolTip("Buffers one backup or restore may use, whatever the size of the save. "
+                                   "A larger budget allows more compression threads, zstd levels above 11 "
+                                   "and binary deltas of larger files.");
+    backupForm->addRow("Memory Per Job:", m_memoryBudgetSpin);
+
+    m_safetySnapshotsCheck = new QCheckBox("Keep the replaced save files for a day so a restore can be undone", this);
+    m_safetySnapshotsCheck->setToolTip("Uses hard links or reflink clones next to the save folder, "
+                                       "so it costs little time or space");
+    backupForm->addRow("", m_safetySnapshotsCheck);
+
+    QPushButton *retentionButton = new QPushButton("Edit Rules...", this);
+    retentionButton->setToolTip("Which old backups are deleted automatically after a new one is made");
+    connect(retentionButton, &QPushButton::clicked, this, &SettingsDialog::onRetentionRules);
+    QHBoxLayout *retentionLayout = new QHBoxLayout();
+    retentionLayout->addWidget(retentionButton);
+    retentionLayout->addStretch();
+    backupForm->addRow("Old Backups:", retentionLayout);
+
+    connect(m_formatCombo, &QComboBox::currentIndexChanged, this, &SettingsDialog::onFormatChanged);
+    onFormatChanged();
+
     mainLayout->addWidget(backupGroup);
 
     // --- System Tray group ---
@@ -65,6 +119,23 @@ SettingsDialog::SettingsDialog(Database *database, QWidget *parent)
     intervalLayout->addStretch();
     trayLayout->addLayout(intervalLayout);
 
+    m_lowImpactCheck = new QCheckBox("Run auto-backups at low priority so a running game does not stutter", this);
+    m_lowImpactCheck->setToolTip("Uses idle disk and CPU priority and keeps the backup out of the file cache; "
+                                 "backups you start yourself always run at full speed");
+    trayLayout->addWidget(m_lowImpactCheck);
+
+    QHBoxLayout *bandwidthLayout = new QHBoxLayout();
+    QLabel *bandwidthLabel = new QLabel("Auto-backup speed limit:", this);
+    m_bandwidthSpin = new QSpinBox(this);
+    m_bandwidthSpin->setRange(0, 10000);
+    m_bandwidthSpin->setSuffix(" MB/s");
+    m_bandwidthSpin->setSpecialValueText("Unlimited");
+    bandwidthLayout->addWidget(bandwidthLabel);
+    bandwidthLayout->addWidget(m_bandwidthSpin);
+    bandwidthLayout->addStretch();
+    trayLayout->addLayout(bandwidthLayout);
+    connect(m_lowImpactCheck, &QCheckBox::toggled, m_bandwidthSpin, &QSpinBox::setEnabled);
+
     mainLayout->addWidget(trayGroup);
 
     // --- Misc group ---
@@ -94,16 +165,29 @@ void SettingsDialog::loadSettings()
                          + "/game-rewind";
     m_backupDirEdit->setText(m_database->getSetting("backup_directory", defaultDir));
 
+    int formatIdx = m_formatCombo->findData(m_database->getSetting("backup_format", "tar.gz"));
+    if (formatIdx >= 0) m_formatCombo->setCurrentIndex(formatIdx);
+
     int compression = m_database->getSetting("compression_level", "6").toInt();
     int comboIdx = m_compressionCombo->findData(compression);
     if (comboIdx >= 0) m_compressionCombo->setCurrentIndex(comboIdx);
 
+    m_threadsSpin->setValue(m_database->getSetting("compression_threads", "0").toInt());
+    m_longDistanceCheck->setChecked(m_database->getSetting("zstd_long", "0") == "1");
+    m_keyframeSpin->setValue(m_database->getSetting("delta_keyframe_interval", "10").toInt());
+    m_differentialRestoreCheck->setChecked(m_database->getSetting("differential_restore", "0") == "1");
+    m_memoryBudgetSpin->setValue(m_database->getSetting("memory_budget_mb", "64").toInt());
+    m_safetySnapshotsCheck->setChecked(m_database->getSetting("safety_snapshots", "1") == "1");
+
     m_minimizeToTrayCheck->setChecked(
         m_database->getSetting("minimize_to_tray", "0") == "1");
     m_autoBackupCheck->setChecked(
         m_database->getSetting("auto_backup_enabled", "0") == "1");
     m_autoBackupIntervalSpin->setValue(
         m_database->getSetting("auto_backup_interval", "30").toInt());
+    m_lowImpactCheck->setChecked(m_database->getSetting("low_impact_auto_backup", "1") == "1");
+    m_bandwidthSpin->setValue(m_database->getSetting("auto_backup_bandwidth_mb", "0").toInt());
+    m_bandwidthSpin->setEnabled(m_lowImpactCheck->isChecked());
 }
 
 void SettingsDialog::saveSettings()
@@ -111,12 +195,21 @@ void SettingsDialog::saveSettings()
     m_database->setSetting("backup_directory", m_backupDirEdit->text().trimmed());
     m_database->setSetting("compression_level",
         QString::number(m_compressionCombo->currentData().toInt()));
+    m_database->setSetting("backup_format", m_formatCombo->currentData().toString());
+    m_database->setSetting("compression_threads", QString::number(m_threadsSpin->value()));
+    m_database->setSetting("zstd_long", m_longDistanceCheck->isChecked() ? "1" : "0");
+    m_database->setSetting("delta_keyframe_interval", QString::number(m_keyframeSpin->value()));
+    m_database->setSetting("differential_restore", m_differentialRestoreCheck->isChecked() ? "1" : "0");
+    m_database->setSetting("memory_budget_mb", QString::number(m_memoryBudgetSpin->value()));
+    m_database->setSetting("safety_snapshots", m_safetySnapshotsCheck->isChecked() ? "1" : "0");
     m_database->setSetting("minimize_to_tray",
         m_minimizeToTrayCheck->isChecked() ? "1" : "0");
     m_database->setSetting("auto_backup_enabled",
         m_autoBackupCheck->isChecked() ? "1" : "0");
     m_database->setSetting("auto_backup_interval",
         QString::number(m_autoBackupIntervalSpin->value()));
+    m_database->setSetting("low_impact_auto_backup", m_lowImpactCheck->isChecked() ? "1" : "0");
+    m_database->setSetting("auto_backup_bandwidth_mb", QString::number(m_bandwidthSpin->value()));
 }
 
 void SettingsDialog::onBrowseBackupDir()
@@ -128,6 +221,43 @@ void SettingsDialog::onBrowseBackupDir()
     }
 }
 
+void SettingsDialog::onFormatChanged()
+{
+    // Level presets differ per codec; keep the closest level when switching
+    int previous = m_compressionCombo->currentData().toInt();
+    QString format = m_formatCombo->currentData().toString();
+    bool zstd = format == "tar.zst";
+
+    m_compressionCombo->clear();
+    if (zstd) {
+        m_compressionCombo->addItem("Fast (zstd -1)", 1);
+        m_compressionCombo->addItem("Default (zstd -3)", 3);
+        m_compressionCombo->addItem("High (zstd -9)", 9);
+        m_compressionCombo->addItem("Maximum (zstd -19)", 19);
+    } else {
+        QString codec = format == "chunks" || format == "delta" ? "zlib" : "gzip";
+        m_compressionCombo->addItem(QString("Fast (%1 -1)").arg(codec), 1);
+        m_compressionCombo->addItem(QString("Default (%1 -6)").arg(codec), 6);
+        m_compressionCombo->addItem(QString("Best (%1 -9)").arg(codec), 9);
+    }
+
+    int idx = m_compressionCombo->findData(previous);
+    m_compressionCombo->setCurrentIndex(idx >= 0 ? idx : 1);
+
+    // Snapshots are stored uncompressed
+    m_compressionCombo->setEnabled(format != "hardlinks");
+    m_threadsSpin->setEnabled(format != "chunks" && format != "delta" && format != "hardlinks");
+    m_longDistanceCheck->setEnabled(zstd);
+    m_keyframeSpin->setEnabled(format == "delta");
+}
+
+void SettingsDialog::onRetentionRules()
+{
+    // Games with their own rules are edited from the game's context menu
+    RetentionDialog dialog(m_database, QString(), QString(), this);
+    dialog.exec();
+}
+
 void SettingsDialog::onResetOnboarding()
 {
     m_database->setSetting("onboarding_completed", "0");
@@ -155,6 +285,41 @@ int SettingsDialog::compressionLevel() const
     return m_compressionCombo->currentData().toInt();
 }
 
+QString SettingsDialog::backupFormat() const
+{
+    return m_formatCombo->currentData().toString();
+}
+
+int SettingsDialog::compressionThreads() const
+{
+    return m_threadsSpin->value();
+}
+
+bool SettingsDialog::longDistanceMatching() const
+{
+    return m_longDistanceCheck->isChecked();
+}
+
+int SettingsDialog::deltaKeyframeInterval() const
+{
+    return m_keyframeSpin->value();
+}
+
+bool SettingsDialog::differentialRestore() const
+{
+    return m_differentialRestoreCheck->isChecked();
+}
+
+int SettingsDialog::memoryBudgetMB() const
+{
+    return m_memoryBudgetSpin->value();
+}
+
+bool SettingsDialog::safetySnapshots() const
+{
+    return m_safetySnapshotsCheck->isChecked();
+}
+
 bool SettingsDialog::minimizeToTray() const
 {
     return m_minimizeToTrayCheck->isChecked();
@@ -169,3 +334,13 @@ int SettingsDialog::autoBackupIntervalSeconds() const
 {
     return m_autoBackupIntervalSpin->value();
 }
+
+bool SettingsDialog::lowImpactAutoBackups() const
+{
+    return m_lowImpactCheck->isChecked();
+}
+
+int SettingsDialog::autoBackupBandwidthMB() const
+{
+    return m_bandwidthSpin->value();
+}
@@ -18,15 +18,27 @@ public:
 
     QString backupDirectory() const;
     int compressionLevel() const;
+    QString backupFormat() const;
+    int compressionThreads() const;
+    bool longDistanceMatching() const;
+    int deltaKeyframeInterval() const;
+    bool differentialRestore() const;
+    int memoryBudgetMB() const;
+    bool safetySnapshots() const;
     bool minimizeToTray() const;
     bool autoBackupEnabled() const;
     int autoBackupIntervalSeconds() const;
+    bool lowImpactAutoBackups() const;
+    // 0 = unlimited
+    int autoBackupBandwidthMB() const;
 
 signals:
     void onboardingResetRequested();
 
 private slots:
     void onBrowseBackupDir();
+    void onFormatChanged();
+    void onRetentionRules();
     void onResetOnboarding();
     void onAccept();
 
@@ -38,9 +50,18 @@ private:
     bool m_onboardingReset = false;
     QLineEdit *m_backupDirEdit;
     QComboBox *m_compressionCombo;
+    QComboBox *m_formatCombo;
+    QSpinBox  *m_threadsSpin;
+    QCheckBox *m_longDistanceCheck;
+    QSpinBox  *m_keyframeSpin;
+    QCheckBox *m_differentialRestoreCheck;
+    QSpinBox  *m_memoryBudgetSpin;
+    QCheckBox *m_safetySnapshotsCheck;
     QCheckBox *m_minimizeToTrayCheck;
     QCheckBox *m_autoBackupCheck;
     QSpinBox  *m_autoBackupIntervalSpin;
+    QCheckBox *m_lowImpactCheck;
+    QSpinBox  *m_bandwidthSpin;
 };
 
 #endif // SETTINGSDIALOG_H
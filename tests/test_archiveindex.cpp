@@ -0,0 +1,172 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+#include <QFile>
+#include <QFileInfo>
+#include "core/archiveindex.h"
+#include "core/parallelgzip.h"
+#include "core/transferprogress.h"
+
+class TestArchiveIndex : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString dir() const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction();
+    }
+
+    static QByteArray sampleData(qsizetype size)
+    {
+        QRandomGenerator rng(11);
+        QByteArray data;
+        data.reserve(size);
+        while (data.size() < size) {
+            if (rng.bounded(2))
+                data.append(QByteArray("slot=2;gold=513;map=forest;").repeated(6));
+            else
+                for (int i = 0; i < 150; ++i)
+                    data.append(char(rng.bounded(256)));
+        }
+        data.truncate(size);
+        return data;
+    }
+
+    static QByteArray readFile(const QString &path)
+    {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return f.readAll();
+    }
+
+    static ArchiveIndex::Entry fileEntry(const QString &path, qint64 offset, qint64 size)
+    {
+        ArchiveIndex::Entry entry;
+        entry.path = path;
+        entry.type = "file";
+        entry.offset = offset;
+        entry.size = size;
+        entry.mtime = 1700000000;
+        return entry;
+    }
+
+    // The index only cares about positions in the uncompressed stream, so a
+    // blob compressed in small blocks stands in for the tar
+    ArchiveIndex writeStream(const QString &archivePath, const QByteArray &stream)
+    {
+        ParallelGzipWriter writer(6, 2, 8 * 1024);
+        if (!writer.open(archivePath) || !writer.write(stream.constData(), stream.size()) || !writer.close())
+            return ArchiveIndex();
+        ArchiveIndex index;
+        index.setMembers(writer.blockSize(), writer.memberSizes());
+        return index;
+    }
+
+private slots:
+    void extract_readsSelectedFilesAcrossMembers()
+    {
+        QByteArray stream = sampleData(200000);
+        QString archivePath = dir() + ".gz";
+        ArchiveIndex index = writeStream(archivePath, stream);
+
+        ArchiveIndex::Entry saveDir;
+        saveDir.path = "Save";
+        saveDir.type = "dir";
+        index.addEntry(saveDir);
+        index.addEntry(fileEntry("Save/early.sav", 100, 5000));
+        // Spans several 8 KiB members
+        index.addEntry(fileEntry("Save/big.sav", 30000, 50000));
+        // Behind the previous one, forces a seek back
+        index.addEntry(fileEntry("Save/late.sav", 190000, 9000));
+        index.addEntry(fileEntry("Other/empty.sav", 0, 0));
+
+        QString target = dir() + "/out";
+        QVERIFY(index.extract(archivePath, {"Save/big.sav", "Save/late.sav"}, target));
+        QCOMPARE(readFile(target + "/Save/big.sav"), stream.mid(30000, 50000));
+        QCOMPARE(readFile(target + "/Save/late.sav"), stream.mid(190000, 9000));
+        QVERIFY(!QFile::exists(target + "/Save/early.sav"));
+        QVERIFY(!QFile::exists(target + "/Other/empty.sav"));
+
+        QString all = dir() + "/all";
+        QVERIFY(index.extract(archivePath, QStringList(), all));
+        QCOMPARE(readFile(all + "/Save/early.sav"), stream.mid(100, 5000));
+        QVERIFY(QFile::exists(all + "/Other/empty.sav"));
+    }
+
+    void extract_rejectsStaleIndex()
+    {
+        QByteArray stream = sampleData(40000);
+        QString archivePath = dir() + ".gz";
+        ArchiveIndex index = writeStream(archivePath, stream);
+        index.addEntry(fileEntry("a.sav", 0, 1000));
+
+        QFile f(archivePath);
+        QVERIFY(f.open(QIODevice::Append));
+        f.write("trailing");
+        f.close();
+
+        QString target = dir() + "/out";
+        QVERIFY(!index.extract(archivePath, QStringList(), target));
+        QVERIFY(!QFile::exists(target + "/a.sav"));
+    }
+
+    void saveLoad_roundtrips()
+    {
+        QByteArray stream = sampleData(30000);
+        QString archivePath = dir() + ".gz";
+        ArchiveIndex index = writeStream(archivePath, stream);
+        ArchiveIndex::Entry entry = fileEntry("run.sh", 2000, 300);
+        entry.executable = true;
+        index.addEntry(entry);
+        ArchiveIndex::Entry link;
+        link.path = "current";
+        link.type = "symlink";
+        link.linkTarget = "run.sh";
+        index.addEntry(link);
+        QVERIFY(index.save(archivePath + ".index"));
+
+        bool ok = false;
+        ArchiveIndex loaded = ArchiveIndex::load(archivePath + ".index", &ok);
+        QVERIFY(ok);
+        QCOMPARE(loaded.entries().size(), 2);
+        QVERIFY(loaded.find("run.sh"));
+        QCOMPARE(loaded.find("run.sh")->offset, qint64(2000));
+        QVERIFY(loaded.find("run.sh")->executable);
+        QCOMPARE(loaded.find("current")->linkTarget, QString("run.sh"));
+
+        QString target = dir() + "/out";
+        QVERIFY(loaded.extract(archivePath, {"run.sh"}, target));
+        QCOMPARE(readFile(target + "/run.sh"), stream.mid(2000, 300));
+        QVERIFY(QFileInfo(target + "/run.sh").isExecutable());
+
+        ArchiveIndex::load(dir() + "/missing.index", &ok);
+        QVERIFY(!ok);
+    }
+
+    void extract_stopsWhenCancelled()
+    {
+        QByteArray stream = sampleData(100000);
+        QString archivePath = dir() + ".gz";
+        ArchiveIndex index = writeStream(archivePath, stream);
+        index.addEntry(fileEntry("a.sav", 0, 90000));
+
+        TransferProgress progress([]() { return true; });
+        index.setProgress(&progress);
+        QVERIFY(!index.extract(archivePath, QStringList(), dir() + "/out"));
+    }
+
+    void isSelected_matchesPathsAndChildren()
+    {
+        QVERIFY(ArchiveIndex::isSelected("Save/a.sav", QStringList()));
+        QVERIFY(ArchiveIndex::isSelected("Save/a.sav", {"Save/a.sav"}));
+        QVERIFY(ArchiveIndex::isSelected("Save/sub/b.sav", {"Save"}));
+        QVERIFY(!ArchiveIndex::isSelected("Saves/a.sav", {"Save"}));
+        QVERIFY(!ArchiveIndex::isSelected("Save", {"Save/a.sav"}));
+    }
+};
+
+QTEST_MAIN(TestArchiveIndex)
+#include "test_archiveindex.moc"
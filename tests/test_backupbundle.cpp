@@ -0,0 +1,352 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QBuffer>
+#include <QSignalSpy>
+#include <QThread>
+#include "core/savemanager.h"
+#include "core/backupbundle.h"
+#include "core/dirwalker.h"
+#include <archive.h>
+#include <archive_entry.h>
+
+class TestBackupBundle : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+    SaveManager *m_source = nullptr;
+    SaveManager *m_target = nullptr;
+    QString m_saveDir;
+
+    QString testDir() const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction();
+    }
+
+    static void writeFile(const QString &path, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write test file");
+        f.write(data);
+        f.close();
+    }
+
+    static QByteArray readFile(const QString &path)
+    {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return f.readAll();
+    }
+
+    GameInfo makeGame(const QString &id)
+    {
+        GameInfo game;
+        game.id = id;
+        game.name = id.toUpper();
+        game.platform = "native";
+        game.detectedSavePath = m_saveDir;
+        game.isDetected = true;
+        return game;
+    }
+
+    // Two backups of the game in the given format, world.dat changing in
+    // between and config.ini not
+    void backUpTwice(const QString &gameId, const QString &format)
+    {
+        m_source->setBackupFormat(format);
+        GameInfo game = makeGame(gameId);
+        writeFile(m_saveDir + "/config.ini", "[settings]\nvolume=80\n");
+        writeFile(m_saveDir + "/world.dat", QByteArray(64 * 1024, 'a') + format.toUtf8());
+        QVERIFY(m_source->createBackup(game, "First"));
+        QThread::msleep(5);
+        writeFile(m_saveDir + "/world.dat", QByteArray(64 * 1024, 'b') + format.toUtf8());
+        QVERIFY(m_source->createBackup(game, "Second"));
+        QThread::msleep(5);
+    }
+
+    QByteArray exportAll(BackupBundle::Stats *stats = nullptr)
+    {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        if (!m_source->exportBackups(QStringList(), &buffer, stats))
+            return QByteArray();
+        return buffer.data();
+    }
+
+    bool import(const QByteArray &data, BackupBundle::Stats *stats = nullptr)
+    {
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        return m_target->importBackups(&buffer, stats);
+    }
+
+    QByteArray restoredWorld(const BackupInfo &backup, const QString &name)
+    {
+        QString dir = testDir() + "/" + name;
+        if (!m_target->restoreBackup(backup, dir))
+            return QByteArray();
+        return readFile(dir + "/world.dat");
+    }
+
+    struct CraftedEntry {
+        QString path;
+        unsigned int type;
+        QByteArray data;
+        QString link;
+    };
+
+    // A bundle header followed by the given entries, as a hostile bundle
+    // would write them
+    static QByteArray craftBundle(const QList<CraftedEntry> &entries)
+    {
+        QList<CraftedEntry> all;
+        all.append({"game-rewind-bundle.json", AE_IFREG,
+                    R"({"format":"game-rewind-bundle","version":1})", QString()});
+        all.append(entries);
+
+        QByteArray out(1024 * 1024, '\0');
+        size_t used = 0;
+        struct archive *a = archive_write_new();
+        archive_write_set_format_pax_restricted(a);
+        archive_write_open_memory(a, out.data(), out.size(), &used);
+        for (const CraftedEntry &crafted : all) {
+            struct archive_entry *entry = archive_entry_new();
+            archive_entry_set_pathname_utf8(entry, crafted.path.toUtf8().constData());
+            archive_entry_set_perm(entry, 0644);
+            if (crafted.type == AE_IFLNK) {
+                archive_entry_set_filetype(entry, AE_IFLNK);
+                archive_entry_set_symlink_utf8(entry, crafted.link.toUtf8().constData());
+            } else {
+                archive_entry_set_filetype(entry, AE_IFREG);
+                archive_entry_set_size(entry, crafted.data.size());
+                if (!crafted.link.isEmpty()) {
+                    archive_entry_set_size(entry, 0);
+                    archive_entry_set_hardlink_utf8(entry, crafted.link.toUtf8().constData());
+                }
+            }
+            archive_write_header(a, entry);
+            if (crafted.link.isEmpty() && !crafted.data.isEmpty())
+                archive_write_data(a, crafted.data.constData(), crafted.data.size());
+            archive_entry_free(entry);
+        }
+        archive_write_close(a);
+        archive_write_free(a);
+        out.resize(static_cast<qsizetype>(used));
+        return out;
+    }
+
+    bool hasStagingLeft() const
+    {
+        return !QDir(m_target->getBackupDirectory())
+                    .entryList(QStringList() << ".import-*", QDir::Dirs | QDir::Hidden).isEmpty();
+    }
+
+private slots:
+    void init()
+    {
+        m_saveDir = testDir() + "/save";
+        m_source = new SaveManager(this);
+        m_source->setBackupDirectory(testDir() + "/source");
+        m_target = new SaveManager(this);
+        m_target->setBackupDirectory(testDir() + "/target");
+    }
+
+    void cleanup()
+    {
+        delete m_source;
+        delete m_target;
+        m_source = m_target = nullptr;
+    }
+
+    void roundTrip_everyFormat()
+    {
+        const QStringList formats = {"tar.gz", "tar.zst", "chunks", "delta", "hardlinks"};
+        for (const QString &format : formats)
+            backUpTwice("game-" + QString(format).replace('.', '-'), format);
+
+        BackupBundle::Stats exported;
+        QByteArray bundle = exportAll(&exported);
+        QVERIFY(!bundle.isEmpty());
+        QCOMPARE(exported.backups, 10);
+
+        BackupBundle::Stats imported;
+        QSignalSpy spy(m_target, &SaveManager::backupsImported);
+        QVERIFY(import(bundle, &imported));
+        QCOMPARE(imported.backups, 10);
+        QCOMPARE(imported.skippedBackups, 0);
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(!hasStagingLeft());
+
+        QCOMPARE(m_target->getAllGameIdsWithBackups().size(), 5);
+        for (const QString &format : formats) {
+            QString gameId = "game-" + QString(format).replace('.', '-');
+            QList<BackupInfo> backups = m_target->getBackupsForGame(gameId);
+            QCOMPARE(backups.size(), 2);
+            QCOMPARE(backups[0].format, format);
+            QCOMPARE(backups[0].gameName, gameId.toUpper());
+            QVERIFY(backups[0].archivePath.startsWith(m_target->getBackupDirectory()));
+            QVERIFY(m_target->verifyBackup(backups[0], SaveManager::VerifyContent));
+            QVERIFY(m_target->verifyBackup(backups[1], SaveManager::VerifyContent));
+            QCOMPARE(restoredWorld(backups[0], gameId + "-new"), QByteArray(64 * 1024, 'b') + format.toUtf8());
+            QCOMPARE(restoredWorld(backups[1], gameId + "-old"), QByteArray(64 * 1024, 'a') + format.toUtf8());
+        }
+    }
+
+    void import_keepsSnapshotsLinked()
+    {
+        backUpTwice("linked", "hardlinks");
+        QVERIFY(import(exportAll()));
+
+        QList<BackupInfo> backups = m_target->getBackupsForGame("linked");
+        QCOMPARE(backups.size(), 2);
+        QString saveName = QFileInfo(m_saveDir).fileName();
+        DirWalker::FileStat newer, older;
+        QVERIFY(DirWalker::stat(backups[0].archivePath + "/" + saveName + "/config.ini", &newer));
+        QVERIFY(DirWalker::stat(backups[1].archivePath + "/" + saveName + "/config.ini", &older));
+        QCOMPARE(newer.inode, older.inode);
+        QVERIFY(DirWalker::stat(backups[0].archivePath + "/" + saveName + "/world.dat", &newer));
+        QVERIFY(DirWalker::stat(backups[1].archivePath + "/" + saveName + "/world.dat", &older));
+        QVERIFY(newer.inode != older.inode);
+    }
+
+    void import_skipsBackupsAlreadyPresent()
+    {
+        backUpTwice("again", "tar.gz");
+        QByteArray bundle = exportAll();
+        QVERIFY(import(bundle));
+
+        // Changed locally: a second import must not overwrite it
+        BackupInfo local = m_target->getBackupsForGame("again")[0];
+        local.notes = "kept";
+        QVERIFY(m_target->updateBackupMetadata(local));
+
+        BackupBundle::Stats stats;
+        QVERIFY(import(bundle, &stats));
+        QCOMPARE(stats.backups, 0);
+        QCOMPARE(stats.skippedBackups, 2);
+        QList<BackupInfo> backups = m_target->getBackupsForGame("again");
+        QCOMPARE(backups.size(), 2);
+        QCOMPARE(backups[0].notes, QString("kept"));
+    }
+
+    void exportBackups_singleGame()
+    {
+        backUpTwice("one", "tar.gz");
+        backUpTwice("two", "tar.gz");
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        BackupBundle::Stats stats;
+        QVERIFY(m_source->exportBackups(QStringList() << "two", &buffer, &stats));
+        QCOMPARE(stats.backups, 2);
+        QVERIFY(import(buffer.data()));
+        QCOMPARE(m_target->getAllGameIdsWithBackups(), QStringList() << "two");
+    }
+
+    void import_rejectsDamagedBackup()
+    {
+        backUpTwice("damaged", "hardlinks");
+        QByteArray bundle = exportAll();
+
+        // The second snapshot's world.dat is stored as is; flip one byte
+        qsizetype pos = bundle.indexOf(QByteArray(64 * 1024, 'b'));
+        QVERIFY(pos > 0);
+        bundle[pos + 100] = 'c';
+
+        BackupBundle::Stats stats;
+        QVERIFY(!import(bundle, &stats));
+        // The first backup was complete and verified before the damage
+        QCOMPARE(stats.backups, 1);
+        QList<BackupInfo> backups = m_target->getBackupsForGame("damaged");
+        QCOMPARE(backups.size(), 1);
+        QCOMPARE(backups[0].displayName, QString("First"));
+        QVERIFY(!hasStagingLeft());
+        QCOMPARE(QDir(m_target->getBackupDirectory() + "/games/damaged")
+                     .entryList(QStringList() << "*.tree", QDir::Dirs).size(), 1);
+    }
+
+    void import_rejectsTruncatedBundle()
+    {
+        backUpTwice("cut", "tar.zst");
+        QByteArray bundle = exportAll();
+        bundle.chop(bundle.size() / 3);
+
+        QVERIFY(!import(bundle));
+        QVERIFY(m_target->getBackupsForGame("cut").size() < 2);
+        QVERIFY(!hasStagingLeft());
+    }
+
+    void import_rejectsOtherData()
+    {
+        QVERIFY(!import(QByteArray("not a bundle")));
+        QVERIFY(!import(QByteArray()));
+        QVERIFY(m_target->getAllGameIdsWithBackups().isEmpty());
+        QVERIFY(!hasStagingLeft());
+    }
+
+    void import_neverWritesThroughSymlinks()
+    {
+        // A staged link out of the bundle, then a file below it
+        QString outside = testDir() + "/outside";
+        QDir().mkpath(outside);
+        QByteArray bundle = craftBundle({
+            {"games/evil/b.tree/x", AE_IFLNK, QByteArray(), outside},
+            {"games/evil/b.tree/x/evil.desktop", AE_IFREG, "[Desktop Entry]\n", QString()},
+        });
+
+        QVERIFY(!import(bundle));
+        QVERIFY(!QFile::exists(outside + "/evil.desktop"));
+        QVERIFY(QDir(outside).isEmpty());
+        QVERIFY(m_target->getAllGameIdsWithBackups().isEmpty());
+        QVERIFY(!hasStagingLeft());
+    }
+
+    void import_neverLinksThroughSymlinks()
+    {
+        // A snapshot already here holds a symlink the save had, to a
+        // directory outside; a hard link must not reach through it
+        QString outside = testDir() + "/outside";
+        writeFile(outside + "/secret.txt", "secret");
+        QString tree = m_target->getBackupDirectory() + "/games/evil/old.tree";
+        QDir().mkpath(tree);
+        QVERIFY(QFile::link(outside, tree + "/link"));
+
+        QByteArray bundle = craftBundle({
+            {"games/evil/new.tree/secret.txt", AE_IFREG, QByteArray(), "games/evil/old.tree/link/secret.txt"},
+        });
+
+        QVERIFY(!import(bundle));
+        QVERIFY(!QFile::exists(m_target->getBackupDirectory() + "/games/evil/new.tree"));
+        QVERIFY(!hasStagingLeft());
+    }
+
+    void exportBackupsAsync_writesFile()
+    {
+        backUpTwice("async", "tar.gz");
+        QString path = testDir() + "/async.grbundle";
+
+        QSignalSpy exportedSpy(m_source, &SaveManager::backupsExported);
+        QSignalSpy finishedSpy(m_source, &SaveManager::jobFinished);
+        QVERIFY(m_source->exportBackupsAsync(QStringList() << "async", path) != 0);
+        QVERIFY(finishedSpy.wait(30000));
+        QCOMPARE(exportedSpy.count(), 1);
+        QCOMPARE(exportedSpy[0][1].toInt(), 2);
+
+        QSignalSpy importedSpy(m_target, &SaveManager::backupsImported);
+        QSignalSpy importFinishedSpy(m_target, &SaveManager::jobFinished);
+        QVERIFY(m_target->importBackupsAsync(path) != 0);
+        QVERIFY(importFinishedSpy.wait(30000));
+        QCOMPARE(importedSpy.count(), 1);
+        QCOMPARE(importedSpy[0][0].toInt(), 2);
+        QCOMPARE(m_target->getBackupsForGame("async").size(), 2);
+    }
+};
+
+QTEST_MAIN(TestBackupBundle)
+#include "test_backupbundle.moc"
@@ -0,0 +1,293 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QThread>
+#include <QJsonDocument>
+#include "core/backupcatalog.h"
+#include "core/database.h"
+
+class TestBackupCatalog : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString gamesDir() const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction();
+    }
+
+    // Writes archive + sidecar the way SaveManager does
+    BackupInfo writeBackup(const QString &gameId, const QString &id, const QDateTime &when,
+                           qint64 size = 42)
+    {
+        QString dir = gamesDir() + "/" + gameId;
+        QDir().mkpath(dir);
+
+        BackupInfo backup;
+        backup.id = id;
+        backup.gameId = gameId;
+        backup.gameName = "Game " + gameId;
+        backup.displayName = "Backup " + id;
+        backup.timestamp = when;
+        backup.archivePath = dir + "/" + id + ".tar.gz";
+        backup.size = size;
+
+        QFile archive(backup.archivePath);
+        if (!archive.open(QIODevice::WriteOnly))
+            qFatal("Failed to write archive");
+        archive.close();
+        writeSidecar(backup);
+        return backup;
+    }
+
+    static void writeSidecar(const BackupInfo &backup)
+    {
+        QFile sidecar(backup.archivePath + ".json");
+        if (!sidecar.open(QIODevice::WriteOnly))
+            qFatal("Failed to write sidecar");
+        sidecar.write(QJsonDocument(BackupCatalog::toJson(backup)).toJson());
+        sidecar.close();
+    }
+
+    // A fresh database per test, with the backups table as the app creates it
+    QString createDatabase() const
+    {
+        // Database uses QStandardPaths, redirected through XDG_DATA_HOME
+        qputenv("XDG_DATA_HOME", (gamesDir() + "-data").toUtf8());
+        Database db;
+        if (!db.open())
+            qFatal("Failed to open database");
+        return db.databasePath();
+    }
+
+    static QDateTime secs(qint64 s)
+    {
+        return QDateTime::fromSecsSinceEpoch(s);
+    }
+
+private slots:
+    void json_roundTrip()
+    {
+        BackupInfo backup;
+        backup.id = "1";
+        backup.gameId = "g";
+        backup.displayName = "Before boss";
+        backup.notes = "notes";
+        backup.timestamp = QDateTime::fromString("2024-05-01T10:00:00", Qt::ISODate);
+        backup.archivePath = "/x/1.tar.zst";
+        backup.size = 1234;
+        backup.profileId = 3;
+        backup.profileName = "Slot 3";
+        backup.format = "tar.zst";
+
+        BackupInfo copy = BackupCatalog::fromJson(BackupCatalog::toJson(backup));
+        QCOMPARE(copy.displayName, backup.displayName);
+        QCOMPARE(copy.timestamp, backup.timestamp);
+        QCOMPARE(copy.size, backup.size);
+        QCOMPARE(copy.profileId, 3);
+        QCOMPARE(copy.format, QString("tar.zst"));
+        QVERIFY(!copy.pinned);
+
+        backup.pinned = true;
+        QVERIFY(BackupCatalog::fromJson(BackupCatalog::toJson(backup)).pinned);
+
+        QVERIFY(!BackupCatalog::toJson(backup).contains("compressionSkipped"));
+        backup.compressionSkipped = 5000000000LL;
+        QCOMPARE(BackupCatalog::fromJson(BackupCatalog::toJson(backup)).compressionSkipped, 5000000000LL);
+
+        // Sidecars from before formats existed
+        QCOMPARE(BackupCatalog::fromJson(QJsonObject()).format, QString("tar.gz"));
+        QCOMPARE(BackupCatalog::fromJson(QJsonObject()).profileId, -1);
+    }
+
+    void backups_importsSidecarsAndSortsNewestFirst()
+    {
+        QDateTime now = QDateTime::currentDateTime();
+        BackupInfo older = writeBackup("g", "1", now.addSecs(-60));
+        writeBackup("g", "2", now);
+        // Index file of earlier versions
+        QFile legacy(gamesDir() + "/g/catalog.jsonl");
+        QVERIFY(legacy.open(QIODevice::WriteOnly));
+        legacy.close();
+
+        BackupCatalog catalog(gamesDir());
+        catalog.setDatabasePath(createDatabase());
+        QVERIFY(catalog.usesDatabase());
+        QList<BackupInfo> list = catalog.backups("g");
+        QCOMPARE(list.size(), 2);
+        QCOMPARE(list[0].id, QString("2"));
+        QCOMPARE(list[1].id, QString("1"));
+        QCOMPARE(list[1].displayName, older.displayName);
+        QCOMPARE(list[1].timestamp, QDateTime::fromString(older.timestamp.toString(Qt::ISODate), Qt::ISODate));
+        QVERIFY(!QFile::exists(gamesDir() + "/g/catalog.jsonl"));
+
+        // Imported once: later sessions read the table, not the sidecars
+        older.notes = "edited by hand";
+        writeSidecar(older);
+        BackupCatalog next(gamesDir());
+        next.setDatabasePath(createDatabase());
+        QCOMPARE(next.backups("g")[1].notes, QString());
+    }
+
+    void backups_servedFromCatalogUntilInvalidated()
+    {
+        BackupInfo backup = writeBackup("g", "1", QDateTime::currentDateTime());
+        QString dbPath = createDatabase();
+        BackupCatalog catalog(gamesDir());
+        catalog.setDatabasePath(dbPath);
+        QCOMPARE(catalog.backups("g").size(), 1);
+
+        backup.notes = "edited";
+        QVERIFY(catalog.record(backup));
+        QCOMPARE(catalog.backups("g")[0].notes, QString()); // still cached
+
+        catalog.invalidate("g");
+        QCOMPARE(catalog.backups("g")[0].notes, QString("edited"));
+
+        // A fresh instance reads the recorded row, not the sidecar
+        BackupCatalog next(gamesDir());
+        next.setDatabasePath(dbPath);
+        QCOMPARE(next.backups("g")[0].notes, QString("edited"));
+    }
+
+    void record_fromAnotherThread()
+    {
+        BackupInfo backup = writeBackup("g", "1", QDateTime::currentDateTime());
+        BackupCatalog catalog(gamesDir());
+        catalog.setDatabasePath(createDatabase());
+        QCOMPARE(catalog.backups("g").size(), 1);
+
+        // Backup jobs record from pool threads
+        bool recorded = false;
+        QThread *thread = QThread::create([&]() {
+            backup.notes = "from job";
+            recorded = catalog.record(backup);
+        });
+        thread->start();
+        QVERIFY(thread->wait(10000));
+        delete thread;
+
+        QVERIFY(recorded);
+        catalog.invalidate("g");
+        QCOMPARE(catalog.backups("g")[0].notes, QString("from job"));
+    }
+
+    void remove_deletesRow()
+    {
+        BackupInfo a = writeBackup("g", "1", QDateTime::currentDateTime());
+        writeBackup("g", "2", QDateTime::currentDateTime());
+        BackupCatalog catalog(gamesDir());
+        catalog.setDatabasePath(createDatabase());
+        QCOMPARE(catalog.backups("g").size(), 2);
+
+        QFile::remove(a.archivePath);
+        QFile::remove(a.archivePath + ".json");
+        QVERIFY(catalog.remove(a));
+        catalog.invalidate("g");
+
+        QList<BackupInfo> list = catalog.backups("g");
+        QCOMPARE(list.size(), 1);
+        QCOMPARE(list[0].id, QString("2"));
+        QCOMPARE(catalog.totals().count, 1);
+    }
+
+    void backups_syncsWithSidecarsOnDisk()
+    {
+        BackupInfo a = writeBackup("g", "1", QDateTime::currentDateTime());
+        QString dbPath = createDatabase();
+        {
+            BackupCatalog catalog(gamesDir());
+            catalog.setDatabasePath(dbPath);
+            catalog.backups("g");
+        }
+
+        // Changes made without going through the catalog
+        QFile::remove(a.archivePath + ".json");
+        writeBackup("g", "2", QDateTime::currentDateTime());
+
+        BackupCatalog catalog(gamesDir());
+        catalog.setDatabasePath(dbPath);
+        QList<BackupInfo> list = catalog.backups("g");
+        QCOMPARE(list.size(), 1);
+        QCOMPARE(list[0].id, QString("2"));
+    }
+
+    void summaries_aggregatePerGame()
+    {
+        writeBackup("a", "1", secs(1000000), 100);
+        writeBackup("a", "2", secs(3000000), 200);
+        writeBackup("b", "1", secs(2000000), 50);
+        QDir().mkpath(gamesDir() + "/empty");
+
+        BackupCatalog catalog(gamesDir());
+        catalog.setDatabasePath(createDatabase());
+        QHash<QString, BackupSummary> summaries = catalog.summaries();
+        QCOMPARE(summaries.size(), 2);
+        QCOMPARE(summaries["a"].count, 2);
+        QCOMPARE(summaries["a"].totalSize, qint64(300));
+        QCOMPARE(summaries["a"].latest, secs(3000000));
+        QCOMPARE(summaries["a"].gameName, QString("Game a"));
+        QCOMPARE(summaries["b"].count, 1);
+        QCOMPARE(summaries["b"].latest, secs(2000000));
+
+        BackupSummary totals = catalog.totals();
+        QCOMPARE(totals.count, 3);
+        QCOMPARE(totals.totalSize, qint64(350));
+        QCOMPARE(totals.latest, secs(3000000));
+
+        QCOMPARE(catalog.staleGames(secs(2500000)), QStringList() << "b");
+        QCOMPARE(catalog.staleGames(secs(4000000)), QStringList() << "a" << "b");
+        QVERIFY(catalog.staleGames(secs(1500000)).isEmpty());
+    }
+
+    void summaries_sameWithoutDatabase()
+    {
+        writeBackup("a", "1", secs(1000000), 100);
+        writeBackup("a", "2", secs(3000000), 200);
+        writeBackup("b", "1", secs(2000000), 50);
+
+        BackupCatalog indexed(gamesDir());
+        indexed.setDatabasePath(createDatabase());
+        BackupCatalog scanned(gamesDir());
+        QVERIFY(indexed.usesDatabase());
+        QVERIFY(!scanned.usesDatabase());
+
+        QHash<QString, BackupSummary> a = indexed.summaries();
+        QHash<QString, BackupSummary> b = scanned.summaries();
+        QCOMPARE(a.keys().size(), b.keys().size());
+        for (const QString &gameId : a.keys()) {
+            QCOMPARE(a[gameId].count, b[gameId].count);
+            QCOMPARE(a[gameId].totalSize, b[gameId].totalSize);
+            QCOMPARE(a[gameId].latest, b[gameId].latest);
+        }
+        QCOMPARE(indexed.totals().totalSize, scanned.totals().totalSize);
+        QCOMPARE(indexed.staleGames(secs(2500000)), scanned.staleGames(secs(2500000)));
+    }
+
+    void backups_fallsBackToSidecars()
+    {
+        writeBackup("g", "1", QDateTime::currentDateTime());
+
+        // No database, or one that cannot be opened
+        BackupCatalog catalog(gamesDir());
+        QCOMPARE(catalog.backups("g").size(), 1);
+        QVERIFY(!catalog.record(BackupInfo()));
+
+        BackupCatalog broken(gamesDir());
+        broken.setDatabasePath(gamesDir() + "/missing/dir/games.db");
+        QVERIFY(!broken.usesDatabase());
+        QCOMPARE(broken.backups("g").size(), 1);
+    }
+
+    void backups_missingGame()
+    {
+        BackupCatalog catalog(gamesDir());
+        QVERIFY(catalog.backups("nope").isEmpty());
+        QVERIFY(!QDir(gamesDir() + "/nope").exists());
+    }
+};
+
+QTEST_MAIN(TestBackupCatalog)
+#include "test_backupcatalog.moc"
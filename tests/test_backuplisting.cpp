@@ -0,0 +1,116 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include "core/backuplisting.h"
+
+class TestBackupListing : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString writeArchive(const QByteArray &data)
+    {
+        QString path = m_tmpDir.path() + "/" + QTest::currentTestFunction() + ".tar.gz";
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write archive");
+        f.write(data);
+        f.close();
+        return path;
+    }
+
+    static QList<BackupEntry> sampleEntries()
+    {
+        BackupEntry dir;
+        dir.path = "Save";
+        dir.type = "dir";
+        dir.mtime = QDateTime::fromSecsSinceEpoch(1700000000);
+
+        BackupEntry file;
+        file.path = "Save/slot1.sav";
+        file.type = "file";
+        file.size = 1234;
+        file.mtime = QDateTime::fromSecsSinceEpoch(1700000100);
+        file.hash = QByteArray(64, 'a');
+
+        BackupEntry link;
+        link.path = "Save/latest";
+        link.type = "symlink";
+        link.mtime = QDateTime::fromSecsSinceEpoch(1700000200);
+        link.linkTarget = "slot1.sav";
+
+        return {dir, file, link};
+    }
+
+private slots:
+    void saveLoad_roundtrips()
+    {
+        QString archive = writeArchive("archive bytes");
+        QVERIFY(BackupListing::save(archive, sampleEntries()));
+        QVERIFY(QFile::exists(BackupListing::cachePath(archive)));
+
+        bool ok = false;
+        QList<BackupEntry> loaded = BackupListing::load(archive, &ok);
+        QVERIFY(ok);
+        QCOMPARE(loaded.size(), 3);
+        QCOMPARE(loaded[0].type, QString("dir"));
+        QCOMPARE(loaded[1].path, QString("Save/slot1.sav"));
+        QCOMPARE(loaded[1].size, qint64(1234));
+        QCOMPARE(loaded[1].mtime, QDateTime::fromSecsSinceEpoch(1700000100));
+        QCOMPARE(loaded[1].hash, QByteArray(64, 'a'));
+        QCOMPARE(loaded[2].linkTarget, QString("slot1.sav"));
+    }
+
+    void load_rejectsChangedArchive()
+    {
+        QString archive = writeArchive("archive bytes");
+        QVERIFY(BackupListing::save(archive, sampleEntries()));
+
+        // Same size, new mtime: the archive was rewritten
+        QFile f(archive);
+        QVERIFY(f.open(QIODevice::ReadWrite));
+        QVERIFY(f.setFileTime(QDateTime::currentDateTime().addSecs(60), QFileDevice::FileModificationTime));
+        f.close();
+
+        bool ok = true;
+        QVERIFY(BackupListing::load(archive, &ok).isEmpty());
+        QVERIFY(!ok);
+
+        QVERIFY(BackupListing::save(archive, sampleEntries()));
+        BackupListing::load(archive, &ok);
+        QVERIFY(ok);
+    }
+
+    void saveLoad_skipsDirectoryBackups()
+    {
+        // A hardlinks snapshot: the top directory's mtime misses changes below
+        QString tree = m_tmpDir.path() + "/" + QTest::currentTestFunction() + ".tree";
+        QVERIFY(QDir().mkpath(tree + "/Save"));
+        QVERIFY(BackupListing::save(tree, sampleEntries()));
+        QVERIFY(!QFile::exists(BackupListing::cachePath(tree)));
+
+        bool ok = true;
+        BackupListing::load(tree, &ok);
+        QVERIFY(!ok);
+    }
+
+    void load_failsWithoutCacheOrArchive()
+    {
+        QString archive = writeArchive("archive bytes");
+        bool ok = true;
+        BackupListing::load(archive, &ok);
+        QVERIFY(!ok);
+
+        QVERIFY(BackupListing::save(archive, sampleEntries()));
+        QVERIFY(QFile::remove(archive));
+        BackupListing::load(archive, &ok);
+        QVERIFY(!ok);
+    }
+};
+
+QTEST_MAIN(TestBackupListing)
+#include "test_backuplisting.moc"
@@ -0,0 +1,160 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QRandomGenerator>
+#include "core/batchfilereader.h"
+
+class TestBatchFileReader : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString writeFile(const QString &name, const QByteArray &data)
+    {
+        QString path = m_tmpDir.path() + "/" + QTest::currentTestFunction() + "/" + name;
+        QDir().mkpath(m_tmpDir.path() + "/" + QTest::currentTestFunction());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write test file");
+        f.write(data);
+        f.close();
+        return path;
+    }
+
+    static QByteArray randomData(qsizetype size, quint32 seed)
+    {
+        QByteArray data(size, Qt::Uninitialized);
+        QRandomGenerator rng(seed);
+        for (qsizetype i = 0; i < size; ++i)
+            data[i] = char(rng.bounded(256));
+        return data;
+    }
+
+    static QByteArray readNext(BatchFileReader &reader, bool *readOk = nullptr)
+    {
+        QByteArray got;
+        reader.readNext([&got](const char *data, qsizetype size) {
+            got.append(data, size);
+            return true;
+        }, readOk);
+        return got;
+    }
+
+    static void addRows()
+    {
+        QTest::addColumn<bool>("useIoUring");
+        QTest::newRow("direct") << false;
+        if (BatchFileReader::ioUringAvailable())
+            QTest::newRow("io_uring") << true;
+    }
+
+private slots:
+    void readNext_returnsFilesInOrder_data() { addRows(); }
+    void readNext_returnsFilesInOrder()
+    {
+        QFETCH(bool, useIoUring);
+        // More files than the queue holds, mixing empty, small and large
+        QList<QByteArray> contents;
+        QStringList paths;
+        for (int i = 0; i < 200; ++i) {
+            qsizetype size = i % 20 == 0 ? 0 : i % 50 == 7 ? BatchFileReader::PrefetchLimit * 2 + 1 : 100 + i * 37;
+            contents.append(randomData(size, quint32(i)));
+            paths.append(writeFile(QString("f%1.sav").arg(i), contents.last()));
+        }
+
+        BatchFileReader reader(useIoUring, 8);
+        QCOMPARE(reader.usesIoUring(), useIoUring);
+        QCOMPARE(reader.queueDepth(), 8);
+        int next = 0;
+        for (int i = 0; i < paths.size(); ++i) {
+            reader.enqueue(paths.at(i), contents.at(i).size());
+            while (reader.pending() > reader.queueDepth()) {
+                bool ok = false;
+                QCOMPARE(readNext(reader, &ok), contents.at(next++));
+                QVERIFY(ok);
+            }
+        }
+        while (reader.pending() > 0) {
+            bool ok = false;
+            QCOMPARE(readNext(reader, &ok), contents.at(next++));
+            QVERIFY(ok);
+        }
+        QCOMPARE(next, paths.size());
+    }
+
+    void readNext_missingFileFails_data() { addRows(); }
+    void readNext_missingFileFails()
+    {
+        QFETCH(bool, useIoUring);
+        QString present = writeFile("present.sav", "here");
+
+        BatchFileReader reader(useIoUring);
+        reader.enqueue(m_tmpDir.path() + "/nope.sav", 10);
+        reader.enqueue(present, 4);
+        bool ok = true;
+        QVERIFY(readNext(reader, &ok).isEmpty());
+        QVERIFY(!ok);
+        QCOMPARE(readNext(reader, &ok), QByteArray("here"));
+        QVERIFY(ok);
+    }
+
+    void readNext_readsNoMoreThanStatSize_data() { addRows(); }
+    void readNext_readsNoMoreThanStatSize()
+    {
+        QFETCH(bool, useIoUring);
+        // Files that changed since their stat: the archive header is already
+        // written with the old size
+        QString grown = writeFile("grown.sav", "0123456789");
+        QString shrunk = writeFile("shrunk.sav", "abc");
+
+        BatchFileReader reader(useIoUring);
+        reader.enqueue(grown, 4);
+        reader.enqueue(shrunk, 8);
+        QCOMPARE(readNext(reader), QByteArray("0123"));
+        QCOMPARE(readNext(reader), QByteArray("abc"));
+    }
+
+    void readNext_sinkCanStop_data() { addRows(); }
+    void readNext_sinkCanStop()
+    {
+        QFETCH(bool, useIoUring);
+        QString small = writeFile("small.sav", "small");
+        QString large = writeFile("large.sav", randomData(BatchFileReader::ReadChunkSize * 5, 1));
+
+        BatchFileReader reader(useIoUring);
+        reader.enqueue(small, 5);
+        reader.enqueue(large, BatchFileReader::ReadChunkSize * 5);
+        int calls = 0;
+        auto stop = [&calls](const char *, qsizetype) {
+            calls++;
+            return false;
+        };
+        QVERIFY(!reader.readNext(stop));
+        QVERIFY(!reader.readNext(stop));
+        QCOMPARE(calls, 2);
+        QCOMPARE(reader.pending(), 0);
+        QVERIFY(reader.readNext(stop));
+    }
+
+    void destructor_withFilesInFlight_data() { addRows(); }
+    void destructor_withFilesInFlight()
+    {
+        QFETCH(bool, useIoUring);
+        QStringList paths;
+        for (int i = 0; i < 64; ++i)
+            paths.append(writeFile(QString("f%1.sav").arg(i), randomData(4096, quint32(i))));
+
+        // Reads the kernel is still working on when the reader goes away
+        for (int round = 0; round < 10; ++round) {
+            BatchFileReader reader(useIoUring, 16);
+            for (const QString &path : paths)
+                reader.enqueue(path, 4096);
+            QCOMPARE(readNext(reader).size(), 4096);
+        }
+    }
+};
+
+QTEST_MAIN(TestBatchFileReader)
+#include "test_batchfilereader.moc"
@@ -0,0 +1,253 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QDirIterator>
+#include <QRandomGenerator>
+#include "core/chunkstore.h"
+#include "core/transferprogress.h"
+
+class TestChunkStore : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    static QByteArray randomBytes(qsizetype size, quint32 seed)
+    {
+        QRandomGenerator rng(seed);
+        QByteArray data(size, Qt::Uninitialized);
+        for (qsizetype i = 0; i < size; ++i)
+            data[i] = static_cast<char>(rng.bounded(256));
+        return data;
+    }
+
+    static void writeFile(const QString &path, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write test file");
+        f.write(data);
+        f.close();
+    }
+
+    static QByteArray readFile(const QString &path)
+    {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return f.readAll();
+    }
+
+    static int countChunks(const QString &root)
+    {
+        int n = 0;
+        QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            n++;
+        }
+        return n;
+    }
+
+    QString path(const QString &name) const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction() + "/" + name;
+    }
+
+private slots:
+    void snapshot_roundtrip()
+    {
+        QByteArray big = randomBytes(1500 * 1024, 1);
+        writeFile(path("src/save/big.bin"), big);
+        writeFile(path("src/save/sub/small.txt"), "hello");
+        writeFile(path("src/save/empty.dat"), QByteArray());
+
+        ChunkStore store(path("chunks"));
+        ChunkStore::Stats stats;
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("a.snap"), &stats));
+        QCOMPARE(stats.files, 3);
+        QVERIFY(stats.chunks > 2); // big.bin spans several chunks
+
+        QVERIFY(store.restoreSnapshot(path("a.snap"), path("out")));
+        QCOMPARE(readFile(path("out/save/big.bin")), big);
+        QCOMPARE(readFile(path("out/save/sub/small.txt")), QByteArray("hello"));
+        QVERIFY(QFile::exists(path("out/save/empty.dat")));
+    }
+
+    void identicalContent_storedOnce()
+    {
+        QByteArray data = randomBytes(300 * 1024, 2);
+        writeFile(path("src/save/a.bin"), data);
+        writeFile(path("src/save/b.bin"), data);
+
+        ChunkStore store(path("chunks"));
+        ChunkStore::Stats first;
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("1.snap"), &first));
+        QCOMPARE(first.newChunks * 2, first.chunks);
+
+        ChunkStore::Stats second;
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("2.snap"), &second));
+        QCOMPARE(second.newChunks, 0);
+        QCOMPARE(second.bytesStored, qint64(0));
+    }
+
+    void insertedBytes_reuseLaterChunks()
+    {
+        QByteArray data = randomBytes(2 * 1024 * 1024, 3);
+        writeFile(path("src/save/world.dat"), data);
+
+        ChunkStore store(path("chunks"));
+        ChunkStore::Stats before;
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("1.snap"), &before));
+
+        // Content-defined boundaries resynchronise after an insertion
+        data.insert(100, QByteArray("inserted bytes"));
+        writeFile(path("src/save/world.dat"), data);
+
+        ChunkStore::Stats after;
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("2.snap"), &after));
+        QVERIFY(after.chunks > 4);
+        QVERIFY(after.newChunks < after.chunks / 2);
+    }
+
+    void verify_detectsCorruptChunk()
+    {
+        writeFile(path("src/save/data.bin"), randomBytes(64 * 1024, 4));
+
+        ChunkStore store(path("chunks"));
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("a.snap")));
+        QVERIFY(store.verifySnapshot(path("a.snap")));
+
+        QDirIterator it(path("chunks"), QDir::Files, QDirIterator::Subdirectories);
+        QVERIFY(it.hasNext());
+        writeFile(it.next(), "garbage");
+
+        QVERIFY(!store.verifySnapshot(path("a.snap")));
+        QVERIFY(!store.restoreSnapshot(path("a.snap"), path("out")));
+    }
+
+    void incompressibleChunks_storedRawAndVerified()
+    {
+        QByteArray noise = randomBytes(200 * 1024, 8);
+        QByteArray text;
+        while (text.size() < 200 * 1024)
+            text += "level=3 gold=120 quest=\"The Long Road\" done=false\n";
+        writeFile(path("src/save/screenshot.png"), noise);
+        writeFile(path("src/save/save.txt"), text);
+
+        ChunkStore store(path("chunks"));
+        ChunkStore::Stats stats;
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("a.snap"), &stats));
+        // A small trailing chunk may still go through zlib
+        QVERIFY(stats.bytesSkipped > noise.size() * 3 / 4);
+        QVERIFY(stats.bytesSkipped <= noise.size());
+        QVERIFY(stats.bytesStored < noise.size() + text.size() / 4);
+
+        QVERIFY(store.restoreSnapshot(path("a.snap"), path("out")));
+        QCOMPARE(readFile(path("out/save/screenshot.png")), noise);
+        QCOMPARE(readFile(path("out/save/save.txt")), text);
+
+        // A flipped byte in a raw chunk is caught on restore too
+        QDirIterator it(path("chunks"), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QString chunk = it.next();
+            QByteArray raw = readFile(chunk);
+            if (!raw.isEmpty() && raw.at(0) == 'r') {
+                raw[raw.size() / 2] = char(raw.at(raw.size() / 2) ^ 0x01);
+                writeFile(chunk, raw);
+                break;
+            }
+        }
+        QVERIFY(!store.restoreSnapshot(path("a.snap"), path("out2")));
+    }
+
+    void collectGarbage_keepsLiveChunks()
+    {
+        writeFile(path("src/save/shared.bin"), randomBytes(100 * 1024, 5));
+        ChunkStore store(path("chunks"));
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("1.snap")));
+
+        writeFile(path("src/save/extra.bin"), randomBytes(100 * 1024, 6));
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("2.snap")));
+        int total = countChunks(path("chunks"));
+
+        QFile::remove(path("2.snap"));
+        int removed = store.collectGarbage(QStringList() << path("1.snap"));
+        QVERIFY(removed > 0);
+        QCOMPARE(countChunks(path("chunks")), total - removed);
+        QVERIFY(store.verifySnapshot(path("1.snap")));
+
+        // A missing manifest aborts the sweep instead of deleting live data
+        QCOMPARE(store.collectGarbage(QStringList() << path("missing.snap")), 0);
+        QVERIFY(store.verifySnapshot(path("1.snap")));
+    }
+
+    void dictionary_compressesNewChunksAndSurvivesGc()
+    {
+        QList<QByteArray> samples;
+        for (int i = 0; i < 50; ++i) {
+            QByteArray slot;
+            for (int j = 0; j < 40; ++j)
+                slot += QString("{\"slot\":%1,\"quest\":\"q%2\",\"done\":false}\n").arg(i).arg(j * i).toUtf8();
+            samples.append(slot);
+            writeFile(path(QString("src/save/slot%1.json").arg(i)), slot);
+        }
+        ZstdDictionary dictionary = ZstdDictionary::train(samples, 8 * 1024);
+        QVERIFY(!dictionary.isNull());
+
+        ChunkStore store(path("chunks"));
+        store.setDictionary(dictionary);
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("a.snap")));
+        QCOMPARE(QDir(path("chunks/dicts")).entryList(QDir::Files).size(), 1);
+
+        // A store without the dictionary set finds it in the pool
+        ChunkStore reader(path("chunks"));
+        QVERIFY(reader.verifySnapshot(path("a.snap")));
+        QVERIFY(reader.restoreSnapshot(path("a.snap"), path("out")));
+        QCOMPARE(readFile(path("out/save/slot7.json")), samples.at(7));
+
+        QCOMPARE(store.collectGarbage(QStringList() << path("a.snap")), 0);
+        QCOMPARE(QDir(path("chunks/dicts")).entryList(QDir::Files).size(), 1);
+
+        // Losing the dictionary makes its chunks unreadable, not wrong
+        QDir(path("chunks/dicts")).removeRecursively();
+        QVERIFY(!ChunkStore(path("chunks")).verifySnapshot(path("a.snap")));
+    }
+
+    void profileFiles_onlySelectedPaths()
+    {
+        writeFile(path("src/slot1.sav"), "one");
+        writeFile(path("src/slot2.sav"), "two");
+
+        ChunkStore store(path("chunks"));
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "slot1.sav" << "missing.sav", path("a.snap")));
+        QVERIFY(store.restoreSnapshot(path("a.snap"), path("out")));
+        QCOMPARE(readFile(path("out/slot1.sav")), QByteArray("one"));
+        QVERIFY(!QFile::exists(path("out/slot2.sav")));
+    }
+
+    void progress_countsBytesAndStopsWhenCancelled()
+    {
+        QByteArray big = randomBytes(1500 * 1024, 7);
+        writeFile(path("src/save/big.bin"), big);
+        writeFile(path("src/save/small.txt"), "hello");
+
+        ChunkStore store(path("chunks"));
+        TransferProgress progress;
+        store.setProgress(&progress);
+        QVERIFY(store.writeSnapshot(path("src"), QStringList() << "save", path("a.snap")));
+        QCOMPARE(progress.stats().bytesDone, big.size() + 5);
+        QCOMPARE(progress.stats().filesDone, 2);
+
+        TransferProgress cancelled([]() { return true; });
+        store.setProgress(&cancelled);
+        QVERIFY(!store.writeSnapshot(path("src"), QStringList() << "save", path("b.snap")));
+        QVERIFY(!QFile::exists(path("b.snap")));
+        QVERIFY(!store.restoreSnapshot(path("a.snap"), path("out")));
+    }
+};
+
+QTEST_MAIN(TestChunkStore)
+#include "test_chunkstore.moc"
@@ -0,0 +1,61 @@
+#include <QTest>
+#include <QRandomGenerator>
+#include "core/compressibility.h"
+
+class TestCompressibility : public QObject {
+    Q_OBJECT
+
+private:
+    static QByteArray randomBytes(qsizetype size, quint32 seed)
+    {
+        QRandomGenerator rng(seed);
+        QByteArray data(size, Qt::Uninitialized);
+        for (qsizetype i = 0; i < size; ++i)
+            data[i] = static_cast<char>(rng.bounded(256));
+        return data;
+    }
+
+    static bool incompressible(const QByteArray &data)
+    {
+        return Compressibility::isIncompressible(data.constData(), data.size());
+    }
+
+private slots:
+    void randomData_isIncompressible()
+    {
+        QVERIFY(incompressible(randomBytes(Compressibility::SampleSize, 1)));
+        QVERIFY(incompressible(randomBytes(1024 * 1024, 2)));
+    }
+
+    void textAndStructuredData_compress()
+    {
+        QByteArray json;
+        while (json.size() < 256 * 1024)
+            json += "{\"id\": \"potion\", \"count\": 3, \"quality\": \"rare\"},\n";
+        QVERIFY(!incompressible(json));
+        QVERIFY(!incompressible(QByteArray(256 * 1024, '\0')));
+    }
+
+    void smallInputs_neverSkipped()
+    {
+        QVERIFY(!incompressible(randomBytes(Compressibility::MinSize - 1, 3)));
+        QVERIFY(!incompressible(QByteArray()));
+    }
+
+    void plainHeaderOnNoise_isIncompressible()
+    {
+        // Like a PNG or zip: a readable header, then compressed data
+        QByteArray file = QByteArray("\x89PNG\r\n\x1a\n", 8) + QByteArray(512, 'A') + randomBytes(2 * 1024 * 1024, 4);
+        QVERIFY(incompressible(file));
+    }
+
+    void compressibleRegion_isSampled()
+    {
+        // Mostly noise with a large plain tail: the tail slice tips it over
+        QByteArray file = randomBytes(768 * 1024, 5) + QByteArray(256 * 1024, 'x');
+        QVERIFY(!incompressible(file));
+    }
+};
+
+QTEST_MAIN(TestCompressibility)
+#include "test_compressibility.moc"
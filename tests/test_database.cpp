@@ -209,6 +209,32 @@ private slots:
         QCOMPARE(m_db->getSetting("key"), QString("second"));
     }
 
+    // --- Retention Rules ---
+
+    void retentionPolicyFallsBackToDefault()
+    {
+        RetentionPolicy defaults;
+        defaults.enabled = true;
+        defaults.keepLast = 3;
+        QVERIFY(m_db->setRetentionPolicy(QString(), defaults));
+
+        RetentionPolicy custom;
+        custom.enabled = true;
+        custom.keepLast = 10;
+        custom.maxTotalSize = 1024 * 1024;
+        QVERIFY(m_db->setRetentionPolicy("retention-game", custom));
+
+        QVERIFY(m_db->hasRetentionPolicy("retention-game"));
+        QCOMPARE(m_db->getRetentionPolicy("retention-game").keepLast, 10);
+        QCOMPARE(m_db->getRetentionPolicy("retention-game").maxTotalSize, qint64(1024 * 1024));
+        QVERIFY(!m_db->hasRetentionPolicy("other-game"));
+        QCOMPARE(m_db->getRetentionPolicy("other-game").keepLast, 3);
+
+        QVERIFY(m_db->clearRetentionPolicy("retention-game"));
+        QVERIFY(!m_db->hasRetentionPolicy("retention-game"));
+        QCOMPARE(m_db->getRetentionPolicy("retention-game").keepLast, 3);
+    }
+
     // --- Save Profiles ---
 
     void addAndGetProfile()
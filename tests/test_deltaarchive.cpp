@@ -0,0 +1,288 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include "core/deltaarchive.h"
+
+class TestDeltaArchive : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    static QByteArray randomBytes(qsizetype size, quint32 seed)
+    {
+        QRandomGenerator rng(seed);
+        QByteArray data(size, Qt::Uninitialized);
+        for (qsizetype i = 0; i < size; ++i)
+            data[i] = static_cast<char>(rng.bounded(256));
+        return data;
+    }
+
+    static void writeFile(const QString &path, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write test file");
+        f.write(data);
+        f.close();
+    }
+
+    static QByteArray readFile(const QString &path)
+    {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return f.readAll();
+    }
+
+    QString path(const QString &name) const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction() + "/" + name;
+    }
+
+private slots:
+    void encodeDelta_roundtripsEdits()
+    {
+        QByteArray base = randomBytes(512 * 1024, 1);
+        QByteArray target = base;
+        target.replace(1000, 16, randomBytes(16, 2));
+        target.insert(200000, randomBytes(3000, 3));
+        target.remove(400000, 5000);
+
+        QByteArray delta = DeltaArchive::encodeDelta(base, target);
+        QVERIFY(delta.size() < 8 * 1024);
+
+        bool ok = false;
+        QCOMPARE(DeltaArchive::applyDelta(base, delta, &ok), target);
+        QVERIFY(ok);
+    }
+
+    void encodeDelta_handlesSmallAndEmptyInputs()
+    {
+        bool ok = false;
+        QByteArray delta = DeltaArchive::encodeDelta(QByteArray(), "hello");
+        QCOMPARE(DeltaArchive::applyDelta(QByteArray(), delta, &ok), QByteArray("hello"));
+        QVERIFY(ok);
+
+        delta = DeltaArchive::encodeDelta("hello", QByteArray());
+        QCOMPARE(DeltaArchive::applyDelta("hello", delta, &ok), QByteArray());
+        QVERIFY(ok);
+    }
+
+    void applyDelta_rejectsCorruptInput()
+    {
+        QByteArray base = randomBytes(64 * 1024, 4);
+        QByteArray target = base;
+        target[100] = 'x';
+        QByteArray delta = DeltaArchive::encodeDelta(base, target);
+
+        bool ok = true;
+        DeltaArchive::applyDelta(base.left(1000), delta, &ok);
+        QVERIFY(!ok);
+        DeltaArchive::applyDelta(base, delta.left(delta.size() - 1), &ok);
+        QVERIFY(!ok);
+    }
+
+    void chain_restoresEveryGeneration()
+    {
+        QByteArray save = randomBytes(1024 * 1024, 5);
+        writeFile(path("src/save/world.dat"), save);
+        writeFile(path("src/save/settings.ini"), "volume=80");
+
+        DeltaArchive first(path("1.delta"));
+        QVERIFY(first.write(path("src"), QStringList() << "save", QString()));
+        QVERIFY(first.basePath().isEmpty());
+
+        QByteArray second = save;
+        second.replace(4096, 8, "CHANGED!");
+        writeFile(path("src/save/world.dat"), second);
+        DeltaArchive::Stats stats;
+        DeltaArchive delta(path("2.delta"));
+        QVERIFY(delta.write(path("src"), QStringList() << "save", path("1.delta"), &stats));
+        QCOMPARE(stats.deltaFiles, 1);
+        QCOMPARE(stats.baseFiles, 1);
+        QVERIFY(QFileInfo(path("2.delta")).size() < 16 * 1024);
+        QCOMPARE(delta.chain(), QStringList() << path("1.delta") << path("2.delta"));
+
+        QVERIFY(first.restore(path("out1")));
+        QCOMPARE(readFile(path("out1/save/world.dat")), save);
+        QVERIFY(delta.restore(path("out2")));
+        QCOMPARE(readFile(path("out2/save/world.dat")), second);
+        QCOMPARE(readFile(path("out2/save/settings.ini")), QByteArray("volume=80"));
+        QVERIFY(delta.verify());
+    }
+
+    void write_unchangedPathsSkipReading()
+    {
+        writeFile(path("src/save/a.dat"), randomBytes(100 * 1024, 6));
+        DeltaArchive first(path("1.delta"));
+        QVERIFY(first.write(path("src"), QStringList() << "save", QString()));
+
+        DeltaArchive::Stats stats;
+        DeltaArchive second(path("2.delta"));
+        QVERIFY(second.write(path("src"), QStringList() << "save", path("1.delta"), &stats,
+                             QSet<QString>() << "save/a.dat"));
+        QCOMPARE(stats.baseFiles, 1);
+        QVERIFY(second.verify());
+    }
+
+    void write_storesIncompressiblePayloadsRaw()
+    {
+        QByteArray noise = randomBytes(256 * 1024, 11);
+        writeFile(path("src/save/thumb.jpg"), noise);
+        writeFile(path("src/save/settings.ini"), QByteArray("volume=80\n").repeated(1000));
+
+        DeltaArchive::Stats stats;
+        DeltaArchive archive(path("1.delta"));
+        QVERIFY(archive.write(path("src"), QStringList() << "save", QString(), &stats));
+        QCOMPARE(stats.bytesSkipped, qint64(noise.size()));
+        QVERIFY(stats.bytesStored < noise.size() + 4096);
+
+        QVERIFY(archive.restore(path("out")));
+        QCOMPARE(readFile(path("out/save/thumb.jpg")), noise);
+        QCOMPARE(readFile(path("out/save/settings.ini")), QByteArray("volume=80\n").repeated(1000));
+        QVERIFY(archive.verify());
+    }
+
+    void write_streamsFilesOverMemoryLimit()
+    {
+        QByteArray world = QByteArray("region=12,40;entities=[zombie];\n").repeated(40000);
+        QByteArray noise = randomBytes(300 * 1024, 12);
+        writeFile(path("src/save/world.dat"), world);
+        writeFile(path("src/save/thumb.jpg"), noise);
+        writeFile(path("src/save/settings.ini"), "volume=80");
+
+        DeltaArchive::Stats stats;
+        DeltaArchive first(path("1.delta"));
+        first.setMemoryLimit(256 * 1024);
+        QVERIFY(first.write(path("src"), QStringList() << "save", QString(), &stats));
+        QCOMPARE(stats.fullFiles, 3);
+        QCOMPARE(stats.bytesSkipped, qint64(noise.size()));
+        QVERIFY(stats.bytesStored < noise.size() + 64 * 1024);
+
+        // Too large to hold, but still diffed against the base
+        QByteArray changed = world;
+        changed.replace(4096, 8, "CHANGED!");
+        writeFile(path("src/save/world.dat"), changed);
+        DeltaArchive::Stats secondStats;
+        DeltaArchive second(path("2.delta"));
+        second.setMemoryLimit(256 * 1024);
+        QVERIFY(second.write(path("src"), QStringList() << "save", path("1.delta"), &secondStats,
+                             QSet<QString>() << "save/thumb.jpg" << "save/settings.ini"));
+        QCOMPARE(secondStats.deltaFiles, 1);
+        QCOMPARE(secondStats.fullFiles, 0);
+        QCOMPARE(secondStats.baseFiles, 2);
+        QVERIFY(secondStats.bytesStored < 64 * 1024);
+        QVERIFY(second.verify());
+        QVERIFY(second.restore(path("out")));
+        QCOMPARE(readFile(path("out/save/world.dat")), changed);
+        QCOMPARE(readFile(path("out/save/thumb.jpg")), noise);
+
+        // Re-basing takes full payloads over and rebuilds the delta
+        QVERIFY(second.rebase(QString()));
+        QVERIFY(QFile::remove(path("1.delta")));
+        QVERIFY(second.verify());
+        QVERIFY(second.restore(path("out2")));
+        QCOMPARE(readFile(path("out2/save/world.dat")), changed);
+        QCOMPARE(readFile(path("out2/save/thumb.jpg")), noise);
+        QCOMPARE(readFile(path("out2/save/settings.ini")), QByteArray("volume=80"));
+    }
+
+    void write_diffsLargeFilesAcrossChain()
+    {
+        // Random, so only the edited regions can be stored as literals
+        QByteArray v1 = randomBytes(2 * 1024 * 1024, 21);
+        QByteArray v2 = v1;
+        v2.replace(100000, 16, randomBytes(16, 22));
+        v2.insert(1500000, randomBytes(3000, 23));
+        QByteArray v3 = v2;
+        v3.remove(600000, 5000);
+        const QList<QByteArray> versions = {v1, v2, v3};
+
+        QString basePath;
+        for (int i = 0; i < versions.size(); ++i) {
+            writeFile(path("src/save/world.dat"), versions[i]);
+            QString archivePath = path(QString("%1.delta").arg(i + 1));
+            DeltaArchive archive(archivePath);
+            archive.setMemoryLimit(256 * 1024);
+            DeltaArchive::Stats stats;
+            QVERIFY(archive.write(path("src"), QStringList() << "save", basePath, &stats));
+            if (i > 0) {
+                QCOMPARE(stats.deltaFiles, 1);
+                QVERIFY(stats.bytesStored < 64 * 1024);
+            }
+            basePath = archivePath;
+        }
+
+        for (int i = 0; i < versions.size(); ++i) {
+            DeltaArchive archive(path(QString("%1.delta").arg(i + 1)));
+            QVERIFY(archive.verify());
+            QString out = path(QString("out%1").arg(i + 1));
+            QVERIFY(archive.restore(out));
+            QCOMPARE(readFile(out + "/save/world.dat"), versions[i]);
+        }
+
+        // Dropping the middle backup re-diffs the top one against the first
+        DeltaArchive top(path("3.delta"));
+        top.setMemoryLimit(256 * 1024);
+        QVERIFY(top.rebase(path("1.delta")));
+        QVERIFY(QFile::remove(path("2.delta")));
+        QVERIFY(QFileInfo(path("3.delta")).size() < 64 * 1024);
+        QVERIFY(top.restore(path("rebased")));
+        QCOMPARE(readFile(path("rebased/save/world.dat")), v3);
+
+        // No temporary files are left next to the archives
+        QCOMPARE(QDir(path("")).entryList(QStringList() << ".delta-*", QDir::Files | QDir::Hidden).size(), 0);
+    }
+
+    void rebase_keepsContentsWithoutOldBase()
+    {
+        QByteArray v1 = randomBytes(256 * 1024, 7);
+        QByteArray v2 = v1;
+        v2.replace(10, 4, "abcd");
+        QByteArray v3 = v2;
+        v3.replace(200000, 4, "wxyz");
+
+        writeFile(path("src/save.dat"), v1);
+        QVERIFY(DeltaArchive(path("1.delta")).write(path("src"), QStringList() << "save.dat", QString()));
+        writeFile(path("src/save.dat"), v2);
+        QVERIFY(DeltaArchive(path("2.delta")).write(path("src"), QStringList() << "save.dat", path("1.delta")));
+        writeFile(path("src/save.dat"), v3);
+        DeltaArchive third(path("3.delta"));
+        QVERIFY(third.write(path("src"), QStringList() << "save.dat", path("2.delta")));
+
+        // Drop the middle backup
+        QVERIFY(third.rebase(path("1.delta")));
+        QVERIFY(QFile::remove(path("2.delta")));
+        QCOMPARE(third.chain(), QStringList() << path("1.delta") << path("3.delta"));
+        QVERIFY(third.restore(path("out3")));
+        QCOMPARE(readFile(path("out3/save.dat")), v3);
+
+        // Drop the keyframe: the dependent becomes one
+        QVERIFY(third.rebase(QString()));
+        QVERIFY(QFile::remove(path("1.delta")));
+        QVERIFY(third.basePath().isEmpty());
+        QVERIFY(third.restore(path("out4")));
+        QCOMPARE(readFile(path("out4/save.dat")), v3);
+    }
+
+    void verify_detectsMissingBase()
+    {
+        writeFile(path("src/save.dat"), randomBytes(50 * 1024, 8));
+        QVERIFY(DeltaArchive(path("1.delta")).write(path("src"), QStringList() << "save.dat", QString()));
+        writeFile(path("src/save.dat"), randomBytes(50 * 1024, 9));
+        DeltaArchive second(path("2.delta"));
+        QVERIFY(second.write(path("src"), QStringList() << "save.dat", path("1.delta")));
+
+        QVERIFY(QFile::remove(path("1.delta")));
+        QVERIFY(!second.verify());
+        QVERIFY(!second.restore(path("out")));
+    }
+};
+
+QTEST_MAIN(TestDeltaArchive)
+#include "test_deltaarchive.moc"
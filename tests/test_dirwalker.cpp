@@ -0,0 +1,211 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include "core/dirwalker.h"
+
+class TestDirWalker : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString root() const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction();
+    }
+
+    void writeFile(const QString &relPath, const QByteArray &data)
+    {
+        QString path = root() + "/" + relPath;
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write test file");
+        f.write(data);
+        f.close();
+    }
+
+    QStringList walkPaths(DirWalker::Order order)
+    {
+        QStringList paths;
+        DirWalker::walk(root(), [&paths](const DirWalker::Entry &entry) {
+            paths.append(entry.relativePath());
+            return DirWalker::Continue;
+        }, order);
+        return paths;
+    }
+
+private slots:
+    void walk_visitsParentsBeforeChildrenInOrder()
+    {
+        writeFile("b.sav", "b");
+        writeFile("a/z.sav", "z");
+        writeFile("a/sub/y.sav", "y");
+        writeFile(".hidden", "h");
+        writeFile("c/x.sav", "x");
+
+        QCOMPARE(walkPaths(DirWalker::ByName),
+                 QStringList() << ".hidden" << "a" << "a/sub" << "a/sub/y.sav" << "a/z.sav" << "b.sav"
+                               << "c" << "c/x.sav");
+        QCOMPARE(walkPaths(DirWalker::DirsFirst),
+                 QStringList() << "a" << "a/sub" << "a/sub/y.sav" << "a/z.sav" << "c" << "c/x.sav"
+                               << ".hidden" << "b.sav");
+
+        QStringList unsorted = walkPaths(DirWalker::Unsorted);
+        unsorted.sort();
+        QStringList sorted = walkPaths(DirWalker::ByName);
+        sorted.sort();
+        QCOMPARE(unsorted, sorted);
+    }
+
+    void walk_reportsStatOfEachEntry()
+    {
+        writeFile("save/slot1.sav", QByteArray(1234, 'x'));
+        QFile::setPermissions(root() + "/save/slot1.sav",
+                              QFile::permissions(root() + "/save/slot1.sav") | QFileDevice::ExeOwner);
+
+        QList<DirWalker::Entry> entries;
+        QStringList names;
+        QStringList filePaths;
+        QVERIFY(DirWalker::walk(root(), [&](const DirWalker::Entry &entry) {
+            entries.append(entry);
+            names.append(entry.fileName());
+            filePaths.append(entry.filePath());
+            return DirWalker::Continue;
+        }));
+        QCOMPARE(entries.size(), 2);
+        QCOMPARE(names, QStringList() << "save" << "slot1.sav");
+        QCOMPARE(filePaths, QStringList() << root() + "/save" << root() + "/save/slot1.sav");
+
+        const DirWalker::Entry &dir = entries.at(0);
+        QCOMPARE(dir.type, DirWalker::Dir);
+        QCOMPARE(dir.depth, 0);
+        QCOMPARE(dir.size, qint64(0));
+
+        const DirWalker::Entry &file = entries.at(1);
+        QCOMPARE(file.type, DirWalker::File);
+        QCOMPARE(file.depth, 1);
+        QCOMPARE(file.size, qint64(1234));
+        QVERIFY(file.executable);
+        QCOMPARE(file.mtimeMs, QFileInfo(filePaths.at(1)).lastModified().toMSecsSinceEpoch());
+#ifdef Q_OS_UNIX
+        QVERIFY(file.inode != 0);
+        QVERIFY(file.inode != dir.inode);
+#endif
+    }
+
+    void walk_skipChildrenAndStop()
+    {
+        writeFile("a/1.sav", "1");
+        writeFile("b/2.sav", "2");
+        writeFile("c/3.sav", "3");
+
+        QStringList paths;
+        QVERIFY(DirWalker::walk(root(), [&paths](const DirWalker::Entry &entry) {
+            paths.append(entry.relativePath());
+            return entry.relativePath() == "b" ? DirWalker::SkipChildren : DirWalker::Continue;
+        }));
+        QCOMPARE(paths, QStringList() << "a" << "a/1.sav" << "b" << "c" << "c/3.sav");
+
+        paths.clear();
+        QVERIFY(!DirWalker::walk(root(), [&paths](const DirWalker::Entry &entry) {
+            paths.append(entry.relativePath());
+            return entry.relativePath() == "b/2.sav" ? DirWalker::Stop : DirWalker::Continue;
+        }));
+        QCOMPARE(paths, QStringList() << "a" << "a/1.sav" << "b" << "b/2.sav");
+    }
+
+    void walk_doesNotFollowSymlinks()
+    {
+#ifdef Q_OS_UNIX
+        writeFile("outside/secret.sav", "s");
+        writeFile("save/real.sav", "r");
+        QVERIFY(QFile::link(root() + "/outside", root() + "/save/link"));
+        QVERIFY(QFile::link("missing-target", root() + "/save/dangling"));
+
+        QHash<QString, DirWalker::Type> types;
+        QVERIFY(DirWalker::walk(root() + "/save", [&types](const DirWalker::Entry &entry) {
+            types.insert(entry.relativePath(), entry.type);
+            return DirWalker::Continue;
+        }));
+        QCOMPARE(types.size(), 3);
+        QCOMPARE(types.value("link"), DirWalker::Symlink);
+        QCOMPARE(types.value("dangling"), DirWalker::Symlink);
+        QCOMPARE(types.value("real.sav"), DirWalker::File);
+
+        // The root itself may be a symlink
+        QVERIFY(QFile::link(root() + "/save", root() + "/save-link"));
+        QStringList paths;
+        QVERIFY(DirWalker::walk(root() + "/save-link/", [&paths](const DirWalker::Entry &entry) {
+            paths.append(entry.relativePath());
+            return DirWalker::Continue;
+        }));
+        QCOMPARE(paths, QStringList() << "dangling" << "link" << "real.sav");
+#else
+        QSKIP("Symlinks need a Unix filesystem");
+#endif
+    }
+
+    void walk_missingRootFails()
+    {
+        bool visited = false;
+        QVERIFY(!DirWalker::walk(root() + "/nope", [&visited](const DirWalker::Entry &) {
+            visited = true;
+            return DirWalker::Continue;
+        }));
+        QVERIFY(!visited);
+
+        writeFile("file.sav", "f");
+        QVERIFY(!DirWalker::walk(root() + "/file.sav", [](const DirWalker::Entry &) {
+            return DirWalker::Continue;
+        }));
+    }
+
+    void walk_manyEntriesAcrossReadBuffers()
+    {
+        // More names than one getdents64 buffer holds
+        QDir().mkpath(root() + "/big");
+        for (int i = 0; i < 3000; ++i)
+            writeFile(QString("big/save_file_with_a_long_name_%1.sav").arg(i, 4, 10, QChar('0')), "x");
+
+        QStringList files;
+        QVERIFY(DirWalker::walk(root(), [&files](const DirWalker::Entry &entry) {
+            if (entry.type == DirWalker::File)
+                files.append(entry.relativePath());
+            return DirWalker::Continue;
+        }));
+        QCOMPARE(files.size(), 3000);
+        QStringList sorted = files;
+        sorted.sort();
+        QCOMPARE(files, sorted);
+    }
+
+    void stat_singlePath()
+    {
+        writeFile("save/a.sav", "abc");
+
+        DirWalker::FileStat st;
+        QVERIFY(DirWalker::stat(root() + "/save/a.sav", &st));
+        QCOMPARE(st.type, DirWalker::File);
+        QCOMPARE(st.size, qint64(3));
+        QVERIFY(DirWalker::stat(root() + "/save", &st));
+        QCOMPARE(st.type, DirWalker::Dir);
+        QVERIFY(!DirWalker::stat(root() + "/save/missing", &st));
+
+#ifdef Q_OS_UNIX
+        QVERIFY(QFile::link(root() + "/save/a.sav", root() + "/save/link"));
+        QVERIFY(DirWalker::stat(root() + "/save/link", &st));
+        QCOMPARE(st.type, DirWalker::Symlink);
+        QVERIFY(DirWalker::stat(root() + "/save/link", &st, true));
+        QCOMPARE(st.type, DirWalker::File);
+        QCOMPARE(st.size, qint64(3));
+#endif
+    }
+};
+
+QTEST_MAIN(TestDirWalker)
+#include "test_dirwalker.moc"
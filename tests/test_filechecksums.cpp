@@ -0,0 +1,84 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include "core/filechecksums.h"
+
+class TestFileChecksums : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    static QByteArray hashOf(const QByteArray &data)
+    {
+        FileChecksums::Hasher hasher;
+        hasher.addData(data.constData(), data.size());
+        return hasher.result();
+    }
+
+private slots:
+    void hasher_isIncremental()
+    {
+        FileChecksums::Hasher hasher;
+        hasher.addData("save ", 5);
+        hasher.addData("data", 4);
+        QCOMPARE(hasher.result(), hashOf("save data"));
+        QCOMPARE(hasher.result().size(), 64); // 256 bits in hex
+        QVERIFY(hashOf("save data") != hashOf("save dato"));
+    }
+
+    void json_roundtrips()
+    {
+        FileChecksums checksums;
+        checksums.insert("Save/slot1.sav", hashOf("one"));
+        checksums.insert("Save/sub/slot2.sav", hashOf("two"));
+
+        bool ok = false;
+        FileChecksums loaded = FileChecksums::fromJson(checksums.toJson(), &ok);
+        QVERIFY(ok);
+        QCOMPARE(loaded.size(), 2);
+        QCOMPARE(loaded.value("Save/slot1.sav"), hashOf("one"));
+        QCOMPARE(loaded.value("Save/sub/slot2.sav"), hashOf("two"));
+        QVERIFY(loaded.value("Save/missing.sav").isEmpty());
+    }
+
+    void fromJson_rejectsUnknownAlgorithm()
+    {
+        FileChecksums checksums;
+        checksums.insert("a.sav", hashOf("a"));
+        QJsonObject obj = checksums.toJson();
+        obj["algorithm"] = "md5";
+
+        bool ok = true;
+        QVERIFY(FileChecksums::fromJson(obj, &ok).isEmpty());
+        QVERIFY(!ok);
+    }
+
+    void loadMetadata_readsSidecar()
+    {
+        FileChecksums checksums;
+        checksums.insert("a.sav", hashOf("a"));
+        QJsonObject root;
+        root["id"] = "1";
+        root["checksums"] = checksums.toJson();
+
+        QString path = m_tmpDir.path() + "/backup.tar.gz.json";
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(QJsonDocument(root).toJson());
+        f.close();
+
+        bool ok = false;
+        QCOMPARE(FileChecksums::loadMetadata(path, &ok).value("a.sav"), hashOf("a"));
+        QVERIFY(ok);
+
+        // Sidecars written before checksums existed
+        QVERIFY(FileChecksums::loadMetadata(m_tmpDir.path() + "/none.json", &ok).isEmpty());
+        QVERIFY(!ok);
+    }
+};
+
+QTEST_MAIN(TestFileChecksums)
+#include "test_filechecksums.moc"
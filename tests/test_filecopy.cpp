@@ -0,0 +1,119 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include "core/filecopy.h"
+
+class TestFileCopy : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString path(const QString &name) const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction() + "/" + name;
+    }
+
+    static void writeFile(const QString &filePath, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(filePath).absolutePath());
+        QFile f(filePath);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write %s", qPrintable(filePath));
+        f.write(data);
+        f.close();
+    }
+
+    static QByteArray readFile(const QString &filePath)
+    {
+        QFile f(filePath);
+        return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+    }
+
+private slots:
+    void copyFile_keepsDataPermissionsAndTimes()
+    {
+        // Spans several buffers whatever method ends up being used
+        QByteArray data(3 * 1024 * 1024 + 17, Qt::Uninitialized);
+        QRandomGenerator rng(7);
+        for (qsizetype i = 0; i < data.size(); ++i)
+            data[i] = static_cast<char>(rng.bounded(256));
+        QString source = path("world.dat");
+        writeFile(source, data);
+
+        QDateTime mtime = QDateTime::fromSecsSinceEpoch(1700000000);
+        QFile f(source);
+        QVERIFY(f.open(QIODevice::ReadWrite));
+        QVERIFY(f.setFileTime(mtime, QFileDevice::FileModificationTime));
+        f.close();
+        QFile::setPermissions(source, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+
+        FileCopy::Method method = FileCopy::Reflink;
+        QString dest = path("copy.dat");
+        QVERIFY(FileCopy::copyFile(source, dest, &method));
+        QCOMPARE(readFile(dest), data);
+        QCOMPARE(QFileInfo(dest).lastModified(), mtime);
+        QVERIFY(QFileInfo(dest).permissions() & QFileDevice::ExeOwner);
+        QVERIFY(!(QFileInfo(dest).permissions() & QFileDevice::ReadOther));
+        qDebug() << "Copied with method" << method;
+    }
+
+    void copyFile_replacesExistingFile()
+    {
+        QString source = path("new.sav");
+        QString dest = path("live.sav");
+        writeFile(source, "new contents");
+        writeFile(dest, "old contents that are longer");
+
+        QVERIFY(FileCopy::copyFile(source, dest));
+        QCOMPARE(readFile(dest), QByteArray("new contents"));
+
+        // No temporary copies left behind
+        QCOMPARE(QDir(QFileInfo(dest).absolutePath()).entryList(QDir::Files | QDir::Hidden).size(), 2);
+    }
+
+    void copyFile_emptyFile()
+    {
+        QString source = path("empty.sav");
+        writeFile(source, QByteArray());
+        QVERIFY(FileCopy::copyFile(source, path("empty-copy.sav")));
+        QVERIFY(QFile::exists(path("empty-copy.sav")));
+        QCOMPARE(QFileInfo(path("empty-copy.sav")).size(), qint64(0));
+    }
+
+    void copyFile_recreatesRelativeSymlink()
+    {
+        writeFile(path("target.sav"), "data");
+        QVERIFY(QDir(QFileInfo(path("target.sav")).absolutePath()).exists());
+        QVERIFY(QFile::link("target.sav", path("link.sav")));
+
+        QVERIFY(FileCopy::copyFile(path("link.sav"), path("link-copy.sav")));
+        QFileInfo copy(path("link-copy.sav"));
+        QVERIFY(copy.isSymLink());
+        QCOMPARE(readFile(copy.filePath()), QByteArray("data"));
+    }
+
+    void copyFile_missingSourceFails()
+    {
+        QDir().mkpath(path(""));
+        QVERIFY(!FileCopy::copyFile(path("missing.sav"), path("dest.sav")));
+        QVERIFY(!QFile::exists(path("dest.sav")));
+    }
+
+    void isMountPoint_detectsFilesystemBoundary()
+    {
+        QDir().mkpath(path("sub"));
+        QVERIFY(!FileCopy::isMountPoint(path("sub")));
+        QVERIFY(!FileCopy::isMountPoint(path("missing")));
+#ifdef Q_OS_LINUX
+        if (QFileInfo::exists("/proc/self"))
+            QVERIFY(FileCopy::isMountPoint("/proc"));
+#endif
+    }
+};
+
+QTEST_MAIN(TestFileCopy)
+#include "test_filecopy.moc"
@@ -0,0 +1,115 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include "core/filemanifest.h"
+
+class TestFileManifest : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString root() const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction();
+    }
+
+    void writeFile(const QString &relPath, const QByteArray &data)
+    {
+        QString path = root() + "/" + relPath;
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write test file");
+        f.write(data);
+        f.close();
+    }
+
+private slots:
+    void scan_recordsTree()
+    {
+        writeFile("save/a.sav", "aaaa");
+        writeFile("save/sub/b.sav", "bb");
+
+        FileManifest manifest = FileManifest::scan(root(), QStringList() << "save");
+        QCOMPARE(manifest.entries().size(), 4); // save, a.sav, sub, sub/b.sav
+        QCOMPARE(manifest.totalSize(), qint64(6));
+
+        const FileManifest::Entry *a = manifest.find("save/a.sav");
+        QVERIFY(a);
+        QCOMPARE(a->type, QString("file"));
+        QCOMPARE(a->hash.size(), 64);
+        QVERIFY(manifest.find("save/sub")->type == "dir");
+        QVERIFY(!manifest.find("save/missing"));
+    }
+
+    void saveLoad_roundtrip()
+    {
+        writeFile("save/a.sav", "content");
+        FileManifest manifest = FileManifest::scan(root(), QStringList() << "save");
+        QVERIFY(manifest.save(root() + "/manifest.files"));
+
+        bool ok = false;
+        FileManifest loaded = FileManifest::load(root() + "/manifest.files", &ok);
+        QVERIFY(ok);
+        QVERIFY(loaded.sameContent(manifest));
+        QCOMPARE(loaded.find("save/a.sav")->inode, manifest.find("save/a.sav")->inode);
+        QCOMPARE(loaded.find("save/a.sav")->mtimeMs, manifest.find("save/a.sav")->mtimeMs);
+
+        FileManifest::load(root() + "/nope.files", &ok);
+        QVERIFY(!ok);
+    }
+
+    void changedPaths_detectsContentChanges()
+    {
+        writeFile("save/same.sav", "same");
+        writeFile("save/edit.sav", "1234");
+        FileManifest before = FileManifest::scan(root(), QStringList() << "save");
+
+        writeFile("save/edit.sav", "4321"); // same size, different bytes
+        writeFile("save/same.sav", "same"); // rewritten, identical bytes
+        writeFile("save/new.sav", "new");
+        FileManifest after = FileManifest::scan(root(), QStringList() << "save", before);
+
+        QStringList changed = after.changedPaths(before);
+        changed.sort();
+        QCOMPARE(changed, QStringList() << "save/edit.sav" << "save/new.sav");
+        QVERIFY(!after.sameContent(before));
+
+        // A removed file makes the trees differ even though nothing is "new"
+        QFile::remove(root() + "/save/new.sav");
+        FileManifest removed = FileManifest::scan(root(), QStringList() << "save", after);
+        QVERIFY(removed.changedPaths(after).isEmpty());
+        QVERIFY(!removed.sameContent(after));
+    }
+
+    void scan_statOnlyHashesOnDemand()
+    {
+        writeFile("save/a.sav", "1234");
+        FileManifest before = FileManifest::scan(root(), QStringList() << "save");
+
+        // Just written, so its old hash cannot be trusted and is left out
+        writeFile("save/a.sav", "4321");
+        FileManifest after = FileManifest::scan(root(), QStringList() << "save", before,
+                                                FileManifest::StatOnly);
+        QVERIFY(after.find("save/a.sav")->hash.isEmpty());
+        QCOMPARE(after.unhashedSize(), qint64(4));
+        QVERIFY(after.maybeSameContent(before));
+        QVERIFY(!after.sameContent(before));
+
+        QVERIFY(after.hashMissing(root()));
+        QCOMPARE(after.unhashedSize(), qint64(0));
+        QVERIFY(!after.maybeSameContent(before));
+        QCOMPARE(after.changedPaths(before), QStringList() << "save/a.sav");
+
+        // Hashes taken elsewhere, e.g. while archiving, fill the same field
+        FileManifest filled = FileManifest::scan(root(), QStringList() << "save", before,
+                                                 FileManifest::StatOnly);
+        filled.setHash("save/a.sav", before.find("save/a.sav")->hash);
+        QVERIFY(filled.sameContent(before));
+    }
+};
+
+QTEST_MAIN(TestFileManifest)
+#include "test_filemanifest.moc"
@@ -0,0 +1,188 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include "core/hardlinksnapshot.h"
+#include "core/dirwalker.h"
+#include "core/filemanifest.h"
+#include "core/transferprogress.h"
+
+class TestHardlinkSnapshot : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString testDir() const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction();
+    }
+
+    static void writeFile(const QString &path, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write test file");
+        f.write(data);
+        f.close();
+    }
+
+    static QByteArray readFile(const QString &path)
+    {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return f.readAll();
+    }
+
+    static quint64 inode(const QString &path)
+    {
+        DirWalker::FileStat st;
+        return DirWalker::stat(path, &st) ? st.inode : 0;
+    }
+
+    // A save dir named "save" below testDir()
+    void writeSave()
+    {
+        writeFile(testDir() + "/save/world.dat", QByteArray(100000, 'w'));
+        writeFile(testDir() + "/save/player.dat", "player");
+        writeFile(testDir() + "/save/region/r.0.0.mca", QByteArray(5000, 'r'));
+        QFile::link("world.dat", testDir() + "/save/latest");
+    }
+
+private slots:
+    void write_copiesTreeAndRestoresIt()
+    {
+        writeSave();
+        HardlinkSnapshot snapshot(testDir() + "/1.tree");
+        HardlinkSnapshot::Stats stats;
+        QVERIFY(snapshot.write(testDir(), QStringList() << "save", QString(), &stats));
+        QCOMPARE(stats.copiedFiles, 3);
+        QCOMPARE(stats.linkedFiles, 0);
+        QCOMPARE(stats.bytesCopied, qint64(100000 + 6 + 5000));
+        QVERIFY(!QFileInfo::exists(testDir() + "/1.tree.partial"));
+
+        QVERIFY(snapshot.restore(testDir() + "/out"));
+        QCOMPARE(readFile(testDir() + "/out/save/world.dat"), QByteArray(100000, 'w'));
+        QCOMPARE(readFile(testDir() + "/out/save/region/r.0.0.mca"), QByteArray(5000, 'r'));
+        QCOMPARE(QFileInfo(testDir() + "/out/save/latest").symLinkTarget(),
+                 testDir() + "/out/save/world.dat");
+
+        // Restored files never share an inode with the snapshot
+        QVERIFY(inode(testDir() + "/out/save/world.dat") != inode(testDir() + "/1.tree/save/world.dat"));
+    }
+
+    void write_linksUnchangedFiles()
+    {
+        writeSave();
+        HardlinkSnapshot first(testDir() + "/1.tree");
+        QVERIFY(first.write(testDir(), QStringList() << "save"));
+
+        writeFile(testDir() + "/save/player.dat", "player2");
+        HardlinkSnapshot second(testDir() + "/2.tree");
+        HardlinkSnapshot::Stats stats;
+        QSet<QString> unchanged = {"save/world.dat", "save/region/r.0.0.mca"};
+        QVERIFY(second.write(testDir(), QStringList() << "save", first.treePath(), &stats, unchanged));
+        QCOMPARE(stats.linkedFiles, 2);
+        QCOMPARE(stats.copiedFiles, 1);
+        QCOMPARE(stats.bytesCopied, qint64(7));
+        QCOMPARE(inode(testDir() + "/2.tree/save/world.dat"), inode(testDir() + "/1.tree/save/world.dat"));
+        QVERIFY(inode(testDir() + "/2.tree/save/player.dat") != inode(testDir() + "/1.tree/save/player.dat"));
+
+        // Deleting the first snapshot leaves the shared files to the second
+        QVERIFY(first.remove());
+        QVERIFY(!QFileInfo::exists(first.treePath()));
+        QVERIFY(second.restore(testDir() + "/out"));
+        QCOMPARE(readFile(testDir() + "/out/save/world.dat"), QByteArray(100000, 'w'));
+        QCOMPARE(readFile(testDir() + "/out/save/player.dat"), QByteArray("player2"));
+    }
+
+    void write_copiesWhenPreviousDiffers()
+    {
+        writeSave();
+        HardlinkSnapshot first(testDir() + "/1.tree");
+        QVERIFY(first.write(testDir(), QStringList() << "save"));
+        // Damaged or edited previous snapshot: sizes no longer match
+        writeFile(testDir() + "/1.tree/save/world.dat", "short");
+
+        HardlinkSnapshot second(testDir() + "/2.tree");
+        HardlinkSnapshot::Stats stats;
+        QVERIFY(second.write(testDir(), QStringList() << "save", first.treePath(), &stats,
+                             QSet<QString>() << "save/world.dat"));
+        QCOMPARE(stats.linkedFiles, 0);
+        QCOMPARE(readFile(testDir() + "/2.tree/save/world.dat"), QByteArray(100000, 'w'));
+    }
+
+    void restore_selectedPaths()
+    {
+        writeSave();
+        HardlinkSnapshot snapshot(testDir() + "/1.tree");
+        QVERIFY(snapshot.write(testDir(), QStringList() << "save"));
+
+        QVERIFY(snapshot.restore(testDir() + "/out", QStringList() << "save/region"));
+        QVERIFY(QFileInfo::exists(testDir() + "/out/save/region/r.0.0.mca"));
+        QVERIFY(!QFileInfo::exists(testDir() + "/out/save/world.dat"));
+    }
+
+    void entries_listTree()
+    {
+        writeSave();
+        HardlinkSnapshot snapshot(testDir() + "/1.tree");
+        QVERIFY(snapshot.write(testDir(), QStringList() << "save"));
+
+        bool ok = false;
+        QHash<QString, HardlinkSnapshot::Entry> byPath;
+        for (const HardlinkSnapshot::Entry &entry : HardlinkSnapshot::entries(snapshot.treePath(), &ok))
+            byPath.insert(entry.path, entry);
+        QVERIFY(ok);
+        QCOMPARE(byPath.size(), 6);
+        QCOMPARE(byPath["save"].type, QString("dir"));
+        QCOMPARE(byPath["save/world.dat"].size, qint64(100000));
+        QCOMPARE(byPath["save/latest"].type, QString("symlink"));
+        QCOMPARE(byPath["save/latest"].linkTarget, QString("world.dat"));
+
+        HardlinkSnapshot::entries(testDir() + "/missing.tree", &ok);
+        QVERIFY(!ok);
+    }
+
+    void verify_detectsDamage()
+    {
+        writeSave();
+        FileManifest files = FileManifest::scan(testDir(), QStringList() << "save");
+        HardlinkSnapshot snapshot(testDir() + "/1.tree");
+        QVERIFY(snapshot.write(testDir(), QStringList() << "save"));
+        QVERIFY(snapshot.verify(files, false));
+        QVERIFY(snapshot.verify(files, true));
+
+        // Same size, different bytes: only a content check notices
+        writeFile(testDir() + "/1.tree/save/player.dat", "PLAYER");
+        QVERIFY(snapshot.verify(files, false));
+        QVERIFY(!snapshot.verify(files, true));
+
+        QFile::remove(testDir() + "/1.tree/save/region/r.0.0.mca");
+        QVERIFY(!snapshot.verify(files, false));
+    }
+
+    void write_cancelLeavesNothing()
+    {
+        writeSave();
+        TransferProgress progress([] { return true; });
+        HardlinkSnapshot snapshot(testDir() + "/1.tree");
+        snapshot.setProgress(&progress);
+        QVERIFY(!snapshot.write(testDir(), QStringList() << "save"));
+        QVERIFY(!QFileInfo::exists(testDir() + "/1.tree"));
+        QVERIFY(!QFileInfo::exists(testDir() + "/1.tree.partial"));
+    }
+
+    void write_missingSource()
+    {
+        HardlinkSnapshot snapshot(testDir() + "/1.tree");
+        QVERIFY(!snapshot.write(testDir(), QStringList() << "nope"));
+        QVERIFY(!QFileInfo::exists(testDir() + "/1.tree"));
+    }
+};
+
+QTEST_MAIN(TestHardlinkSnapshot)
+#include "test_hardlinksnapshot.moc"
@@ -0,0 +1,270 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QSemaphore>
+#include <QMutex>
+#include <QThread>
+#include <QSet>
+#include <atomic>
+#include "core/jobscheduler.h"
+#include "core/lowimpactio.h"
+
+class TestJobScheduler : public QObject {
+    Q_OBJECT
+
+private slots:
+    void submit_runsDifferentKeysConcurrently()
+    {
+        JobScheduler scheduler;
+        scheduler.setMaxConcurrentJobs(4);
+
+        // Every job waits until all four are running at once
+        QSemaphore arrived;
+        std::atomic<int> together{0};
+        for (int i = 0; i < 4; ++i) {
+            scheduler.submit(JobScheduler::Manual, QString("game-%1").arg(i), [&](JobContext &) {
+                arrived.release();
+                if (arrived.tryAcquire(4, 5000)) {
+                    arrived.release(4);
+                    ++together;
+                }
+            });
+        }
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        QVERIFY(idleSpy.wait(10000));
+        QCOMPARE(together.load(), 4);
+    }
+
+    void submit_serializesSameKey()
+    {
+        JobScheduler scheduler;
+        scheduler.setMaxConcurrentJobs(4);
+
+        std::atomic<int> running{0};
+        std::atomic<int> maxRunning{0};
+        for (int i = 0; i < 6; ++i) {
+            scheduler.submit(JobScheduler::Manual, "same-game", [&](JobContext &) {
+                int now = ++running;
+                int seen = maxRunning.load();
+                while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {
+                }
+                QThread::msleep(10);
+                --running;
+            });
+        }
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        QVERIFY(idleSpy.wait(10000));
+        QCOMPARE(maxRunning.load(), 1);
+    }
+
+    void submit_sharedKeysWaitForExclusiveHolder()
+    {
+        JobScheduler scheduler;
+        scheduler.setMaxConcurrentJobs(4);
+
+        // Two jobs sharing "store" run together; the one holding it waits
+        QSemaphore arrived;
+        std::atomic<int> together{0};
+        std::atomic<int> sharing{0};
+        std::atomic<bool> overlapped{false};
+        for (int i = 0; i < 2; ++i) {
+            JobScheduler::Keys keys;
+            keys.exclusive.append(QString("game-%1").arg(i));
+            keys.shared.append("store");
+            scheduler.submit(JobScheduler::Manual, keys, [&](JobContext &) {
+                ++sharing;
+                arrived.release();
+                if (arrived.tryAcquire(2, 5000)) {
+                    arrived.release(2);
+                    ++together;
+                }
+                QThread::msleep(10);
+                --sharing;
+            });
+        }
+        JobScheduler::Keys exclusive;
+        exclusive.exclusive.append("store");
+        scheduler.submit(JobScheduler::Manual, exclusive, [&](JobContext &) {
+            if (sharing.load() != 0)
+                overlapped = true;
+        });
+        QCOMPARE(scheduler.runningCount(), 2);
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        QVERIFY(idleSpy.wait(10000));
+        QCOMPARE(together.load(), 2);
+        QVERIFY(!overlapped.load());
+    }
+
+    void submit_allKeysRunsAlone()
+    {
+        JobScheduler scheduler;
+        scheduler.setMaxConcurrentJobs(4);
+
+        QSemaphore release;
+        scheduler.submit(JobScheduler::Manual, "game-a", [&](JobContext &) { release.acquire(); });
+
+        QMutex mutex;
+        QStringList order;
+        auto record = [&](const QString &name) {
+            return [&mutex, &order, name](JobContext &) {
+                QMutexLocker locker(&mutex);
+                order.append(name);
+            };
+        };
+        JobScheduler::Keys all;
+        all.all = true;
+        scheduler.submit(JobScheduler::Manual, all, record("all"));
+        // Free key, but queued behind the job that needs every key
+        scheduler.submit(JobScheduler::Manual, "game-b", record("game-b"));
+        QCOMPARE(scheduler.pendingCount(), 2);
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        release.release();
+        QVERIFY(idleSpy.wait(10000));
+        QCOMPARE(order, QStringList() << "all" << "game-b");
+    }
+
+    void submit_startsByPriority()
+    {
+        JobScheduler scheduler;
+        scheduler.setMaxConcurrentJobs(1);
+
+        // Occupy the only slot so the rest queue up
+        QSemaphore release;
+        scheduler.submit(JobScheduler::Manual, "blocker", [&](JobContext &) { release.acquire(); });
+
+        QMutex mutex;
+        QStringList order;
+        auto record = [&](const QString &name) {
+            return [&mutex, &order, name](JobContext &) {
+                QMutexLocker locker(&mutex);
+                order.append(name);
+            };
+        };
+        scheduler.submit(JobScheduler::Bulk, "a", record("bulk1"));
+        scheduler.submit(JobScheduler::Auto, "b", record("auto"));
+        scheduler.submit(JobScheduler::Bulk, "c", record("bulk2"));
+        scheduler.submit(JobScheduler::Manual, "d", record("manual"));
+        QCOMPARE(scheduler.pendingCount(), 4);
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        release.release();
+        QVERIFY(idleSpy.wait(10000));
+        QCOMPARE(order, QStringList() << "manual" << "auto" << "bulk1" << "bulk2");
+    }
+
+    void cancel_pendingJobSkipsWork()
+    {
+        JobScheduler scheduler;
+        scheduler.setMaxConcurrentJobs(1);
+
+        QSemaphore release;
+        scheduler.submit(JobScheduler::Manual, "blocker", [&](JobContext &) { release.acquire(); });
+
+        bool workRan = false;
+        bool doneCancelled = false;
+        quint64 id = scheduler.submit(JobScheduler::Bulk, "game",
+            [&](JobContext &) { workRan = true; },
+            [&](const JobContext &job) { doneCancelled = job.isCancelled(); });
+
+        QSignalSpy finishedSpy(&scheduler, &JobScheduler::jobFinished);
+        QVERIFY(scheduler.cancel(id));
+        QCOMPARE(finishedSpy.count(), 1);
+        QCOMPARE(finishedSpy[0][0].toULongLong(), id);
+        QCOMPARE(finishedSpy[0][1].toBool(), true);
+        QVERIFY(doneCancelled);
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        release.release();
+        QVERIFY(idleSpy.wait(10000));
+        QVERIFY(!workRan);
+    }
+
+    void cancel_runningJobIsFlagged()
+    {
+        JobScheduler scheduler;
+        QSemaphore started;
+        quint64 id = scheduler.submit(JobScheduler::Manual, "game", [&](JobContext &job) {
+            started.release();
+            while (!job.isCancelled())
+                QThread::msleep(1);
+        });
+
+        QVERIFY(started.tryAcquire(1, 5000));
+        QSignalSpy finishedSpy(&scheduler, &JobScheduler::jobFinished);
+        QVERIFY(scheduler.cancel(id));
+        QVERIFY(finishedSpy.wait(10000));
+        QCOMPARE(finishedSpy[0][1].toBool(), true);
+        QVERIFY(scheduler.isIdle());
+    }
+
+    void reportProgress_emitsOnSchedulerThread()
+    {
+        JobScheduler scheduler;
+        QSignalSpy progressSpy(&scheduler, &JobScheduler::jobProgress);
+        quint64 id = scheduler.submit(JobScheduler::Manual, QString(), [](JobContext &job) {
+            job.reportProgress(50, 100);
+            job.reportProgress(100, 100);
+        });
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        QVERIFY(idleSpy.wait(10000));
+        QTRY_COMPARE(progressSpy.count(), 2);
+        QCOMPARE(progressSpy[1][0].toULongLong(), id);
+        QCOMPARE(progressSpy[1][1].toLongLong(), qint64(100));
+        QCOMPARE(progressSpy[1][2].toLongLong(), qint64(100));
+    }
+
+    void setLowImpact_runsOnBackgroundThreads()
+    {
+        JobScheduler scheduler;
+        QVERIFY(!scheduler.isLowImpact(JobScheduler::Auto));
+        scheduler.setLowImpact(JobScheduler::Auto, true);
+        QVERIFY(scheduler.isLowImpact(JobScheduler::Auto));
+        QVERIFY(!scheduler.isLowImpact(JobScheduler::Manual));
+
+        QMutex mutex;
+        QHash<QString, bool> lowImpact;
+        QHash<QString, bool> background;
+        auto record = [&](const QString &name) {
+            return [&mutex, &lowImpact, &background, name](JobContext &job) {
+                QMutexLocker locker(&mutex);
+                lowImpact.insert(name, job.isLowImpact());
+                background.insert(name, LowImpactIo::isBackground());
+            };
+        };
+        // Manual jobs never share a thread that went into background mode
+        for (int i = 0; i < 4; ++i) {
+            scheduler.submit(JobScheduler::Auto, QString(), record(QString("auto%1").arg(i)));
+            scheduler.submit(JobScheduler::Manual, QString(), record(QString("manual%1").arg(i)));
+        }
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        QVERIFY(idleSpy.wait(10000));
+        QCOMPARE(lowImpact.size(), 8);
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(lowImpact.value(QString("auto%1").arg(i)));
+            QVERIFY(background.value(QString("auto%1").arg(i)));
+            QVERIFY(!lowImpact.value(QString("manual%1").arg(i)));
+            QVERIFY(!background.value(QString("manual%1").arg(i)));
+        }
+    }
+
+    void submit_returnsUniqueIds()
+    {
+        JobScheduler scheduler;
+        QSet<quint64> ids;
+        for (int i = 0; i < 10; ++i)
+            ids.insert(scheduler.submit(JobScheduler::Bulk, QString(), [](JobContext &) {}));
+        QCOMPARE(ids.size(), 10);
+        QVERIFY(!ids.contains(0));
+
+        QSignalSpy idleSpy(&scheduler, &JobScheduler::idle);
+        QVERIFY(idleSpy.wait(10000));
+    }
+};
+
+QTEST_MAIN(TestJobScheduler)
+#include "test_jobscheduler.moc"
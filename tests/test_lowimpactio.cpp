@@ -0,0 +1,115 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QFile>
+#include <thread>
+#include "core/lowimpactio.h"
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct ThreadState {
+    bool background = false;
+    int policy = -1;
+    int ioprioClass = -1;
+    int nice = 0;
+};
+
+ThreadState currentThreadState()
+{
+    ThreadState state;
+    state.background = LowImpactIo::isBackground();
+#ifdef Q_OS_LINUX
+    state.policy = sched_getscheduler(0);
+    // IOPRIO_WHO_PROCESS for the calling thread; the class is above bit 13
+    long ioprio = ::syscall(SYS_ioprio_get, 1, 0);
+    state.ioprioClass = ioprio >= 0 ? int(ioprio >> 13) : -1;
+    state.nice = ::getpriority(PRIO_PROCESS, id_t(::syscall(SYS_gettid)));
+#endif
+    return state;
+}
+
+} // namespace
+
+class TestLowImpactIo : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+private slots:
+    void enterBackgroundMode_appliesToCallingThreadOnly()
+    {
+        ThreadState before = currentThreadState();
+        ThreadState inside;
+        ThreadState child;
+        bool entered = false;
+        QThread *thread = QThread::create([&]() {
+            entered = LowImpactIo::enterBackgroundMode();
+            // Calling it again is harmless
+            LowImpactIo::enterBackgroundMode();
+            inside = currentThreadState();
+            // Compression threads started by the job inherit it
+            std::thread([&child]() { child = currentThreadState(); }).join();
+        });
+        thread->start();
+        QVERIFY(thread->wait(10000));
+        delete thread;
+
+        QVERIFY(entered);
+        QVERIFY(inside.background);
+        ThreadState after = currentThreadState();
+        QVERIFY(!after.background);
+        QCOMPARE(after.policy, before.policy);
+        QCOMPARE(after.nice, before.nice);
+#ifdef Q_OS_LINUX
+        QCOMPARE(inside.policy, SCHED_IDLE);
+        QCOMPARE(inside.nice, 19);
+        QCOMPARE(child.policy, SCHED_IDLE);
+        QCOMPARE(child.nice, 19);
+        // Containers may refuse ioprio_set; the rest still applies
+        if (inside.ioprioClass >= 0 && inside.ioprioClass != 3)
+            qWarning("ioprio_set not honoured here (class %d)", inside.ioprioClass);
+        else if (inside.ioprioClass == 3)
+            QCOMPARE(child.ioprioClass, 3);
+#endif
+    }
+
+    void dropCache_keepsFileContent()
+    {
+        QString path = m_tmpDir.path() + "/save.dat";
+        QByteArray data(256 * 1024, 'x');
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(data);
+        f.close();
+
+        // Outside background mode nothing happens
+        LowImpactIo::dropCache(path, true);
+
+        QByteArray read;
+        QThread *thread = QThread::create([&]() {
+            LowImpactIo::enterBackgroundMode();
+            LowImpactIo::dropCache(path, true);
+            QFile in(path);
+            if (in.open(QIODevice::ReadOnly)) {
+                read = in.readAll();
+                LowImpactIo::dropCache(in.handle());
+            }
+            LowImpactIo::dropCache(m_tmpDir.path() + "/missing.dat");
+        });
+        thread->start();
+        QVERIFY(thread->wait(10000));
+        delete thread;
+        QCOMPARE(read, data);
+    }
+};
+
+QTEST_MAIN(TestLowImpactIo)
+#include "test_lowimpactio.moc"
@@ -0,0 +1,51 @@
+#include <QTest>
+#include "core/memorybudget.h"
+
+class TestMemoryBudget : public QObject {
+    Q_OBJECT
+
+private slots:
+    void budget_clampsToMinimum()
+    {
+        QCOMPARE(MemoryBudget(0).bytes(), MemoryBudget::MinimumBytes);
+        QCOMPARE(MemoryBudget().bytes(), MemoryBudget::DefaultBytes);
+
+        MemoryBudget budget(64 * 1024 * 1024);
+        QCOMPARE(budget.readAheadBytes() + budget.compressionBytes(), budget.bytes());
+        QCOMPARE(budget.deltaFileLimit(), qint64(8 * 1024 * 1024));
+    }
+
+    void budget_splitsBetweenStages()
+    {
+        MemoryBudget small(MemoryBudget::MinimumBytes);
+        MemoryBudget large(1024 * 1024 * 1024);
+
+        // Every stage gets at least one buffer, and more with more memory
+        QVERIFY(small.readAheadFiles(256 * 1024) >= 1);
+        QVERIFY(large.readAheadFiles(256 * 1024) > small.readAheadFiles(256 * 1024));
+        QVERIFY(small.gzipBlocksInFlight(1024 * 1024) >= 2);
+        QVERIFY(qint64(small.gzipBlocksInFlight(1024 * 1024)) * 2 * 1024 * 1024 <= small.compressionBytes());
+        QVERIFY(large.gzipBlocksInFlight(1024 * 1024) > small.gzipBlocksInFlight(1024 * 1024));
+        QVERIFY(small.zstdThreads(64, 3) >= 1);
+        QVERIFY(large.zstdThreads(64, 3) > small.zstdThreads(64, 3));
+        QCOMPARE(large.zstdThreads(2, 3), 2);
+    }
+
+    void budget_lowersZstdToWhatFits()
+    {
+        // Level 19's match tables alone are over 64 MiB
+        QVERIFY(MemoryBudget().zstdLevel(19) < 19);
+        QCOMPARE(MemoryBudget(1024 * 1024 * 1024).zstdLevel(19), 19);
+        QCOMPARE(MemoryBudget(MemoryBudget::MinimumBytes).zstdLevel(3), 3);
+
+        // The long-distance window grows with the budget up to 128 MiB
+        int smallWindow = MemoryBudget().zstdLongWindowLog(3);
+        QVERIFY(smallWindow == 0 || smallWindow > 21);
+        QVERIFY(smallWindow < 27);
+        QCOMPARE(MemoryBudget(2048LL * 1024 * 1024).zstdLongWindowLog(3), 27);
+        QCOMPARE(MemoryBudget(MemoryBudget::MinimumBytes).zstdThreads(16, 3, 27), 1);
+    }
+};
+
+QTEST_MAIN(TestMemoryBudget)
+#include "test_memorybudget.moc"
@@ -0,0 +1,152 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+#include <QFile>
+#include "core/parallelgzip.h"
+#include <zlib.h>
+
+class TestParallelGzip : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString path() const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction() + ".gz";
+    }
+
+    // gzread transparently continues across concatenated members
+    static QByteArray gunzip(const QString &path)
+    {
+        gzFile gz = gzopen(QFile::encodeName(path).constData(), "rb");
+        if (!gz)
+            return QByteArray();
+        QByteArray out;
+        char buf[65536];
+        int n;
+        while ((n = gzread(gz, buf, sizeof(buf))) > 0)
+            out.append(buf, n);
+        gzclose(gz);
+        return out;
+    }
+
+    static QByteArray sampleData(qsizetype size)
+    {
+        QRandomGenerator rng(7);
+        QByteArray data;
+        data.reserve(size);
+        while (data.size() < size) {
+            // Half text, half noise so members differ in compressed size
+            if (rng.bounded(2))
+                data.append(QByteArray("level=3;hp=100;pos=12,40;").repeated(8));
+            else
+                for (int i = 0; i < 200; ++i)
+                    data.append(char(rng.bounded(256)));
+        }
+        data.truncate(size);
+        return data;
+    }
+
+private slots:
+    void roundTrip_manyBlocksStayOrdered()
+    {
+        QByteArray data = sampleData(1000000);
+
+        // 16 KiB blocks and 4 threads: ~60 members, many in flight at once
+        ParallelGzipWriter writer(6, 4, 16 * 1024);
+        QVERIFY(writer.open(path()));
+        // Odd write sizes so blocks never line up with writes
+        for (qsizetype pos = 0; pos < data.size(); pos += 3001)
+            QVERIFY(writer.write(data.constData() + pos, qMin<qsizetype>(3001, data.size() - pos)));
+        QVERIFY(writer.close());
+
+        QCOMPARE(writer.bytesIn(), qint64(data.size()));
+        QCOMPARE(writer.bytesOut(), QFileInfo(path()).size());
+        QCOMPARE(gunzip(path()), data);
+    }
+
+    void roundTrip_singleThread()
+    {
+        QByteArray data = sampleData(100000);
+        ParallelGzipWriter writer(1, 1, 8 * 1024);
+        QVERIFY(writer.open(path()));
+        QVERIFY(writer.write(data.constData(), data.size()));
+        QVERIFY(writer.close());
+        QCOMPARE(gunzip(path()), data);
+    }
+
+    void roundTrip_boundedQueueRecyclesBuffers()
+    {
+        QByteArray data = sampleData(2000000);
+
+        // More threads than blocks allowed in flight: the queue decides
+        ParallelGzipWriter writer(6, 8, 32 * 1024, 3);
+        QCOMPARE(writer.maxInFlight(), 3);
+        QVERIFY(writer.open(path()));
+        for (qsizetype pos = 0; pos < data.size(); pos += 50000)
+            QVERIFY(writer.write(data.constData() + pos, qMin<qsizetype>(50000, data.size() - pos)));
+        QVERIFY(writer.close());
+
+        QCOMPARE(writer.memberSizes().size(), (data.size() + 32 * 1024 - 1) / (32 * 1024));
+        QCOMPARE(gunzip(path()), data);
+    }
+
+    void emptyStream_isValidGzip()
+    {
+        ParallelGzipWriter writer(6, 2);
+        QVERIFY(writer.open(path()));
+        QVERIFY(writer.close());
+
+        QFile f(path());
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        QCOMPARE(f.read(2), QByteArray("\x1f\x8b", 2));
+        f.close();
+        QVERIFY(gunzip(path()).isEmpty());
+    }
+
+    void compressMember_isStandaloneGzip()
+    {
+        QByteArray member = ParallelGzipWriter::compressMember("hello hello hello", 9);
+        QVERIFY(member.startsWith(QByteArray("\x1f\x8b", 2)));
+
+        QFile f(path());
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(member);
+        f.write(member);
+        f.close();
+        QCOMPARE(gunzip(path()), QByteArray("hello hello hellohello hello hello"));
+    }
+
+    void incompressibleBlocks_areStored()
+    {
+        QRandomGenerator rng(11);
+        QByteArray noise(64 * 1024, Qt::Uninitialized);
+        for (qsizetype i = 0; i < noise.size(); ++i)
+            noise[i] = char(rng.bounded(256));
+        QByteArray text = QByteArray("level=3;hp=100;pos=12,40;").repeated(64 * 1024 / 26 + 1).left(64 * 1024);
+
+        ParallelGzipWriter writer(9, 2, 64 * 1024);
+        QVERIFY(writer.open(path()));
+        QVERIFY(writer.write(noise.constData(), noise.size()));
+        QVERIFY(writer.write(text.constData(), text.size()));
+        QVERIFY(writer.close());
+
+        QCOMPARE(writer.skippedBytes(), qint64(noise.size()));
+        QCOMPARE(writer.memberSizes().size(), 2);
+        // A stored member costs a few bytes of framing over its input
+        QVERIFY(writer.memberSizes().at(0) < noise.size() + 64);
+        QVERIFY(writer.memberSizes().at(1) < text.size() / 10);
+        QCOMPARE(gunzip(path()), noise + text);
+    }
+
+    void open_failsForMissingDirectory()
+    {
+        ParallelGzipWriter writer(6, 2);
+        QVERIFY(!writer.open(m_tmpDir.path() + "/missing/dir/out.gz"));
+        QVERIFY(!writer.errorString().isEmpty());
+    }
+};
+
+QTEST_MAIN(TestParallelGzip)
+#include "test_parallelgzip.moc"
@@ -0,0 +1,189 @@
+#include <QTest>
+#include "core/retentionpolicy.h"
+
+class TestRetentionPolicy : public QObject {
+    Q_OBJECT
+
+private:
+    // Wednesday, ISO week 20
+    const QDateTime m_now = QDateTime::fromString("2024-05-15T12:00:00Z", Qt::ISODate);
+
+    BackupInfo backupAt(const QString &id, const QDateTime &when, qint64 size = 100, int profileId = -1) const
+    {
+        BackupInfo backup;
+        backup.id = id;
+        backup.gameId = "g";
+        backup.timestamp = when;
+        backup.size = size;
+        backup.profileId = profileId;
+        return backup;
+    }
+
+    static QDateTime at(const QString &iso)
+    {
+        return QDateTime::fromString(iso, Qt::ISODate);
+    }
+
+    static RetentionPolicy onlyKeepLast(int count)
+    {
+        RetentionPolicy policy;
+        policy.enabled = true;
+        policy.keepLast = count;
+        policy.hourly = 0;
+        policy.daily = 0;
+        policy.weekly = 0;
+        return policy;
+    }
+
+    static QStringList ids(const QList<BackupInfo> &backups)
+    {
+        QStringList result;
+        for (const BackupInfo &backup : backups)
+            result.append(backup.id);
+        return result;
+    }
+
+private slots:
+    void disabled_prunesNothing()
+    {
+        RetentionPolicy policy = onlyKeepLast(1);
+        policy.enabled = false;
+        QList<BackupInfo> backups = {backupAt("a", m_now.addDays(-1)), backupAt("b", m_now.addDays(-2))};
+        QVERIFY(policy.plan(backups, m_now).isEmpty());
+    }
+
+    void keepLast_prunesOldestFirst()
+    {
+        QList<BackupInfo> backups;
+        for (int i = 0; i < 5; ++i)
+            backups.append(backupAt(QString::number(i), m_now.addSecs(-60 * i)));
+
+        QCOMPARE(ids(onlyKeepLast(3).plan(backups, m_now)), QStringList({"4", "3"}));
+    }
+
+    void hourly_keepsNewestPerHour()
+    {
+        RetentionPolicy policy = onlyKeepLast(1);
+        policy.hourly = 24;
+        QList<BackupInfo> backups = {
+            backupAt("11:50", at("2024-05-15T11:50:00Z")),
+            backupAt("11:40", at("2024-05-15T11:40:00Z")),
+            backupAt("10:30", at("2024-05-15T10:30:00Z")),
+            backupAt("10:10", at("2024-05-15T10:10:00Z")),
+            backupAt("old", at("2024-05-14T06:00:00Z")),
+        };
+
+        QCOMPARE(ids(policy.plan(backups, m_now)), QStringList({"old", "10:10", "11:40"}));
+    }
+
+    void daily_keepsNewestPerDay()
+    {
+        RetentionPolicy policy = onlyKeepLast(1);
+        policy.daily = 7;
+        QList<BackupInfo> backups = {
+            backupAt("today-9", at("2024-05-15T09:00:00Z")),
+            backupAt("today-8", at("2024-05-15T08:00:00Z")),
+            backupAt("yesterday-20", at("2024-05-14T20:00:00Z")),
+            backupAt("yesterday-10", at("2024-05-14T10:00:00Z")),
+            backupAt("old", at("2024-05-05T10:00:00Z")),
+        };
+
+        QCOMPARE(ids(policy.plan(backups, m_now)), QStringList({"old", "yesterday-10", "today-8"}));
+    }
+
+    void weekly_keepsNewestPerIsoWeek()
+    {
+        RetentionPolicy policy = onlyKeepLast(1);
+        policy.weekly = 4;
+        QList<BackupInfo> backups = {
+            backupAt("tue", at("2024-05-14T10:00:00Z")),
+            backupAt("mon", at("2024-05-13T10:00:00Z")),
+            backupAt("last-wed", at("2024-05-08T10:00:00Z")),
+            backupAt("last-tue", at("2024-05-07T10:00:00Z")),
+            backupAt("old", at("2024-04-01T10:00:00Z")),
+        };
+
+        QCOMPARE(ids(policy.plan(backups, m_now)), QStringList({"old", "last-tue", "mon"}));
+    }
+
+    void profiles_areBucketedSeparately()
+    {
+        QList<BackupInfo> backups = {
+            backupAt("a1", m_now.addSecs(-60), 100, 1),
+            backupAt("b1", m_now.addSecs(-120), 100, 2),
+            backupAt("a2", m_now.addSecs(-180), 100, 1),
+            backupAt("b2", m_now.addSecs(-240), 100, 2),
+        };
+
+        QCOMPARE(ids(onlyKeepLast(1).plan(backups, m_now)), QStringList({"b2", "a2"}));
+    }
+
+    void pinnedAndNoted_areNeverPruned()
+    {
+        BackupInfo pinned = backupAt("pinned", m_now.addDays(-400));
+        pinned.pinned = true;
+        BackupInfo noted = backupAt("noted", m_now.addDays(-300));
+        noted.notes = "Before final boss";
+        QList<BackupInfo> backups = {backupAt("new", m_now.addSecs(-60)), noted, pinned,
+                                     backupAt("plain", m_now.addDays(-200))};
+
+        QCOMPARE(ids(onlyKeepLast(1).plan(backups, m_now)), QStringList({"plain"}));
+        QVERIFY(RetentionPolicy::isExempt(pinned));
+        QVERIFY(RetentionPolicy::isExempt(noted));
+    }
+
+    void sizeCap_dropsOldestButKeepsNewest()
+    {
+        RetentionPolicy policy = onlyKeepLast(10);
+        QList<BackupInfo> backups;
+        for (int i = 0; i < 4; ++i)
+            backups.append(backupAt(QString::number(i), m_now.addSecs(-60 * i)));
+
+        policy.maxTotalSize = 250;
+        QCOMPARE(ids(policy.plan(backups, m_now)), QStringList({"3", "2"}));
+
+        // Even when the newest alone is over the cap
+        policy.maxTotalSize = 50;
+        QCOMPARE(ids(policy.plan(backups, m_now)), QStringList({"3", "2", "1"}));
+    }
+
+    void sizeCap_countsExemptBackups()
+    {
+        RetentionPolicy policy = onlyKeepLast(10);
+        policy.maxTotalSize = 250;
+        BackupInfo pinned = backupAt("pinned", m_now.addDays(-10), 200);
+        pinned.pinned = true;
+        QList<BackupInfo> backups = {backupAt("new", m_now.addSecs(-60)), backupAt("mid", m_now.addDays(-1)),
+                                     pinned};
+
+        QCOMPARE(ids(policy.plan(backups, m_now)), QStringList({"mid"}));
+    }
+
+    void json_roundTrips()
+    {
+        RetentionPolicy policy;
+        policy.enabled = true;
+        policy.keepLast = 2;
+        policy.hourly = 12;
+        policy.daily = 3;
+        policy.weekly = 8;
+        policy.maxTotalSize = qint64(5) * 1024 * 1024 * 1024;
+
+        RetentionPolicy copy = RetentionPolicy::fromJson(policy.toJson());
+        QVERIFY(copy.enabled);
+        QCOMPARE(copy.keepLast, 2);
+        QCOMPARE(copy.hourly, 12);
+        QCOMPARE(copy.daily, 3);
+        QCOMPARE(copy.weekly, 8);
+        QCOMPARE(copy.maxTotalSize, policy.maxTotalSize);
+
+        // Missing rules are off; keepLast never drops below one
+        QVERIFY(!RetentionPolicy::fromJson(QJsonObject()).enabled);
+        QJsonObject zero;
+        zero["keepLast"] = 0;
+        QCOMPARE(RetentionPolicy::fromJson(zero).keepLast, 1);
+    }
+};
+
+QTEST_MAIN(TestRetentionPolicy)
+#include "test_retentionpolicy.moc"
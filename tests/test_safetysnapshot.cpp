@@ -0,0 +1,151 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include "core/safetysnapshot.h"
+#include "core/transferprogress.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+class TestSafetySnapshot : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString path(const QString &name) const
+    {
+        return m_tmpDir.path() + "/" + QTest::currentTestFunction() + "/" + name;
+    }
+
+    static void writeFile(const QString &filePath, const QByteArray &data)
+    {
+        QDir().mkpath(QFileInfo(filePath).absolutePath());
+        QFile f(filePath);
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write %s", qPrintable(filePath));
+        f.write(data);
+        f.close();
+    }
+
+    static QByteArray readFile(const QString &filePath)
+    {
+        QFile f(filePath);
+        return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+    }
+
+    SafetySnapshot makeSnapshot(const QString &gameId)
+    {
+        SafetySnapshot snapshot;
+        snapshot.gameId = gameId;
+        snapshot.targetPath = path("saves");
+        snapshot.path = SafetySnapshot::newPath(snapshot.targetPath);
+        snapshot.backupName = "Before boss";
+        snapshot.created = QDateTime::currentDateTime();
+        QDir().mkpath(snapshot.treePath());
+        return snapshot;
+    }
+
+private slots:
+    void newPath_isHiddenSibling()
+    {
+        QString snapshotPath = SafetySnapshot::newPath(path("saves/"));
+        QCOMPARE(QFileInfo(snapshotPath).absolutePath(), QFileInfo(path("saves")).absolutePath());
+        QVERIFY(QFileInfo(snapshotPath).fileName().startsWith(".saves.undo-"));
+    }
+
+    void record_saveLoadRemove()
+    {
+        QString backupDir = path("backups");
+        SafetySnapshot snapshot = makeSnapshot("game-a");
+        QVERIFY(snapshot.isValid());
+        QCOMPARE(snapshot.treePath(), snapshot.path + "/restore/saves");
+        QVERIFY(snapshot.save(backupDir));
+
+        SafetySnapshot loaded = SafetySnapshot::load(backupDir, "game-a");
+        QVERIFY(loaded.isValid());
+        QCOMPARE(loaded.targetPath, snapshot.targetPath);
+        QCOMPARE(loaded.path, snapshot.path);
+        QCOMPARE(loaded.backupName, QString("Before boss"));
+        QCOMPARE(loaded.created.toSecsSinceEpoch(), snapshot.created.toSecsSinceEpoch());
+
+        QVERIFY(makeSnapshot("game-b").save(backupDir));
+        QCOMPARE(SafetySnapshot::loadAll(backupDir).size(), 2);
+
+        QVERIFY(SafetySnapshot::remove(backupDir, "game-a"));
+        QVERIFY(!SafetySnapshot::load(backupDir, "game-a").isValid());
+        QCOMPARE(SafetySnapshot::loadAll(backupDir).size(), 1);
+        // Removing a missing record is not an error
+        QVERIFY(SafetySnapshot::remove(backupDir, "game-a"));
+    }
+
+    void isValid_needsTree()
+    {
+        SafetySnapshot snapshot = makeSnapshot("game");
+        QVERIFY(snapshot.isValid());
+        QDir(snapshot.path).removeRecursively();
+        QVERIFY(!snapshot.isValid());
+        QVERIFY(!SafetySnapshot().isValid());
+    }
+
+    void isExpired_afterMaxAge()
+    {
+        SafetySnapshot snapshot;
+        snapshot.created = QDateTime::fromSecsSinceEpoch(1700000000);
+        QVERIFY(!snapshot.isExpired(snapshot.created.addSecs(SafetySnapshot::MaxAgeSecs - 1)));
+        QVERIFY(snapshot.isExpired(snapshot.created.addSecs(SafetySnapshot::MaxAgeSecs)));
+    }
+
+    void cloneTree_copiesTree()
+    {
+        writeFile(path("saves/save.dat"), "save data");
+        writeFile(path("saves/sub/deep/extra.bin"), "extra");
+        QDir().mkpath(path("saves/empty"));
+
+        TransferProgress progress;
+        QVERIFY(SafetySnapshot::cloneTree(path("saves"), path("copy"), false, progress));
+        QCOMPARE(readFile(path("copy/save.dat")), QByteArray("save data"));
+        QCOMPARE(readFile(path("copy/sub/deep/extra.bin")), QByteArray("extra"));
+        QVERIFY(QFileInfo(path("copy/empty")).isDir());
+        QCOMPARE(progress.stats().filesDone, 2);
+
+        // A copy, so writing the source leaves it alone
+        writeFile(path("saves/save.dat"), "changed");
+        QCOMPARE(readFile(path("copy/save.dat")), QByteArray("save data"));
+    }
+
+    void cloneTree_hardLinksShareInode()
+    {
+        writeFile(path("saves/save.dat"), "save data");
+
+        TransferProgress progress;
+        QVERIFY(SafetySnapshot::cloneTree(path("saves"), path("links"), true, progress));
+        QCOMPARE(readFile(path("links/save.dat")), QByteArray("save data"));
+#ifdef Q_OS_UNIX
+        struct stat source;
+        struct stat link;
+        QVERIFY(::stat(QFile::encodeName(path("saves/save.dat")).constData(), &source) == 0);
+        QVERIFY(::stat(QFile::encodeName(path("links/save.dat")).constData(), &link) == 0);
+        QCOMPARE(source.st_ino, link.st_ino);
+#endif
+
+        // Replacing the live file by rename leaves the snapshot's copy intact
+        writeFile(path("new.dat"), "restored");
+        QFile::remove(path("saves/save.dat"));
+        QVERIFY(QFile::rename(path("new.dat"), path("saves/save.dat")));
+        QCOMPARE(readFile(path("links/save.dat")), QByteArray("save data"));
+    }
+
+    void cloneTree_stopsWhenCancelled()
+    {
+        writeFile(path("saves/save.dat"), "save data");
+        TransferProgress progress([]() { return true; });
+        QVERIFY(!SafetySnapshot::cloneTree(path("saves"), path("copy"), false, progress));
+    }
+};
+
+QTEST_MAIN(TestSafetySnapshot)
+#include "test_safetysnapshot.moc"
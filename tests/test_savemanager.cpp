@@ -6,8 +6,13 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QThread>
+#include <QThreadPool>
+#include <QSet>
+#include <QRandomGenerator>
 #include "core/savemanager.h"
+#include "core/database.h"
 #include "core/gameinfo.h"
+#include "core/dirwalker.h"
 
 static int s_testCounter = 0;
 
@@ -54,6 +59,26 @@ private:
         return game;
     }
 
+    void writeWorld(const QByteArray &data)
+    {
+        QFile f(m_saveDir + "/world.dat");
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Failed to write world.dat");
+        f.write(data);
+        f.close();
+    }
+
+    QByteArray restoredWorld(const BackupInfo &backup, const QString &name)
+    {
+        QString restoreDir = m_tmpDir.path() + "/" + name;
+        if (!m_mgr->restoreBackup(backup, restoreDir))
+            return QByteArray();
+        QFile f(restoreDir + "/world.dat");
+        if (!f.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return f.readAll();
+    }
+
 private slots:
     void init()
     {
@@ -131,6 +156,28 @@ private slots:
         QCOMPARE(errorSpy.count(), 1);
     }
 
+    void createBackup_unreadableFileIsSkipped()
+    {
+        createSaveFiles();
+        QFile locked(m_saveDir + "/save.dat");
+        QVERIFY(locked.setPermissions(QFileDevice::WriteOwner));
+        if (locked.open(QIODevice::ReadOnly)) {
+            locked.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+            QSKIP("Permissions do not stop this user from reading");
+        }
+
+        // The rest of the saves are kept and the left-out file is reported
+        QSignalSpy spy(m_mgr, &SaveManager::backupIncomplete);
+        GameInfo game = makeGame("locked", "Locked");
+        QVERIFY(m_mgr->createBackup(game));
+        locked.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+        QCOMPARE(m_mgr->getBackupsForGame("locked").size(), 1);
+        QCOMPARE(spy.count(), 1);
+        QStringList paths = spy.at(0).at(2).toStringList();
+        QCOMPARE(paths.size(), 1);
+        QVERIFY(paths.first().endsWith("save.dat"));
+    }
+
     // --- Listing and retrieval ---
 
     void getBackupsForGame_sortedDescending()
@@ -217,6 +264,402 @@ private slots:
         QCOMPARE(errorSpy.count(), 1);
     }
 
+    void restoreBackup_replacesExistingTree()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("swap-game", "Swap Game");
+        QVERIFY(m_mgr->createBackup(game, "Swap"));
+        BackupInfo backup = m_mgr->getBackupsForGame("swap-game")[0];
+
+        // Files added after the backup must not survive the restore
+        QFile stray(m_saveDir + "/stray.tmp");
+        QVERIFY(stray.open(QIODevice::WriteOnly));
+        stray.close();
+        QFile::remove(m_saveDir + "/config.ini");
+
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir));
+        QVERIFY(!QFile::exists(m_saveDir + "/stray.tmp"));
+        QVERIFY(QFile::exists(m_saveDir + "/config.ini"));
+        QVERIFY(QFile::exists(m_saveDir + "/subdir/extra.bin"));
+
+        // The staging sibling holding the old tree is removed in the background
+        QThreadPool::globalInstance()->waitForDone();
+        QDir parent = QFileInfo(m_saveDir).absoluteDir();
+        QVERIFY(parent.entryList(QStringList() << ".*.restore-*", QDir::AllEntries | QDir::Hidden).isEmpty());
+        QVERIFY(QDir(m_backupDir).entryList(QStringList() << "temp_restore_*", QDir::Dirs).isEmpty());
+    }
+
+    void restoreBackup_missingTargetParent()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("moved-game", "Moved Game");
+        QVERIFY(m_mgr->createBackup(game, "Moved"));
+        BackupInfo backup = m_mgr->getBackupsForGame("moved-game")[0];
+
+        QString target = m_tmpDir.path() + "/new_machine_" + QString::number(s_testCounter) + "/saves";
+        QVERIFY(m_mgr->restoreBackup(backup, target));
+        QVERIFY(QFile::exists(target + "/save.dat"));
+        QVERIFY(QFile::exists(target + "/subdir/extra.bin"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void restoreBackupAsync_swapsIntoPlace()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("async-game", "Async Game");
+        QVERIFY(m_mgr->createBackup(game, "Async"));
+        BackupInfo backup = m_mgr->getBackupsForGame("async-game")[0];
+
+        QFile save(m_saveDir + "/save.dat");
+        QVERIFY(save.open(QIODevice::WriteOnly));
+        save.write("overwritten");
+        save.close();
+
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QSignalSpy restoredSpy(m_mgr, &SaveManager::backupRestored);
+        m_mgr->restoreBackupAsync(backup, m_saveDir);
+        QVERIFY(finishedSpy.wait(10000));
+        QCOMPARE(restoredSpy.count(), 1);
+
+        QVERIFY(save.open(QIODevice::ReadOnly));
+        QCOMPARE(save.readAll(), QByteArray("save data content 12345"));
+        save.close();
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void restoreBackup_differentialWritesOnlyChangedFiles()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("diff-game", "Diff Game");
+        QVERIFY(m_mgr->createBackup(game, "Diff"));
+        BackupInfo backup = m_mgr->getBackupsForGame("diff-game")[0];
+
+        QFile save(m_saveDir + "/save.dat");
+        QVERIFY(save.open(QIODevice::WriteOnly));
+        save.write("save data content 54321"); // same size, new content
+        save.close();
+        QFile::remove(m_saveDir + "/config.ini");
+        QFile stray(m_saveDir + "/stray.tmp");
+        QVERIFY(stray.open(QIODevice::WriteOnly));
+        stray.close();
+        QDir().mkpath(m_saveDir + "/cache/shaders");
+        QFile shader(m_saveDir + "/cache/shaders/a.bin");
+        QVERIFY(shader.open(QIODevice::WriteOnly));
+        shader.close();
+
+        QSignalSpy reportSpy(m_mgr, &SaveManager::restoreReported);
+        SaveManager::RestoreReport report;
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir, SaveManager::RestoreDifferential, &report));
+        QCOMPARE(reportSpy.count(), 1);
+
+        QStringList written = report.written;
+        written.sort();
+        QCOMPARE(written, QStringList() << "config.ini" << "save.dat");
+        QCOMPARE(report.removed, QStringList() << "cache" << "stray.tmp");
+        QCOMPARE(report.unchanged, 1);
+
+        QVERIFY(save.open(QIODevice::ReadOnly));
+        QCOMPARE(save.readAll(), QByteArray("save data content 12345"));
+        save.close();
+        QVERIFY(QFile::exists(m_saveDir + "/config.ini"));
+        QVERIFY(QFile::exists(m_saveDir + "/subdir/extra.bin"));
+        QVERIFY(!QFile::exists(m_saveDir + "/stray.tmp"));
+        QVERIFY(!QFile::exists(m_saveDir + "/cache"));
+        QThreadPool::globalInstance()->waitForDone();
+        QDir parent = QFileInfo(m_saveDir).absoluteDir();
+        QVERIFY(parent.entryList(QStringList() << ".*.restore-*", QDir::AllEntries | QDir::Hidden).isEmpty());
+    }
+
+    void restoreBackup_differentialMatchingTreeTouchesNothing()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("diff-noop", "Diff Noop");
+        QVERIFY(m_mgr->createBackup(game, "Noop"));
+        BackupInfo backup = m_mgr->getBackupsForGame("diff-noop")[0];
+        QDateTime mtime = QFileInfo(m_saveDir + "/save.dat").lastModified();
+
+        SaveManager::RestoreReport report;
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir, SaveManager::RestoreDifferential, &report));
+        QVERIFY(report.written.isEmpty());
+        QVERIFY(report.removed.isEmpty());
+        QCOMPARE(report.unchanged, 3);
+        QCOMPARE(QFileInfo(m_saveDir + "/save.dat").lastModified(), mtime);
+        // No staging directory was needed
+        QDir parent = QFileInfo(m_saveDir).absoluteDir();
+        QVERIFY(parent.entryList(QStringList() << ".*.restore-*", QDir::AllEntries | QDir::Hidden).isEmpty());
+    }
+
+    void restoreBackup_differentialIntoNewLocation()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("diff-new", "Diff New");
+        QVERIFY(m_mgr->createBackup(game, "New"));
+        BackupInfo backup = m_mgr->getBackupsForGame("diff-new")[0];
+
+        QString target = m_tmpDir.path() + "/diff_target_" + QString::number(s_testCounter);
+        SaveManager::RestoreReport report;
+        QVERIFY(m_mgr->restoreBackup(backup, target, SaveManager::RestoreDifferential, &report));
+        QCOMPARE(report.written.size(), 3);
+        QCOMPARE(report.unchanged, 0);
+        QFile extra(target + "/subdir/extra.bin");
+        QVERIFY(extra.open(QIODevice::ReadOnly));
+        QCOMPARE(extra.readAll(), QByteArray("binary content"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void restoreBackupAsync_differentialReports()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("diff-async", "Diff Async");
+        QVERIFY(m_mgr->createBackup(game, "Async"));
+        BackupInfo backup = m_mgr->getBackupsForGame("diff-async")[0];
+        QFile::remove(m_saveDir + "/subdir/extra.bin");
+
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QSignalSpy reportSpy(m_mgr, &SaveManager::restoreReported);
+        QSignalSpy restoredSpy(m_mgr, &SaveManager::backupRestored);
+        QVERIFY(m_mgr->restoreBackupAsync(backup, m_saveDir, SaveManager::RestoreDifferential) != 0);
+        QVERIFY(finishedSpy.wait(10000));
+        QCOMPARE(restoredSpy.count(), 1);
+        QCOMPARE(reportSpy.count(), 1);
+        QCOMPARE(reportSpy[0][2].toStringList(), QStringList() << "subdir/extra.bin");
+        QCOMPARE(reportSpy[0][4].toInt(), 2);
+        QVERIFY(QFile::exists(m_saveDir + "/subdir/extra.bin"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void undoRestore_putsBackReplacedTree()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("undo-game", "Undo Game");
+        QVERIFY(m_mgr->createBackup(game, "Undo"));
+        BackupInfo backup = m_mgr->getBackupsForGame("undo-game")[0];
+        QVERIFY(!m_mgr->safetySnapshot("undo-game").isValid());
+
+        writeWorld("progress since the backup");
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir));
+        QVERIFY(!QFile::exists(m_saveDir + "/world.dat"));
+
+        SafetySnapshot snapshot = m_mgr->safetySnapshot("undo-game");
+        QVERIFY(snapshot.isValid());
+        QCOMPARE(snapshot.backupName, backup.displayName);
+
+        QSignalSpy undoneSpy(m_mgr, &SaveManager::restoreUndone);
+        QVERIFY(m_mgr->undoRestore("undo-game"));
+        QCOMPARE(undoneSpy.count(), 1);
+        QFile world(m_saveDir + "/world.dat");
+        QVERIFY(world.open(QIODevice::ReadOnly));
+        QCOMPARE(world.readAll(), QByteArray("progress since the backup"));
+        QVERIFY(!m_mgr->safetySnapshot("undo-game").isValid());
+        QVERIFY(!m_mgr->undoRestore("undo-game"));
+
+        QThreadPool::globalInstance()->waitForDone();
+        QDir parent = QFileInfo(m_saveDir).absoluteDir();
+        QVERIFY(parent.entryList(QStringList() << ".*.undo-*", QDir::AllEntries | QDir::Hidden).isEmpty());
+    }
+
+    void undoRestore_afterDifferentialRestore()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("undo-diff", "Undo Diff");
+        QVERIFY(m_mgr->createBackup(game, "Diff"));
+        BackupInfo backup = m_mgr->getBackupsForGame("undo-diff")[0];
+
+        QFile save(m_saveDir + "/save.dat");
+        QVERIFY(save.open(QIODevice::WriteOnly));
+        save.write("newer save");
+        save.close();
+        writeWorld("world");
+
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir, SaveManager::RestoreDifferential));
+        QVERIFY(save.open(QIODevice::ReadOnly));
+        QCOMPARE(save.readAll(), QByteArray("save data content 12345"));
+        save.close();
+
+        QVERIFY(m_mgr->undoRestore("undo-diff"));
+        QVERIFY(save.open(QIODevice::ReadOnly));
+        QCOMPARE(save.readAll(), QByteArray("newer save"));
+        save.close();
+        QVERIFY(QFile::exists(m_saveDir + "/world.dat"));
+        QVERIFY(QFile::exists(m_saveDir + "/subdir/extra.bin"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void undoRestoreAsync_putsBackReplacedTree()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("undo-async", "Undo Async");
+        QVERIFY(m_mgr->createBackup(game, "Async"));
+        BackupInfo backup = m_mgr->getBackupsForGame("undo-async")[0];
+        writeWorld("world");
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir));
+
+        QSignalSpy undoneSpy(m_mgr, &SaveManager::restoreUndone);
+        QVERIFY(m_mgr->undoRestoreAsync("undo-async") != 0);
+        QVERIFY(undoneSpy.wait(10000));
+        QVERIFY(QFile::exists(m_saveDir + "/world.dat"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void safetySnapshots_disabledKeepsNothing()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("no-undo", "No Undo");
+        QVERIFY(m_mgr->createBackup(game, "Plain"));
+        BackupInfo backup = m_mgr->getBackupsForGame("no-undo")[0];
+
+        m_mgr->setSafetySnapshots(false);
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir));
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir, SaveManager::RestoreDifferential));
+        QVERIFY(!m_mgr->safetySnapshot("no-undo").isValid());
+
+        QThreadPool::globalInstance()->waitForDone();
+        QDir parent = QFileInfo(m_saveDir).absoluteDir();
+        QVERIFY(parent.entryList(QStringList() << ".*.undo-*", QDir::AllEntries | QDir::Hidden).isEmpty());
+    }
+
+    void restoreBackupPaths_restoresOnlySelectedFiles()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("partial-game", "Partial Game");
+        QVERIFY(m_mgr->createBackup(game, "Partial"));
+        BackupInfo backup = m_mgr->getBackupsForGame("partial-game")[0];
+        QVERIFY(QFile::exists(backup.archivePath + ".index"));
+
+        QString top = QFileInfo(m_saveDir).fileName();
+        QList<BackupEntry> contents = m_mgr->listBackupContents(backup);
+        QStringList paths;
+        for (const BackupEntry &entry : contents)
+            paths.append(entry.path);
+        QVERIFY(paths.contains(top + "/save.dat"));
+        QVERIFY(paths.contains(top + "/subdir"));
+        QVERIFY(paths.contains(top + "/subdir/extra.bin"));
+
+        QFile save(m_saveDir + "/save.dat");
+        QVERIFY(save.open(QIODevice::WriteOnly));
+        save.write("newer progress");
+        save.close();
+        QFile::remove(m_saveDir + "/subdir/extra.bin");
+        QFile stray(m_saveDir + "/stray.tmp");
+        QVERIFY(stray.open(QIODevice::WriteOnly));
+        stray.close();
+
+        QSignalSpy restoredSpy(m_mgr, &SaveManager::backupRestored);
+        QVERIFY(m_mgr->restoreBackupPaths(backup, {top + "/subdir"}, m_saveDir));
+        QCOMPARE(restoredSpy.count(), 1);
+
+        QFile extra(m_saveDir + "/subdir/extra.bin");
+        QVERIFY(extra.open(QIODevice::ReadOnly));
+        QCOMPARE(extra.readAll(), QByteArray("binary content"));
+        // Everything outside the selection is left alone
+        QVERIFY(save.open(QIODevice::ReadOnly));
+        QCOMPARE(save.readAll(), QByteArray("newer progress"));
+        save.close();
+        QVERIFY(QFile::exists(m_saveDir + "/stray.tmp"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void restoreBackupPaths_zstdWithoutIndex()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("tar.zst");
+        GameInfo game = makeGame("partial-zstd", "Partial Zstd");
+        QVERIFY(m_mgr->createBackup(game, "Zstd"));
+        BackupInfo backup = m_mgr->getBackupsForGame("partial-zstd")[0];
+        QVERIFY(!QFile::exists(backup.archivePath + ".index"));
+        QCOMPARE(m_mgr->listBackupContents(backup).size(), 5);
+
+        QFile::remove(m_saveDir + "/config.ini");
+        QFile::remove(m_saveDir + "/save.dat");
+        QString top = QFileInfo(m_saveDir).fileName();
+        QVERIFY(m_mgr->restoreBackupPaths(backup, {top + "/config.ini"}, m_saveDir));
+        QVERIFY(QFile::exists(m_saveDir + "/config.ini"));
+        QVERIFY(!QFile::exists(m_saveDir + "/save.dat"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void restoreBackupPaths_staleIndexFallsBack()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("stale-index", "Stale Index");
+        QVERIFY(m_mgr->createBackup(game, "First"));
+        writeWorld(QByteArray(300000, 'w'));
+        QVERIFY(m_mgr->createBackup(game, "Second"));
+        BackupInfo first = m_mgr->getBackupsForGame("stale-index").last();
+        BackupInfo second = m_mgr->getBackupsForGame("stale-index").first();
+        QCOMPARE(first.displayName, QString("First"));
+
+        // An index that does not belong to the archive must not be trusted
+        QVERIFY(QFile::remove(first.archivePath + ".index"));
+        QVERIFY(QFile::copy(second.archivePath + ".index", first.archivePath + ".index"));
+
+        QFile::remove(m_saveDir + "/save.dat");
+        QString top = QFileInfo(m_saveDir).fileName();
+        QVERIFY(m_mgr->restoreBackupPaths(first, {top + "/save.dat"}, m_saveDir));
+        QFile save(m_saveDir + "/save.dat");
+        QVERIFY(save.open(QIODevice::ReadOnly));
+        QCOMPARE(save.readAll(), QByteArray("save data content 12345"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void listBackupContents_cachesListingWithHashes()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("browse-game", "Browse Game");
+        QVERIFY(m_mgr->createBackup(game, "Browse"));
+        BackupInfo backup = m_mgr->getBackupsForGame("browse-game")[0];
+        QString top = QFileInfo(m_saveDir).fileName();
+
+        QList<BackupEntry> contents = m_mgr->listBackupContents(backup);
+        QCOMPARE(contents.size(), 5);
+        QString cachePath = backup.archivePath + ".contents";
+        QVERIFY(QFile::exists(cachePath));
+
+        FileChecksums::Hasher hasher;
+        hasher.addData("save data content 12345", 23);
+        bool found = false;
+        for (const BackupEntry &entry : contents) {
+            if (entry.path == top + "/save.dat") {
+                found = true;
+                QCOMPARE(entry.type, QString("file"));
+                QCOMPARE(entry.size, qint64(23));
+                QCOMPARE(entry.hash, hasher.result());
+            } else if (entry.type == "dir") {
+                QVERIFY(entry.hash.isEmpty());
+            }
+        }
+        QVERIFY(found);
+
+        // Later calls are served from the cache, not the index or archive
+        QVERIFY(QFile::remove(backup.archivePath + ".index"));
+        QCOMPARE(m_mgr->listBackupContents(backup).size(), 5);
+
+        QVERIFY(m_mgr->deleteBackup(backup));
+        QVERIFY(!QFile::exists(cachePath));
+    }
+
+    void listBackupContents_deltaUsesFingerprintHashes()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("delta");
+        GameInfo game = makeGame("browse-delta", "Browse Delta");
+        QVERIFY(m_mgr->createBackup(game, "Delta"));
+        BackupInfo backup = m_mgr->getBackupsForGame("browse-delta")[0];
+        QCOMPARE(backup.format, QString("delta"));
+
+        FileChecksums::Hasher hasher;
+        hasher.addData("binary content", 14);
+        QString top = QFileInfo(m_saveDir).fileName();
+        bool found = false;
+        for (const BackupEntry &entry : m_mgr->listBackupContents(backup)) {
+            if (entry.path == top + "/subdir/extra.bin") {
+                found = true;
+                QCOMPARE(entry.hash, hasher.result());
+            }
+        }
+        QVERIFY(found);
+    }
+
     // --- Delete ---
 
     void deleteBackup_success()
@@ -239,6 +682,8 @@ private slots:
 
         QVERIFY(!QFile::exists(archivePath));
         QVERIFY(!QFile::exists(metadataPath));
+        QVERIFY(m_mgr->getBackupsForGame("del-game").isEmpty());
+        QVERIFY(!m_mgr->getAllGameIdsWithBackups().contains("del-game"));
     }
 
     // --- Update metadata ---
@@ -325,6 +770,76 @@ private slots:
         QVERIFY(!m_mgr->verifyBackup(fake));
     }
 
+    void verifyBackup_contentDetectsSwappedData()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("content-game", "Content Game");
+        QVERIFY(m_mgr->createBackup(game, "First"));
+        QFile f(m_saveDir + "/save.dat");
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write("different save data 67890");
+        f.close();
+        QVERIFY(m_mgr->createBackup(game, "Second"));
+
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("content-game");
+        QCOMPARE(backups.size(), 2);
+        QVERIFY(m_mgr->verifyBackup(backups[1], SaveManager::VerifyContent));
+
+        // A well-formed archive with the wrong content: only hashes notice
+        QVERIFY(QFile::remove(backups[1].archivePath));
+        QVERIFY(QFile::copy(backups[0].archivePath, backups[1].archivePath));
+        QVERIFY(m_mgr->verifyBackup(backups[1], SaveManager::VerifyStructure));
+        QVERIFY(!m_mgr->verifyBackup(backups[1], SaveManager::VerifyContent));
+        QVERIFY(m_mgr->verifyBackup(backups[0], SaveManager::VerifyContent));
+    }
+
+    void verifyBackup_checksumsSurviveMetadataEdits()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("checksum-game", "Checksum Game");
+        QVERIFY(m_mgr->createBackup(game, "Original"));
+        BackupInfo backup = m_mgr->getBackupsForGame("checksum-game").first();
+
+        QFile json(backup.archivePath + ".json");
+        QVERIFY(json.open(QIODevice::ReadOnly));
+        QJsonObject checksums = QJsonDocument::fromJson(json.readAll()).object()["checksums"].toObject();
+        json.close();
+        QCOMPARE(checksums["files"].toObject().size(), 3);
+
+        backup.notes = "Edited";
+        QVERIFY(m_mgr->updateBackupMetadata(backup));
+        QVERIFY(json.open(QIODevice::ReadOnly));
+        QCOMPARE(QJsonDocument::fromJson(json.readAll()).object()["checksums"].toObject(), checksums);
+        json.close();
+        QVERIFY(m_mgr->verifyBackup(backup, SaveManager::VerifyContent));
+    }
+
+    void verifyAllBackupsAsync_checksEveryBackup()
+    {
+        createSaveFiles();
+        m_mgr->setMaxConcurrentJobs(4);
+        QVERIFY(m_mgr->createBackup(makeGame("all-a", "A"), "A1"));
+        QVERIFY(m_mgr->createBackup(makeGame("all-a", "A"), "A2"));
+        QVERIFY(m_mgr->createBackup(makeGame("all-b", "B"), "B1"));
+
+        BackupInfo corrupt = m_mgr->getBackupsForGame("all-b").first();
+        QFile f(corrupt.archivePath);
+        QVERIFY(f.open(QIODevice::ReadWrite));
+        f.resize(f.size() / 2);
+        f.close();
+
+        QSignalSpy verifiedSpy(m_mgr, &SaveManager::backupVerified);
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QCOMPARE(m_mgr->verifyAllBackupsAsync().size(), 3);
+        QVERIFY(finishedSpy.wait(30000));
+
+        QCOMPARE(verifiedSpy.count(), 3);
+        for (const QList<QVariant> &args : verifiedSpy) {
+            bool isCorrupt = args[1].toString() == corrupt.id;
+            QCOMPARE(args[2].toBool(), !isCorrupt);
+        }
+    }
+
     // --- getAllGameIdsWithBackups ---
 
     void getAllGameIdsWithBackups_multipleGames()
@@ -366,6 +881,42 @@ private slots:
         QCOMPARE(name, QString("no-such-game"));
     }
 
+    // --- Backup index ---
+
+    void metadataDatabase_tracksBackups()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("index-game", "Indexed Game");
+        QVERIFY(m_mgr->createBackup(game, "Before index"));
+
+        qputenv("XDG_DATA_HOME", (m_tmpDir.path() + "/index-data").toUtf8());
+        Database db;
+        QVERIFY(db.open());
+        m_mgr->setMetadataDatabase(db.databasePath());
+
+        // Existing sidecars are imported, new backups recorded
+        QVERIFY(m_mgr->createBackup(game, "After index"));
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("index-game");
+        QCOMPARE(backups.size(), 2);
+
+        BackupSummary summary = m_mgr->getBackupSummaries().value("index-game");
+        QCOMPARE(summary.count, 2);
+        QCOMPARE(summary.totalSize, backups[0].size + backups[1].size);
+        QCOMPARE(summary.gameName, QString("Indexed Game"));
+        QCOMPARE(m_mgr->getBackupTotals().count, 2);
+        QVERIFY(m_mgr->getStaleGameIds(QDateTime::currentDateTime().addDays(-7)).isEmpty());
+        QCOMPARE(m_mgr->getStaleGameIds(QDateTime::currentDateTime().addDays(1)),
+                 QStringList() << "index-game");
+
+        // Sidecars are still written, so the index can be rebuilt from them
+        QVERIFY(QFile::exists(backups[0].archivePath + ".json"));
+
+        QVERIFY(m_mgr->deleteBackup(backups[0]));
+        QCOMPARE(m_mgr->getBackupsForGame("index-game").size(), 1);
+        QCOMPARE(m_mgr->getBackupTotals().count, 1);
+        m_mgr->setMetadataDatabase(QString());
+    }
+
     // --- Compression level ---
 
     void compressionLevel_applies()
@@ -391,6 +942,337 @@ private slots:
         QVERIFY(m_mgr->createBackup(game, "Default"));
     }
 
+    // --- Parallel gzip ---
+
+    void gzipFormat_multiMemberRestoresAndVerifies()
+    {
+        createSaveFiles();
+        // Several 1 MiB pipeline blocks, so the archive has many gzip members
+        QByteArray big;
+        for (int i = 0; i < 200000; ++i)
+            big.append(QByteArray::number(i * 7919 % 100003)).append(',');
+        QFile f(m_saveDir + "/world.dat");
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(big);
+        f.close();
+
+        m_mgr->setCompressionThreads(4);
+        GameInfo game = makeGame("pgz-game", "Parallel Gzip Game");
+        QVERIFY(m_mgr->createBackup(game, "Parallel"));
+
+        BackupInfo backup = m_mgr->getBackupsForGame("pgz-game")[0];
+        QCOMPARE(backup.format, QString("tar.gz"));
+        QFile archive(backup.archivePath);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QCOMPARE(archive.read(2), QByteArray("\x1f\x8b", 2));
+        archive.close();
+
+        QVERIFY(m_mgr->verifyBackup(backup));
+        QDir(m_saveDir).removeRecursively();
+        QVERIFY(m_mgr->restoreBackup(backup, m_saveDir));
+
+        QFile restored(m_saveDir + "/world.dat");
+        QVERIFY(restored.open(QIODevice::ReadOnly));
+        QCOMPARE(restored.readAll(), big);
+        QVERIFY(QFile::exists(m_saveDir + "/subdir/extra.bin"));
+    }
+
+    void compressionSkipped_recordedPerBackup_data()
+    {
+        QTest::addColumn<QString>("format");
+        QTest::newRow("tar.gz") << "tar.gz";
+        QTest::newRow("chunks") << "chunks";
+        QTest::newRow("delta") << "delta";
+    }
+
+    void compressionSkipped_recordedPerBackup()
+    {
+        QFETCH(QString, format);
+        createSaveFiles();
+        m_mgr->setBackupFormat(format);
+        GameInfo game = makeGame("skip-game", "Skip Game");
+
+        QVERIFY(m_mgr->createBackup(game, "Text only"));
+        QCOMPARE(m_mgr->getBackupsForGame("skip-game")[0].compressionSkipped, qint64(0));
+
+        // Several gzip blocks' worth, as an encrypted or zipped save would be
+        QByteArray world(3 * 1024 * 1024, Qt::Uninitialized);
+        QRandomGenerator rng(18);
+        for (qsizetype i = 0; i < world.size(); ++i)
+            world[i] = char(rng.bounded(256));
+        writeWorld(world);
+        QVERIFY(m_mgr->createBackup(game, "With noise"));
+
+        BackupInfo backup = m_mgr->getBackupsForGame("skip-game")[0];
+        QCOMPARE(backup.displayName, QString("With noise"));
+        QVERIFY(backup.compressionSkipped >= 1024 * 1024);
+        QVERIFY(backup.compressionSkipped <= world.size() + 64 * 1024);
+        QVERIFY(backup.size < world.size() + 64 * 1024);
+
+        // Survives a reload from the sidecars
+        SaveManager reloaded;
+        reloaded.setBackupDirectory(m_backupDir);
+        QCOMPARE(reloaded.getBackupsForGame("skip-game")[0].compressionSkipped, backup.compressionSkipped);
+
+        QVERIFY(m_mgr->verifyBackup(backup));
+        QCOMPARE(restoredWorld(backup, "restore_skip_" + format), world);
+    }
+
+    void batchedReads_manySmallFilesRestoreIntact_data()
+    {
+        QTest::addColumn<bool>("batched");
+        QTest::newRow("batched") << true;
+        QTest::newRow("direct") << false;
+    }
+
+    void batchedReads_manySmallFilesRestoreIntact()
+    {
+        QFETCH(bool, batched);
+        createSaveFiles();
+        // More files than the reader keeps in flight, with empty and large
+        // ones in between
+        QHash<QString, QByteArray> files;
+        QRandomGenerator rng(20);
+        for (int i = 0; i < 300; ++i) {
+            QByteArray data(i % 25 == 0 ? 0 : rng.bounded(1, 9000), Qt::Uninitialized);
+            if (i % 100 == 50)
+                data.resize(BatchFileReader::PrefetchLimit + 12345);
+            for (qsizetype j = 0; j < data.size(); ++j)
+                data[j] = char(rng.bounded(256));
+            QString relPath = QString("slots/%1/part_%2.sav").arg(i / 40).arg(i);
+            QDir().mkpath(QFileInfo(m_saveDir + "/" + relPath).absolutePath());
+            QFile f(m_saveDir + "/" + relPath);
+            QVERIFY(f.open(QIODevice::WriteOnly));
+            f.write(data);
+            f.close();
+            files.insert(relPath, data);
+        }
+
+        m_mgr->setBatchedReads(batched);
+        GameInfo game = makeGame("batch-game", "Batch Game");
+        QVERIFY(m_mgr->createBackup(game, "Many files"));
+        BackupInfo backup = m_mgr->getBackupsForGame("batch-game")[0];
+        QVERIFY(m_mgr->verifyBackup(backup));
+
+        QString restoreDir = m_tmpDir.path() + "/restore_batch_" + QTest::currentDataTag();
+        QVERIFY(m_mgr->restoreBackup(backup, restoreDir));
+        for (auto it = files.cbegin(); it != files.cend(); ++it) {
+            QFile f(restoreDir + "/" + it.key());
+            QVERIFY2(f.open(QIODevice::ReadOnly), qPrintable(it.key()));
+            QCOMPARE(f.readAll(), it.value());
+        }
+        QVERIFY(QFile::exists(restoreDir + "/subdir/extra.bin"));
+    }
+
+    // --- Job scheduler ---
+
+    void createBackup_idsUniqueWithinSameMillisecond()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("burst-game", "Burst Game");
+        for (int i = 0; i < 5; ++i)
+            QVERIFY(m_mgr->createBackup(game));
+
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("burst-game");
+        QCOMPARE(backups.size(), 5);
+        QSet<QString> ids;
+        for (const BackupInfo &backup : backups)
+            ids.insert(backup.id);
+        QCOMPARE(ids.size(), 5);
+    }
+
+    void createBackupAsync_runsGamesConcurrently()
+    {
+        createSaveFiles();
+        m_mgr->setMaxConcurrentJobs(4);
+
+        QSignalSpy createdSpy(m_mgr, &SaveManager::backupCreated);
+        QSignalSpy jobSpy(m_mgr, &SaveManager::jobFinished);
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+
+        QSet<quint64> jobIds;
+        for (int i = 0; i < 4; ++i) {
+            GameInfo game = makeGame(QString("bulk-%1").arg(i), "Bulk");
+            jobIds.insert(m_mgr->createBackupAsync(game, QString(), QString(), SaveProfile(),
+                                                   false, JobScheduler::Bulk));
+        }
+        // Two jobs for one game are queued one after the other
+        jobIds.insert(m_mgr->createBackupAsync(makeGame("bulk-0", "Bulk"), "Second"));
+        QCOMPARE(jobIds.size(), 5);
+        QVERIFY(m_mgr->isBusy());
+
+        QVERIFY(finishedSpy.wait(30000));
+        QCOMPARE(finishedSpy.count(), 1);
+        QCOMPARE(createdSpy.count(), 5);
+        QCOMPARE(jobSpy.count(), 5);
+        QVERIFY(!m_mgr->isBusy());
+        QCOMPARE(m_mgr->getBackupsForGame("bulk-0").size(), 2);
+        QCOMPARE(m_mgr->getAllGameIdsWithBackups().size(), 4);
+    }
+
+    void cancelOperation_dropsQueuedBackups()
+    {
+        createSaveFiles();
+        m_mgr->setMaxConcurrentJobs(1);
+
+        QSignalSpy cancelledSpy(m_mgr, &SaveManager::operationCancelled);
+        for (int i = 0; i < 3; ++i)
+            m_mgr->createBackupAsync(makeGame(QString("cancel-%1").arg(i), "Cancel"));
+        m_mgr->cancelOperation();
+
+        QVERIFY(cancelledSpy.wait(30000));
+        QVERIFY(m_mgr->getAllGameIdsWithBackups().isEmpty());
+    }
+
+    void createBackupAsync_reportsTransferProgress()
+    {
+        createSaveFiles();
+        QFile big(m_saveDir + "/big.bin");
+        QVERIFY(big.open(QIODevice::WriteOnly));
+        big.write(QByteArray(2 * 1024 * 1024, 'x'));
+        big.close();
+        qint64 expectedBytes = 2 * 1024 * 1024 + 23 + 21 + 14;
+
+        QSignalSpy progressSpy(m_mgr, &SaveManager::transferProgress);
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        quint64 jobId = m_mgr->createBackupAsync(makeGame("progress-game", "Progress"));
+        QVERIFY(finishedSpy.wait(30000));
+
+        QVERIFY(progressSpy.count() >= 2);
+        const QList<QVariant> last = progressSpy.last();
+        QCOMPARE(last[0].toULongLong(), jobId);
+        QCOMPARE(last[1].toLongLong(), expectedBytes);
+        QCOMPARE(last[2].toLongLong(), expectedBytes);
+        QCOMPARE(last[3].toInt(), 4);
+        QCOMPARE(last[4].toInt(), 4);
+
+        // Restores know the total from the backup's fingerprint
+        progressSpy.clear();
+        BackupInfo backup = m_mgr->getBackupsForGame("progress-game")[0];
+        m_mgr->restoreBackupAsync(backup, m_saveDir);
+        QVERIFY(finishedSpy.wait(30000));
+        QVERIFY(!progressSpy.isEmpty());
+        QCOMPARE(progressSpy.last()[1].toLongLong(), expectedBytes);
+        QCOMPARE(progressSpy.last()[2].toLongLong(), expectedBytes);
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void cancelOperation_stopsRunningBackup()
+    {
+        createSaveFiles();
+        // Incompressible data so the backup takes a while
+        QByteArray data(64 * 1024 * 1024, Qt::Uninitialized);
+        quint32 state = 12345;
+        for (char &c : data) {
+            state = state * 1664525u + 1013904223u;
+            c = static_cast<char>(state >> 24);
+        }
+        QFile big(m_saveDir + "/big.bin");
+        QVERIFY(big.open(QIODevice::WriteOnly));
+        big.write(data);
+        big.close();
+
+        QSignalSpy cancelledSpy(m_mgr, &SaveManager::operationCancelled);
+        QSignalSpy createdSpy(m_mgr, &SaveManager::backupCreated);
+        // The first report arrives before any data has been compressed
+        connect(m_mgr, &SaveManager::transferProgress, m_mgr, &SaveManager::cancelOperation);
+        m_mgr->createBackupAsync(makeGame("cancel-running", "Cancel"));
+
+        QVERIFY(cancelledSpy.wait(30000));
+        QCOMPARE(createdSpy.count(), 0);
+        QVERIFY(m_mgr->getBackupsForGame("cancel-running").isEmpty());
+        QDir gameDir(m_backupDir + "/games/cancel-running");
+        QVERIFY(gameDir.entryList(QDir::Files).isEmpty());
+    }
+
+    void cancelOperation_stopsRunningRestore()
+    {
+        createSaveFiles();
+        QFile big(m_saveDir + "/big.bin");
+        QVERIFY(big.open(QIODevice::WriteOnly));
+        big.write(QByteArray(32 * 1024 * 1024, 'r'));
+        big.close();
+        GameInfo game = makeGame("cancel-restore", "Cancel");
+        QVERIFY(m_mgr->createBackup(game));
+        BackupInfo backup = m_mgr->getBackupsForGame("cancel-restore")[0];
+
+        QFile save(m_saveDir + "/save.dat");
+        QVERIFY(save.open(QIODevice::WriteOnly));
+        save.write("current");
+        save.close();
+
+        QSignalSpy cancelledSpy(m_mgr, &SaveManager::operationCancelled);
+        QSignalSpy restoredSpy(m_mgr, &SaveManager::backupRestored);
+        connect(m_mgr, &SaveManager::transferProgress, m_mgr, &SaveManager::cancelOperation);
+        m_mgr->restoreBackupAsync(backup, m_saveDir);
+
+        QVERIFY(cancelledSpy.wait(30000));
+        QCOMPARE(restoredSpy.count(), 0);
+        // The live save tree is left untouched
+        QVERIFY(save.open(QIODevice::ReadOnly));
+        QCOMPARE(save.readAll(), QByteArray("current"));
+        save.close();
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    // --- zstd format ---
+
+    void zstdFormat_createRestoreVerify()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("tar.zst");
+        m_mgr->setCompressionLevel(19);
+        m_mgr->setCompressionThreads(2);
+        m_mgr->setLongDistanceMatching(true);
+
+        GameInfo game = makeGame("zstd-game", "Zstd Game");
+        QVERIFY(m_mgr->createBackup(game, "Zstd"));
+
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("zstd-game");
+        QCOMPARE(backups.size(), 1);
+        QCOMPARE(backups[0].format, QString("tar.zst"));
+        QVERIFY(backups[0].archivePath.endsWith(".tar.zst"));
+
+        // zstd frames start with the magic 28 b5 2f fd
+        QFile archive(backups[0].archivePath);
+        QVERIFY(archive.open(QIODevice::ReadOnly));
+        QCOMPARE(archive.read(4), QByteArray("\x28\xb5\x2f\xfd", 4));
+        archive.close();
+
+        QVERIFY(m_mgr->verifyBackup(backups[0]));
+        QDir(m_saveDir).removeRecursively();
+        QVERIFY(m_mgr->restoreBackup(backups[0], m_saveDir));
+        QVERIFY(QFile::exists(m_saveDir + "/subdir/extra.bin"));
+    }
+
+    void zstdFormat_levelRange()
+    {
+        m_mgr->setBackupFormat("tar.zst");
+        m_mgr->setCompressionLevel(19);
+        QCOMPARE(m_mgr->compressionLevel(), 19);
+        m_mgr->setCompressionLevel(20);
+        QCOMPARE(m_mgr->compressionLevel(), 19);
+
+        // Switching back to gzip clamps to its range
+        m_mgr->setBackupFormat("tar.gz");
+        QCOMPARE(m_mgr->compressionLevel(), 9);
+    }
+
+    void zstdFormat_gzipBackupsStillRestore()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("mixed-game", "Mixed Game");
+        QVERIFY(m_mgr->createBackup(game, "Old gzip"));
+
+        m_mgr->setBackupFormat("tar.zst");
+        BackupInfo old = m_mgr->getBackupsForGame("mixed-game")[0];
+        QCOMPARE(old.format, QString("tar.gz"));
+
+        QDir(m_saveDir).removeRecursively();
+        QVERIFY(m_mgr->restoreBackup(old, m_saveDir));
+        QVERIFY(QFile::exists(m_saveDir + "/save.dat"));
+    }
+
     // --- Profile backup ---
 
     void profileBackup_specificFiles()
@@ -419,6 +1301,455 @@ private slots:
         QVERIFY(!QFile::exists(restoreDir + "/config.ini"));
     }
 
+    // --- Skip if unchanged ---
+
+    void skipIfUnchanged_skipsIdenticalSaves()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("skip-game", "Skip Game");
+        QVERIFY(m_mgr->createBackup(game, "First", "", SaveProfile(), true));
+        QVERIFY(QFile::exists(m_mgr->getBackupsForGame("skip-game")[0].archivePath + ".files"));
+
+        // Rewriting a file with the same bytes only touches its mtime
+        QThread::msleep(5);
+        QFile f(m_saveDir + "/save.dat");
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write("save data content 12345");
+        f.close();
+
+        QSignalSpy skipSpy(m_mgr, &SaveManager::backupSkipped);
+        QSignalSpy createdSpy(m_mgr, &SaveManager::backupCreated);
+        QVERIFY(m_mgr->createBackup(game, "Second", "", SaveProfile(), true));
+        QCOMPARE(skipSpy.count(), 1);
+        QCOMPARE(skipSpy[0][0].toString(), QString("skip-game"));
+        QCOMPARE(createdSpy.count(), 0);
+        QCOMPARE(m_mgr->getBackupsForGame("skip-game").size(), 1);
+
+        // Without the flag a backup is always written
+        QVERIFY(m_mgr->createBackup(game, "Forced"));
+        QCOMPARE(m_mgr->getBackupsForGame("skip-game").size(), 2);
+    }
+
+    void skipIfUnchanged_backsUpChanges()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("change-game", "Change Game");
+        QVERIFY(m_mgr->createBackup(game, "First", "", SaveProfile(), true));
+        QThread::msleep(5);
+
+        QFile f(m_saveDir + "/subdir/new.sav");
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write("new slot");
+        f.close();
+
+        QSignalSpy skipSpy(m_mgr, &SaveManager::backupSkipped);
+        QVERIFY(m_mgr->createBackup(game, "Second", "", SaveProfile(), true));
+        QCOMPARE(skipSpy.count(), 0);
+        QCOMPARE(m_mgr->getBackupsForGame("change-game").size(), 2);
+    }
+
+    void skipIfUnchanged_chunkFormatReusesUnchangedFiles()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("chunks");
+        GameInfo game = makeGame("reuse-game", "Reuse Game");
+        QVERIFY(m_mgr->createBackup(game, "First"));
+        QThread::msleep(5);
+
+        QFile f(m_saveDir + "/config.ini");
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write("[settings]\nvolume=20\n");
+        f.close();
+
+        QVERIFY(m_mgr->createBackup(game, "Second", "", SaveProfile(), true));
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("reuse-game");
+        QCOMPARE(backups.size(), 2);
+
+        QString restoreDir = m_tmpDir.path() + "/reuse_restore";
+        QVERIFY(m_mgr->restoreBackup(backups[0], restoreDir));
+        QFile restored(restoreDir + "/config.ini");
+        QVERIFY(restored.open(QIODevice::ReadOnly));
+        QCOMPARE(restored.readAll(), QByteArray("[settings]\nvolume=20\n"));
+        QVERIFY(QFile::exists(restoreDir + "/subdir/extra.bin"));
+    }
+
+    // --- Chunk store format ---
+
+    void chunkFormat_createAndRestore()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("chunks");
+        GameInfo game = makeGame("chunk-game", "Chunk Game");
+        QVERIFY(m_mgr->createBackup(game, "Chunked"));
+
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("chunk-game");
+        QCOMPARE(backups.size(), 1);
+        QCOMPARE(backups[0].format, QString("chunks"));
+        QVERIFY(backups[0].archivePath.endsWith(".snap"));
+        QVERIFY(m_mgr->verifyBackup(backups[0]));
+        QCOMPARE(m_mgr->getAllGameIdsWithBackups(), QStringList() << "chunk-game");
+
+        QDir(m_saveDir).removeRecursively();
+        QVERIFY(m_mgr->restoreBackup(backups[0], m_saveDir));
+
+        QFile f(m_saveDir + "/save.dat");
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        QCOMPARE(f.readAll(), QByteArray("save data content 12345"));
+        QVERIFY(QFile::exists(m_saveDir + "/subdir/extra.bin"));
+    }
+
+    void trainDictionaryAsync_usedByChunkBackups()
+    {
+        QDir().mkpath(m_saveDir + "/slots");
+        for (int i = 0; i < 30; ++i) {
+            QFile slot(QString("%1/slots/slot%2.json").arg(m_saveDir).arg(i));
+            QVERIFY(slot.open(QIODevice::WriteOnly));
+            for (int j = 0; j < 30; ++j)
+                slot.write(QString("{\"slot\":%1,\"flag\":\"f%2\",\"set\":true}\n").arg(i).arg(i * j).toUtf8());
+            slot.close();
+        }
+        GameInfo game = makeGame("dict-game", "Dict Game");
+        QVERIFY(m_mgr->createBackup(game, "Plain"));
+        QVERIFY(!m_mgr->hasDictionary("dict-game"));
+
+        QSignalSpy trainedSpy(m_mgr, &SaveManager::dictionaryTrained);
+        QVERIFY(m_mgr->trainDictionaryAsync("dict-game") != 0);
+        QVERIFY(trainedSpy.wait(10000));
+        QCOMPARE(trainedSpy[0][2].toInt(), 30);
+        QVERIFY(m_mgr->hasDictionary("dict-game"));
+
+        m_mgr->setBackupFormat("chunks");
+        QVERIFY(m_mgr->createBackup(game, "Chunked"));
+        BackupInfo backup = m_mgr->getBackupsForGame("dict-game")[0];
+        QCOMPARE(backup.format, QString("chunks"));
+        QCOMPARE(QDir(m_backupDir + "/chunks/dicts").entryList(QDir::Files).size(), 1);
+
+        // Chunks stay readable once the game's dictionary is gone
+        QVERIFY(m_mgr->removeDictionary("dict-game"));
+        QVERIFY(m_mgr->verifyBackup(backup, SaveManager::VerifyContent));
+        QString target = m_tmpDir.path() + "/dict_restore_" + QString::number(s_testCounter);
+        QVERIFY(m_mgr->restoreBackup(backup, target));
+        QFile slot(target + "/slots/slot3.json");
+        QVERIFY(slot.open(QIODevice::ReadOnly));
+        QVERIFY(slot.readAll().startsWith("{\"slot\":3,"));
+        QThreadPool::globalInstance()->waitForDone();
+    }
+
+    void trainDictionaryAsync_tooFewFilesFails()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("dict-small", "Dict Small");
+        QVERIFY(m_mgr->createBackup(game, "Plain"));
+
+        QSignalSpy errorSpy(m_mgr, &SaveManager::error);
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QVERIFY(m_mgr->trainDictionaryAsync("dict-small") != 0);
+        QVERIFY(finishedSpy.wait(10000));
+        QCOMPARE(errorSpy.count(), 1);
+        QVERIFY(!m_mgr->hasDictionary("dict-small"));
+        QCOMPARE(m_mgr->trainDictionaryAsync("no-backups"), quint64(0));
+    }
+
+    void chunkFormat_deleteCollectsChunks()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("chunks");
+        GameInfo game = makeGame("chunk-del", "Chunk Delete");
+        QVERIFY(m_mgr->createBackup(game, "First"));
+        QThread::msleep(5);
+        QVERIFY(m_mgr->createBackup(game, "Second"));
+
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("chunk-del");
+        QCOMPARE(backups.size(), 2);
+        // Identical content: the second backup only adds its manifest
+        QVERIFY(backups[0].size < backups[1].size);
+
+        QDir chunkDir(m_backupDir + "/chunks");
+        auto countChunks = [&]() {
+            int n = 0;
+            for (const QString &sub : chunkDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+                n += QDir(chunkDir.filePath(sub)).entryList(QDir::Files).size();
+            return n;
+        };
+        int chunks = countChunks();
+        QVERIFY(chunks > 0);
+
+        // Chunks stay while any snapshot still references them. Collection
+        // runs as a job, which finishes like any other operation
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QVERIFY(m_mgr->deleteBackup(backups[1]));
+        QVERIFY(finishedSpy.wait(10000));
+        QCOMPARE(countChunks(), chunks);
+        QVERIFY(m_mgr->restoreBackup(backups[0], m_tmpDir.path() + "/chunk_restore"));
+
+        QVERIFY(m_mgr->deleteBackup(backups[0]));
+        QVERIFY(finishedSpy.wait(10000));
+        QCOMPARE(countChunks(), 0);
+    }
+
+    // --- Delta format ---
+
+    void deltaFormat_chainRestoresEachBackup()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("delta");
+        m_mgr->setDeltaKeyframeInterval(3);
+        GameInfo game = makeGame("delta-game", "Delta Game");
+
+        QByteArray world(1024 * 1024, Qt::Uninitialized);
+        QRandomGenerator rng(42);
+        for (qsizetype i = 0; i < world.size(); ++i)
+            world[i] = static_cast<char>(rng.bounded(256));
+
+        QList<QByteArray> versions;
+        for (int i = 0; i < 4; ++i) {
+            world.replace(i * 100000, 8, QByteArray::number(1000000 + i));
+            writeWorld(world);
+            versions.append(world);
+            QVERIFY(m_mgr->createBackup(game, QString("Backup %1").arg(i)));
+            QThread::msleep(5);
+        }
+
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("delta-game");
+        QCOMPARE(backups.size(), 4);
+        // Newest first: a keyframe starts the second chain, deltas stay small
+        QCOMPARE(backups[0].format, QString("delta"));
+        QVERIFY(backups[0].size > 100 * 1024);
+        QVERIFY(backups[1].size < 16 * 1024);
+        QVERIFY(backups[2].size < 16 * 1024);
+        QVERIFY(backups[3].size > 100 * 1024);
+
+        for (int i = 0; i < 4; ++i) {
+            QCOMPARE(restoredWorld(backups[3 - i], QString("delta_restore_%1").arg(i)), versions[i]);
+            QVERIFY(m_mgr->verifyBackup(backups[3 - i]));
+        }
+    }
+
+    void deltaFormat_deleteRebasesDependents()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("delta");
+        GameInfo game = makeGame("rebase-game", "Rebase Game");
+
+        QByteArray world(512 * 1024, 'w');
+        QList<QByteArray> versions;
+        for (int i = 0; i < 3; ++i) {
+            world.replace(i * 1000, 4, QByteArray::number(1000 + i));
+            writeWorld(world);
+            versions.append(world);
+            QVERIFY(m_mgr->createBackup(game, QString("Backup %1").arg(i)));
+            QThread::msleep(5);
+        }
+
+        // Delete the keyframe, then the middle delta
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("rebase-game");
+        QSignalSpy updatedSpy(m_mgr, &SaveManager::backupUpdated);
+        QVERIFY(m_mgr->deleteBackup(backups[2]));
+        QCOMPARE(updatedSpy.count(), 1);
+        QVERIFY(m_mgr->deleteBackup(m_mgr->getBackupById("rebase-game", backups[1].id)));
+
+        BackupInfo last = m_mgr->getBackupById("rebase-game", backups[0].id);
+        QVERIFY(m_mgr->verifyBackup(last));
+        QCOMPARE(restoredWorld(last, "rebase_restore"), versions[2]);
+    }
+
+    void deleteBackupAsync_rebasesQueuedDelta()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("delta");
+        GameInfo game = makeGame("delete-async", "Delete Async");
+
+        QByteArray world(512 * 1024, 'w');
+        writeWorld(world);
+        QVERIFY(m_mgr->createBackup(game, "Keyframe"));
+        BackupInfo keyframe = m_mgr->getBackupsForGame("delete-async").first();
+        QThread::msleep(5);
+
+        // The delta is queued on the keyframe before the delete is
+        QByteArray changed = world;
+        changed.replace(0, 4, "edit");
+        writeWorld(changed);
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QSignalSpy deletedSpy(m_mgr, &SaveManager::backupDeleted);
+        QVERIFY(m_mgr->createBackupAsync(game, "Delta") != 0);
+        QVERIFY(m_mgr->deleteBackupAsync(keyframe) != 0);
+        QVERIFY(finishedSpy.wait(30000));
+
+        QCOMPARE(deletedSpy.count(), 1);
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("delete-async");
+        QCOMPARE(backups.size(), 1);
+        QVERIFY(m_mgr->verifyBackup(backups[0]));
+        QCOMPARE(restoredWorld(backups[0], "delete_async_restore"), changed);
+    }
+
+    // --- Hard-link snapshot format ---
+
+    void hardlinksFormat_linksUnchangedFiles()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("hardlinks");
+        GameInfo game = makeGame("link-game", "Link Game");
+
+        QByteArray world(256 * 1024, 'w');
+        writeWorld(world);
+        QVERIFY(m_mgr->createBackup(game, "First"));
+        QThread::msleep(5);
+        QByteArray changed = world;
+        changed.replace(0, 4, "edit");
+        writeWorld(changed);
+        QVERIFY(m_mgr->createBackup(game, "Second"));
+
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("link-game");
+        QCOMPARE(backups.size(), 2);
+        QCOMPARE(backups[0].format, QString("hardlinks"));
+        QVERIFY(backups[0].archivePath.endsWith(".tree"));
+        QVERIFY(QFileInfo(backups[0].archivePath).isDir());
+        // Only the changed file counts towards the second backup
+        QCOMPARE(backups[0].size, qint64(changed.size()));
+
+        QString saveName = QFileInfo(m_saveDir).fileName();
+        DirWalker::FileStat oldSave, newSave, oldWorld, newWorld;
+        QVERIFY(DirWalker::stat(backups[1].archivePath + "/" + saveName + "/save.dat", &oldSave));
+        QVERIFY(DirWalker::stat(backups[0].archivePath + "/" + saveName + "/save.dat", &newSave));
+        QCOMPARE(newSave.inode, oldSave.inode);
+        QVERIFY(DirWalker::stat(backups[1].archivePath + "/" + saveName + "/world.dat", &oldWorld));
+        QVERIFY(DirWalker::stat(backups[0].archivePath + "/" + saveName + "/world.dat", &newWorld));
+        QVERIFY(newWorld.inode != oldWorld.inode);
+
+        QVERIFY(m_mgr->verifyBackup(backups[0]));
+        QCOMPARE(restoredWorld(backups[1], "hardlinks_restore_0"), world);
+
+        // The second snapshot keeps the files it shared with the first
+        QVERIFY(m_mgr->deleteBackup(backups[1]));
+        QVERIFY(!QFileInfo::exists(backups[1].archivePath));
+        QCOMPARE(m_mgr->getBackupsForGame("link-game").size(), 1);
+        QVERIFY(m_mgr->verifyBackup(backups[0]));
+        QCOMPARE(restoredWorld(backups[0], "hardlinks_restore_1"), changed);
+        QFile restoredSave(m_tmpDir.path() + "/hardlinks_restore_1/save.dat");
+        QVERIFY(restoredSave.open(QIODevice::ReadOnly));
+        QCOMPARE(restoredSave.readAll(), QByteArray("save data content 12345"));
+    }
+
+    // --- Retention ---
+
+    void pruneBackupsAsync_keepsPinnedAndNewest()
+    {
+        createSaveFiles();
+        GameInfo game = makeGame("prune-game", "Prune Game");
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(m_mgr->createBackup(game, QString("Backup %1").arg(i)));
+            QThread::msleep(5);
+        }
+        QList<BackupInfo> backups = m_mgr->getBackupsForGame("prune-game");
+        BackupInfo pinned = backups[3];
+        pinned.pinned = true;
+        QVERIFY(m_mgr->updateBackupMetadata(pinned));
+
+        RetentionPolicy policy;
+        policy.enabled = true;
+        policy.keepLast = 1;
+        policy.hourly = 0;
+        policy.daily = 0;
+        policy.weekly = 0;
+
+        QSignalSpy deletedSpy(m_mgr, &SaveManager::backupDeleted);
+        QSignalSpy prunedSpy(m_mgr, &SaveManager::backupsPruned);
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QVERIFY(m_mgr->pruneBackupsAsync("prune-game", policy) != 0);
+        QVERIFY(finishedSpy.wait(30000));
+
+        QCOMPARE(deletedSpy.count(), 2);
+        QCOMPARE(prunedSpy.count(), 1);
+        QCOMPARE(prunedSpy[0][1].toInt(), 2);
+        QCOMPARE(prunedSpy[0][2].toLongLong(), backups[1].size + backups[2].size);
+        QVERIFY(!QFile::exists(backups[1].archivePath));
+        QVERIFY(!QFile::exists(backups[2].archivePath + ".json"));
+
+        QList<BackupInfo> remaining = m_mgr->getBackupsForGame("prune-game");
+        QCOMPARE(remaining.size(), 2);
+        QCOMPARE(remaining[0].id, backups[0].id);
+        QCOMPARE(remaining[1].id, pinned.id);
+        QVERIFY(remaining[1].pinned);
+
+        // Nothing left to prune
+        QCOMPARE(m_mgr->pruneBackupsAsync("prune-game", policy), quint64(0));
+    }
+
+    void pruneBackupsAsync_rebasesDeltaChain()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("delta");
+        GameInfo game = makeGame("prune-delta", "Prune Delta");
+
+        QByteArray world(512 * 1024, 'w');
+        for (int i = 0; i < 3; ++i) {
+            world.replace(i * 1000, 4, QByteArray::number(1000 + i));
+            writeWorld(world);
+            QVERIFY(m_mgr->createBackup(game, QString("Backup %1").arg(i)));
+            QThread::msleep(5);
+        }
+
+        RetentionPolicy policy;
+        policy.enabled = true;
+        policy.keepLast = 1;
+        policy.hourly = 0;
+        policy.daily = 0;
+        policy.weekly = 0;
+
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QVERIFY(m_mgr->pruneBackupsAsync("prune-delta", policy) != 0);
+        QVERIFY(finishedSpy.wait(30000));
+
+        QList<BackupInfo> remaining = m_mgr->getBackupsForGame("prune-delta");
+        QCOMPARE(remaining.size(), 1);
+        QCOMPARE(remaining[0].size, QFileInfo(remaining[0].archivePath).size());
+        QVERIFY(m_mgr->verifyBackup(remaining[0]));
+        QCOMPARE(restoredWorld(remaining[0], "prune_restore"), world);
+    }
+
+    void pruneBackupsAsync_rebasesQueuedDelta()
+    {
+        createSaveFiles();
+        m_mgr->setBackupFormat("delta");
+        GameInfo game = makeGame("prune-queued", "Prune Queued");
+
+        QByteArray world(512 * 1024, 'w');
+        for (int i = 0; i < 2; ++i) {
+            world.replace(i * 1000, 4, QByteArray::number(1000 + i));
+            writeWorld(world);
+            QVERIFY(m_mgr->createBackup(game, QString("Backup %1").arg(i)));
+            QThread::msleep(5);
+        }
+
+        RetentionPolicy policy;
+        policy.enabled = true;
+        policy.keepLast = 1;
+        policy.hourly = 0;
+        policy.daily = 0;
+        policy.weekly = 0;
+
+        // The Manual backup runs first and is a delta on a backup the Bulk
+        // prune then deletes
+        world.replace(5000, 4, "edit");
+        writeWorld(world);
+        QSignalSpy finishedSpy(m_mgr, &SaveManager::operationFinished);
+        QVERIFY(m_mgr->createBackupAsync(game, "Queued") != 0);
+        QVERIFY(m_mgr->pruneBackupsAsync("prune-queued", policy) != 0);
+        QVERIFY(finishedSpy.wait(30000));
+
+        QList<BackupInfo> remaining = m_mgr->getBackupsForGame("prune-queued");
+        QCOMPARE(remaining.size(), 1);
+        QCOMPARE(remaining[0].displayName, QString("Queued"));
+        QVERIFY(m_mgr->verifyBackup(remaining[0]));
+        QCOMPARE(restoredWorld(remaining[0], "prune_queued_restore"), world);
+    }
+
+    void backupFormat_invalidIgnored()
+    {
+        m_mgr->setBackupFormat("rar");
+        QCOMPARE(m_mgr->backupFormat(), QString("tar.gz"));
+    }
+
     // --- Backup directory ---
 
     void backupDirectory_setAndGet()
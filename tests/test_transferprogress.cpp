@@ -0,0 +1,101 @@
+#include <QTest>
+#include <QThread>
+#include <QElapsedTimer>
+#include "core/transferprogress.h"
+
+class TestTransferProgress : public QObject {
+    Q_OBJECT
+
+private slots:
+    void addBytes_accumulatesCounters()
+    {
+        TransferProgress progress;
+        progress.setTotals(1000, 2);
+        QVERIFY(progress.addBytes(400));
+        progress.addFile();
+        QVERIFY(progress.addBytes(600));
+        progress.addFile();
+
+        TransferProgress::Stats stats = progress.stats();
+        QCOMPARE(stats.bytesDone, qint64(1000));
+        QCOMPARE(stats.bytesTotal, qint64(1000));
+        QCOMPARE(stats.filesDone, 2);
+        QCOMPARE(stats.filesTotal, 2);
+    }
+
+    void report_throttledToInterval()
+    {
+        QList<TransferProgress::Stats> reports;
+        TransferProgress progress(TransferProgress::CancelCheck(),
+            [&](const TransferProgress::Stats &stats) { reports.append(stats); }, 50);
+
+        // setTotals always reports; the burst after it is swallowed
+        progress.setTotals(100, 1);
+        for (int i = 0; i < 100; ++i)
+            progress.addBytes(1);
+        QCOMPARE(reports.size(), 1);
+
+        QThread::msleep(60);
+        progress.addBytes(0);
+        QCOMPARE(reports.size(), 2);
+
+        progress.finish();
+        QCOMPARE(reports.size(), 3);
+        QCOMPARE(reports.last().bytesDone, qint64(100));
+    }
+
+    void addBytes_returnsFalseOnceCancelled()
+    {
+        bool cancelled = false;
+        TransferProgress progress([&]() { return cancelled; });
+        QVERIFY(progress.addBytes(10));
+        QVERIFY(!progress.isCancelled());
+
+        cancelled = true;
+        QVERIFY(progress.isCancelled());
+        QVERIFY(!progress.addBytes(10));
+    }
+
+    void stats_computesThroughput()
+    {
+        TransferProgress progress;
+        progress.addBytes(1024 * 1024);
+        QThread::msleep(20);
+        TransferProgress::Stats stats = progress.stats();
+        QVERIFY(stats.elapsedMs >= 20);
+        QVERIFY(stats.bytesPerSecond > 0);
+        QVERIFY(stats.bytesPerSecond <= 1024 * 1024 * 1000 / 20);
+    }
+
+    void setBandwidthLimit_capsThroughput()
+    {
+        TransferProgress progress;
+        progress.setBandwidthLimit(1024 * 1024);
+        QElapsedTimer timer;
+        timer.start();
+        // A quarter second passes as burst, the rest at the limit
+        for (int i = 0; i < 16; ++i)
+            QVERIFY(progress.addBytes(64 * 1024));
+        QVERIFY(timer.elapsed() >= 650);
+        QVERIFY(timer.elapsed() < 5000);
+
+        progress.setBandwidthLimit(0);
+        timer.restart();
+        QVERIFY(progress.addBytes(100 * 1024 * 1024));
+        QVERIFY(timer.elapsed() < 100);
+    }
+
+    void setBandwidthLimit_cancelStopsWaiting()
+    {
+        QElapsedTimer timer;
+        TransferProgress progress([&timer]() { return timer.elapsed() >= 100; });
+        progress.setBandwidthLimit(1024);
+        timer.start();
+        // Would wait about 17 minutes at 1 KiB/s
+        QVERIFY(!progress.addBytes(1024 * 1024));
+        QVERIFY(timer.elapsed() < 1000);
+    }
+};
+
+QTEST_MAIN(TestTransferProgress)
+#include "test_transferprogress.moc"
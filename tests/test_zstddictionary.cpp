@@ -0,0 +1,107 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+#include "core/zstddictionary.h"
+
+class TestZstdDictionary : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    // Save slots of one game: the same keys and layout, different values
+    static QByteArray saveSlot(quint32 seed)
+    {
+        QRandomGenerator rng(seed);
+        QByteArray slot = "{\"version\":3,\"player\":{\"name\":\"Hero\",\"inventory\":[";
+        int items = 20 + rng.bounded(40);
+        for (int i = 0; i < items; ++i) {
+            slot += QString("{\"item\":\"%1\",\"count\":%2,\"durability\":%3,\"enchanted\":%4},")
+                        .arg(QStringList{"sword", "potion", "arrow", "shield", "torch"}.at(rng.bounded(5)))
+                        .arg(rng.bounded(64)).arg(rng.bounded(1000))
+                        .arg(rng.bounded(2) ? "true" : "false").toUtf8();
+        }
+        slot += QString("]},\"world\":{\"seed\":%1,\"day\":%2}}").arg(rng.generate()).arg(rng.bounded(500)).toUtf8();
+        return slot;
+    }
+
+    static QList<QByteArray> saveSlots(int count, quint32 firstSeed)
+    {
+        QList<QByteArray> result;
+        for (int i = 0; i < count; ++i)
+            result.append(saveSlot(firstSeed + i));
+        return result;
+    }
+
+private slots:
+    void train_compressesUnseenSlotsBetter()
+    {
+        QString error;
+        ZstdDictionary dictionary = ZstdDictionary::train(saveSlots(200, 1), 16 * 1024, &error);
+        QVERIFY2(!dictionary.isNull(), qPrintable(error));
+        QVERIFY(dictionary.id() != 0);
+        QVERIFY(dictionary.data().size() <= 16 * 1024);
+
+        QByteArray slot = saveSlot(5000);
+        QByteArray frame = dictionary.compress(slot.constData(), slot.size(), 3);
+        QVERIFY(!frame.isEmpty());
+        QCOMPARE(ZstdDictionary::frameDictionaryId(frame.constData(), frame.size()), dictionary.id());
+        // A single small slot gives zlib little context to work with
+        QVERIFY(frame.size() < qCompress(slot, 9).size());
+
+        bool ok = false;
+        QCOMPARE(dictionary.decompress(frame.constData(), frame.size(), slot.size(), &ok), slot);
+        QVERIFY(ok);
+    }
+
+    void train_tooFewSamplesFails()
+    {
+        QString error;
+        QVERIFY(ZstdDictionary::train(saveSlots(ZstdDictionary::MinSamples - 1, 1), 16 * 1024, &error).isNull());
+        QVERIFY(!error.isEmpty());
+        // Oversized files are not counted as samples
+        QList<QByteArray> samples = saveSlots(ZstdDictionary::MinSamples - 1, 1);
+        samples.append(QByteArray(ZstdDictionary::MaxSampleSize + 1, 'x'));
+        QVERIFY(ZstdDictionary::train(samples).isNull());
+    }
+
+    void saveAndLoad_keepId()
+    {
+        ZstdDictionary dictionary = ZstdDictionary::train(saveSlots(100, 1), 8 * 1024);
+        QVERIFY(!dictionary.isNull());
+        QString file = m_tmpDir.path() + "/game.dict";
+        QVERIFY(dictionary.save(file));
+
+        ZstdDictionary loaded = ZstdDictionary::load(file);
+        QVERIFY(!loaded.isNull());
+        QCOMPARE(loaded.id(), dictionary.id());
+        QCOMPARE(loaded.data(), dictionary.data());
+
+        // Frames from one copy decode with the other
+        QByteArray slot = saveSlot(77);
+        QByteArray frame = dictionary.compress(slot.constData(), slot.size(), 5);
+        QCOMPARE(loaded.decompress(frame.constData(), frame.size(), slot.size()), slot);
+
+        QVERIFY(ZstdDictionary::load(m_tmpDir.path() + "/missing.dict").isNull());
+        QVERIFY(ZstdDictionary::fromData("not a dictionary").isNull());
+    }
+
+    void decompress_rejectsOversizedAndCorruptFrames()
+    {
+        ZstdDictionary dictionary = ZstdDictionary::train(saveSlots(100, 1), 8 * 1024);
+        QVERIFY(!dictionary.isNull());
+        QByteArray slot = saveSlot(9);
+        QByteArray frame = dictionary.compress(slot.constData(), slot.size(), 3);
+
+        bool ok = true;
+        QVERIFY(dictionary.decompress(frame.constData(), frame.size(), slot.size() - 1, &ok).isEmpty());
+        QVERIFY(!ok);
+
+        QByteArray truncated = frame.left(frame.size() / 2);
+        QVERIFY(dictionary.decompress(truncated.constData(), truncated.size(), slot.size(), &ok).isEmpty());
+        QVERIFY(!ok);
+    }
+};
+
+QTEST_MAIN(TestZstdDictionary)
+#include "test_zstddictionary.moc"